@@ -59,6 +59,8 @@ void XmlToolsConfig::Read(std::wstring _configPath) {
 	ReadInt(L"annotationHighlightStyle", xmltoolsoptions.annotationHighlightStyle);
 	ReadInt(L"maxErrorsNum", xmltoolsoptions.maxErrorsNum);
 	ReadInt(L"maxIndentLevel", xmltoolsoptions.maxIndentLevel);
+	ReadInt(L"memoryBudgetMB", xmltoolsoptions.memoryBudgetMB);
+	ReadInt(L"documentCacheMB", xmltoolsoptions.documentCacheMB);
 	ReadBool(L"xpathOnStatusbar", xmltoolsoptions.xpathOnStatusbar);
 	ReadBool(L"dumpAttributeName", xmltoolsoptions.dumpAttributeName);
 	ReadBool(L"printXPathIndex", xmltoolsoptions.printXPathIndex);
@@ -138,6 +140,8 @@ void XmlToolsConfig::Write() {
 	WriteInt(L"annotationStyle", xmltoolsoptions.annotationStyle);
 	WriteInt(L"annotationHighlightStyle", xmltoolsoptions.annotationHighlightStyle);
 	WriteInt(L"maxIndentLevel", xmltoolsoptions.maxIndentLevel);
+	WriteInt(L"memoryBudgetMB", xmltoolsoptions.memoryBudgetMB);
+	WriteInt(L"documentCacheMB", xmltoolsoptions.documentCacheMB);
 	WriteInt(L"maxErrorsNum", xmltoolsoptions.maxErrorsNum);
 	WriteBool(L"xpathOnStatusbar", xmltoolsoptions.xpathOnStatusbar);
 	WriteBool(L"dumpAttributeName", xmltoolsoptions.dumpAttributeName);
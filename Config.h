@@ -39,12 +39,14 @@ struct struct_msxmloptions {                // default value
 };
 
 struct struct_xmltoolsoptions {
-	std::wstring formatingEngine = L"QuickXml";
+	std::wstring formatingEngine = L"Auto";
 	std::wstring errorDisplayMode = L"Annotation";	// Annotation / Dialog / Alert
 	int annotationStyle = 12;                // 12
 	int annotationHighlightStyle = 13;
 	int maxErrorsNum = 10;
 	int maxIndentLevel = 0;
+	int memoryBudgetMB = 0;                 // peak memory of a formatting command per document, 0: no limit
+	int documentCacheMB = 64;               // parsed documents kept for XPath, validation and XSLT, 0: none
 
 	bool xpathOnStatusbar = true;
 	bool dumpAttributeName = false;
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+* A command on editor documents, split in phases so that several documents can be processed at once:
+* - collect: reads what the command needs from the document (editor thread);
+* - process: does the work on the collected data only (any thread);
+* - apply: writes the result back into the document (editor thread).
+* Doc is ScintillaDoc in the plugin, or an in-memory stand-in with the same interface in the tests.
+*/
+template <class Doc>
+class DocumentAction {
+public:
+    struct Task {
+        virtual ~Task() {}
+
+        double milliseconds = 0;    // time spent in process() (or run())
+        std::string log;            // what was done, for the debug output
+    };
+
+    virtual ~DocumentAction() {}
+
+    // nullptr skips the document
+    virtual std::unique_ptr<Task> collect(Doc& doc) = 0;
+    virtual void process(Task& task) = 0;
+    virtual void apply(Doc& doc, Task& task) = 0;
+
+    // the three phases at once, on the editor thread; used when documents are processed one by one
+    virtual std::unique_ptr<Task> run(Doc& doc) {
+        std::unique_ptr<Task> task = collect(doc);
+        if (task) {
+            auto start = std::chrono::steady_clock::now();
+            process(*task);
+            task->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            apply(doc, *task);
+        }
+        return task;
+    }
+};
+
+/*
+* Gives access to the documents an action runs on: calls fn with document index, made current,
+* or does not call it when the document must be skipped (read only, ...).
+*/
+template <class Doc>
+using DocumentAccess = std::function<void(size_t index, const std::function<void(Doc&)>& fn)>;
+
+/*
+* Runs action on count documents. With more than one document and thread, the texts are collected
+* first, processed by a pool of threads, and applied in document order as the results come; the
+* documents are only touched from the calling thread. applied is called after each document.
+* A document whose processing throws is left as it is; the first exception is rethrown at the end.
+* When applying a result throws, the documents after it are left as they are, and the exception is
+* rethrown once the pool has stopped.
+*/
+template <class Doc>
+void runDocumentAction(DocumentAction<Doc>& action, size_t count, const DocumentAccess<Doc>& access, unsigned threads,
+        const std::function<void(size_t index, Doc& doc, const typename DocumentAction<Doc>::Task& task)>& applied = nullptr) {
+    typedef typename DocumentAction<Doc>::Task Task;
+
+    if (count < 2 || threads < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            access(i, [&](Doc& doc) {
+                std::unique_ptr<Task> task = action.run(doc);
+                if (task && applied)
+                    applied(i, doc, *task);
+            });
+        }
+        return;
+    }
+
+    struct Job {
+        std::unique_ptr<Task> task;
+        std::exception_ptr error;
+        bool done = false;
+    };
+    std::vector<Job> jobs(count);
+    for (size_t i = 0; i < count; ++i) {
+        access(i, [&](Doc& doc) { jobs[i].task = action.collect(doc); });
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            if (jobs[i].task) {
+                try {
+                    auto start = std::chrono::steady_clock::now();
+                    action.process(*jobs[i].task);
+                    jobs[i].task->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+                catch (...) {
+                    jobs[i].error = std::current_exception();
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs[i].done = true;
+            finished.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < std::min<size_t>(threads, count); ++t)
+        pool.emplace_back(worker);
+
+    std::exception_ptr error;
+    for (size_t i = 0; i < count; ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() { return jobs[i].done; });
+        }
+        if (jobs[i].error) {
+            if (!error)
+                error = jobs[i].error;
+            jobs[i].task.reset();
+        }
+        else if (jobs[i].task) {
+            try {
+                access(i, [&](Doc& doc) {
+                    action.apply(doc, *jobs[i].task);
+                    if (applied)
+                        applied(i, doc, *jobs[i].task);
+                });
+            }
+            catch (...) {
+                // the workers take no more documents; the pool must be joined before leaving
+                if (!error)
+                    error = std::current_exception();
+                next = count;
+                break;
+            }
+            // the texts of big documents are released as soon as they are applied
+            jobs[i].task.reset();
+        }
+    }
+    for (auto& thread : pool)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
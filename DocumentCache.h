@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DocumentQueries.h"
+#include "XmlDocument.h"
+#include "XmlIndex.h"
+
+/*
+* Parsed documents kept per editor buffer, so that the XPath evaluation, the validation and the
+* XSL transformation of the same buffer share one parse until the buffer is modified.
+* An entry is keyed by the Scintilla document of the buffer (SCI_GETDOCPOINTER), as SCN_MODIFIED
+* only tells which Scintilla window changed, and Notepad++ also edits a buffer through a hidden
+* one (Replace All in all opened documents). Every SCN_MODIFIED that inserts or deletes text bumps
+* the modification counter of the document of its window (modified()); the next get() of that
+* document parses it again. The Notepad++ buffer id is kept with it for NPPN_FILEBEFORECLOSE. The entries are evicted in least recently used order when their memory goes
+* over the capacity, except the most recent one: a document larger than the capacity is kept
+* alone, so that the queries on a huge buffer do not parse it again each time. A zero capacity
+* keeps nothing. A command keeps the document it got alive until it is done with it, even if
+* the entry is evicted or replaced in the meantime.
+* Each document comes with its indexes (see XmlIndex.h), built by the first XPath query which needs
+* them and reused by the next ones on the same version of the buffer. They are not counted in the
+* capacity, as they are built after the document is kept.
+* Doc is ScintillaDoc in the plugin, or an in-memory stand-in with the same interface in the tests.
+*/
+
+// a buffer as the commands read it: its text, the model built from it and what is derived from the model
+struct ParsedDocument {
+    std::string text;               // copy of the buffer: the model points into it, and MSXML loads it
+    QuickXml::Document document;
+    QuickXml::DocumentIndex index;  // of the document, the identity attributes of the options
+    ValidationHints hints;
+    bool stylesheet;                // see isStylesheet()
+
+    ParsedDocument(const char* data, size_t length, const std::vector<std::string>& identityAttributes = QuickXml::DocumentIndex::defaultIdentityAttributes())
+        : text(data, length), document(text.c_str(), text.length()), index(document, identityAttributes), hints(validationHints(document)), stylesheet(isStylesheet(document)) {}
+
+    ParsedDocument(const ParsedDocument&) = delete;
+    ParsedDocument& operator=(const ParsedDocument&) = delete;
+
+    size_t memoryUsage() const {
+        return sizeof(ParsedDocument) + text.capacity() + document.memoryUsage() + index.memoryUsage() + hints.rootName.capacity();
+    }
+};
+
+class DocumentCache {
+public:
+    typedef uintptr_t BufferId;
+    typedef uintptr_t DocumentId;   // Scintilla document, SCI_GETDOCPOINTER
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;          // parses, the first one of a buffer or after a modification
+        size_t evictions = 0;       // entries dropped to stay within the capacity
+        size_t entries = 0;
+        size_t bytes = 0;           // memory of the documents kept
+    };
+
+    static const size_t DefaultCapacity = 64 * 1024 * 1024;
+
+    explicit DocumentCache(size_t capacity = DefaultCapacity) : capacity(capacity) {}
+
+    // parsed document of the buffer, from the cache when it has not been modified since it was parsed
+    template <class Doc>
+    std::shared_ptr<const ParsedDocument> get(BufferId buffer, DocumentId document, Doc& doc) {
+        size_t length = (size_t)doc.GetTextLength();
+        uint64_t version;
+        std::vector<std::string> identityAttributes;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            Tracked& tracked = this->documents[document];
+            tracked.buffer = buffer;
+            version = tracked.version;
+            identityAttributes = this->identity;
+            auto found = this->index.find(document);
+            if (found != this->index.end()) {
+                // the length is checked too, in case a change came without its notification
+                if (found->second->version == version && found->second->length == length) {
+                    ++this->counters.hits;
+                    this->entries.splice(this->entries.begin(), this->entries, found->second);
+                    return found->second->parsed;
+                }
+                this->erase(found->second);
+            }
+            ++this->counters.misses;
+        }
+
+        typename Doc::sciTextView view = doc.GetCharacterPointer();
+        std::shared_ptr<const ParsedDocument> parsed = std::make_shared<const ParsedDocument>(view ? view.text : "", view ? (size_t)view.length : 0, identityAttributes);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto found = this->documents.find(document);
+        if (found != this->documents.end() && found->second.version == version && this->capacity > 0 && this->index.find(document) == this->index.end()) {
+            this->entries.push_front({ document, version, length, parsed->memoryUsage(), parsed });
+            this->index[document] = this->entries.begin();
+            this->bytes += this->entries.front().bytes;
+            this->evict();
+        }
+        return parsed;
+    }
+
+    // text of the document inserted or deleted (SCN_MODIFIED); only the documents get() has seen are tracked
+    void modified(DocumentId document) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto tracked = this->documents.find(document);
+        if (tracked == this->documents.end())
+            return;
+        ++tracked->second.version;
+        auto found = this->index.find(document);
+        if (found != this->index.end())
+            this->erase(found->second);
+    }
+
+    void closed(BufferId buffer) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto tracked = this->documents.begin(); tracked != this->documents.end();) {
+            if (tracked->second.buffer != buffer) {
+                ++tracked;
+                continue;
+            }
+            auto found = this->index.find(tracked->first);
+            if (found != this->index.end())
+                this->erase(found->second);
+            tracked = this->documents.erase(tracked);
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->entries.clear();
+        this->index.clear();
+        this->documents.clear();
+        this->bytes = 0;
+    }
+
+    // attributes whose values the indexes of the documents keep; the documents indexed with others are dropped
+    void setIdentityAttributes(const std::vector<std::string>& attributes) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (attributes == this->identity)
+            return;
+        this->identity = attributes;
+        this->entries.clear();
+        this->index.clear();
+        this->bytes = 0;
+    }
+
+    void setCapacity(size_t bytes) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->capacity = bytes;
+        this->evict();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        Stats stats = this->counters;
+        stats.entries = this->entries.size();
+        stats.bytes = this->bytes;
+        return stats;
+    }
+
+private:
+    struct Entry {
+        DocumentId document;
+        uint64_t version;           // modification counter of the document when it was parsed
+        size_t length;
+        size_t bytes;
+        std::shared_ptr<const ParsedDocument> parsed;
+    };
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    size_t bytes = 0;
+    std::list<Entry> entries;       // most recently used first
+    struct Tracked {
+        BufferId buffer = 0;
+        uint64_t version = 0;       // modification counter
+    };
+
+    std::unordered_map<DocumentId, std::list<Entry>::iterator> index;
+    std::unordered_map<DocumentId, Tracked> documents;
+    std::vector<std::string> identity = QuickXml::DocumentIndex::defaultIdentityAttributes();
+    Stats counters;
+
+    void erase(std::list<Entry>::iterator entry) {
+        this->bytes -= entry->bytes;
+        this->index.erase(entry->document);
+        this->entries.erase(entry);
+    }
+
+    // down to the most recently used entry, which stays unless the cache is disabled
+    void evict() {
+        while (this->bytes > this->capacity && !this->entries.empty() && (this->capacity == 0 || this->entries.size() > 1)) {
+            this->erase(std::prev(this->entries.end()));
+            ++this->counters.evictions;
+        }
+    }
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DocumentAction.h"
+#include "FormatEngine.h"
+#include "TextDiff.h"
+
+/*
+* Replaces the selection (doc.inSelection) or the whole document by text, in one undo action, by
+* editing only the parts that differ (see FormatEngine::diffText): the editor keeps the styles,
+* folds and markers of the unchanged lines. Returns the number of edits.
+*/
+template <class Doc>
+size_t replaceWorkText(Doc& doc, const std::string& text, const FormatEngine::TextDiffParms& parms) {
+    typedef decltype(doc.GetTextLength()) Position;
+    typename Doc::sciTextView current = doc.inSelection
+        ? doc.GetRangePointer(doc.SelectionStart(), doc.SelectionEnd() - doc.SelectionStart())
+        : doc.GetCharacterPointer();
+    size_t base = doc.inSelection ? (size_t)current.selstart : 0;
+    // the view is only read before the first change
+    std::vector<FormatEngine::TextEdit> edits = FormatEngine::diffText(current.text, (size_t)current.length, text.data(), text.size(), parms);
+
+    if (!edits.empty()) {
+        doc.BeginUndoAction();
+        // from the end, so that the positions of the next edits do not move
+        for (auto edit = edits.rbegin(); edit != edits.rend(); ++edit) {
+            doc.ReplaceTarget((Position)(base + edit->start), (Position)edit->length, text.data() + edit->newStart, (Position)edit->newLength);
+        }
+        doc.EndUndoAction();
+    }
+    if (doc.inSelection) {
+        // the new text stays selected, the caret after it
+        doc.SetAnchor((Position)base);
+        doc.SetCurrentPosition((Position)(base + text.size()));
+    }
+    return edits.size();
+}
+
+/*
+* Formats the selection, or the whole document, with the engine named in the settings ("Auto"
+* picks one per document). run() lets the chunked engines read a whole document straight from
+* the editor, on the calling thread only; collect() copies the text, so that process() needs nothing from the editor.
+* The result is applied with replaceWorkText().
+* With options.memoryBudget, a document the engine would format over budget goes to the chunked
+* engine, or is refused with FormatEngine::MemoryBudgetError before its text is copied.
+*/
+template <class Doc>
+class FormatDocumentAction : public DocumentAction<Doc> {
+public:
+    typedef typename DocumentAction<Doc>::Task Task;
+
+    struct Settings {
+        FormatEngine::Operation operation = FormatEngine::Operation::PrettyPrint;
+        std::string engine = "Auto";
+        FormatEngine::Options options;      // eol and tab are taken from each document
+        FormatEngine::TextDiffParms diff;
+    };
+
+    struct FormatTask : public Task {
+        FormatEngine::Options options;
+        std::string text;
+        bool inSelection = false;
+        std::string refused;                // why the document is not formatted
+        SimpleXml::StringOutputSink output;
+    };
+
+    explicit FormatDocumentAction(const Settings& settings) : settings(settings) {}
+
+    std::unique_ptr<Task> collect(Doc& doc) override {
+        std::unique_ptr<FormatTask> task = prepare(doc);
+        // refused from process(), so that the other documents are still formatted
+        try {
+            bool selection = doc.SelectionEnd() > doc.SelectionStart();
+            FormatEngine::Input size((size_t)(selection ? doc.SelectionEnd() - doc.SelectionStart() : doc.GetTextLength()), nullptr);
+            select(size, task->options);
+        }
+        catch (const FormatEngine::MemoryBudgetError& e) {
+            task->refused = e.what();
+            return task;
+        }
+        typename Doc::sciWorkText inText = doc.GetWorkText();
+        if (inText.text == NULL)
+            return nullptr;
+        task->inSelection = doc.inSelection;
+        task->text.assign(inText.text, (size_t)inText.length);
+        inText.FreeMemory();
+        // several documents at once already keep the cores busy
+        task->options.allowThreads = false;
+        return task;
+    }
+
+    void process(Task& task) override {
+        FormatTask& formatTask = static_cast<FormatTask&>(task);
+        if (!formatTask.refused.empty())
+            throw FormatEngine::MemoryBudgetError(formatTask.refused);
+        FormatEngine::Input input(formatTask.text.c_str(), formatTask.text.size());
+        format(formatTask, input);
+        std::string().swap(formatTask.text);
+    }
+
+    void apply(Doc& doc, Task& task) override {
+        FormatTask& formatTask = static_cast<FormatTask&>(task);
+        doc.inSelection = formatTask.inSelection;
+        size_t edits = replaceWorkText(doc, formatTask.output.str(), settings.diff);
+        formatTask.log += ", " + std::to_string(edits) + " edits";
+        std::string().swap(formatTask.output.str());
+        doc.SetScrollWidth(80); // 80 is arbitrary
+    }
+
+    std::unique_ptr<Task> run(Doc& doc) override {
+        std::unique_ptr<FormatTask> task = prepare(doc);
+        auto start = std::chrono::steady_clock::now();
+
+        // a selection is formatted in place, a whole document is read in chunks by the engines that can
+        if (doc.SelectionEnd() > doc.SelectionStart()) {
+            typename Doc::sciTextView inText = doc.GetWorkTextView();
+            if (!inText)
+                return nullptr;
+            FormatEngine::Input input(inText.text, (size_t)inText.length);
+            format(*task, input);
+            task->inSelection = true;
+        }
+        else {
+            // the reader sends messages to the editor, which only answers them on this thread:
+            // a pipelined engine would call it from its lexer thread while this one waits
+            task->options.allowThreads = false;
+            typedef decltype(doc.GetTextLength()) Position;
+            FormatEngine::Input input((size_t)doc.GetTextLength(), [&doc](size_t offset, char* target, size_t length) {
+                return (size_t)doc.GetText((Position)offset, target, (Position)length);
+            });
+            format(*task, input);
+        }
+
+        task->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        apply(doc, *task);
+        return task;
+    }
+
+private:
+    Settings settings;
+
+    std::unique_ptr<FormatTask> prepare(Doc& doc) {
+        std::unique_ptr<FormatTask> task(new FormatTask);
+        task->options = settings.options;
+        task->options.eol = doc.EOL();
+        task->options.tab = doc.Tab();
+        return task;
+    }
+
+    // the engine for input, and why it was chosen; throws FormatEngine::MemoryBudgetError
+    FormatEngine::Selection select(const FormatEngine::Input& input, const FormatEngine::Options& options) const {
+        FormatEngine::Selection selection{ &FormatEngine::engineByName(settings.engine), std::string() };
+        // the shared Auto engine keeps its last selection, so it only selects here
+        if (selection.engine == &FormatEngine::autoEngine()) {
+            selection = FormatEngine::autoEngine().select(settings.operation, input, options);
+            selection.reason = "auto: " + selection.reason;
+        }
+        FormatEngine::Selection budget = FormatEngine::withinMemoryBudget(*selection.engine, settings.operation, input, options);
+        if (budget.engine != selection.engine) {
+            selection.engine = budget.engine;
+            selection.reason += (selection.reason.empty() ? "" : "; ") + budget.reason;
+        }
+        return selection;
+    }
+
+    void format(FormatTask& task, FormatEngine::Input& input) {
+        FormatEngine::Selection selection = select(input, task.options);
+        // a streamed output grows by doubling, which needs three times its size at the last step:
+        // room for about the size of the input avoids most of it (other engines hand their text over)
+        if (selection.engine->can(FormatEngine::StreamingOutput))
+            task.output.reserve(input.length() + (settings.operation == FormatEngine::Operation::Linearize ? 0 : input.length() / 8));
+        selection.engine->format(settings.operation, input, task.options, task.output);
+        task.log = std::string(FormatEngine::operationName(settings.operation)) + " with " + selection.engine->name();
+        if (!selection.reason.empty())
+            task.log += " (" + selection.reason + ")";
+    }
+};
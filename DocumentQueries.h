@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include "XmlDocument.h"
+#include "XmlFormater.h"
+#include "XmlParser.h"
+
+/*
+* Commands which only read a document. They parse the text where the editor keeps it, through
+* Doc::GetCharacterPointer() or Doc::GetWorkTextView(), rather than a copy: the QuickXml parser
+* stays within the given length, so a selection needs no terminator either. The views are only
+* valid while the document is not modified, so nothing here writes to the document.
+* Doc is ScintillaDoc in the plugin, or an in-memory stand-in with the same interface in the tests.
+*/
+
+// path of the node at pos (see XmlFormater::currentPath()), in the whole document
+template <class Doc>
+std::string documentCurrentPath(Doc& doc, size_t pos, int xpathMode, const QuickXml::XmlFormaterParamsType& params) {
+    typename Doc::sciTextView view = doc.GetCharacterPointer();
+    if (!view)
+        return "";
+    QuickXml::XmlFormater formater(view.text, (size_t)view.length, params);
+    return formater.currentPath(pos, xpathMode)->str();
+}
+
+// QuickXml tokens of the selection, or of the whole document
+template <class Doc>
+std::string documentTokens(Doc& doc, const std::string& separator, const QuickXml::XmlFormaterParamsType& params) {
+    typename Doc::sciTextView view = doc.GetWorkTextView();
+    if (!view)
+        return "";
+    QuickXml::XmlFormater formater(view.text, (size_t)view.length, params);
+    return formater.debugTokens(separator, true);
+}
+
+// looks for a <!DOCTYPE declaration, with an internal subset or not, before the root element
+inline bool hasDoctype(const char* text, size_t length) {
+    const QuickXml::XmlTokensType declaration = QuickXml::XmlTokenType::DeclarationBeg | QuickXml::XmlTokenType::DeclarationSelfClosing;
+    QuickXml::XmlParser parser(text, length);
+    QuickXml::XmlToken token = QuickXml::undefinedToken;
+    do {
+        token = parser.parseUntil(declaration | QuickXml::XmlTokenType::TagOpening);
+        if ((token.type & declaration) && token.size >= 9 && !strncmp(token.chars, "<!DOCTYPE", 9)) {
+            return true;
+        }
+    } while (token.type != QuickXml::XmlTokenType::EndOfFile && token.type != QuickXml::XmlTokenType::TagOpening);
+    return false;
+}
+
+// what the validation needs to know of a document before choosing how to validate it
+struct ValidationHints {
+    std::string rootName;           // qualified name of the root element, empty when there is none
+    bool schemaLocation = false;    // the root element has xsi:noNamespaceSchemaLocation or xsi:schemaLocation
+    bool doctype = false;           // a <!DOCTYPE declaration comes before the root element
+};
+
+inline ValidationHints validationHints(const QuickXml::Document& document) {
+    const char* xsi = "http://www.w3.org/2001/XMLSchema-instance";
+    ValidationHints hints;
+    QuickXml::NodeId root = document.documentElement();
+    if (root != QuickXml::NoNode) {
+        hints.rootName = std::string(document.name(root));
+        hints.schemaLocation = document.findAttribute(root, xsi, "noNamespaceSchemaLocation") != QuickXml::NoAttr ||
+                               document.findAttribute(root, xsi, "schemaLocation") != QuickXml::NoAttr;
+    }
+    hints.doctype = !document.doctype().empty();
+    return hints;
+}
+
+inline ValidationHints validationHints(const char* text, size_t length) {
+    QuickXml::Document document(text, length);
+    return validationHints(document);
+}
+
+// the root element is an XSLT stylesheet (xsl:stylesheet or xsl:transform, whatever the prefix)
+inline bool isStylesheet(const QuickXml::Document& document) {
+    QuickXml::NodeId root = document.documentElement();
+    if (root == QuickXml::NoNode || document.namespaceUri(root) != "http://www.w3.org/1999/XSL/Transform")
+        return false;
+    std::string_view local = QuickXml::Document::localNameOf(document.name(root));
+    return local == "stylesheet" || local == "transform";
+}
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "FormatEngine.h"
+
+#include "PrettyPrinter.h"
+#include "StringXml.h"
+#include "XmlFormater.h"
+
+namespace FormatEngine {
+    const char* operationName(Operation op) {
+        switch (op) {
+            case Operation::PrettyPrint: return "pretty print";
+            case Operation::PrettyPrintAttr: return "pretty print with attributes";
+            case Operation::IndentOnly: return "indent only";
+            case Operation::Linearize: return "linearize";
+        }
+        return "";
+    }
+
+    const char* Input::data() {
+        if (text == nullptr) {
+            // one byte more for the terminator the reader may add
+            loaded.resize(size + 1);
+            size_t done = 0;
+            while (done < size) {
+                size_t len = reader(done, &loaded[done], size - done);
+                if (len == 0)
+                    break;
+                done += len;
+            }
+            loaded.resize(done);
+            size = done;
+            text = loaded.c_str();
+        }
+        return text;
+    }
+
+    ChunkReader Input::chunkReader() {
+        if (text == nullptr)
+            return reader;
+        const char* data = text;
+        size_t length = size;
+        return [data, length](size_t offset, char* target, size_t len) -> size_t {
+            if (offset >= length)
+                return 0;
+            len = std::min(len, length - offset);
+            memcpy(target, data + offset, len);
+            return len;
+        };
+    }
+
+    //-------------------------------------------------------------------------------------------//
+
+    namespace {
+        // chunked reader, fast and low on memory; the only engine streaming its output
+        class SimpleXmlEngine : public Engine {
+        public:
+            const char* name() const override { return "SimpleXml"; }
+
+            unsigned capabilities() const override {
+                return ChunkedInput | IndentOnly | StreamingOutput | Parallel;
+            }
+
+            // output text and its growth, the input when it is in memory
+            double memoryFactor() const override { return 2.5; }
+
+            // plus the chunk buffers being read and lexed
+            size_t estimatedPeak(size_t inputLength) const override {
+                return Engine::estimatedPeak(inputLength) + 4 * chunkSize;
+            }
+
+            // the lexer runs ahead on a second thread
+            bool usesThreads(size_t inputLength, const Options& options) const override {
+                return options.allowThreads && inputLength >= options.parallelDocumentSize && std::thread::hardware_concurrency() > 1;
+            }
+
+            void format(Operation op, Input& input, const Options& options, SimpleXml::OutputSink& out) override {
+                SimpleXml::PrettyPrintParms parms;
+                parms.eol = options.eol;
+                parms.tab = options.tab;
+                parms.insertIndents = true;
+                parms.insertNewLines = true;
+                parms.removeWhitespace = true;
+                parms.autocloseEmptyElements = options.autoclose;
+                if (options.maxIndentLevel > 0) {
+                    parms.maxElementDepth = (int)options.maxIndentLevel;
+                }
+                parms.keepExistingBreaks = (op == Operation::IndentOnly);
+                parms.indentAttributes = (op == Operation::PrettyPrintAttr);
+                parms.pipelined = usesThreads(input.length(), options);
+                if (op == Operation::Linearize) {
+                    parms.eol = "";
+                    parms.tab = "";
+                    parms.insertIndents = false;
+                    parms.insertNewLines = false;
+                }
+
+                ChunkReader reader = input.chunkReader();
+                std::function<size_t(size_t, char*, size_t)> chunker = reader;
+                SimpleXml::ChunkedStream stream(chunkSize, chunker);
+                SimpleXml::PrettyPrinter prettyPrinter(stream, parms, out);
+                prettyPrinter.Convert();
+            }
+
+        private:
+            // a few of them are alive at once; bigger chunks do not read faster
+            static const size_t chunkSize = 256 * 1024;
+        };
+
+        // conformity oriented engine working on the whole text
+        class QuickXmlEngine : public Engine {
+        public:
+            const char* name() const override { return "QuickXml"; }
+
+            unsigned capabilities() const override {
+                return SpacePreserve | IndentOnly;
+            }
+
+            // input text, output stream and its growth, output copy
+            double memoryFactor() const override { return 4.25; }
+
+            void format(Operation op, Input& input, const Options& options, SimpleXml::OutputSink& out) override {
+                QuickXml::XmlFormaterParamsType params;
+                params.indentChars = options.tab;
+                params.eolChars = options.eol;
+                params.maxIndentLevel = options.maxIndentLevel;
+                params.ensureConformity = options.ensureConformity;
+                params.autoCloseTags = options.autoclose;
+                params.indentAttributes = (op == Operation::PrettyPrintAttr || op == Operation::IndentOnly);
+                params.indentOnly = (op == Operation::IndentOnly);
+                params.applySpacePreserve = options.applySpacePreserve;
+
+                QuickXml::XmlFormater formater(input.data(), input.length(), params);
+                std::stringstream* outText = (op == Operation::Linearize) ? formater.linearize() : formater.prettyPrint();
+                // read back in pieces: str() would be one more copy of the whole output
+                SimpleXml::StringOutputSink* sink = dynamic_cast<SimpleXml::StringOutputSink*>(&out);
+                if (sink)
+                    sink->reserve(sink->str().size() + (size_t)outText->tellp());
+                std::vector<char> chunk(64 * 1024);
+                std::streamsize len;
+                while ((len = outText->rdbuf()->sgetn(chunk.data(), (std::streamsize)chunk.size())) > 0)
+                    out.write(chunk.data(), (size_t)len);
+            }
+        };
+
+        // string processing engine, permissive on invalid xml
+        class StringXmlEngine : public Engine {
+        public:
+            const char* name() const override { return "StringXml"; }
+
+            unsigned capabilities() const override {
+                return IndentOnly;
+            }
+
+            // input text, edited copy and its output part
+            double memoryFactor() const override { return 4.0; }
+
+            void format(Operation op, Input& input, const Options& options, SimpleXml::OutputSink& out) override {
+                StringXml::XmlFormaterParamsType params;
+                params.indentChars = options.tab;
+                params.eolChars = options.eol;
+                params.autoCloseTags = options.autoclose;
+
+                std::string str(input.data(), input.length());
+                StringXml::XmlFormater formater(&str, params);
+                switch (op) {
+                    case Operation::PrettyPrint: formater.prettyPrint(); break;
+                    case Operation::PrettyPrintAttr: formater.prettyPrintAttr(); break;
+                    case Operation::IndentOnly: formater.prettyPrintIndent(); break;
+                    case Operation::Linearize: formater.linearize(); break;
+                }
+                // an empty string sink takes the text over instead of copying it
+                SimpleXml::StringOutputSink* sink = dynamic_cast<SimpleXml::StringOutputSink*>(&out);
+                if (sink && sink->str().empty())
+                    sink->str().swap(str);
+                else
+                    out.write(str);
+            }
+        };
+
+        std::string megabytes(size_t bytes) {
+            std::ostringstream s;
+            s.precision(3);
+            s << bytes / (1024.0 * 1024.0) << " MB";
+            return s.str();
+        }
+    }
+
+    Engine& simpleXmlEngine() {
+        static SimpleXmlEngine engine;
+        return engine;
+    }
+
+    Engine& quickXmlEngine() {
+        static QuickXmlEngine engine;
+        return engine;
+    }
+
+    Engine& stringXmlEngine() {
+        static StringXmlEngine engine;
+        return engine;
+    }
+
+    unsigned requiredCapabilities(Operation op, const Options& options) {
+        unsigned required = 0;
+        if (op == Operation::IndentOnly)
+            required |= IndentOnly;
+        if (options.applySpacePreserve && op != Operation::Linearize)
+            required |= SpacePreserve;
+        return required;
+    }
+
+    size_t availableMemory() {
+#ifdef _WIN32
+        MEMORYSTATUSEX status;
+        status.dwLength = sizeof(status);
+        if (GlobalMemoryStatusEx(&status))
+            return (size_t)std::min<DWORDLONG>(status.ullAvailPhys, (DWORDLONG)SIZE_MAX);
+        return 0;
+#else
+        long pages = sysconf(_SC_AVPHYS_PAGES);
+        long pageSize = sysconf(_SC_PAGESIZE);
+        if (pages <= 0 || pageSize <= 0)
+            return 0;
+        return (size_t)pages * (size_t)pageSize;
+#endif
+    }
+
+    Selection withinMemoryBudget(Engine& engine, Operation op, const Input& input, const Options& options) {
+        size_t size = input.length();
+        if (options.memoryBudget == 0 || engine.estimatedPeak(size) <= options.memoryBudget)
+            return { &engine, std::string() };
+
+        std::string reason = std::string(engine.name()) + " would need about " + megabytes(engine.estimatedPeak(size)) +
+                             ", over the memory budget of " + megabytes(options.memoryBudget);
+        Engine& chunked = simpleXmlEngine();
+        if (&engine == &chunked || chunked.estimatedPeak(size) > options.memoryBudget)
+            throw MemoryBudgetError(megabytes(size) + " document not formatted: " + reason);
+        if (!chunked.can(requiredCapabilities(op, options)))
+            reason += ", xml:space is not applied";
+        return { &chunked, reason };
+    }
+
+    //-------------------------------------------------------------------------------------------//
+
+    unsigned AutoEngine::capabilities() const {
+        return simpleXmlEngine().capabilities() | quickXmlEngine().capabilities();
+    }
+
+    double AutoEngine::memoryFactor() const {
+        return quickXmlEngine().memoryFactor();
+    }
+
+    Selection AutoEngine::select(Operation op, const Input& input, const Options& options) const {
+        size_t size = input.length();
+        size_t memory = parms.memory ? parms.memory : availableMemory();
+        unsigned required = requiredCapabilities(op, options);
+
+        Engine& inMemory = quickXmlEngine();
+        Engine& chunked = simpleXmlEngine();
+
+        // half of the free memory is left to the editor, which keeps its own copy of the text
+        bool fits = (memory == 0 || size * inMemory.memoryFactor() < memory / 2.0) &&
+                    (options.memoryBudget == 0 || inMemory.estimatedPeak(size) <= options.memoryBudget);
+        bool huge = size >= parms.hugeDocumentSize;
+
+        if (fits && (!huge || !chunked.can(required))) {
+            std::string reason = megabytes(size) + " document";
+            if (huge)
+                reason += ", kept in memory for xml:space handling";
+            return { &inMemory, reason };
+        }
+
+        std::string reason = megabytes(size) + " document, ";
+        if (fits)
+            reason += "huge";
+        else if (options.memoryBudget && inMemory.estimatedPeak(size) > options.memoryBudget)
+            reason += "over the memory budget of " + megabytes(options.memoryBudget) + " in one piece";
+        else
+            reason += "does not fit in " + megabytes(memory) + " in one piece";
+        if (!chunked.can(required))
+            reason += ", xml:space is not applied";
+        if (chunked.usesThreads(size, options))
+            reason += ", pipelined";
+        return { &chunked, reason };
+    }
+
+    void AutoEngine::format(Operation op, Input& input, const Options& options, SimpleXml::OutputSink& out) {
+        selection = select(op, input, options);
+        withinMemoryBudget(*selection.engine, op, input, options);
+        selection.engine->format(op, input, options, out);
+    }
+
+    AutoEngine& autoEngine() {
+        static AutoEngine engine;
+        return engine;
+    }
+
+    Engine& engineByName(const std::string& name) {
+        std::string lower(name);
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (lower == "simplexml")
+            return simpleXmlEngine();
+        if (lower == "quickxml")
+            return quickXmlEngine();
+        if (lower == "stringxml")
+            return stringXmlEngine();
+        return autoEngine();
+    }
+}
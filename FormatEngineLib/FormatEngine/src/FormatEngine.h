@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "OutputSink.h"
+
+/*
+* One interface over the three formatting engines (SimpleXml, QuickXml, StringXml), so that the
+* commands do not depend on a particular engine, plus an "Auto" engine choosing one per document.
+*/
+namespace FormatEngine {
+    enum class Operation { PrettyPrint, PrettyPrintAttr, IndentOnly, Linearize };
+
+    const char* operationName(Operation op);
+
+    // what an engine can do, beyond the four operations all of them support
+    enum Capability : unsigned {
+        ChunkedInput = 1 << 0,      // reads the input in chunks, the text is never needed in one piece
+        SpacePreserve = 1 << 1,     // applies xml:space="preserve"
+        IndentOnly = 1 << 2,        // keeps the existing line breaks and only fixes the indentation
+        StreamingOutput = 1 << 3,   // writes the output while formatting, not at the end
+        Parallel = 1 << 4           // can use a second thread for one document
+    };
+
+    // reads up to length bytes at offset into target, returns the count; one more byte may be
+    // written after them (Scintilla terminates the text ranges it returns)
+    typedef std::function<size_t(size_t offset, char* target, size_t length)> ChunkReader;
+
+    // the text to format: either already in memory, or read on demand through a ChunkReader
+    class Input {
+        const char* text = nullptr;
+        size_t size = 0;
+        ChunkReader reader;
+        std::string loaded;
+    public:
+        // data needs no terminator: a range of a bigger buffer can be formatted in place
+        Input(const char* data, size_t length) : text(data), size(length) {}
+        Input(size_t length, ChunkReader reader) : size(length), reader(reader) {}
+
+        size_t length() const { return size; }
+        bool inMemory() const { return text != nullptr; }
+
+        // the whole text; chunked input is read completely on first use
+        const char* data();
+
+        // reader over the text, whatever its origin
+        ChunkReader chunkReader();
+    };
+
+    struct Options {
+        std::string eol = "\n";
+        std::string tab = "\t";
+        bool autoclose = false;             // <a></a> becomes <a/>
+        size_t maxIndentLevel = 255;        // 0: unlimited
+        bool ensureConformity = true;
+        bool applySpacePreserve = false;    // keep xml:space="preserve" content as it is
+        bool allowThreads = true;           // engines with the Parallel capability may use them
+        size_t parallelDocumentSize = 4 * 1024 * 1024;  // below that, a second thread does not pay off
+        size_t memoryBudget = 0;            // peak memory allowed for one document, 0: no limit
+    };
+
+    class Engine {
+    public:
+        virtual ~Engine() {}
+
+        virtual const char* name() const = 0;
+        virtual unsigned capabilities() const = 0;
+
+        // estimated peak memory per byte of input, input and output text included; used by the
+        // automatic selection (see the peak_x counters of XMLToolsBench for measured values)
+        virtual double memoryFactor() const = 0;
+
+        // estimated peak memory for a document, checked against Options::memoryBudget
+        virtual size_t estimatedPeak(size_t inputLength) const { return (size_t)(inputLength * memoryFactor()); }
+
+        // whether format() uses a second thread for a document of this length with these options
+        virtual bool usesThreads(size_t /*inputLength*/, const Options& /*options*/) const { return false; }
+
+        virtual void format(Operation op, Input& input, const Options& options, SimpleXml::OutputSink& out) = 0;
+
+        bool can(unsigned required) const { return (capabilities() & required) == required; }
+    };
+
+    Engine& simpleXmlEngine();
+    Engine& quickXmlEngine();
+    Engine& stringXmlEngine();
+
+    // capabilities an operation needs with these options
+    unsigned requiredCapabilities(Operation op, const Options& options);
+
+    // free physical memory in bytes, 0 when unknown
+    size_t availableMemory();
+
+    struct Selection {
+        Engine* engine;
+        std::string reason;
+    };
+
+    // thrown before formatting a document which no engine can format within Options::memoryBudget
+    class MemoryBudgetError : public std::runtime_error {
+    public:
+        explicit MemoryBudgetError(const std::string& message) : std::runtime_error(message) {}
+    };
+
+    /*
+    * The engine formatting input within options.memoryBudget: engine itself when its estimated
+    * peak fits, the chunked SimpleXml engine otherwise (the reason then tells why). Throws
+    * MemoryBudgetError when neither fits, so that nothing is allocated for a document that cannot
+    * be done.
+    */
+    Selection withinMemoryBudget(Engine& engine, Operation op, const Input& input, const Options& options);
+
+    /*
+    * Picks an engine per document:
+    * - documents of hugeDocumentSize and more, or whose copy in memory would not fit in the free
+    *   memory or the memory budget, go to the chunked SimpleXml engine, which uses a second thread
+    *   when it may;
+    * - the others go to QuickXml, which is the fastest engine on documents kept in memory.
+    * Features the command needs (xml:space handling) are honoured as long as the memory allows.
+    */
+    class AutoEngine : public Engine {
+    public:
+        struct Parms {
+            size_t hugeDocumentSize = 64 * 1024 * 1024;
+            size_t memory = 0;                              // available memory, 0: ask the system
+        } parms;
+
+        const char* name() const override { return "Auto"; }
+        unsigned capabilities() const override;
+        double memoryFactor() const override;
+
+        Selection select(Operation op, const Input& input, const Options& options) const;
+
+        void format(Operation op, Input& input, const Options& options, SimpleXml::OutputSink& out) override;
+
+        // the selection made by the last format() call
+        const Selection& lastSelection() const { return selection; }
+
+    private:
+        Selection selection{ nullptr, std::string() };
+    };
+
+    AutoEngine& autoEngine();
+
+    // "Auto", "SimpleXml", "QuickXml" or "StringXml" (case insensitive); unknown names give Auto
+    Engine& engineByName(const std::string& name);
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+
+#include "TextDiff.h"
+
+namespace FormatEngine {
+    namespace {
+        struct Line {
+            size_t start;
+            size_t length;
+        };
+
+        // lines of text[begin, end), with their line ending (\n, \r\n or \r)
+        std::vector<Line> splitLines(const char* text, size_t begin, size_t end) {
+            std::vector<Line> lines;
+            const char* pos = text + begin;
+            const char* last = text + end;
+            while (pos < last) {
+                const char* lf = static_cast<const char*>(memchr(pos, '\n', last - pos));
+                const char* next = lf ? lf + 1 : last;
+                // a \r alone ends a line too (old Mac files)
+                const char* cr = static_cast<const char*>(memchr(pos, '\r', next - pos));
+                if (cr && cr + 1 < next && cr[1] != '\n')
+                    next = cr + 1;
+                lines.push_back({ (size_t)(pos - text), (size_t)(next - pos) });
+                pos = next;
+            }
+            return lines;
+        }
+
+        bool sameLine(const char* oldText, const Line& a, const char* newText, const Line& b) {
+            return a.length == b.length && !memcmp(oldText + a.start, newText + b.start, a.length);
+        }
+
+        // lines [oldBegin, oldEnd) replaced by lines [newBegin, newEnd)
+        struct LineEdit {
+            size_t oldBegin, oldEnd;
+            size_t newBegin, newEnd;
+        };
+
+        /*
+        * Myers' O(ND) difference of two line sequences. Gives up (returns false) when more than
+        * maxEdits lines are inserted or removed, or when the comparisons exceed a budget
+        * proportional to the number of lines.
+        */
+        bool diffLines(const char* oldText, const std::vector<Line>& a, const char* newText, const std::vector<Line>& b,
+                       size_t maxEdits, std::vector<LineEdit>& edits) {
+            const ptrdiff_t n = (ptrdiff_t)a.size();
+            const ptrdiff_t m = (ptrdiff_t)b.size();
+            const ptrdiff_t max = (ptrdiff_t)std::min<size_t>(maxEdits, a.size() + b.size());
+            const ptrdiff_t offset = max + 1;
+            size_t budget = 16 * (a.size() + b.size()) + 65536;
+
+            // furthest x on each diagonal k = x - y; trace[d] keeps v[-d-1 .. d+1] as it was before step d
+            std::vector<ptrdiff_t> v(2 * max + 3, 0);
+            std::vector<std::vector<ptrdiff_t>> trace;
+            ptrdiff_t found = -1;
+            for (ptrdiff_t d = 0; d <= max && found < 0; ++d) {
+                trace.emplace_back(v.begin() + (offset - d - 1), v.begin() + (offset + d + 2));
+                for (ptrdiff_t k = -d; k <= d; k += 2) {
+                    ptrdiff_t x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+                    ptrdiff_t y = x - k;
+                    ptrdiff_t start = x;
+                    while (x < n && y < m && sameLine(oldText, a[x], newText, b[y])) {
+                        ++x;
+                        ++y;
+                    }
+                    budget -= std::min<size_t>(budget, 1 + (size_t)(x - start));
+                    v[offset + k] = x;
+                    if (x >= n && y >= m) {
+                        found = d;
+                        break;
+                    }
+                }
+                if (budget == 0 && found < 0)
+                    return false;
+            }
+            if (found < 0)
+                return false;
+
+            // back from (n, m): each step d is one inserted or removed line, after the common lines
+            std::vector<LineEdit> steps;
+            ptrdiff_t x = n, y = m;
+            for (ptrdiff_t d = found; d > 0; --d) {
+                const std::vector<ptrdiff_t>& prev = trace[d];
+                auto at = [&prev, d](ptrdiff_t k) { return prev[k + d + 1]; };
+                ptrdiff_t k = x - y;
+                bool down = (k == -d || (k != d && at(k - 1) < at(k + 1)));
+                ptrdiff_t prevK = down ? k + 1 : k - 1;
+                ptrdiff_t prevX = at(prevK);
+                ptrdiff_t prevY = prevX - prevK;
+                if (down)
+                    steps.push_back({ (size_t)prevX, (size_t)prevX, (size_t)prevY, (size_t)prevY + 1 });
+                else
+                    steps.push_back({ (size_t)prevX, (size_t)prevX + 1, (size_t)prevY, (size_t)prevY });
+                x = prevX;
+                y = prevY;
+            }
+
+            edits.clear();
+            for (auto step = steps.rbegin(); step != steps.rend(); ++step) {
+                if (!edits.empty() && edits.back().oldEnd == step->oldBegin && edits.back().newEnd == step->newBegin) {
+                    edits.back().oldEnd = step->oldEnd;
+                    edits.back().newEnd = step->newEnd;
+                }
+                else {
+                    edits.push_back(*step);
+                }
+            }
+            return true;
+        }
+
+        size_t commonPrefix(const char* a, const char* b, size_t length) {
+            size_t i = 0;
+            const size_t block = 64;
+            while (i + block <= length && !memcmp(a + i, b + i, block))
+                i += block;
+            while (i < length && a[i] == b[i])
+                ++i;
+            return i;
+        }
+
+        size_t commonSuffix(const char* a, size_t aLength, const char* b, size_t bLength, size_t length) {
+            size_t i = 0;
+            const size_t block = 64;
+            while (i + block <= length && !memcmp(a + aLength - i - block, b + bLength - i - block, block))
+                i += block;
+            while (i < length && a[aLength - i - 1] == b[bLength - i - 1])
+                ++i;
+            return i;
+        }
+
+        // the edit without its common start and end; false when nothing is left
+        bool trimEdit(const char* oldText, const char* newText, TextEdit& edit) {
+            size_t prefix = commonPrefix(oldText + edit.start, newText + edit.newStart, std::min(edit.length, edit.newLength));
+            edit.start += prefix;
+            edit.newStart += prefix;
+            edit.length -= prefix;
+            edit.newLength -= prefix;
+            size_t suffix = commonSuffix(oldText + edit.start, edit.length, newText + edit.newStart, edit.newLength, std::min(edit.length, edit.newLength));
+            edit.length -= suffix;
+            edit.newLength -= suffix;
+            return edit.length > 0 || edit.newLength > 0;
+        }
+    }
+
+    std::vector<TextEdit> diffText(const char* oldText, size_t oldLength, const char* newText, size_t newLength, const TextDiffParms& parms) {
+        std::vector<TextEdit> edits;
+        size_t prefix = commonPrefix(oldText, newText, std::min(oldLength, newLength));
+        if (prefix == oldLength && prefix == newLength)
+            return edits;
+        size_t suffix = commonSuffix(oldText, oldLength, newText, newLength, std::min(oldLength, newLength) - prefix);
+        TextEdit whole = { prefix, oldLength - prefix - suffix, prefix, newLength - prefix - suffix };
+        if (!parms.lineDiff) {
+            edits.push_back(whole);
+            return edits;
+        }
+
+        // whole lines around the difference: back to the start of the line, on to the end of the line
+        size_t begin = prefix;
+        while (begin > 0 && oldText[begin - 1] != '\n' && oldText[begin - 1] != '\r')
+            --begin;
+        size_t oldEnd = oldLength - suffix;
+        size_t end = oldEnd;
+        while (end < oldLength) {
+            char c = oldText[end++];
+            if (c == '\n' || (c == '\r' && (end == oldLength || oldText[end] != '\n')))
+                break;
+        }
+        size_t newEnd = newLength - suffix + (end - oldEnd);
+        oldEnd = end;
+
+        std::vector<Line> oldLines = splitLines(oldText, begin, oldEnd);
+        std::vector<Line> newLines = splitLines(newText, begin, newEnd);
+        std::vector<LineEdit> lineEdits;
+        if (!diffLines(oldText, oldLines, newText, newLines, parms.maxLineEdits, lineEdits)) {
+            edits.push_back(whole);
+            return edits;
+        }
+
+        for (const LineEdit& lineEdit : lineEdits) {
+            TextEdit edit;
+            edit.start = lineEdit.oldBegin < oldLines.size() ? oldLines[lineEdit.oldBegin].start : oldEnd;
+            edit.length = (lineEdit.oldEnd < oldLines.size() ? oldLines[lineEdit.oldEnd].start : oldEnd) - edit.start;
+            edit.newStart = lineEdit.newBegin < newLines.size() ? newLines[lineEdit.newBegin].start : newEnd;
+            edit.newLength = (lineEdit.newEnd < newLines.size() ? newLines[lineEdit.newEnd].start : newEnd) - edit.newStart;
+            if (trimEdit(oldText, newText, edit))
+                edits.push_back(edit);
+        }
+        return edits;
+    }
+
+    size_t editedBytes(const std::vector<TextEdit>& edits) {
+        size_t bytes = 0;
+        for (const TextEdit& edit : edits)
+            bytes += edit.length + edit.newLength;
+        return bytes;
+    }
+}
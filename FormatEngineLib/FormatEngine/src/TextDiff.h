@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+* Differences between a text and its formatted version, so that only the changed parts of a
+* document are replaced in the editor: the editor then keeps its styles, folds, markers and a
+* small undo record for the rest.
+*/
+namespace FormatEngine {
+    // the length bytes at start of the old text become the newLength bytes at newStart of the new text
+    struct TextEdit {
+        size_t start;
+        size_t length;
+        size_t newStart;
+        size_t newLength;
+    };
+
+    struct TextDiffParms {
+        bool lineDiff = true;           // diff the lines between the common prefix and suffix
+        size_t maxLineEdits = 512;      // beyond this many inserted and removed lines, the rest is one edit
+    };
+
+    // edits turning oldText into newText, in increasing order and not overlapping; none when the
+    // texts are equal. Without line diff, or when it costs too much, there is at most one edit.
+    std::vector<TextEdit> diffText(const char* oldText, size_t oldLength, const char* newText, size_t newLength,
+                                   const TextDiffParms& parms = TextDiffParms());
+
+    // bytes replaced and inserted by the edits
+    size_t editedBytes(const std::vector<TextEdit>& edits);
+}
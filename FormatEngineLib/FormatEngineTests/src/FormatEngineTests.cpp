@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "FormatEngine.h"
+#include "PrettyPrinter.h"
+#include "StringXml.h"
+#include "XmlFormater.h"
+
+using namespace FormatEngine;
+
+namespace {
+    const std::string sample =
+        "<?xml version=\"1.0\"?>\n"
+        "<root a=\"1\" b=\"2\"><item>text</item><empty></empty>\n"
+        "  <group><!-- comment --><value x=\"y\">  v  </value></group>\n"
+        "<pre xml:space=\"preserve\">  <keep>  a  </keep>  </pre></root>\n";
+
+    const Operation allOperations[] = { Operation::PrettyPrint, Operation::PrettyPrintAttr, Operation::IndentOnly, Operation::Linearize };
+
+    std::string format(Engine& engine, Operation op, Input& input, const Options& options = Options()) {
+        SimpleXml::StringOutputSink out;
+        engine.format(op, input, options, out);
+        return out.str();
+    }
+
+    std::string format(Engine& engine, Operation op, const std::string& text, const Options& options = Options()) {
+        Input input(text.c_str(), text.size());
+        return format(engine, op, input, options);
+    }
+
+    // reads in chunks of at most chunkSize bytes and writes a terminator after each, as Scintilla does
+    Input chunkedInput(const std::string& text, size_t chunkSize) {
+        return Input(text.size(), [&text, chunkSize](size_t offset, char* target, size_t length) -> size_t {
+            if (offset >= text.size())
+                return 0;
+            length = std::min({ length, chunkSize, text.size() - offset });
+            memcpy(target, text.data() + offset, length);
+            target[length] = '\0';
+            return length;
+        });
+    }
+}
+
+TEST(FormatEngine, SimpleXmlMatchesPrettyPrinter) {
+    SimpleXml::PrettyPrintParms parms;
+    parms.eol = "\n";
+    parms.tab = "\t";
+    parms.insertIndents = true;
+    parms.insertNewLines = true;
+    parms.removeWhitespace = true;
+    parms.autocloseEmptyElements = false;
+    parms.maxElementDepth = 255;
+    SimpleXml::ChunkedStream stream(sample.c_str(), sample.size());
+    SimpleXml::PrettyPrinter prettyPrinter(stream, parms);
+    prettyPrinter.Convert();
+
+    EXPECT_EQ(prettyPrinter.Text(), format(simpleXmlEngine(), Operation::PrettyPrint, sample));
+}
+
+TEST(FormatEngine, QuickXmlMatchesXmlFormater) {
+    QuickXml::XmlFormaterParamsType params;
+    params.indentChars = "\t";
+    params.eolChars = "\n";
+    params.indentAttributes = true;
+    QuickXml::XmlFormater formater(sample.c_str(), sample.size(), params);
+
+    EXPECT_EQ(formater.prettyPrint()->str(), format(quickXmlEngine(), Operation::PrettyPrintAttr, sample));
+}
+
+TEST(FormatEngine, StringXmlMatchesXmlFormater) {
+    StringXml::XmlFormaterParamsType params;
+    params.indentChars = "\t";
+    params.eolChars = "\n";
+    std::string str = sample;
+    StringXml::XmlFormater formater(&str, params);
+    formater.linearize();
+
+    EXPECT_EQ(str, format(stringXmlEngine(), Operation::Linearize, sample));
+}
+
+TEST(FormatEngine, ChunkedInputMatchesMemory) {
+    Engine* engines[] = { &simpleXmlEngine(), &quickXmlEngine(), &stringXmlEngine() };
+    for (Engine* engine : engines) {
+        for (Operation op : allOperations) {
+            Input input = chunkedInput(sample, 7);
+            EXPECT_FALSE(input.inMemory());
+            EXPECT_EQ(format(*engine, op, sample), format(*engine, op, input)) << engine->name() << ", " << operationName(op);
+        }
+    }
+}
+
+TEST(FormatEngine, ChunkedInputLoadsOnDemand) {
+    Input input = chunkedInput(sample, 5);
+    EXPECT_EQ(sample.size(), input.length());
+    EXPECT_EQ(sample, std::string(input.data(), input.length()));
+    EXPECT_EQ(sample, std::string(input.data()));
+}
+
+TEST(FormatEngine, Capabilities) {
+    EXPECT_TRUE(simpleXmlEngine().can(ChunkedInput | StreamingOutput | Parallel | IndentOnly));
+    EXPECT_FALSE(simpleXmlEngine().can(SpacePreserve));
+    EXPECT_TRUE(quickXmlEngine().can(SpacePreserve | IndentOnly));
+    EXPECT_FALSE(quickXmlEngine().can(ChunkedInput));
+    EXPECT_FALSE(stringXmlEngine().can(SpacePreserve));
+
+    Options options;
+    EXPECT_EQ(0u, requiredCapabilities(Operation::PrettyPrint, options));
+    EXPECT_EQ((unsigned)IndentOnly, requiredCapabilities(Operation::IndentOnly, options));
+    options.applySpacePreserve = true;
+    EXPECT_EQ((unsigned)SpacePreserve, requiredCapabilities(Operation::PrettyPrint, options));
+    EXPECT_EQ(0u, requiredCapabilities(Operation::Linearize, options));
+}
+
+TEST(FormatEngine, EngineByName) {
+    EXPECT_STREQ("SimpleXml", engineByName("SimpleXml").name());
+    EXPECT_STREQ("QuickXml", engineByName("quickxml").name());
+    EXPECT_STREQ("StringXml", engineByName("STRINGXML").name());
+    EXPECT_STREQ("Auto", engineByName("Auto").name());
+    EXPECT_STREQ("Auto", engineByName("unknown").name());
+}
+
+TEST(FormatEngine, AutoSelectsBySize) {
+    AutoEngine engine;
+    engine.parms.hugeDocumentSize = 1000;
+    engine.parms.memory = 1024 * 1024;
+
+    Input small(sample.c_str(), sample.size());
+    EXPECT_STREQ("QuickXml", engine.select(Operation::PrettyPrint, small, Options()).engine->name());
+
+    Input huge(2000, [](size_t, char*, size_t) -> size_t { return 0; });
+    EXPECT_STREQ("SimpleXml", engine.select(Operation::PrettyPrint, huge, Options()).engine->name());
+}
+
+TEST(FormatEngine, AutoSelectsByMemory) {
+    AutoEngine engine;
+    engine.parms.memory = 64 * 1024;
+
+    Input fits(4 * 1024, [](size_t, char*, size_t) -> size_t { return 0; });
+    EXPECT_STREQ("QuickXml", engine.select(Operation::PrettyPrint, fits, Options()).engine->name());
+
+    Input tooBig(20 * 1024, [](size_t, char*, size_t) -> size_t { return 0; });
+    Selection selection = engine.select(Operation::PrettyPrint, tooBig, Options());
+    EXPECT_STREQ("SimpleXml", selection.engine->name());
+    EXPECT_NE(std::string::npos, selection.reason.find("does not fit"));
+}
+
+TEST(FormatEngine, AutoKeepsSpacePreserveWhileMemoryAllows) {
+    AutoEngine engine;
+    engine.parms.hugeDocumentSize = 1000;
+    engine.parms.memory = 1024 * 1024;
+    Options options;
+    options.applySpacePreserve = true;
+
+    Input huge(2000, [](size_t, char*, size_t) -> size_t { return 0; });
+    EXPECT_STREQ("QuickXml", engine.select(Operation::PrettyPrint, huge, options).engine->name());
+
+    engine.parms.memory = 4 * 1024;
+    Selection selection = engine.select(Operation::PrettyPrint, huge, options);
+    EXPECT_STREQ("SimpleXml", selection.engine->name());
+    EXPECT_NE(std::string::npos, selection.reason.find("xml:space"));
+}
+
+TEST(FormatEngine, AutoReasonTellsWhetherPipelined) {
+    AutoEngine engine;
+    engine.parms.hugeDocumentSize = 1000;
+    engine.parms.memory = 1024 * 1024;
+    Options options;
+    options.parallelDocumentSize = 1500;
+    bool threads = std::thread::hardware_concurrency() > 1;
+
+    Input below(1200, [](size_t, char*, size_t) -> size_t { return 0; });
+    Input above(2000, [](size_t, char*, size_t) -> size_t { return 0; });
+    EXPECT_FALSE(simpleXmlEngine().usesThreads(below.length(), options));
+    EXPECT_EQ(threads, simpleXmlEngine().usesThreads(above.length(), options));
+    EXPECT_EQ(std::string::npos, engine.select(Operation::PrettyPrint, below, options).reason.find("pipelined"));
+    EXPECT_EQ(threads, engine.select(Operation::PrettyPrint, above, options).reason.find("pipelined") != std::string::npos);
+
+    options.allowThreads = false;
+    EXPECT_FALSE(simpleXmlEngine().usesThreads(above.length(), options));
+    EXPECT_EQ(std::string::npos, engine.select(Operation::PrettyPrint, above, options).reason.find("pipelined"));
+    EXPECT_FALSE(quickXmlEngine().usesThreads(above.length(), Options()));
+}
+
+TEST(FormatEngine, AutoFormatsWithSelectedEngine) {
+    AutoEngine engine;
+    engine.parms.memory = 1024 * 1024;
+    Input input(sample.c_str(), sample.size());
+    SimpleXml::StringOutputSink out;
+    engine.format(Operation::PrettyPrint, input, Options(), out);
+
+    ASSERT_NE(nullptr, engine.lastSelection().engine);
+    EXPECT_STREQ("QuickXml", engine.lastSelection().engine->name());
+    EXPECT_EQ(format(quickXmlEngine(), Operation::PrettyPrint, sample), out.str());
+}
+
+TEST(FormatEngine, AutoSelectsByBudget) {
+    AutoEngine engine;
+    engine.parms.memory = 1024 * 1024;
+    Options options;
+    options.memoryBudget = 64 * 1024;
+
+    Input fits(4 * 1024, [](size_t, char*, size_t) -> size_t { return 0; });
+    EXPECT_STREQ("QuickXml", engine.select(Operation::PrettyPrint, fits, options).engine->name());
+
+    Input overBudget(20 * 1024, [](size_t, char*, size_t) -> size_t { return 0; });
+    Selection selection = engine.select(Operation::PrettyPrint, overBudget, options);
+    EXPECT_STREQ("SimpleXml", selection.engine->name());
+    EXPECT_NE(std::string::npos, selection.reason.find("memory budget"));
+}
+
+TEST(FormatEngine, BudgetSwitchesToChunkedEngine) {
+    const size_t megabyte = 1024 * 1024;
+    Options options;
+    Input input(4 * megabyte, [](size_t, char*, size_t) -> size_t { return 0; });
+    EXPECT_EQ(&stringXmlEngine(), withinMemoryBudget(stringXmlEngine(), Operation::PrettyPrint, input, options).engine);
+
+    options.memoryBudget = stringXmlEngine().estimatedPeak(input.length()) - 1;
+    ASSERT_LE(simpleXmlEngine().estimatedPeak(input.length()), options.memoryBudget);
+    Selection selection = withinMemoryBudget(stringXmlEngine(), Operation::PrettyPrint, input, options);
+    EXPECT_EQ(&simpleXmlEngine(), selection.engine);
+    EXPECT_NE(std::string::npos, selection.reason.find("StringXml"));
+    EXPECT_EQ(&simpleXmlEngine(), withinMemoryBudget(simpleXmlEngine(), Operation::PrettyPrint, input, options).engine);
+}
+
+TEST(FormatEngine, BudgetRefusesWhatNoEngineFits) {
+    Options options;
+    Input input(4 * 1024 * 1024, [](size_t, char*, size_t) -> size_t { return 0; });
+    options.memoryBudget = simpleXmlEngine().estimatedPeak(input.length()) - 1;
+    EXPECT_THROW(withinMemoryBudget(quickXmlEngine(), Operation::PrettyPrint, input, options), MemoryBudgetError);
+    EXPECT_THROW(withinMemoryBudget(simpleXmlEngine(), Operation::PrettyPrint, input, options), MemoryBudgetError);
+
+    // the automatic engine refuses before reading anything
+    AutoEngine engine;
+    engine.parms.memory = 1024 * 1024 * 1024;
+    SimpleXml::StringOutputSink out;
+    EXPECT_THROW(engine.format(Operation::PrettyPrint, input, options, out), MemoryBudgetError);
+    EXPECT_TRUE(out.str().empty());
+}
+
+TEST(FormatEngine, StringXmlAppendsToSinkWithText) {
+    SimpleXml::StringOutputSink out;
+    out.write("before\n");
+    Input input(sample.c_str(), sample.size());
+    stringXmlEngine().format(Operation::PrettyPrint, input, Options(), out);
+    EXPECT_EQ("before\n" + format(stringXmlEngine(), Operation::PrettyPrint, sample), out.str());
+}
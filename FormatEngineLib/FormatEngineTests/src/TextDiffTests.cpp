@@ -0,0 +1,121 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "TextDiff.h"
+
+using namespace FormatEngine;
+
+namespace {
+    std::vector<TextEdit> diff(const std::string& oldText, const std::string& newText, const TextDiffParms& parms = TextDiffParms()) {
+        return diffText(oldText.data(), oldText.size(), newText.data(), newText.size(), parms);
+    }
+
+    // applies the edits from the end, as the editor does
+    std::string apply(std::string text, const std::string& newText, const std::vector<TextEdit>& edits) {
+        for (auto edit = edits.rbegin(); edit != edits.rend(); ++edit)
+            text.replace(edit->start, edit->length, newText, edit->newStart, edit->newLength);
+        return text;
+    }
+
+    void expectOrdered(const std::vector<TextEdit>& edits) {
+        for (size_t i = 1; i < edits.size(); ++i) {
+            EXPECT_LE(edits[i - 1].start + edits[i - 1].length, edits[i].start);
+            EXPECT_LE(edits[i - 1].newStart + edits[i - 1].newLength, edits[i].newStart);
+        }
+    }
+
+    std::string lines(int count, const std::string& eol = "\n") {
+        std::string text;
+        for (int i = 0; i < count; ++i)
+            text += "\t<item n=\"" + std::to_string(i) + "\"/>" + eol;
+        return text;
+    }
+}
+
+TEST(TextDiff, EqualTextsHaveNoEdit) {
+    std::string text = lines(20);
+    EXPECT_TRUE(diff(text, text).empty());
+    EXPECT_TRUE(diff("", "").empty());
+}
+
+TEST(TextDiff, PrefixAndSuffixOnly) {
+    TextDiffParms parms;
+    parms.lineDiff = false;
+    std::string oldText = lines(20);
+    std::string newText = oldText;
+    newText.replace(newText.find("n=\"3\""), 5, "n=\"three\"");
+    newText.replace(newText.find("n=\"17\""), 6, "n=\"seventeen\"");
+
+    std::vector<TextEdit> edits = diff(oldText, newText, parms);
+    ASSERT_EQ(1u, edits.size());
+    EXPECT_EQ(newText, apply(oldText, newText, edits));
+}
+
+TEST(TextDiff, ChangedLinesOnly) {
+    std::string oldText = lines(200);
+    std::string newText = oldText;
+    newText.replace(newText.find("\t<item n=\"10\"/>"), 1, "\t\t");    // indentation
+    newText.erase(newText.find("\t<item n=\"50\"/>\n"), 15);          // removed line
+    newText.insert(newText.find("\t<item n=\"150\"/>"), "\t<new/>\n");  // added line
+
+    std::vector<TextEdit> edits = diff(oldText, newText);
+    ASSERT_EQ(3u, edits.size());
+    expectOrdered(edits);
+    EXPECT_EQ(newText, apply(oldText, newText, edits));
+    EXPECT_EQ(1u + 15u + 8u, editedBytes(edits));
+}
+
+TEST(TextDiff, CrLfAndCrLines) {
+    for (std::string eol : { "\r\n", "\r" }) {
+        std::string oldText = lines(50, eol);
+        std::string newText = oldText;
+        newText.insert(newText.find("\t<item n=\"20\"/>"), "\t<new/>" + eol);
+        newText.insert(newText.find("\t<item n=\"40\"/>"), "\t<new/>" + eol);
+
+        std::vector<TextEdit> edits = diff(oldText, newText);
+        EXPECT_EQ(2u, edits.size());
+        EXPECT_EQ(newText, apply(oldText, newText, edits));
+    }
+}
+
+TEST(TextDiff, TooManyChangesGiveOneEdit) {
+    std::string oldText = lines(100);
+    std::string newText = lines(100, " \n");
+    TextDiffParms parms;
+    parms.maxLineEdits = 10;
+
+    std::vector<TextEdit> edits = diff(oldText, newText, parms);
+    ASSERT_EQ(1u, edits.size());
+    EXPECT_EQ(newText, apply(oldText, newText, edits));
+}
+
+TEST(TextDiff, RandomChanges) {
+    std::mt19937 random(7);
+    const char* samples[] = { "<a>", "</a>", "\t<b x=\"1\"/>", "text", "", "\t\t<c>v</c>" };
+    for (int round = 0; round < 200; ++round) {
+        std::vector<std::string> oldLines, newLines;
+        int count = 1 + (int)(random() % 40);
+        for (int i = 0; i < count; ++i)
+            oldLines.push_back(samples[random() % 6]);
+        for (const std::string& line : oldLines) {
+            switch (random() % 6) {
+                case 0: break;                                          // removed
+                case 1: newLines.push_back(samples[random() % 6]); break;  // replaced
+                case 2: newLines.push_back(line); newLines.push_back(samples[random() % 6]); break;  // added
+                default: newLines.push_back(line);
+            }
+        }
+        std::string oldText, newText;
+        for (const std::string& line : oldLines) oldText += line + "\n";
+        for (const std::string& line : newLines) newText += line + "\n";
+        if (random() % 2) newText.pop_back();    // no line break at the end
+
+        TextDiffParms parms;
+        parms.maxLineEdits = random() % 2 ? 512 : 4;
+        std::vector<TextEdit> edits = diff(oldText, newText, parms);
+        expectOrdered(edits);
+        EXPECT_EQ(newText, apply(oldText, newText, edits)) << "round " << round;
+    }
+}
@@ -5,7 +5,7 @@
 #include "Report.h"
 #include <comutil.h>
 
-MSXMLWrapper::MSXMLWrapper(const char* xml, size_t size) {
+MSXMLWrapper::MSXMLWrapper(const char* xml, size_t size) : m_iStylesheet(-1) {
     Report::char2BSTR(xml, size, this->m_sXml);
 
     std::map<std::string, std::string> tristate{ { "-1", "default" }, { "0", "false" }, { "1", "true" } };
@@ -33,6 +33,10 @@ MSXMLWrapper::~MSXMLWrapper() {
     this->resetErrors();
 }
 
+void MSXMLWrapper::setStylesheetHint(bool stylesheet) {
+    this->m_iStylesheet = stylesheet ? 1 : 0;
+}
+
 int MSXMLWrapper::getCapabilities() {
     return XmlCapabilityType::ALL_OPTIONS;
 }
@@ -158,66 +162,50 @@ bool MSXMLWrapper::checkValidity(std::wstring schemaFilename, std::wstring valid
 
     this->resetErrors();
 
+    // the schema is loaded first, so that the document is loaded only once, together with it
+    if (!schemaFilename.empty()) {
+        CHK_HR(CreateAndInitDOM(&pXSDDom, (INIT_OPTION_VALIDATEONPARSE | INIT_OPTION_RESOLVEEXTERNALS)));
+        CHK_HR(pXSDDom->load(CComVariant(schemaFilename.c_str()), &varStatus));
+        if (varStatus != VARIANT_TRUE) {
+            this->errors.push_back({
+                    FALSE,
+                    0,
+                    0,
+                    0,
+                    L"The referenced schema is detected as being invalid. Please fix it before using it as validation schema."
+                });
+            res = false;
+            goto CleanUp;
+        }
+
+        CHK_HR(CreateAndInitSchema(&pXS));
+        hr = pXS->add(_bstr_t(validationNamespace.c_str()), CComVariant(schemaFilename.c_str()));
+        if (FAILED(hr)) {
+            this->errors.push_back({
+                FALSE,
+                0,
+                0,
+                0,
+                L"Invalid schema or missing namespace."
+            });
+            res = false;
+            goto CleanUp;
+        }
+    }
+
     CHK_HR(CreateAndInitDOM(&pXMLDom, (INIT_OPTION_VALIDATEONPARSE | INIT_OPTION_RESOLVEEXTERNALS)));
+    if (pXS != NULL) {
+        CHK_HR(pXMLDom->putref_schemas(CComVariant(pXS)));
+    }
     CHK_HR(pXMLDom->loadXML(this->m_sXml.m_str, &varStatus));
 
     if (varStatus == VARIANT_TRUE) {
-        if (!schemaFilename.empty()) {
-            CHK_HR(CreateAndInitDOM(&pXSDDom, (INIT_OPTION_VALIDATEONPARSE | INIT_OPTION_RESOLVEEXTERNALS)));
-            CHK_HR(pXSDDom->load(CComVariant(schemaFilename.c_str()), &varStatus));
-            if (varStatus == VARIANT_TRUE) {
-                CHK_HR(CreateAndInitSchema(&pXS));
-                hr = pXS->add(_bstr_t(validationNamespace.c_str()), CComVariant(schemaFilename.c_str()));
-                if (SUCCEEDED(hr)) {
-                    // Create a DOMDocument and set its properties.
-                    SAFE_RELEASE(pXMLDom);
-                    CHK_HR(CreateAndInitDOM(&pXMLDom, (INIT_OPTION_VALIDATEONPARSE | INIT_OPTION_RESOLVEEXTERNALS)));
-                    CHK_HR(pXMLDom->putref_schemas(CComVariant(pXS)));
-
-                    /*
-                    pXMLDom->put_async(VARIANT_FALSE);
-                    pXMLDom->put_validateOnParse(VARIANT_TRUE);
-                    pXMLDom->put_resolveExternals(VARIANT_TRUE);
-                    */
-
-                    CHK_HR(pXMLDom->loadXML(this->m_sXml.m_str, &varStatus));
-                    if (varStatus != VARIANT_TRUE) {
-                        CHK_HR(pXMLDom->get_parseError((IXMLDOMParseError**)&pXMLErr));
-                        this->buildErrorsVector(pXMLErr);
-                        res = false;
-                    }
-                }
-                else {
-                    this->errors.push_back({
-                        FALSE,
-                        0,
-                        0,
-                        0,
-                        L"Invalid schema or missing namespace."
-                    });
-                    res = false;
-                }
-            }
-            else {
-                this->errors.push_back({
-                        FALSE,
-                        0,
-                        0,
-                        0,
-                        L"The referenced schema is detected as being invalid. Please fix it before using it as validation schema."
-                    });
-                res = false;
-            }
-        }
-
-        if (res) {
-            // If we are here, this means that noNamespaceSchemaLocation or schemaLocation attribute is present.
-            // So validation is supposed OK since xml is loaded with INIT_OPTION_VALIDATEONPARSE option. Then we
-            // just have to test validity.
-            if (pXMLDom->validate((IXMLDOMParseError**)&pXMLErr) == S_FALSE) {
-                this->buildErrorsVector(pXMLErr);
-                res = false;
-            }
+        // Without schema file, this means that noNamespaceSchemaLocation or schemaLocation attribute is present.
+        // So validation is supposed OK since xml is loaded with INIT_OPTION_VALIDATEONPARSE option. Then we
+        // just have to test validity.
+        if (pXMLDom->validate((IXMLDOMParseError**)&pXMLErr) == S_FALSE) {
+            this->buildErrorsVector(pXMLErr);
+            res = false;
         }
     }
     else {
@@ -433,35 +421,41 @@ bool MSXMLWrapper::xslTransform(std::wstring xslfile, XSLTransformResultType* ou
 
     // active document may either be XML or XSL; if XSL,
     // then m_sSelectedFile refers to an XML file
-    CHK_HR(CreateAndInitDOM(&pXml));
-    CHK_HR(pXml->loadXML(this->m_sXml.m_str, &varStatus));
-    if (varStatus == VARIANT_TRUE) {
-        CHK_HR(pXml->setProperty(L"SelectionNamespaces", variant_t(L"xmlns:xsl=\"http://www.w3.org/1999/XSL/Transform\"")));
-        if (SUCCEEDED(pXml->selectNodes(L"/xsl:stylesheet", &pNodes))) {
-            CHK_HR(pNodes->get_length(&length));
-            if (length == 1) {
-                // the active document is an XSL one; let's invert both files
-                currentDataIsXml = false;
-            }
-        }
+    if (this->m_iStylesheet >= 0) {
+        // already known from the parsed document: the source is loaded once, below
+        currentDataIsXml = (this->m_iStylesheet == 0);
     }
     else {
-        CHK_HR(pXml->get_parseError((IXMLDOMParseError**)&pXMLErr));
-        this->buildErrorsVector(pXMLErr);
+        CHK_HR(CreateAndInitDOM(&pXml));
+        CHK_HR(pXml->loadXML(this->m_sXml.m_str, &varStatus));
+        if (varStatus == VARIANT_TRUE) {
+            CHK_HR(pXml->setProperty(L"SelectionNamespaces", variant_t(L"xmlns:xsl=\"http://www.w3.org/1999/XSL/Transform\"")));
+            if (SUCCEEDED(pXml->selectNodes(L"/xsl:stylesheet", &pNodes))) {
+                CHK_HR(pNodes->get_length(&length));
+                if (length == 1) {
+                    // the active document is an XSL one; let's invert both files
+                    currentDataIsXml = false;
+                }
+            }
+        }
+        else {
+            CHK_HR(pXml->get_parseError((IXMLDOMParseError**)&pXMLErr));
+            this->buildErrorsVector(pXMLErr);
 
-        if (this->errors.size() == 0) {
-            this->errors.push_back({
-                FALSE,
-                0,
-                0,
-                0,
-                L"An error occurred during current source loading. Please check source validity. Transformation aborted."
-             });
+            if (this->errors.size() == 0) {
+                this->errors.push_back({
+                    FALSE,
+                    0,
+                    0,
+                    0,
+                    L"An error occurred during current source loading. Please check source validity. Transformation aborted."
+                 });
+            }
+            res = false;
         }
-        res = false;
+        SAFE_RELEASE(pXml);
+        SAFE_RELEASE(pNodes);
     }
-    SAFE_RELEASE(pXml);
-    SAFE_RELEASE(pNodes);
 
     if (!res) goto CleanUp;
 
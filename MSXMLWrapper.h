@@ -5,6 +5,7 @@
 
 class MSXMLWrapper : public XmlWrapperInterface {
 	CComBSTR m_sXml;
+	int m_iStylesheet;		// the source is an XSL stylesheet: 1, or not: 0; -1 when unknown
 	void addErrorToVector(IXMLDOMParseError2* pXMLErr, const wchar_t* szDesc = L"An unexpected error occurred");
 	void buildErrorsVector(IXMLDOMParseError2* pXMLErr, const wchar_t* szDesc = L"An unexpected error occurred");
 
@@ -12,6 +13,9 @@ public:
 	MSXMLWrapper(const char* xml, size_t size);
 	~MSXMLWrapper();
 
+	// tells xslTransform() whether the source is a stylesheet, so that it does not load it to find out
+	void setStylesheetHint(bool stylesheet);
+
 	int getCapabilities();
 	bool checkSyntax();
 	bool checkValidity(std::wstring schemaFilename = L"", std::wstring validationNamespace = L"");
@@ -120,6 +120,8 @@ BOOL COptionsDlg::OnInitDialog() {
   pGrpOptions->AddSubItem(pTmpOption); vIntProperties.push_back(pTmpOption);
   pTmpOption = new CMFCPropertyGridProperty(L"Add node position in XPath", COleVariant((short)(xmltoolsoptions.printXPathIndex ? VARIANT_TRUE : VARIANT_FALSE), VT_BOOL), L"Additionally shows the nodes position in XPath. When enabled, the XPath of \"<a><b></b><b>Content</b></a>\" will resolve to \"/a/b[2]\" instead of \"/a/b\".", (DWORD_PTR)&xmltoolsoptions.printXPathIndex);
   pGrpOptions->AddSubItem(pTmpOption); vBoolProperties.push_back(pTmpOption);
+  pTmpOption = new CMFCPropertyGridProperty(L"Document cache (MB)", COleVariant((long)xmltoolsoptions.documentCacheMB, VT_INT), L"The memory kept for parsed documents, in megabytes. XPath evaluation, validation and XSL transformation parse a document once and reuse it until it is modified. When the documents go over this size, the least recently used are dropped, except the last one: a document larger than this size is kept alone, with the indexes of its XPath queries. A zero (0) value disables the cache.", (DWORD_PTR)&xmltoolsoptions.documentCacheMB);
+  pGrpOptions->AddSubItem(pTmpOption); vIntProperties.push_back(pTmpOption);
 
 
   CMFCPropertyGridProperty* pGrpStatusbar = new CMFCPropertyGridProperty(L"Status bar");
@@ -148,8 +150,8 @@ BOOL COptionsDlg::OnInitDialog() {
 
   CMFCPropertyGridProperty* pGrpPrettyPrint = new CMFCPropertyGridProperty(L"Pretty print options");
   m_wndPropList.AddProperty(pGrpPrettyPrint);
-  pTmpOption = new CMFCPropertyGridProperty(L"Formating engine", COleVariant(xmltoolsoptions.formatingEngine.c_str()), L"This property let you choose the pretty print and linearize formating engine. Currently, you have choice between:\r\n- SimpleXml: A fast and low memory engine developped by LetMeSleepAlready (https://github.com/LetMeSleepAlready)\r\n- QuickXml: A quick and simple engine which focus on conformity\r\n- StringXml: An engine based on string processing. This engine is more permissive on invalid xml, but very slow on big xml files.", (DWORD_PTR)&xmltoolsoptions.formatingEngine);
-  pTmpOption->AddOption(L"SimpleXml"); pTmpOption->AddOption(L"QuickXml"); pTmpOption->AddOption(L"StringXml");
+  pTmpOption = new CMFCPropertyGridProperty(L"Formating engine", COleVariant(xmltoolsoptions.formatingEngine.c_str()), L"This property let you choose the pretty print and linearize formating engine. Currently, you have choice between:\r\n- Auto: QuickXml for documents that fit in memory, SimpleXml for huge documents or when memory is short\r\n- SimpleXml: A fast and low memory engine developped by LetMeSleepAlready (https://github.com/LetMeSleepAlready)\r\n- QuickXml: A quick and simple engine which focus on conformity\r\n- StringXml: An engine based on string processing. This engine is more permissive on invalid xml, but very slow on big xml files.", (DWORD_PTR)&xmltoolsoptions.formatingEngine);
+  pTmpOption->AddOption(L"Auto"); pTmpOption->AddOption(L"SimpleXml"); pTmpOption->AddOption(L"QuickXml"); pTmpOption->AddOption(L"StringXml");
   pGrpPrettyPrint->AddSubItem(pTmpOption); vWStringProperties.push_back(pTmpOption);
   pTmpOption = new CMFCPropertyGridProperty(L"Auto-close tags", COleVariant((short)(xmltoolsoptions.ppAutoclose ? VARIANT_TRUE : VARIANT_FALSE), VT_BOOL), L"Enable auto-close tags on pretty print. For instance, when enabled, \"<sample></sample>\" is replaced with \"<sample/>\".", (DWORD_PTR)&xmltoolsoptions.ppAutoclose);
   pGrpPrettyPrint->AddSubItem(pTmpOption); vBoolProperties.push_back(pTmpOption);
@@ -157,6 +159,8 @@ BOOL COptionsDlg::OnInitDialog() {
   pGrpPrettyPrint->AddSubItem(pTmpOption); vBoolProperties.push_back(pTmpOption);
   pTmpOption = new CMFCPropertyGridProperty(L"Max indent level", COleVariant((long)xmltoolsoptions.maxIndentLevel, VT_INT), L"The max indentation level for pretty print. A zero (0) value means no indentation limit", (DWORD_PTR)&xmltoolsoptions.maxIndentLevel);
   pGrpPrettyPrint->AddSubItem(pTmpOption); vIntProperties.push_back(pTmpOption);
+  pTmpOption = new CMFCPropertyGridProperty(L"Memory budget (MB)", COleVariant((long)xmltoolsoptions.memoryBudgetMB, VT_INT), L"The memory a formating command may use for one document, in megabytes. A document the selected engine would format over this budget is formatted by the low memory SimpleXml engine, or left as it is when even that engine would need more. A zero (0) value means no limit.", (DWORD_PTR)&xmltoolsoptions.memoryBudgetMB);
+  pGrpPrettyPrint->AddSubItem(pTmpOption); vIntProperties.push_back(pTmpOption);
   pTmpOption = new CMFCPropertyGridProperty(L"Apply xml:space=\"preserve\"", COleVariant((short)(xmltoolsoptions.applySpacePreserve ? VARIANT_TRUE : VARIANT_FALSE), VT_BOOL), L"Make the formating engine take care of xml:space=\"preserve\" and xml:space=\"default\" declarations. Currently only available on QuickXml.", (DWORD_PTR)&xmltoolsoptions.applySpacePreserve);
   pGrpPrettyPrint->AddSubItem(pTmpOption); vBoolProperties.push_back(pTmpOption);
 
@@ -0,0 +1,1989 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "XPath.h"
+
+namespace QuickXml {
+    namespace {
+        const char* xmlNamespace = "http://www.w3.org/XML/1998/namespace";
+
+        bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
+
+        bool isNameStart(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (unsigned char)c >= 0x80;
+        }
+
+        bool isNameChar(char c) {
+            return isNameStart(c) || (c >= '0' && c <= '9') || c == '.' || c == '-';
+        }
+
+        bool isDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        // namespace declarations are not attributes in the XPath data model
+        bool isNamespaceDeclaration(std::string_view qname) {
+            return qname.size() >= 5 && !qname.compare(0, 5, "xmlns") && (qname.size() == 5 || qname[5] == ':');
+        }
+
+        // UTF-8 characters of a string, as XPath counts them
+        size_t charLength(std::string_view s) {
+            size_t count = 0;
+            for (char c : s) {
+                if (((unsigned char)c & 0xC0) != 0x80)
+                    ++count;
+            }
+            return count;
+        }
+
+        size_t nextChar(std::string_view s, size_t pos) {
+            ++pos;
+            while (pos < s.size() && ((unsigned char)s[pos] & 0xC0) == 0x80)
+                ++pos;
+            return pos;
+        }
+
+        /*
+        * Lexer
+        */
+        enum class Tok {
+            End, LParen, RParen, LBracket, RBracket, Dot, DotDot, At, Comma, ColonColon,
+            Slash, SlashSlash, Pipe, Plus, Minus, Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual,
+            Star,           // name test
+            Multiply, And, Or, Mod, Div,
+            Literal, Number, Name, Variable
+        };
+
+        struct Token {
+            Tok type;
+            std::string_view text;
+            size_t pos;
+            double number;
+        };
+
+        bool isOperator(Tok t) {
+            switch (t) {
+                case Tok::And: case Tok::Or: case Tok::Mod: case Tok::Div: case Tok::Multiply:
+                case Tok::Slash: case Tok::SlashSlash: case Tok::Pipe: case Tok::Plus: case Tok::Minus:
+                case Tok::Equal: case Tok::NotEqual: case Tok::Less: case Tok::LessEqual: case Tok::Greater: case Tok::GreaterEqual:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        size_t readNCName(std::string_view s, size_t pos) {
+            if (pos >= s.size() || !isNameStart(s[pos]))
+                return pos;
+            while (pos < s.size() && isNameChar(s[pos]))
+                ++pos;
+            return pos;
+        }
+
+        std::vector<Token> tokenize(std::string_view s) {
+            std::vector<Token> tokens;
+            size_t pos = 0;
+            while (true) {
+                while (pos < s.size() && isSpace(s[pos]))
+                    ++pos;
+                if (pos >= s.size())
+                    break;
+
+                // an operator comes after an operand only (XPath 1.0, 3.7)
+                bool afterOperand = !tokens.empty() && !isOperator(tokens.back().type) &&
+                                    tokens.back().type != Tok::At && tokens.back().type != Tok::ColonColon &&
+                                    tokens.back().type != Tok::LParen && tokens.back().type != Tok::LBracket &&
+                                    tokens.back().type != Tok::Comma;
+                size_t start = pos;
+                char c = s[pos];
+                char n = pos + 1 < s.size() ? s[pos + 1] : '\0';
+                Tok type;
+                double number = 0;
+                switch (c) {
+                    case '(': type = Tok::LParen; ++pos; break;
+                    case ')': type = Tok::RParen; ++pos; break;
+                    case '[': type = Tok::LBracket; ++pos; break;
+                    case ']': type = Tok::RBracket; ++pos; break;
+                    case '@': type = Tok::At; ++pos; break;
+                    case ',': type = Tok::Comma; ++pos; break;
+                    case '|': type = Tok::Pipe; ++pos; break;
+                    case '+': type = Tok::Plus; ++pos; break;
+                    case '-': type = Tok::Minus; ++pos; break;
+                    case '=': type = Tok::Equal; ++pos; break;
+                    case '*': type = afterOperand ? Tok::Multiply : Tok::Star; ++pos; break;
+                    case '/':
+                        type = (n == '/') ? Tok::SlashSlash : Tok::Slash;
+                        pos += (n == '/') ? 2 : 1;
+                        break;
+                    case '<':
+                        type = (n == '=') ? Tok::LessEqual : Tok::Less;
+                        pos += (n == '=') ? 2 : 1;
+                        break;
+                    case '>':
+                        type = (n == '=') ? Tok::GreaterEqual : Tok::Greater;
+                        pos += (n == '=') ? 2 : 1;
+                        break;
+                    case '!':
+                        if (n != '=')
+                            throw XPathError("'!' must be followed by '='", pos);
+                        type = Tok::NotEqual;
+                        pos += 2;
+                        break;
+                    case ':':
+                        if (n != ':')
+                            throw XPathError("unexpected ':'", pos);
+                        type = Tok::ColonColon;
+                        pos += 2;
+                        break;
+                    case '"':
+                    case '\'': {
+                        size_t end = s.find(c, pos + 1);
+                        if (end == std::string_view::npos)
+                            throw XPathError("unterminated string literal", pos);
+                        tokens.push_back({ Tok::Literal, s.substr(pos + 1, end - pos - 1), start, 0 });
+                        pos = end + 1;
+                        continue;
+                    }
+                    case '$': {
+                        size_t end = readNCName(s, pos + 1);
+                        if (end == pos + 1)
+                            throw XPathError("variable name expected", pos);
+                        if (end + 1 < s.size() && s[end] == ':' && s[end + 1] != ':')
+                            end = readNCName(s, end + 1);
+                        type = Tok::Variable;
+                        pos = end;
+                        break;
+                    }
+                    default:
+                        if (isDigit(c) || (c == '.' && isDigit(n))) {
+                            while (pos < s.size() && isDigit(s[pos]))
+                                ++pos;
+                            if (pos < s.size() && s[pos] == '.') {
+                                ++pos;
+                                while (pos < s.size() && isDigit(s[pos]))
+                                    ++pos;
+                            }
+                            number = xpathStringToNumber(s.substr(start, pos - start));
+                            type = Tok::Number;
+                        }
+                        else if (c == '.') {
+                            type = (n == '.') ? Tok::DotDot : Tok::Dot;
+                            pos += (n == '.') ? 2 : 1;
+                        }
+                        else if (isNameStart(c)) {
+                            pos = readNCName(s, pos);
+                            std::string_view word = s.substr(start, pos - start);
+                            if (afterOperand) {
+                                if (word == "and") type = Tok::And;
+                                else if (word == "or") type = Tok::Or;
+                                else if (word == "mod") type = Tok::Mod;
+                                else if (word == "div") type = Tok::Div;
+                                else throw XPathError("operator expected instead of '" + std::string(word) + "'", start);
+                                break;
+                            }
+                            // QName or prefix:*
+                            if (pos + 1 < s.size() && s[pos] == ':' && s[pos + 1] != ':') {
+                                if (s[pos + 1] == '*')
+                                    pos += 2;
+                                else if (isNameStart(s[pos + 1]))
+                                    pos = readNCName(s, pos + 1);
+                                else
+                                    throw XPathError("name expected after ':'", pos + 1);
+                            }
+                            type = Tok::Name;
+                        }
+                        else {
+                            throw XPathError("unexpected character '" + std::string(1, c) + "'", pos);
+                        }
+                }
+                tokens.push_back({ type, s.substr(start, pos - start), start, number });
+            }
+            tokens.push_back({ Tok::End, std::string_view(), s.size(), 0 });
+            return tokens;
+        }
+
+        /*
+        * Parser
+        */
+        struct FunctionInfo {
+            const char* name;
+            XPathFunction function;
+            size_t minArgs;
+            size_t maxArgs;
+            XPathType type;
+        };
+
+        const FunctionInfo functions[] = {
+            { "last", XPathFunction::Last, 0, 0, XPathType::Number },
+            { "position", XPathFunction::Position, 0, 0, XPathType::Number },
+            { "count", XPathFunction::Count, 1, 1, XPathType::Number },
+            { "id", XPathFunction::Id, 1, 1, XPathType::NodeSet },
+            { "local-name", XPathFunction::LocalName, 0, 1, XPathType::String },
+            { "namespace-uri", XPathFunction::NamespaceUri, 0, 1, XPathType::String },
+            { "name", XPathFunction::Name, 0, 1, XPathType::String },
+            { "string", XPathFunction::String, 0, 1, XPathType::String },
+            { "concat", XPathFunction::Concat, 2, SIZE_MAX, XPathType::String },
+            { "starts-with", XPathFunction::StartsWith, 2, 2, XPathType::Boolean },
+            { "contains", XPathFunction::Contains, 2, 2, XPathType::Boolean },
+            { "substring-before", XPathFunction::SubstringBefore, 2, 2, XPathType::String },
+            { "substring-after", XPathFunction::SubstringAfter, 2, 2, XPathType::String },
+            { "substring", XPathFunction::Substring, 2, 3, XPathType::String },
+            { "string-length", XPathFunction::StringLength, 0, 1, XPathType::Number },
+            { "normalize-space", XPathFunction::NormalizeSpace, 0, 1, XPathType::String },
+            { "translate", XPathFunction::Translate, 3, 3, XPathType::String },
+            { "boolean", XPathFunction::Boolean, 1, 1, XPathType::Boolean },
+            { "not", XPathFunction::Not, 1, 1, XPathType::Boolean },
+            { "true", XPathFunction::True, 0, 0, XPathType::Boolean },
+            { "false", XPathFunction::False, 0, 0, XPathType::Boolean },
+            { "lang", XPathFunction::Lang, 1, 1, XPathType::Boolean },
+            { "number", XPathFunction::Number, 0, 1, XPathType::Number },
+            { "sum", XPathFunction::Sum, 1, 1, XPathType::Number },
+            { "floor", XPathFunction::Floor, 1, 1, XPathType::Number },
+            { "ceiling", XPathFunction::Ceiling, 1, 1, XPathType::Number },
+            { "round", XPathFunction::Round, 1, 1, XPathType::Number },
+        };
+
+        const std::pair<const char*, XPathAxis> axes[] = {
+            { "ancestor", XPathAxis::Ancestor },
+            { "ancestor-or-self", XPathAxis::AncestorOrSelf },
+            { "attribute", XPathAxis::Attribute },
+            { "child", XPathAxis::Child },
+            { "descendant", XPathAxis::Descendant },
+            { "descendant-or-self", XPathAxis::DescendantOrSelf },
+            { "following", XPathAxis::Following },
+            { "following-sibling", XPathAxis::FollowingSibling },
+            { "namespace", XPathAxis::Namespace },
+            { "parent", XPathAxis::Parent },
+            { "preceding", XPathAxis::Preceding },
+            { "preceding-sibling", XPathAxis::PrecedingSibling },
+            { "self", XPathAxis::Self },
+        };
+
+        bool isNodeType(std::string_view name) {
+            return name == "node" || name == "text" || name == "comment" || name == "processing-instruction";
+        }
+
+        bool usesPosition(const std::vector<XPathExpr>& exprs, uint32_t index) {
+            const XPathExpr& expr = exprs[index];
+            if (expr.op == XPathOp::Function && (expr.function == XPathFunction::Last || expr.function == XPathFunction::Position))
+                return true;
+            // the predicates of inner paths and filters have their own context
+            return std::any_of(expr.args.begin(), expr.args.end(), [&exprs](uint32_t arg) { return usesPosition(exprs, arg); });
+        }
+
+        // does a predicate depend on the position of the node (a numeric one does)
+        bool positional(const std::vector<XPathExpr>& exprs, uint32_t predicate) {
+            return exprs[predicate].type == XPathType::Number || usesPosition(exprs, predicate);
+        }
+
+        class Parser {
+            const std::vector<Token>& tokens;
+            const XPathNamespaces& namespaces;
+            std::vector<XPathExpr>& exprs;
+            size_t at = 0;
+
+            const Token& peek(size_t ahead = 0) const {
+                return tokens[std::min(at + ahead, tokens.size() - 1)];
+            }
+
+            bool accept(Tok type) {
+                if (peek().type != type)
+                    return false;
+                ++at;
+                return true;
+            }
+
+            void expect(Tok type, const char* what) {
+                if (!accept(type))
+                    fail(std::string(what) + " expected");
+            }
+
+            [[noreturn]] void fail(const std::string& message) const {
+                throw XPathError(message, peek().pos);
+            }
+
+            uint32_t add(XPathExpr expr) {
+                exprs.push_back(std::move(expr));
+                return (uint32_t)exprs.size() - 1;
+            }
+
+            uint32_t binary(XPathOp op, XPathType type, uint32_t left, uint32_t right) {
+                XPathExpr expr;
+                expr.op = op;
+                expr.type = type;
+                expr.args = { left, right };
+                return add(std::move(expr));
+            }
+
+            std::string resolve(std::string_view prefix, size_t pos) const {
+                if (prefix == "xml")
+                    return xmlNamespace;
+                auto found = namespaces.find(prefix);
+                if (found == namespaces.end())
+                    throw XPathError("reference to undeclared namespace prefix '" + std::string(prefix) + "'", pos);
+                return found->second;
+            }
+
+            uint32_t parseOr() {
+                uint32_t left = parseAnd();
+                while (accept(Tok::Or))
+                    left = binary(XPathOp::Or, XPathType::Boolean, left, parseAnd());
+                return left;
+            }
+
+            uint32_t parseAnd() {
+                uint32_t left = parseEquality();
+                while (accept(Tok::And))
+                    left = binary(XPathOp::And, XPathType::Boolean, left, parseEquality());
+                return left;
+            }
+
+            uint32_t parseEquality() {
+                uint32_t left = parseRelational();
+                while (true) {
+                    if (accept(Tok::Equal)) left = binary(XPathOp::Equal, XPathType::Boolean, left, parseRelational());
+                    else if (accept(Tok::NotEqual)) left = binary(XPathOp::NotEqual, XPathType::Boolean, left, parseRelational());
+                    else return left;
+                }
+            }
+
+            uint32_t parseRelational() {
+                uint32_t left = parseAdditive();
+                while (true) {
+                    if (accept(Tok::Less)) left = binary(XPathOp::Less, XPathType::Boolean, left, parseAdditive());
+                    else if (accept(Tok::LessEqual)) left = binary(XPathOp::LessEqual, XPathType::Boolean, left, parseAdditive());
+                    else if (accept(Tok::Greater)) left = binary(XPathOp::Greater, XPathType::Boolean, left, parseAdditive());
+                    else if (accept(Tok::GreaterEqual)) left = binary(XPathOp::GreaterEqual, XPathType::Boolean, left, parseAdditive());
+                    else return left;
+                }
+            }
+
+            uint32_t parseAdditive() {
+                uint32_t left = parseMultiplicative();
+                while (true) {
+                    if (accept(Tok::Plus)) left = binary(XPathOp::Add, XPathType::Number, left, parseMultiplicative());
+                    else if (accept(Tok::Minus)) left = binary(XPathOp::Subtract, XPathType::Number, left, parseMultiplicative());
+                    else return left;
+                }
+            }
+
+            uint32_t parseMultiplicative() {
+                uint32_t left = parseUnary();
+                while (true) {
+                    if (accept(Tok::Multiply)) left = binary(XPathOp::Multiply, XPathType::Number, left, parseUnary());
+                    else if (accept(Tok::Div)) left = binary(XPathOp::Divide, XPathType::Number, left, parseUnary());
+                    else if (accept(Tok::Mod)) left = binary(XPathOp::Modulo, XPathType::Number, left, parseUnary());
+                    else return left;
+                }
+            }
+
+            uint32_t parseUnary() {
+                if (accept(Tok::Minus)) {
+                    XPathExpr expr;
+                    expr.op = XPathOp::Negate;
+                    expr.type = XPathType::Number;
+                    expr.args = { parseUnary() };
+                    return add(std::move(expr));
+                }
+                return parseUnion();
+            }
+
+            uint32_t parseUnion() {
+                uint32_t left = parsePath();
+                while (accept(Tok::Pipe))
+                    left = binary(XPathOp::Union, XPathType::NodeSet, left, parsePath());
+                return left;
+            }
+
+            bool startsFilter() const {
+                Tok t = peek().type;
+                return t == Tok::Literal || t == Tok::Number || t == Tok::Variable || t == Tok::LParen ||
+                       (t == Tok::Name && peek(1).type == Tok::LParen && !isNodeType(peek().text));
+            }
+
+            bool startsStep() const {
+                Tok t = peek().type;
+                return t == Tok::Name || t == Tok::Star || t == Tok::Dot || t == Tok::DotDot || t == Tok::At;
+            }
+
+            uint32_t parsePath() {
+                XPathExpr path;
+                path.op = XPathOp::Path;
+                path.type = XPathType::NodeSet;
+                if (startsFilter()) {
+                    uint32_t filter = parseFilter();
+                    if (peek().type != Tok::Slash && peek().type != Tok::SlashSlash)
+                        return filter;
+                    path.hasStart = true;
+                    path.args = { filter };
+                    parseRelative(path.steps, false);
+                }
+                else if (accept(Tok::Slash)) {
+                    path.absolute = true;
+                    if (startsStep())
+                        parseRelative(path.steps, true);
+                }
+                else if (peek().type == Tok::SlashSlash) {
+                    path.absolute = true;
+                    parseRelative(path.steps, false);
+                }
+                else {
+                    parseRelative(path.steps, true);
+                }
+                optimize(path.steps);
+                return add(std::move(path));
+            }
+
+            // steps, from the first one when first, else from a '/' or '//' before it
+            void parseRelative(std::vector<XPathStep>& steps, bool first) {
+                while (true) {
+                    if (!first) {
+                        if (accept(Tok::SlashSlash)) {
+                            XPathStep any;
+                            any.axis = XPathAxis::DescendantOrSelf;
+                            steps.push_back(any);
+                        }
+                        else if (!accept(Tok::Slash)) {
+                            return;
+                        }
+                    }
+                    steps.push_back(parseStep());
+                    first = false;
+                }
+            }
+
+            XPathStep parseStep() {
+                XPathStep step;
+                if (accept(Tok::Dot)) {
+                    step.axis = XPathAxis::Self;
+                    return step;
+                }
+                if (accept(Tok::DotDot)) {
+                    step.axis = XPathAxis::Parent;
+                    return step;
+                }
+                if (accept(Tok::At)) {
+                    step.axis = XPathAxis::Attribute;
+                }
+                else if (peek().type == Tok::Name && peek(1).type == Tok::ColonColon) {
+                    auto axis = std::find_if(std::begin(axes), std::end(axes), [this](const std::pair<const char*, XPathAxis>& a) { return peek().text == a.first; });
+                    if (axis == std::end(axes))
+                        fail("unknown axis '" + std::string(peek().text) + "'");
+                    step.axis = axis->second;
+                    at += 2;
+                }
+
+                const Token& test = peek();
+                if (accept(Tok::Star)) {
+                    step.test = XPathTest::AnyName;
+                }
+                else if (test.type == Tok::Name && peek(1).type == Tok::LParen && isNodeType(test.text)) {
+                    at += 2;
+                    if (test.text == "node") step.test = XPathTest::Node;
+                    else if (test.text == "text") step.test = XPathTest::Text;
+                    else if (test.text == "comment") step.test = XPathTest::Comment;
+                    else {
+                        step.test = XPathTest::ProcessingInstruction;
+                        if (peek().type == Tok::Literal) {
+                            step.name = std::string(peek().text);
+                            ++at;
+                        }
+                    }
+                    expect(Tok::RParen, "')'");
+                }
+                else if (accept(Tok::Name)) {
+                    std::string_view name = test.text;
+                    size_t colon = name.find(':');
+                    if (colon == std::string_view::npos) {
+                        step.test = XPathTest::Name;
+                        step.name = std::string(name);
+                    }
+                    else {
+                        step.uri = resolve(name.substr(0, colon), test.pos);
+                        if (name.substr(colon + 1) == "*") {
+                            step.test = XPathTest::AnyLocalName;
+                        }
+                        else {
+                            step.test = XPathTest::Name;
+                            step.name = std::string(name.substr(colon + 1));
+                        }
+                    }
+                }
+                else {
+                    fail("location step expected");
+                }
+
+                while (accept(Tok::LBracket)) {
+                    step.predicates.push_back(parseOr());
+                    expect(Tok::RBracket, "']'");
+                }
+                return step;
+            }
+
+            uint32_t parseFilter() {
+                uint32_t primary = parsePrimary();
+                if (peek().type != Tok::LBracket)
+                    return primary;
+                XPathExpr filter;
+                filter.op = XPathOp::Filter;
+                filter.type = XPathType::NodeSet;
+                filter.args = { primary };
+                while (accept(Tok::LBracket)) {
+                    filter.predicates.push_back(parseOr());
+                    expect(Tok::RBracket, "']'");
+                }
+                return add(std::move(filter));
+            }
+
+            uint32_t parsePrimary() {
+                const Token& token = peek();
+                XPathExpr expr;
+                switch (token.type) {
+                    case Tok::Literal:
+                        ++at;
+                        expr.op = XPathOp::Literal;
+                        expr.type = XPathType::String;
+                        expr.literal = std::string(token.text);
+                        return add(std::move(expr));
+                    case Tok::Number:
+                        ++at;
+                        expr.op = XPathOp::Number;
+                        expr.type = XPathType::Number;
+                        expr.number = token.number;
+                        return add(std::move(expr));
+                    case Tok::Variable:
+                        fail("variables are not supported");
+                    case Tok::LParen: {
+                        ++at;
+                        uint32_t inner = parseOr();
+                        expect(Tok::RParen, "')'");
+                        return inner;
+                    }
+                    default:
+                        break;
+                }
+
+                // function call
+                auto info = std::find_if(std::begin(functions), std::end(functions), [&token](const FunctionInfo& f) { return token.text == f.name; });
+                if (info == std::end(functions))
+                    fail("unknown function '" + std::string(token.text) + "'");
+                at += 2;
+                expr.op = XPathOp::Function;
+                expr.function = info->function;
+                expr.type = info->type;
+                if (!accept(Tok::RParen)) {
+                    do {
+                        expr.args.push_back(parseOr());
+                    } while (accept(Tok::Comma));
+                    expect(Tok::RParen, "')'");
+                }
+                if (expr.args.size() < info->minArgs || expr.args.size() > info->maxArgs)
+                    throw XPathError("wrong number of arguments for " + std::string(info->name) + "()", token.pos);
+                return add(std::move(expr));
+            }
+
+            // '//name[...]' is descendant::name[...] when the predicates do not count positions among siblings
+            void optimize(std::vector<XPathStep>& steps) const {
+                for (size_t i = 0; i + 1 < steps.size(); ++i) {
+                    const XPathStep& any = steps[i];
+                    XPathStep& next = steps[i + 1];
+                    if (any.axis != XPathAxis::DescendantOrSelf || any.test != XPathTest::Node || !any.predicates.empty() || next.axis != XPathAxis::Child)
+                        continue;
+                    if (std::any_of(next.predicates.begin(), next.predicates.end(), [this](uint32_t p) { return positional(exprs, p); }))
+                        continue;
+                    next.axis = XPathAxis::Descendant;
+                    steps.erase(steps.begin() + i);
+                }
+            }
+
+        public:
+            Parser(const std::vector<Token>& tokens, const XPathNamespaces& namespaces, std::vector<XPathExpr>& exprs)
+                : tokens(tokens), namespaces(namespaces), exprs(exprs) {}
+
+            void parse() {
+                if (peek().type == Tok::End)
+                    fail("empty expression");
+                uint32_t root = parseOr();
+                if (peek().type != Tok::End)
+                    fail("unexpected '" + std::string(peek().text) + "'");
+                // the root is the last expression
+                if (root != exprs.size() - 1) {
+                    XPathExpr copy = exprs[root];
+                    exprs.push_back(std::move(copy));
+                }
+            }
+        };
+
+        /*
+        * Index lookups: the descendant steps whose candidates a DocumentIndex gives
+        */
+        enum class Lookup {
+            None,
+            Name,           // the elements with the name of the test
+            Attribute,      // [@a]: the elements having a
+            Value           // [@a = 'v']: the elements whose a is v, or having a when a is not an identity attribute
+        };
+
+        struct IndexLookup {
+            Lookup kind = Lookup::None;
+            const std::string* attribute = nullptr;
+            const std::string* value = nullptr;
+        };
+
+        // an unprefixed attribute of the context node: @a
+        const std::string* attributeOperand(const std::vector<XPathExpr>& exprs, uint32_t index) {
+            const XPathExpr& expr = exprs[index];
+            if (expr.op != XPathOp::Path || expr.absolute || expr.hasStart || expr.steps.size() != 1)
+                return nullptr;
+            const XPathStep& step = expr.steps[0];
+            if (step.axis != XPathAxis::Attribute || step.test != XPathTest::Name || !step.uri.empty() || !step.predicates.empty())
+                return nullptr;
+            return &step.name;
+        }
+
+        IndexLookup indexLookup(const std::vector<XPathExpr>& exprs, const XPathStep& step) {
+            IndexLookup lookup;
+            if (step.axis != XPathAxis::Descendant || (step.test != XPathTest::Name && step.test != XPathTest::AnyName && step.test != XPathTest::AnyLocalName))
+                return lookup;
+            if (!step.predicates.empty()) {
+                const XPathExpr& first = exprs[step.predicates[0]];
+                if (first.op == XPathOp::Equal) {
+                    for (size_t i = 0; i < 2; ++i) {
+                        const std::string* attribute = attributeOperand(exprs, first.args[i]);
+                        const XPathExpr& other = exprs[first.args[1 - i]];
+                        if (attribute && other.op == XPathOp::Literal) {
+                            lookup.kind = Lookup::Value;
+                            lookup.attribute = attribute;
+                            lookup.value = &other.literal;
+                            return lookup;
+                        }
+                    }
+                }
+                else if ((lookup.attribute = attributeOperand(exprs, step.predicates[0])) != nullptr) {
+                    lookup.kind = Lookup::Attribute;
+                    return lookup;
+                }
+            }
+            if (step.test == XPathTest::Name)
+                lookup.kind = Lookup::Name;
+            return lookup;
+        }
+
+        /*
+        * Evaluator
+        */
+        struct Context {
+            XPathNode node;
+            size_t position;
+            size_t size;
+        };
+
+        class Evaluator {
+            const Document& doc;
+            const std::vector<XPathExpr>& exprs;
+            const DocumentIndex* index;
+            XPathOptions options;
+            bool defaultNamespaces;     // some element declares a default namespace
+            // per name test: 0 the name does not match, 1 it matches, 2 it matches if the namespace does
+            std::unordered_map<const XPathStep*, std::vector<uint8_t>> nameTables;
+            std::vector<std::pair<std::string, std::string>> idAttributes;     // element, attribute
+            bool idAttributesRead = false;
+
+            NodeId subtreeEnd(NodeId node) const {
+                while (node != NoNode) {
+                    NodeId sibling = doc.nextSibling(node);
+                    if (sibling != NoNode)
+                        return sibling;
+                    node = doc.parent(node);
+                }
+                return (NodeId)doc.nodeCount();
+            }
+
+            NodeId previousSibling(NodeId node) const {
+                NodeId parent = doc.parent(node);
+                if (parent == NoNode || node == parent + 1)
+                    return NoNode;
+                NodeId previous = node - 1;
+                while (doc.parent(previous) != parent)
+                    previous = doc.parent(previous);
+                return previous;
+            }
+
+            const std::vector<uint8_t>& nameTable(const XPathStep& step, bool attribute) {
+                auto found = nameTables.find(&step);
+                if (found != nameTables.end())
+                    return found->second;
+                std::vector<uint8_t>& table = nameTables[&step];
+                table.resize(doc.nameCount(), 0);
+                for (NameId id = 0; id < table.size(); ++id) {
+                    std::string_view qname = doc.nameOf(id);
+                    std::string_view prefix = Document::prefixOf(qname);
+                    if (attribute && isNamespaceDeclaration(qname))
+                        continue;
+                    switch (step.test) {
+                        case XPathTest::AnyName:
+                            table[id] = 1;
+                            break;
+                        case XPathTest::AnyLocalName:
+                            // an unprefixed attribute has no namespace
+                            if (!attribute || !prefix.empty())
+                                table[id] = 2;
+                            break;
+                        default:
+                            if (Document::localNameOf(qname) != step.name)
+                                break;
+                            if (step.uri.empty())
+                                table[id] = prefix.empty() ? (attribute || !defaultNamespaces ? 1 : 2) : 0;
+                            else if (!attribute || !prefix.empty())
+                                table[id] = 2;
+                            break;
+                    }
+                }
+                return table;
+            }
+
+            bool matchesName(const XPathStep& step, const XPathNode& node) {
+                if (node.type == XPathNode::Attribute) {
+                    uint8_t match = nameTable(step, true)[doc.attributeNameId(node.index)];
+                    return match == 1 || (match == 2 && doc.attributeNamespaceUri(node.node, node.index) == step.uri);
+                }
+                uint8_t match = nameTable(step, false)[doc.nameId(node.node)];
+                return match == 1 || (match == 2 && doc.namespaceUri(node.node) == step.uri);
+            }
+
+            bool matches(const XPathStep& step, const XPathNode& node) {
+                switch (step.test) {
+                    case XPathTest::Node:
+                        return true;
+                    case XPathTest::Text:
+                        return node.type == XPathNode::Tree && (doc.kind(node.node) == NodeKind::Text || doc.kind(node.node) == NodeKind::CData);
+                    case XPathTest::Comment:
+                        return node.type == XPathNode::Tree && doc.kind(node.node) == NodeKind::Comment;
+                    case XPathTest::ProcessingInstruction:
+                        return node.type == XPathNode::Tree && doc.kind(node.node) == NodeKind::ProcessingInstruction &&
+                               (step.name.empty() || doc.name(node.node) == step.name);
+                    default:
+                        break;
+                }
+                // name tests select the principal node type of the axis
+                if (step.axis == XPathAxis::Attribute)
+                    return node.type == XPathNode::Attribute && matchesName(step, node);
+                if (step.axis == XPathAxis::Namespace) {
+                    if (node.type != XPathNode::Namespace)
+                        return false;
+                    return step.test == XPathTest::AnyName || (step.test == XPathTest::Name && step.uri.empty() && namespacePrefix(node) == step.name);
+                }
+                return node.type == XPathNode::Tree && doc.kind(node.node) == NodeKind::Element && matchesName(step, node);
+            }
+
+            void push(const XPathStep& step, const XPathNode& node, std::vector<XPathNode>& out) {
+                if (matches(step, node))
+                    out.push_back(node);
+            }
+
+            void pushAncestors(const XPathStep& step, NodeId node, std::vector<XPathNode>& out) {
+                for (; node != NoNode; node = doc.parent(node))
+                    push(step, XPathNode::tree(node), out);
+            }
+
+            void pushNamespaces(const XPathStep& step, NodeId element, std::vector<XPathNode>& out) {
+                std::vector<std::string_view> seen;
+                for (NodeId node = element; node != NoNode; node = doc.parent(node)) {
+                    if (doc.kind(node) != NodeKind::Element)
+                        continue;
+                    for (AttrId attr = doc.attributesBegin(node), end = doc.attributesEnd(node); attr < end; ++attr) {
+                        std::string_view qname = doc.attributeName(attr);
+                        if (!isNamespaceDeclaration(qname))
+                            continue;
+                        std::string_view prefix = qname.size() > 6 ? qname.substr(6) : std::string_view();
+                        if (std::find(seen.begin(), seen.end(), prefix) != seen.end())
+                            continue;
+                        seen.push_back(prefix);
+                        // xmlns="" undeclares the default namespace
+                        if (!doc.rawAttributeValue(attr).empty())
+                            push(step, XPathNode::ns(element, attr), out);
+                    }
+                }
+                push(step, XPathNode::ns(element, NoAttr), out);
+            }
+
+            void checkCancel() const {
+                if (options.cancel && options.cancel->load(std::memory_order_relaxed))
+                    throw XPathCancelled();
+            }
+
+            // the nodes of [begin, end) which pass the node test
+            void scan(const XPathStep& step, NodeId begin, NodeId end, std::vector<XPathNode>& out) {
+                for (NodeId id = begin; id < end; ++id) {
+                    if ((id & 0xFFF) == 0)
+                        checkCancel();
+                    push(step, XPathNode::tree(id), out);
+                }
+            }
+
+            // the nodes of the axis which pass the node test, in the order of the axis
+            void axisNodes(const XPathStep& step, const XPathNode& context, std::vector<XPathNode>& out) {
+                bool tree = (context.type == XPathNode::Tree);
+                NodeId node = context.node;
+                switch (step.axis) {
+                    case XPathAxis::Self:
+                        push(step, context, out);
+                        break;
+                    case XPathAxis::Child:
+                        if (tree) {
+                            for (NodeId child = doc.firstChild(node); child != NoNode; child = doc.nextSibling(child))
+                                push(step, XPathNode::tree(child), out);
+                        }
+                        break;
+                    case XPathAxis::DescendantOrSelf:
+                        push(step, context, out);
+                        // fall through
+                    case XPathAxis::Descendant:
+                        if (tree)
+                            scan(step, node + 1, subtreeEnd(node), out);
+                        break;
+                    case XPathAxis::Parent:
+                        if (!tree)
+                            push(step, XPathNode::tree(node), out);
+                        else if (doc.parent(node) != NoNode)
+                            push(step, XPathNode::tree(doc.parent(node)), out);
+                        break;
+                    case XPathAxis::AncestorOrSelf:
+                        push(step, context, out);
+                        // fall through
+                    case XPathAxis::Ancestor:
+                        pushAncestors(step, tree ? doc.parent(node) : node, out);
+                        break;
+                    case XPathAxis::FollowingSibling:
+                        if (tree) {
+                            for (NodeId sibling = doc.nextSibling(node); sibling != NoNode; sibling = doc.nextSibling(sibling))
+                                push(step, XPathNode::tree(sibling), out);
+                        }
+                        break;
+                    case XPathAxis::PrecedingSibling:
+                        if (tree) {
+                            for (NodeId sibling = previousSibling(node); sibling != NoNode; sibling = previousSibling(sibling))
+                                push(step, XPathNode::tree(sibling), out);
+                        }
+                        break;
+                    case XPathAxis::Following:
+                        // after the attributes of an element come its children
+                        scan(step, tree ? subtreeEnd(node) : node + 1, (NodeId)doc.nodeCount(), out);
+                        break;
+                    case XPathAxis::Preceding: {
+                        // every node before, but the ancestors
+                        NodeId ancestor = doc.parent(node);
+                        for (NodeId id = node; id-- > 1;) {
+                            if (id == ancestor) {
+                                ancestor = doc.parent(ancestor);
+                                continue;
+                            }
+                            push(step, XPathNode::tree(id), out);
+                        }
+                        break;
+                    }
+                    case XPathAxis::Attribute:
+                        if (tree && doc.kind(node) == NodeKind::Element) {
+                            for (AttrId attr = doc.attributesBegin(node), end = doc.attributesEnd(node); attr < end; ++attr)
+                                push(step, XPathNode::attribute(node, attr), out);
+                        }
+                        break;
+                    case XPathAxis::Namespace:
+                        if (tree && doc.kind(node) == NodeKind::Element)
+                            pushNamespaces(step, node, out);
+                        break;
+                }
+            }
+
+            bool reverseAxis(XPathAxis axis) const {
+                return axis == XPathAxis::Ancestor || axis == XPathAxis::AncestorOrSelf || axis == XPathAxis::Preceding || axis == XPathAxis::PrecedingSibling;
+            }
+
+            // keeps the nodes for which the predicate is true; positions follow the order of nodes
+            void filter(std::vector<XPathNode>& nodes, uint32_t predicate) {
+                const XPathExpr& expr = exprs[predicate];
+                if (expr.op == XPathOp::Number) {
+                    double position = expr.number;
+                    if (position >= 1 && position <= nodes.size() && position == std::floor(position)) {
+                        XPathNode kept = nodes[(size_t)position - 1];
+                        nodes.assign(1, kept);
+                    }
+                    else {
+                        nodes.clear();
+                    }
+                    return;
+                }
+                size_t kept = 0;
+                size_t size = nodes.size();
+                for (size_t i = 0; i < size; ++i) {
+                    checkCancel();
+                    XPathValue value = eval(predicate, { nodes[i], i + 1, size });
+                    bool keep = (value.type == XPathType::Number) ? value.number == (double)(i + 1) : toBoolean(value);
+                    if (keep)
+                        nodes[kept++] = nodes[i];
+                }
+                nodes.resize(kept);
+            }
+
+            static void sortNodes(std::vector<XPathNode>& nodes) {
+                if (!std::is_sorted(nodes.begin(), nodes.end()))
+                    std::sort(nodes.begin(), nodes.end());
+                nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+            }
+
+            void pushRange(const XPathStep& step, DocumentIndex::NodeRange range, std::vector<XPathNode>& out) {
+                for (NodeId node : range)
+                    push(step, XPathNode::tree(node), out);
+            }
+
+            bool identityLookup(const IndexLookup& lookup) const {
+                return lookup.kind == Lookup::Value && index->isIdentityAttribute(*lookup.attribute);
+            }
+
+            // the predicates a lookup answers: the first one, unless it is only narrowed to the elements having the attribute
+            size_t answered(const IndexLookup& lookup) const {
+                return (lookup.kind == Lookup::Attribute || identityLookup(lookup)) ? 1 : 0;
+            }
+
+            // does the index pay for the subtree [begin, end): a small one is scanned faster than the index is built
+            bool useIndex(const IndexLookup& lookup, NodeId begin, NodeId end) const {
+                if (!index || lookup.kind == Lookup::None)
+                    return false;
+                DocumentIndex::Part part = lookup.kind == Lookup::Name ? DocumentIndex::Part::Names : (identityLookup(lookup) ? DocumentIndex::Part::Values : DocumentIndex::Part::Attributes);
+                return index->built(part) || (size_t)(end - begin) * 16 >= doc.nodeCount();
+            }
+
+            /*
+            * The candidates of a descendant step in [begin, end) taken from the index, which pass
+            * the node test; gives how many predicates the lookup answered
+            */
+            size_t indexedNodes(const XPathStep& step, const IndexLookup& lookup, NodeId begin, NodeId end, std::vector<XPathNode>& out) {
+                if (lookup.kind == Lookup::Name) {
+                    const std::vector<uint8_t>& table = nameTable(step, false);
+                    std::vector<DocumentIndex::NodeRange> ranges;
+                    for (NameId name = 0; name < table.size(); ++name) {
+                        if (table[name] != 0)
+                            ranges.push_back(index->elementsNamed(name).within(begin, end));
+                    }
+                    if (ranges.size() == 1) {
+                        pushRange(step, ranges[0], out);
+                    }
+                    else if (ranges.size() > 1) {
+                        // several prefixes for the same name: the lists are merged in document order
+                        std::vector<NodeId> nodes;
+                        for (const auto& range : ranges)
+                            nodes.insert(nodes.end(), range.begin(), range.end());
+                        std::sort(nodes.begin(), nodes.end());
+                        pushRange(step, { nodes.data(), nodes.data() + nodes.size() }, out);
+                    }
+                    return 0;
+                }
+
+                // without the name in the document, no element has the attribute
+                NameId attribute = doc.findName(*lookup.attribute);
+                if (identityLookup(lookup)) {
+                    std::vector<NodeId> nodes = attribute == NoName ? std::vector<NodeId>() : index->elementsWithValue(attribute, *lookup.value);
+                    pushRange(step, DocumentIndex::NodeRange{ nodes.data(), nodes.data() + nodes.size() }.within(begin, end), out);
+                }
+                else if (attribute != NoName) {
+                    // the values of other attributes are not indexed: the predicate still compares them
+                    pushRange(step, index->elementsWithAttribute(attribute).within(begin, end), out);
+                }
+                return answered(lookup);
+            }
+
+            // the nodes of [begin, end) the descendant step selects, its predicates applied
+            void selectRange(const XPathStep& step, const IndexLookup& lookup, bool indexed, NodeId begin, NodeId end, std::vector<XPathNode>& out) {
+                size_t checked = 0;
+                if (indexed)
+                    checked = indexedNodes(step, lookup, begin, end, out);
+                else
+                    scan(step, begin, end, out);
+                for (size_t i = checked; i < step.predicates.size(); ++i)
+                    filter(out, step.predicates[i]);
+            }
+
+            /*
+            * A descendant step over a large subtree split across threads, see XPathOptions; false
+            * when it is evaluated on this thread. Each worker has its own evaluator, as the
+            * evaluator keeps its tables.
+            */
+            bool parallelStep(const XPathStep& step, const XPathNode& context, std::vector<XPathNode>& out) {
+                if (options.threads < 2 || context.type != XPathNode::Tree || step.axis != XPathAxis::Descendant || step.predicates.empty())
+                    return false;
+                NodeId begin = context.node + 1, end = subtreeEnd(context.node);
+                if ((size_t)(end - begin) < options.parallelNodes)
+                    return false;
+                // the positions would be counted in each chunk
+                if (std::any_of(step.predicates.begin(), step.predicates.end(), [this](uint32_t p) { return positional(exprs, p); }))
+                    return false;
+                IndexLookup lookup = indexLookup(exprs, step);
+                bool indexed = useIndex(lookup, begin, end);
+                // nothing is left to split when the lookup answers every predicate
+                if (indexed && answered(lookup) >= step.predicates.size())
+                    return false;
+
+                // several chunks per thread, so that the workers finish together; a chunk ends where
+                // the subtree of its last node does, when that subtree is not larger than a chunk
+                size_t chunkNodes = std::max<size_t>((end - begin) / ((size_t)options.threads * 4), 1);
+                std::vector<NodeId> cuts(1, begin);
+                while (cuts.back() < end) {
+                    NodeId cut = (NodeId)std::min<size_t>((size_t)cuts.back() + chunkNodes, end);
+                    if (cut < end && subtreeEnd(cut) - cut <= chunkNodes)
+                        cut = subtreeEnd(cut);
+                    cuts.push_back(cut);
+                }
+
+                std::vector<std::vector<XPathNode>> chunks(cuts.size() - 1);
+                std::atomic<size_t> next{ 0 };
+                std::atomic<bool> failed{ false };
+                std::exception_ptr error;
+                std::mutex mutex;
+                XPathOptions workerOptions = options;
+                workerOptions.threads = 1;
+                auto worker = [&]() {
+                    try {
+                        Evaluator evaluator(doc, exprs, workerOptions);
+                        for (size_t i = next++; i < chunks.size() && !failed; i = next++)
+                            evaluator.selectRange(step, lookup, indexed, cuts[i], cuts[i + 1], chunks[i]);
+                    }
+                    catch (...) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error)
+                            error = std::current_exception();
+                        failed = true;
+                    }
+                };
+                std::vector<std::thread> pool;
+                for (size_t t = 1; t < std::min<size_t>(options.threads, chunks.size()); ++t)
+                    pool.emplace_back(worker);
+                worker();
+                for (auto& thread : pool)
+                    thread.join();
+                if (error)
+                    std::rethrow_exception(error);
+
+                for (const auto& chunk : chunks)
+                    out.insert(out.end(), chunk.begin(), chunk.end());
+                return true;
+            }
+
+            void evalStep(const XPathStep& step, const std::vector<XPathNode>& input, std::vector<XPathNode>& output) {
+                std::vector<XPathNode> candidates;
+                for (const XPathNode& context : input) {
+                    candidates.clear();
+                    if (!parallelStep(step, context, candidates)) {
+                        IndexLookup lookup = (index && context.type == XPathNode::Tree) ? indexLookup(exprs, step) : IndexLookup();
+                        NodeId begin = context.node + 1, end = lookup.kind == Lookup::None ? begin : subtreeEnd(context.node);
+                        size_t checked = 0;
+                        if (useIndex(lookup, begin, end))
+                            checked = indexedNodes(step, lookup, begin, end, candidates);
+                        else
+                            axisNodes(step, context, candidates);
+                        for (size_t i = checked; i < step.predicates.size(); ++i)
+                            filter(candidates, step.predicates[i]);
+                    }
+                    if (reverseAxis(step.axis))
+                        std::reverse(candidates.begin(), candidates.end());
+                    output.insert(output.end(), candidates.begin(), candidates.end());
+                }
+                if (input.size() > 1 || reverseAxis(step.axis))
+                    sortNodes(output);
+            }
+
+            XPathValue evalPath(const XPathExpr& expr, const Context& context) {
+                std::vector<XPathNode> current;
+                if (expr.hasStart) {
+                    XPathValue start = eval(expr.args[0], context);
+                    if (start.type != XPathType::NodeSet)
+                        throw XPathError("a path must start from a node-set");
+                    current = std::move(start.nodes);
+                }
+                else {
+                    current.push_back(expr.absolute ? XPathNode::tree(doc.root()) : context.node);
+                }
+                std::vector<XPathNode> next;
+                for (const XPathStep& step : expr.steps) {
+                    next.clear();
+                    evalStep(step, current, next);
+                    current.swap(next);
+                    if (current.empty())
+                        break;
+                }
+                XPathValue value;
+                value.nodes = std::move(current);
+                return value;
+            }
+
+            /*
+            * Conversions
+            */
+            std::string_view namespacePrefix(const XPathNode& node) const {
+                if (node.index == NoAttr)
+                    return "xml";
+                std::string_view qname = doc.attributeName(node.index);
+                return qname.size() > 6 ? qname.substr(6) : std::string_view();
+            }
+
+            std::string toString(const XPathValue& value) const {
+                switch (value.type) {
+                    case XPathType::NodeSet: return value.nodes.empty() ? std::string() : xpathStringValue(doc, value.nodes.front());
+                    case XPathType::Boolean: return value.boolean ? "true" : "false";
+                    case XPathType::Number: return xpathNumberToString(value.number);
+                    default: return value.string;
+                }
+            }
+
+            double toNumber(const XPathValue& value) const {
+                switch (value.type) {
+                    case XPathType::Boolean: return value.boolean ? 1 : 0;
+                    case XPathType::Number: return value.number;
+                    default: return xpathStringToNumber(toString(value));
+                }
+            }
+
+            static bool toBoolean(const XPathValue& value) {
+                switch (value.type) {
+                    case XPathType::NodeSet: return !value.nodes.empty();
+                    case XPathType::Boolean: return value.boolean;
+                    case XPathType::Number: return value.number != 0 && !std::isnan(value.number);
+                    default: return !value.string.empty();
+                }
+            }
+
+            static XPathValue makeBoolean(bool b) {
+                XPathValue value;
+                value.type = XPathType::Boolean;
+                value.boolean = b;
+                return value;
+            }
+
+            static XPathValue makeNumber(double n) {
+                XPathValue value;
+                value.type = XPathType::Number;
+                value.number = n;
+                return value;
+            }
+
+            static XPathValue makeString(std::string s) {
+                XPathValue value;
+                value.type = XPathType::String;
+                value.string = std::move(s);
+                return value;
+            }
+
+            /*
+            * Comparisons (XPath 1.0, 3.4)
+            */
+            static bool compareNumbers(XPathOp op, double a, double b) {
+                switch (op) {
+                    case XPathOp::Equal: return a == b;
+                    case XPathOp::NotEqual: return a != b;
+                    case XPathOp::Less: return a < b;
+                    case XPathOp::LessEqual: return a <= b;
+                    case XPathOp::Greater: return a > b;
+                    default: return a >= b;
+                }
+            }
+
+            static XPathOp swapped(XPathOp op) {
+                switch (op) {
+                    case XPathOp::Less: return XPathOp::Greater;
+                    case XPathOp::LessEqual: return XPathOp::GreaterEqual;
+                    case XPathOp::Greater: return XPathOp::Less;
+                    case XPathOp::GreaterEqual: return XPathOp::LessEqual;
+                    default: return op;
+                }
+            }
+
+            // a node-set compared with a value which is not a node-set
+            bool compareNodes(XPathOp op, const std::vector<XPathNode>& nodes, const XPathValue& other) const {
+                bool equality = (op == XPathOp::Equal || op == XPathOp::NotEqual);
+                if (other.type == XPathType::Boolean)
+                    return compareNumbers(op, !nodes.empty(), other.boolean);
+                if (other.type == XPathType::Number || !equality) {
+                    double number = toNumber(other);
+                    for (const XPathNode& node : nodes) {
+                        if (compareNumbers(op, xpathStringToNumber(xpathStringValue(doc, node)), number))
+                            return true;
+                    }
+                    return false;
+                }
+                std::string scratch;
+                for (const XPathNode& node : nodes) {
+                    bool equal = (stringView(node, scratch) == other.string);
+                    if (equal == (op == XPathOp::Equal))
+                        return true;
+                }
+                return false;
+            }
+
+            bool compare(XPathOp op, const XPathValue& left, const XPathValue& right) const {
+                bool equality = (op == XPathOp::Equal || op == XPathOp::NotEqual);
+                if (left.type == XPathType::NodeSet && right.type == XPathType::NodeSet) {
+                    if (equality) {
+                        std::vector<std::string> values;
+                        for (const XPathNode& node : right.nodes)
+                            values.push_back(xpathStringValue(doc, node));
+                        for (const XPathNode& node : left.nodes) {
+                            std::string value = xpathStringValue(doc, node);
+                            for (const std::string& other : values) {
+                                if ((value == other) == (op == XPathOp::Equal))
+                                    return true;
+                            }
+                        }
+                        return false;
+                    }
+                    std::vector<double> numbers;
+                    for (const XPathNode& node : right.nodes)
+                        numbers.push_back(xpathStringToNumber(xpathStringValue(doc, node)));
+                    for (const XPathNode& node : left.nodes) {
+                        double number = xpathStringToNumber(xpathStringValue(doc, node));
+                        for (double other : numbers) {
+                            if (compareNumbers(op, number, other))
+                                return true;
+                        }
+                    }
+                    return false;
+                }
+                if (left.type == XPathType::NodeSet)
+                    return compareNodes(op, left.nodes, right);
+                if (right.type == XPathType::NodeSet)
+                    return compareNodes(swapped(op), right.nodes, left);
+                if (equality) {
+                    bool equal;
+                    if (left.type == XPathType::Boolean || right.type == XPathType::Boolean)
+                        equal = (toBoolean(left) == toBoolean(right));
+                    else if (left.type == XPathType::Number || right.type == XPathType::Number)
+                        equal = (toNumber(left) == toNumber(right));
+                    else
+                        equal = (left.string == right.string);
+                    return equal == (op == XPathOp::Equal);
+                }
+                return compareNumbers(op, toNumber(left), toNumber(right));
+            }
+
+            // string-value without copy when the source holds it as is
+            std::string_view stringView(const XPathNode& node, std::string& scratch) const {
+                if (node.type == XPathNode::Attribute) {
+                    std::string_view raw = doc.rawAttributeValue(node.index);
+                    if (raw.find_first_of("&\t\r\n") == std::string_view::npos)
+                        return raw;
+                }
+                else if (node.type == XPathNode::Tree && doc.kind(node.node) != NodeKind::Element && doc.kind(node.node) != NodeKind::Document) {
+                    std::string_view raw = doc.rawValue(node.node);
+                    if (doc.kind(node.node) != NodeKind::Text || raw.find('&') == std::string_view::npos)
+                        return raw;
+                }
+                scratch = xpathStringValue(doc, node);
+                return scratch;
+            }
+
+            /*
+            * Functions
+            */
+            const std::vector<XPathNode>& nodeSetArg(const XPathValue& value, const char* function) const {
+                if (value.type != XPathType::NodeSet)
+                    throw XPathError(std::string("the argument of ") + function + "() must be a node-set");
+                return value.nodes;
+            }
+
+            // the node of the functions on names: the first of the argument, or the context node
+            bool nameNode(const XPathExpr& expr, const Context& context, const char* function, XPathNode& node) {
+                if (expr.args.empty()) {
+                    node = context.node;
+                    return true;
+                }
+                XPathValue arg = eval(expr.args[0], context);
+                const std::vector<XPathNode>& nodes = nodeSetArg(arg, function);
+                if (nodes.empty())
+                    return false;
+                node = nodes.front();
+                return true;
+            }
+
+            std::string_view qualifiedName(const XPathNode& node) const {
+                switch (node.type) {
+                    case XPathNode::Attribute: return doc.attributeName(node.index);
+                    case XPathNode::Namespace: return namespacePrefix(node);
+                    default:
+                        if (doc.kind(node.node) == NodeKind::Element || doc.kind(node.node) == NodeKind::ProcessingInstruction)
+                            return doc.name(node.node);
+                        return std::string_view();
+                }
+            }
+
+            std::string_view namespaceUri(const XPathNode& node) const {
+                if (node.type == XPathNode::Attribute)
+                    return doc.attributeNamespaceUri(node.node, node.index);
+                if (node.type == XPathNode::Tree && doc.kind(node.node) == NodeKind::Element)
+                    return doc.namespaceUri(node.node);
+                return std::string_view();
+            }
+
+            void readIdAttributes() {
+                idAttributesRead = true;
+                std::string_view doctype = doc.doctype();
+                size_t pos = 0;
+                while ((pos = doctype.find("<!ATTLIST", pos)) != std::string_view::npos) {
+                    pos += 9;
+                    // element name, then (name, type, default) for each attribute
+                    std::vector<std::string_view> words;
+                    while (pos < doctype.size() && doctype[pos] != '>') {
+                        if (isSpace(doctype[pos])) {
+                            ++pos;
+                            continue;
+                        }
+                        size_t start = pos;
+                        if (doctype[pos] == '"' || doctype[pos] == '\'') {
+                            size_t end = doctype.find(doctype[pos], pos + 1);
+                            pos = (end == std::string_view::npos) ? doctype.size() : end + 1;
+                        }
+                        else if (doctype[pos] == '(') {
+                            size_t end = doctype.find(')', pos);
+                            pos = (end == std::string_view::npos) ? doctype.size() : end + 1;
+                        }
+                        else {
+                            while (pos < doctype.size() && !isSpace(doctype[pos]) && doctype[pos] != '>')
+                                ++pos;
+                        }
+                        words.push_back(doctype.substr(start, pos - start));
+                    }
+                    for (size_t i = 1; i + 1 < words.size(); ++i) {
+                        if (words[i + 1] == "ID" && words[i][0] != '#' && words[i][0] != '"' && words[i][0] != '\'')
+                            idAttributes.emplace_back(std::string(words[0]), std::string(words[i]));
+                    }
+                }
+            }
+
+            void splitTokens(std::string_view text, std::vector<std::string>& tokens) const {
+                size_t pos = 0;
+                while (pos < text.size()) {
+                    while (pos < text.size() && isSpace(text[pos]))
+                        ++pos;
+                    size_t start = pos;
+                    while (pos < text.size() && !isSpace(text[pos]))
+                        ++pos;
+                    if (pos > start)
+                        tokens.emplace_back(text.substr(start, pos - start));
+                }
+            }
+
+            XPathValue id(const XPathValue& arg) {
+                std::vector<std::string> ids;
+                if (arg.type == XPathType::NodeSet) {
+                    for (const XPathNode& node : arg.nodes)
+                        splitTokens(xpathStringValue(doc, node), ids);
+                }
+                else {
+                    splitTokens(toString(arg), ids);
+                }
+                if (!idAttributesRead)
+                    readIdAttributes();
+
+                XPathValue value;
+                if (ids.empty() || idAttributes.empty())
+                    return value;
+                for (NodeId node = 1; node < doc.nodeCount() && !ids.empty(); ++node) {
+                    if (doc.kind(node) != NodeKind::Element)
+                        continue;
+                    for (AttrId attr = doc.attributesBegin(node), end = doc.attributesEnd(node); attr < end; ++attr) {
+                        std::pair<std::string, std::string> key(std::string(doc.name(node)), std::string(doc.attributeName(attr)));
+                        if (std::find(idAttributes.begin(), idAttributes.end(), key) == idAttributes.end())
+                            continue;
+                        std::vector<std::string> values;
+                        splitTokens(doc.attributeValue(attr), values);
+                        if (values.size() != 1)
+                            continue;
+                        auto found = std::find(ids.begin(), ids.end(), values[0]);
+                        if (found != ids.end()) {
+                            value.nodes.push_back(XPathNode::tree(node));
+                            ids.erase(std::remove(ids.begin(), ids.end(), values[0]), ids.end());
+                            break;
+                        }
+                    }
+                }
+                return value;
+            }
+
+            bool lang(const std::string& language, const Context& context) const {
+                NodeId node = context.node.node;
+                for (; node != NoNode; node = doc.parent(node)) {
+                    if (doc.kind(node) != NodeKind::Element)
+                        continue;
+                    AttrId attr = doc.findAttribute(node, "xml:lang");
+                    if (attr == NoAttr)
+                        continue;
+                    std::string value = doc.attributeValue(attr);
+                    if (value.size() < language.size())
+                        return false;
+                    for (size_t i = 0; i < language.size(); ++i) {
+                        if (tolower((unsigned char)value[i]) != tolower((unsigned char)language[i]))
+                            return false;
+                    }
+                    return value.size() == language.size() || value[language.size()] == '-';
+                }
+                return false;
+            }
+
+            static double round(double n) {
+                if (std::isnan(n) || std::isinf(n))
+                    return n;
+                if (n < 0 && n >= -0.5)
+                    return -0.0;
+                return std::floor(n + 0.5);
+            }
+
+            std::string substring(const std::string& s, double start, double length, bool hasLength) const {
+                double first = round(start);
+                double last = hasLength ? first + round(length) : std::numeric_limits<double>::infinity();
+                std::string res;
+                double position = 1;
+                for (size_t pos = 0; pos < s.size(); ++position) {
+                    size_t next = nextChar(s, pos);
+                    if (position >= first && position < last)
+                        res.append(s, pos, next - pos);
+                    pos = next;
+                }
+                return res;
+            }
+
+            std::string translate(const std::string& s, const std::string& from, const std::string& to) const {
+                std::vector<std::string_view> fromChars, toChars;
+                for (size_t pos = 0; pos < from.size();) {
+                    size_t next = nextChar(from, pos);
+                    fromChars.push_back(std::string_view(from).substr(pos, next - pos));
+                    pos = next;
+                }
+                for (size_t pos = 0; pos < to.size();) {
+                    size_t next = nextChar(to, pos);
+                    toChars.push_back(std::string_view(to).substr(pos, next - pos));
+                    pos = next;
+                }
+                std::string res;
+                for (size_t pos = 0; pos < s.size();) {
+                    size_t next = nextChar(s, pos);
+                    std::string_view c = std::string_view(s).substr(pos, next - pos);
+                    auto found = std::find(fromChars.begin(), fromChars.end(), c);
+                    if (found == fromChars.end())
+                        res += c;
+                    else if ((size_t)(found - fromChars.begin()) < toChars.size())
+                        res += toChars[found - fromChars.begin()];
+                    pos = next;
+                }
+                return res;
+            }
+
+            std::string stringArg(const XPathExpr& expr, size_t i, const Context& context) {
+                if (i >= expr.args.size())
+                    return xpathStringValue(doc, context.node);
+                return toString(eval(expr.args[i], context));
+            }
+
+            XPathValue function(const XPathExpr& expr, const Context& context) {
+                switch (expr.function) {
+                    case XPathFunction::Last:
+                        return makeNumber((double)context.size);
+                    case XPathFunction::Position:
+                        return makeNumber((double)context.position);
+                    case XPathFunction::Count:
+                        return makeNumber((double)nodeSetArg(eval(expr.args[0], context), "count").size());
+                    case XPathFunction::Id:
+                        return id(eval(expr.args[0], context));
+                    case XPathFunction::LocalName: {
+                        XPathNode node;
+                        if (!nameNode(expr, context, "local-name", node))
+                            return makeString("");
+                        return makeString(std::string(Document::localNameOf(qualifiedName(node))));
+                    }
+                    case XPathFunction::NamespaceUri: {
+                        XPathNode node;
+                        if (!nameNode(expr, context, "namespace-uri", node))
+                            return makeString("");
+                        return makeString(std::string(namespaceUri(node)));
+                    }
+                    case XPathFunction::Name: {
+                        XPathNode node;
+                        if (!nameNode(expr, context, "name", node))
+                            return makeString("");
+                        return makeString(std::string(qualifiedName(node)));
+                    }
+                    case XPathFunction::String:
+                        return makeString(stringArg(expr, 0, context));
+                    case XPathFunction::Concat: {
+                        std::string res;
+                        for (uint32_t arg : expr.args)
+                            res += toString(eval(arg, context));
+                        return makeString(std::move(res));
+                    }
+                    case XPathFunction::StartsWith: {
+                        std::string s = stringArg(expr, 0, context);
+                        std::string prefix = stringArg(expr, 1, context);
+                        return makeBoolean(s.compare(0, prefix.size(), prefix) == 0);
+                    }
+                    case XPathFunction::Contains:
+                        return makeBoolean(stringArg(expr, 0, context).find(stringArg(expr, 1, context)) != std::string::npos);
+                    case XPathFunction::SubstringBefore: {
+                        std::string s = stringArg(expr, 0, context);
+                        size_t found = s.find(stringArg(expr, 1, context));
+                        return makeString(found == std::string::npos ? std::string() : s.substr(0, found));
+                    }
+                    case XPathFunction::SubstringAfter: {
+                        std::string s = stringArg(expr, 0, context);
+                        std::string sep = stringArg(expr, 1, context);
+                        size_t found = s.find(sep);
+                        return makeString(found == std::string::npos ? std::string() : s.substr(found + sep.size()));
+                    }
+                    case XPathFunction::Substring: {
+                        std::string s = stringArg(expr, 0, context);
+                        double start = toNumber(eval(expr.args[1], context));
+                        bool hasLength = expr.args.size() > 2;
+                        double length = hasLength ? toNumber(eval(expr.args[2], context)) : 0;
+                        return makeString(substring(s, start, length, hasLength));
+                    }
+                    case XPathFunction::StringLength:
+                        return makeNumber((double)charLength(stringArg(expr, 0, context)));
+                    case XPathFunction::NormalizeSpace: {
+                        std::string s = stringArg(expr, 0, context);
+                        std::string res;
+                        bool space = false;
+                        for (char c : s) {
+                            if (isSpace(c)) {
+                                space = !res.empty();
+                                continue;
+                            }
+                            if (space)
+                                res += ' ';
+                            space = false;
+                            res += c;
+                        }
+                        return makeString(std::move(res));
+                    }
+                    case XPathFunction::Translate:
+                        return makeString(translate(stringArg(expr, 0, context), stringArg(expr, 1, context), stringArg(expr, 2, context)));
+                    case XPathFunction::Boolean:
+                        return makeBoolean(toBoolean(eval(expr.args[0], context)));
+                    case XPathFunction::Not:
+                        return makeBoolean(!toBoolean(eval(expr.args[0], context)));
+                    case XPathFunction::True:
+                        return makeBoolean(true);
+                    case XPathFunction::False:
+                        return makeBoolean(false);
+                    case XPathFunction::Lang:
+                        return makeBoolean(lang(stringArg(expr, 0, context), context));
+                    case XPathFunction::Number:
+                        if (expr.args.empty())
+                            return makeNumber(xpathStringToNumber(xpathStringValue(doc, context.node)));
+                        return makeNumber(toNumber(eval(expr.args[0], context)));
+                    case XPathFunction::Sum: {
+                        double sum = 0;
+                        XPathValue arg = eval(expr.args[0], context);
+                        for (const XPathNode& node : nodeSetArg(arg, "sum"))
+                            sum += xpathStringToNumber(xpathStringValue(doc, node));
+                        return makeNumber(sum);
+                    }
+                    case XPathFunction::Floor:
+                        return makeNumber(std::floor(toNumber(eval(expr.args[0], context))));
+                    case XPathFunction::Ceiling:
+                        return makeNumber(std::ceil(toNumber(eval(expr.args[0], context))));
+                    case XPathFunction::Round:
+                        return makeNumber(round(toNumber(eval(expr.args[0], context))));
+                }
+                return XPathValue();
+            }
+
+        public:
+            Evaluator(const Document& doc, const std::vector<XPathExpr>& exprs, const XPathOptions& options = XPathOptions())
+                : doc(doc), exprs(exprs), index(options.index), options(options), defaultNamespaces(doc.findName("xmlns") != NoName) {}
+
+            XPathValue eval(uint32_t index, const Context& context) {
+                const XPathExpr& expr = exprs[index];
+                switch (expr.op) {
+                    case XPathOp::Or:
+                        return makeBoolean(toBoolean(eval(expr.args[0], context)) || toBoolean(eval(expr.args[1], context)));
+                    case XPathOp::And:
+                        return makeBoolean(toBoolean(eval(expr.args[0], context)) && toBoolean(eval(expr.args[1], context)));
+                    case XPathOp::Equal:
+                    case XPathOp::NotEqual:
+                    case XPathOp::Less:
+                    case XPathOp::LessEqual:
+                    case XPathOp::Greater:
+                    case XPathOp::GreaterEqual:
+                        return makeBoolean(compare(expr.op, eval(expr.args[0], context), eval(expr.args[1], context)));
+                    case XPathOp::Add:
+                        return makeNumber(toNumber(eval(expr.args[0], context)) + toNumber(eval(expr.args[1], context)));
+                    case XPathOp::Subtract:
+                        return makeNumber(toNumber(eval(expr.args[0], context)) - toNumber(eval(expr.args[1], context)));
+                    case XPathOp::Multiply:
+                        return makeNumber(toNumber(eval(expr.args[0], context)) * toNumber(eval(expr.args[1], context)));
+                    case XPathOp::Divide:
+                        return makeNumber(toNumber(eval(expr.args[0], context)) / toNumber(eval(expr.args[1], context)));
+                    case XPathOp::Modulo:
+                        return makeNumber(std::fmod(toNumber(eval(expr.args[0], context)), toNumber(eval(expr.args[1], context))));
+                    case XPathOp::Negate:
+                        return makeNumber(-toNumber(eval(expr.args[0], context)));
+                    case XPathOp::Union: {
+                        XPathValue left = eval(expr.args[0], context);
+                        XPathValue right = eval(expr.args[1], context);
+                        if (left.type != XPathType::NodeSet || right.type != XPathType::NodeSet)
+                            throw XPathError("the operands of '|' must be node-sets");
+                        left.nodes.insert(left.nodes.end(), right.nodes.begin(), right.nodes.end());
+                        sortNodes(left.nodes);
+                        return left;
+                    }
+                    case XPathOp::Literal:
+                        return makeString(expr.literal);
+                    case XPathOp::Number:
+                        return makeNumber(expr.number);
+                    case XPathOp::Function:
+                        return function(expr, context);
+                    case XPathOp::Filter: {
+                        XPathValue value = eval(expr.args[0], context);
+                        if (value.type != XPathType::NodeSet)
+                            throw XPathError("predicates apply to node-sets only");
+                        for (uint32_t predicate : expr.predicates)
+                            filter(value.nodes, predicate);
+                        return value;
+                    }
+                    case XPathOp::Path:
+                        return evalPath(expr, context);
+                }
+                return XPathValue();
+            }
+        };
+
+        /*
+        * Constant folding: an operation or a function whose operands are all constants gives the
+        * same value on every node of every document, so it is evaluated once, when compiling
+        */
+        bool isConstant(const XPathExpr& expr) {
+            switch (expr.op) {
+                case XPathOp::Literal:
+                case XPathOp::Number:
+                    return true;
+                case XPathOp::Function:
+                    return expr.function == XPathFunction::True || expr.function == XPathFunction::False;
+                default:
+                    return false;
+            }
+        }
+
+        bool isFoldable(const std::vector<XPathExpr>& exprs, const XPathExpr& expr) {
+            switch (expr.op) {
+                case XPathOp::Literal:
+                case XPathOp::Number:
+                case XPathOp::Union:
+                case XPathOp::Filter:
+                case XPathOp::Path:
+                    return false;
+                case XPathOp::Function:
+                    switch (expr.function) {
+                        // the context, or the document
+                        case XPathFunction::Last:
+                        case XPathFunction::Position:
+                        case XPathFunction::Id:
+                        case XPathFunction::Lang:
+                        // constants already
+                        case XPathFunction::True:
+                        case XPathFunction::False:
+                            return false;
+                        default:
+                            // without argument, the functions take the context node
+                            if (expr.args.empty())
+                                return false;
+                            break;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return std::all_of(expr.args.begin(), expr.args.end(), [&exprs](uint32_t arg) { return isConstant(exprs[arg]); });
+        }
+
+        // the operands come before the expressions using them, so a single pass folds nested constants
+        size_t foldConstants(std::vector<XPathExpr>& exprs) {
+            static const Document empty("", 0);
+            size_t folded = 0;
+            for (size_t i = 0; i < exprs.size(); ++i) {
+                if (!isFoldable(exprs, exprs[i]))
+                    continue;
+                XPathValue value = Evaluator(empty, exprs).eval((uint32_t)i, { XPathNode::tree(empty.root()), 1, 1 });
+                XPathExpr& expr = exprs[i];
+                expr.args.clear();
+                switch (value.type) {
+                    case XPathType::Boolean:
+                        expr.op = XPathOp::Function;
+                        expr.function = value.boolean ? XPathFunction::True : XPathFunction::False;
+                        break;
+                    case XPathType::Number:
+                        expr.op = XPathOp::Number;
+                        expr.number = value.number;
+                        break;
+                    default:
+                        expr.op = XPathOp::Literal;
+                        expr.literal = value.string;
+                        break;
+                }
+                ++folded;
+            }
+            return folded;
+        }
+    }
+
+    XPathNamespaces parseSelectionNamespaces(std::string_view declarations) {
+        XPathNamespaces namespaces;
+        size_t pos = 0;
+        while (true) {
+            while (pos < declarations.size() && isSpace(declarations[pos]))
+                ++pos;
+            if (pos >= declarations.size())
+                break;
+            if (declarations.compare(pos, 5, "xmlns"))
+                throw XPathError("namespace declaration expected", pos);
+            size_t nameEnd = pos + 5;
+            std::string prefix;
+            if (nameEnd < declarations.size() && declarations[nameEnd] == ':') {
+                size_t end = readNCName(declarations, nameEnd + 1);
+                if (end == nameEnd + 1)
+                    throw XPathError("namespace prefix expected", nameEnd + 1);
+                prefix = std::string(declarations.substr(nameEnd + 1, end - nameEnd - 1));
+                nameEnd = end;
+            }
+            pos = nameEnd;
+            while (pos < declarations.size() && isSpace(declarations[pos]))
+                ++pos;
+            if (pos >= declarations.size() || declarations[pos] != '=')
+                throw XPathError("'=' expected", pos);
+            ++pos;
+            while (pos < declarations.size() && isSpace(declarations[pos]))
+                ++pos;
+            if (pos >= declarations.size() || (declarations[pos] != '"' && declarations[pos] != '\''))
+                throw XPathError("quoted namespace URI expected", pos);
+            size_t end = declarations.find(declarations[pos], pos + 1);
+            if (end == std::string_view::npos)
+                throw XPathError("unterminated namespace URI", pos);
+            // the default namespace does not apply to XPath names
+            if (!prefix.empty())
+                namespaces[prefix] = std::string(declarations.substr(pos + 1, end - pos - 1));
+            pos = end + 1;
+        }
+        return namespaces;
+    }
+
+    XPathExpression::XPathExpression(std::string_view expression, const XPathNamespaces& namespaces) : text(expression) {
+        std::vector<Token> tokens = tokenize(text);
+        Parser(tokens, namespaces, exprs).parse();
+        folds = foldConstants(exprs);
+    }
+
+    XPathValue XPathExpression::evaluate(const Document& document) const {
+        return evaluate(document, XPathNode::tree(document.root()));
+    }
+
+    XPathValue XPathExpression::evaluate(const Document& document, const XPathNode& context) const {
+        Evaluator evaluator(document, exprs);
+        return evaluator.eval(root(), { context, 1, 1 });
+    }
+
+    XPathValue XPathExpression::evaluate(const DocumentIndex& index) const {
+        return evaluate(index, XPathNode::tree(index.document().root()));
+    }
+
+    XPathValue XPathExpression::evaluate(const DocumentIndex& index, const XPathNode& context) const {
+        XPathOptions options;
+        options.index = &index;
+        return evaluate(index.document(), context, options);
+    }
+
+    XPathValue XPathExpression::evaluate(const Document& document, const XPathNode& context, const XPathOptions& options) const {
+        Evaluator evaluator(document, exprs, options);
+        return evaluator.eval(root(), { context, 1, 1 });
+    }
+
+    std::vector<std::string> xpathIndexLookups(const XPathExpression& expression) {
+        std::vector<std::string> lookups;
+        for (const XPathExpr& expr : expression.tree()) {
+            for (const XPathStep& step : expr.steps) {
+                IndexLookup lookup = indexLookup(expression.tree(), step);
+                if (lookup.kind == Lookup::None)
+                    continue;
+                std::string text = "descendant::";
+                if (step.test == XPathTest::Name)
+                    text += (step.uri.empty() ? "" : "{" + step.uri + "}") + step.name;
+                else
+                    text += (step.test == XPathTest::AnyLocalName ? "{" + step.uri + "}*" : "*");
+                switch (lookup.kind) {
+                    case Lookup::Name: text += ": element name"; break;
+                    case Lookup::Attribute: text += ": attribute @" + *lookup.attribute; break;
+                    default: text += ": value of @" + *lookup.attribute + ", attribute @" + *lookup.attribute + " when not an identity attribute"; break;
+                }
+                lookups.push_back(text);
+            }
+        }
+        return lookups;
+    }
+
+    std::string xpathStringValue(const Document& document, const XPathNode& node) {
+        switch (node.type) {
+            case XPathNode::Attribute:
+                return document.attributeValue(node.index);
+            case XPathNode::Namespace:
+                return node.index == NoAttr ? std::string(xmlNamespace) : std::string(document.rawAttributeValue(node.index));
+            default:
+                return document.value(node.node);
+        }
+    }
+
+    std::string xpathNumberToString(double number) {
+        if (std::isnan(number))
+            return "NaN";
+        if (std::isinf(number))
+            return number > 0 ? "Infinity" : "-Infinity";
+        if (number == 0)
+            return "0";
+        // the shortest decimal which reads back as the number, without exponent
+        char buffer[512];
+        auto res = std::to_chars(buffer, buffer + sizeof(buffer), number, std::chars_format::fixed);
+        return std::string(buffer, res.ptr);
+    }
+
+    double xpathStringToNumber(std::string_view text) {
+        size_t begin = 0, end = text.size();
+        while (begin < end && isSpace(text[begin]))
+            ++begin;
+        while (end > begin && isSpace(text[end - 1]))
+            --end;
+        std::string_view s = text.substr(begin, end - begin);
+        // -? (Digits ('.' Digits?)? | '.' Digits)
+        size_t pos = (!s.empty() && s[0] == '-') ? 1 : 0;
+        size_t digits = 0;
+        while (pos < s.size() && isDigit(s[pos])) {
+            ++pos;
+            ++digits;
+        }
+        if (pos < s.size() && s[pos] == '.') {
+            ++pos;
+            while (pos < s.size() && isDigit(s[pos])) {
+                ++pos;
+                ++digits;
+            }
+        }
+        if (!digits || pos != s.size())
+            return std::numeric_limits<double>::quiet_NaN();
+        double number = 0;
+        std::from_chars(s.data(), s.data() + s.size(), number, std::chars_format::fixed);
+        return number;
+    }
+
+    const char* xpathEntryType(const Document& document, const XPathNode& node) {
+        if (node.type != XPathNode::Tree)
+            return "attribute";
+        switch (document.kind(node.node)) {
+            case NodeKind::Document: return "document";
+            case NodeKind::Element: return "element";
+            case NodeKind::Text: return "text";
+            case NodeKind::CData: return "cdatasection";
+            case NodeKind::Comment: return "comment";
+            case NodeKind::ProcessingInstruction: return "processinginstruction";
+        }
+        return "";
+    }
+
+    std::string xpathEntryName(const Document& document, const XPathNode& node) {
+        if (node.type == XPathNode::Attribute)
+            return std::string(document.attributeName(node.index));
+        if (node.type == XPathNode::Namespace)
+            return node.index == NoAttr ? "xmlns:xml" : std::string(document.attributeName(node.index));
+        switch (document.kind(node.node)) {
+            case NodeKind::Document: return "#document";
+            case NodeKind::Text: return "#text";
+            case NodeKind::CData: return "#cdata-section";
+            case NodeKind::Comment: return "#comment";
+            default: return std::string(document.name(node.node));
+        }
+    }
+
+    std::string xpathEntryValue(const Document& document, const XPathNode& node) {
+        if (node.type == XPathNode::Attribute)
+            return document.attributeValue(node.index);
+        if (node.type == XPathNode::Namespace)
+            return xpathStringValue(document, node);
+        switch (document.kind(node.node)) {
+            case NodeKind::Element: {
+                // only the direct text children, not the text of the descendants
+                std::string value;
+                for (NodeId child = document.firstChild(node.node); child != NoNode; child = document.nextSibling(child)) {
+                    if (document.kind(child) == NodeKind::Text)
+                        value += document.value(child);
+                }
+                return value;
+            }
+            case NodeKind::Text:
+                return document.value(node.node);
+            case NodeKind::CData:
+            case NodeKind::Comment:
+            case NodeKind::ProcessingInstruction:
+                return std::string(document.rawValue(node.node));
+            default:
+                return "";
+        }
+    }
+
+    XPathEntry xpathEntry(const Document& document, const XPathNode& node) {
+        return { xpathEntryType(document, node), xpathEntryName(document, node), xpathEntryValue(document, node) };
+    }
+
+    size_t xpathNodeOffset(const Document& document, const XPathNode& node) {
+        if (node.type != XPathNode::Tree && node.index != NoAttr)
+            return document.attributeOffset(node.index);
+        return document.offset(node.node);
+    }
+
+    XPathCursor::XPathCursor(const Document& document, const XPathExpression& expression) : doc(&document) {
+        XPathValue value = expression.evaluate(document);
+        if (value.type != XPathType::NodeSet)
+            throw XPathError("expression does not evaluate to a node-set");
+        selected = std::move(value.nodes);
+    }
+
+    XPathCursor::XPathCursor(const DocumentIndex& index, const XPathExpression& expression) : doc(&index.document()) {
+        XPathValue value = expression.evaluate(index);
+        if (value.type != XPathType::NodeSet)
+            throw XPathError("expression does not evaluate to a node-set");
+        selected = std::move(value.nodes);
+    }
+
+    XPathCursor::XPathCursor(const Document& document, const XPathExpression& expression, const XPathOptions& options) : doc(&document) {
+        XPathValue value = expression.evaluate(document, XPathNode::tree(document.root()), options);
+        if (value.type != XPathType::NodeSet)
+            throw XPathError("expression does not evaluate to a node-set");
+        selected = std::move(value.nodes);
+    }
+
+    std::vector<XPathEntry> XPathCursor::entries(size_t first, size_t count) const {
+        std::vector<XPathEntry> res;
+        if (first >= selected.size())
+            return res;
+        size_t last = selected.size() - first < count ? selected.size() : first + count;
+        res.reserve(last - first);
+        for (size_t i = first; i < last; ++i)
+            res.push_back(xpathEntry(*doc, selected[i]));
+        return res;
+    }
+
+    std::vector<XPathEntry> selectEntries(const Document& document, const XPathExpression& expression) {
+        XPathCursor cursor(document, expression);
+        return cursor.entries(0, cursor.size());
+    }
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "XmlDocument.h"
+#include "XmlIndex.h"
+
+/*
+* XPath 1.0 over the read-only Document: all axes, predicates and the core function library.
+* The prefixes used in an expression are bound by the caller, as with the SelectionNamespaces
+* property of MSXML, whose selectNodes() results selectEntries() reproduces. Variables are not
+* supported (there is no way to bind them, as with selectNodes()).
+* An expression is compiled once into an XPathExpression, which can then be evaluated on any
+* number of documents. Evaluated with a DocumentIndex, the descendant steps testing a name, or an
+* attribute in their first predicate, take their candidates from the index rather than from a scan
+* of the subtree (see xpathIndexLookups()).
+*/
+namespace QuickXml {
+    // a node of the XPath data model: a node of the document, an attribute, or a namespace in scope of an element
+    struct XPathNode {
+        enum Type : uint8_t { Tree, Namespace, Attribute };
+
+        NodeId node = 0;        // the tree node, or the element of the attribute or namespace
+        Type type = Tree;
+        uint32_t index = 0;     // the attribute; for a namespace, the declaring attribute (NoAttr for xml)
+
+        static XPathNode tree(NodeId node) { return { node, Tree, 0 }; }
+        static XPathNode attribute(NodeId element, AttrId attr) { return { element, Attribute, attr }; }
+        static XPathNode ns(NodeId element, AttrId declaration) { return { element, Namespace, declaration }; }
+
+        bool operator==(const XPathNode& other) const { return node == other.node && type == other.type && index == other.index; }
+        bool operator!=(const XPathNode& other) const { return !(*this == other); }
+        // document order: an element, then its namespaces, then its attributes, then its children
+        bool operator<(const XPathNode& other) const {
+            if (node != other.node) return node < other.node;
+            if (type != other.type) return type < other.type;
+            return index < other.index;
+        }
+    };
+
+    class XPathError : public std::runtime_error {
+        size_t pos;
+
+    public:
+        XPathError(const std::string& message, size_t pos = 0) : std::runtime_error(message), pos(pos) {}
+        // position of the error in the expression
+        size_t position() const { return pos; }
+    };
+
+    // thrown when the evaluation is stopped through XPathOptions::cancel
+    class XPathCancelled : public XPathError {
+    public:
+        XPathCancelled() : XPathError("evaluation cancelled") {}
+    };
+
+    /*
+    * How an expression is evaluated; by default, on the calling thread, without index.
+    * With several threads, a descendant step over a subtree of parallelNodes nodes or more, whose
+    * predicates do not depend on the position of the node (//entry[contains(title, 'foo')]), is
+    * split across a pool of workers: the node range of the subtree is cut into chunks, which start
+    * at a node and end where a subtree ends, each worker scans and filters whole chunks, and the
+    * chunks are merged in document order. The result is the one of the sequential evaluation.
+    */
+    struct XPathOptions {
+        const DocumentIndex* index = nullptr;       // of the evaluated document, see DocumentIndex
+        unsigned threads = 1;
+        size_t parallelNodes = 64 * 1024;
+        const std::atomic<bool>* cancel = nullptr;  // set from any thread to stop the evaluation, which throws XPathCancelled
+    };
+
+    enum class XPathType { NodeSet, Boolean, Number, String };
+
+    struct XPathValue {
+        XPathType type = XPathType::NodeSet;
+        std::vector<XPathNode> nodes;   // in document order, without duplicates
+        bool boolean = false;
+        double number = 0;
+        std::string string;
+    };
+
+    // prefix -> namespace URI
+    typedef std::map<std::string, std::string, std::less<>> XPathNamespaces;
+
+    /*
+    * Reads namespace bindings written as xmlns declarations, the format of the MSXML
+    * SelectionNamespaces property: "xmlns:a='urn:a' xmlns:b=\"urn:b\"". Throws XPathError when
+    * the text is not a list of such declarations.
+    */
+    XPathNamespaces parseSelectionNamespaces(std::string_view declarations);
+
+    /*
+    * The compiled expression: a tree of XPathExpr in one vector, the root last
+    */
+    enum class XPathAxis {
+        Ancestor, AncestorOrSelf, Attribute, Child, Descendant, DescendantOrSelf,
+        Following, FollowingSibling, Namespace, Parent, Preceding, PrecedingSibling, Self
+    };
+
+    enum class XPathTest {
+        Name,                       // [prefix:]local
+        AnyName,                    // *
+        AnyLocalName,               // prefix:*
+        Node,                       // node()
+        Text,                       // text()
+        Comment,                    // comment()
+        ProcessingInstruction       // processing-instruction(['target'])
+    };
+
+    enum class XPathOp {
+        Or, And, Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual,
+        Add, Subtract, Multiply, Divide, Modulo, Negate, Union,
+        Literal, Number, Function,
+        Filter,                     // args[0] filtered by the predicates
+        Path                        // steps from the root, the context node, or the node-set of args[0]
+    };
+
+    enum class XPathFunction {
+        Last, Position, Count, Id, LocalName, NamespaceUri, Name,
+        String, Concat, StartsWith, Contains, SubstringBefore, SubstringAfter, Substring,
+        StringLength, NormalizeSpace, Translate,
+        Boolean, Not, True, False, Lang,
+        Number, Sum, Floor, Ceiling, Round
+    };
+
+    struct XPathStep {
+        XPathAxis axis = XPathAxis::Child;
+        XPathTest test = XPathTest::Node;
+        std::string name;                   // local name of a name test, or target of a processing-instruction() test
+        std::string uri;                    // namespace URI of a prefixed name test
+        std::vector<uint32_t> predicates;
+    };
+
+    struct XPathExpr {
+        XPathOp op = XPathOp::Literal;
+        XPathType type = XPathType::String; // static type of the result
+        std::vector<uint32_t> args;         // operands, or function arguments
+        std::vector<uint32_t> predicates;   // Filter
+        std::vector<XPathStep> steps;       // Path
+        bool absolute = false;              // Path from the root
+        bool hasStart = false;              // Path from the node-set of args[0]
+        XPathFunction function = XPathFunction::Last;
+        std::string literal;
+        double number = 0;
+    };
+
+    class XPathExpression {
+        std::string text;
+        std::vector<XPathExpr> exprs;
+        size_t folds = 0;
+
+    public:
+        /*
+        * Compiles an expression; throws XPathError on a syntax error, an unknown function, or a
+        * prefix without binding. The operations on constants are evaluated once, when compiling.
+        * @param expression The XPath expression
+        * @param namespaces The bindings of the prefixes used in the expression
+        */
+        XPathExpression(std::string_view expression, const XPathNamespaces& namespaces = XPathNamespaces());
+
+        const std::string& expression() const { return text; }
+        const std::vector<XPathExpr>& tree() const { return exprs; }
+        uint32_t root() const { return (uint32_t)exprs.size() - 1; }
+        // operations and function calls replaced with their constant value
+        size_t folded() const { return folds; }
+
+        /*
+        * Evaluates the expression; throws XPathError when a value has not the type an operation
+        * requires (ex. a path from a number)
+        * @param document The document
+        * @param context The context node; the root of the document by default
+        */
+        XPathValue evaluate(const Document& document) const;
+        XPathValue evaluate(const Document& document, const XPathNode& context) const;
+        // the same, on the document of the index, whose indexes are built when a step needs them
+        XPathValue evaluate(const DocumentIndex& index) const;
+        XPathValue evaluate(const DocumentIndex& index, const XPathNode& context) const;
+        XPathValue evaluate(const Document& document, const XPathNode& context, const XPathOptions& options) const;
+    };
+
+    /*
+    * The steps of the expression an index answers, as text ("descendant::item: element name"):
+    * a descendant step whose first predicate is [@a = 'literal'] takes the elements with that
+    * value when a is an identity attribute, and those having a otherwise; one whose first
+    * predicate is [@a] those having a; another one with a name test the elements with that name
+    */
+    std::vector<std::string> xpathIndexLookups(const XPathExpression& expression);
+
+    /*
+    * Values of the data model
+    */
+    std::string xpathStringValue(const Document& document, const XPathNode& node);
+    std::string xpathNumberToString(double number);
+    double xpathStringToNumber(std::string_view text);
+
+    /*
+    * A selected node as MSXML describes it: nodeTypeString, nodeName and nodeValue, except for
+    * an element, whose value is the concatenation of its direct text children
+    */
+    struct XPathEntry {
+        std::string type;
+        std::string name;
+        std::string value;
+    };
+
+    XPathEntry xpathEntry(const Document& document, const XPathNode& node);
+
+    // the parts of the entry, when not all of them are needed: the type costs nothing, the value the most
+    const char* xpathEntryType(const Document& document, const XPathNode& node);
+    std::string xpathEntryName(const Document& document, const XPathNode& node);
+    std::string xpathEntryValue(const Document& document, const XPathNode& node);
+
+    // start of the node markup in the source, or of the value of an attribute
+    size_t xpathNodeOffset(const Document& document, const XPathNode& node);
+
+    /*
+    * The nodes selected by an expression, whose entries are only built when they are asked for:
+    * the count, the type and the offset of a node cost nothing once the expression is evaluated,
+    * so that a view showing a page of the results at a time builds the entries of that page and
+    * leaves the others alone.
+    * The cursor refers to the document, which must outlive it.
+    */
+    class XPathCursor {
+        const Document* doc;
+        std::vector<XPathNode> selected;
+
+    public:
+        // throws XPathError when the expression does not give a node-set
+        XPathCursor(const Document& document, const XPathExpression& expression);
+        XPathCursor(const DocumentIndex& index, const XPathExpression& expression);
+        XPathCursor(const Document& document, const XPathExpression& expression, const XPathOptions& options);
+
+        size_t size() const { return selected.size(); }
+        bool empty() const { return selected.empty(); }
+        const XPathNode& node(size_t index) const { return selected[index]; }
+        const char* type(size_t index) const { return xpathEntryType(*doc, selected[index]); }
+        size_t offset(size_t index) const { return xpathNodeOffset(*doc, selected[index]); }
+
+        XPathEntry entry(size_t index) const { return xpathEntry(*doc, selected[index]); }
+        // entries of the nodes [first, first + count), fewer at the end of the results
+        std::vector<XPathEntry> entries(size_t first, size_t count) const;
+    };
+
+    // the entries of the nodes selected by the expression; throws XPathError when it does not give a node-set
+    std::vector<XPathEntry> selectEntries(const Document& document, const XPathExpression& expression);
+}
@@ -0,0 +1,209 @@
+#include "XPathPlan.h"
+
+namespace QuickXml {
+    namespace {
+        const char* axisName(XPathAxis axis) {
+            switch (axis) {
+                case XPathAxis::Ancestor: return "ancestor";
+                case XPathAxis::AncestorOrSelf: return "ancestor-or-self";
+                case XPathAxis::Attribute: return "attribute";
+                case XPathAxis::Child: return "child";
+                case XPathAxis::Descendant: return "descendant";
+                case XPathAxis::DescendantOrSelf: return "descendant-or-self";
+                case XPathAxis::Following: return "following";
+                case XPathAxis::FollowingSibling: return "following-sibling";
+                case XPathAxis::Namespace: return "namespace";
+                case XPathAxis::Parent: return "parent";
+                case XPathAxis::Preceding: return "preceding";
+                case XPathAxis::PrecedingSibling: return "preceding-sibling";
+                case XPathAxis::Self: return "self";
+            }
+            return "";
+        }
+
+        const char* opName(XPathOp op) {
+            switch (op) {
+                case XPathOp::Or: return "or";
+                case XPathOp::And: return "and";
+                case XPathOp::Equal: return "=";
+                case XPathOp::NotEqual: return "!=";
+                case XPathOp::Less: return "<";
+                case XPathOp::LessEqual: return "<=";
+                case XPathOp::Greater: return ">";
+                case XPathOp::GreaterEqual: return ">=";
+                case XPathOp::Add: return "+";
+                case XPathOp::Subtract: return "-";
+                case XPathOp::Multiply: return "*";
+                case XPathOp::Divide: return "div";
+                case XPathOp::Modulo: return "mod";
+                case XPathOp::Negate: return "negate";
+                case XPathOp::Union: return "union";
+                case XPathOp::Literal: return "literal";
+                case XPathOp::Number: return "number";
+                case XPathOp::Function: return "function";
+                case XPathOp::Filter: return "filter";
+                case XPathOp::Path: return "path";
+            }
+            return "";
+        }
+
+        const char* functionName(XPathFunction function) {
+            switch (function) {
+                case XPathFunction::Last: return "last";
+                case XPathFunction::Position: return "position";
+                case XPathFunction::Count: return "count";
+                case XPathFunction::Id: return "id";
+                case XPathFunction::LocalName: return "local-name";
+                case XPathFunction::NamespaceUri: return "namespace-uri";
+                case XPathFunction::Name: return "name";
+                case XPathFunction::String: return "string";
+                case XPathFunction::Concat: return "concat";
+                case XPathFunction::StartsWith: return "starts-with";
+                case XPathFunction::Contains: return "contains";
+                case XPathFunction::SubstringBefore: return "substring-before";
+                case XPathFunction::SubstringAfter: return "substring-after";
+                case XPathFunction::Substring: return "substring";
+                case XPathFunction::StringLength: return "string-length";
+                case XPathFunction::NormalizeSpace: return "normalize-space";
+                case XPathFunction::Translate: return "translate";
+                case XPathFunction::Boolean: return "boolean";
+                case XPathFunction::Not: return "not";
+                case XPathFunction::True: return "true";
+                case XPathFunction::False: return "false";
+                case XPathFunction::Lang: return "lang";
+                case XPathFunction::Number: return "number";
+                case XPathFunction::Sum: return "sum";
+                case XPathFunction::Floor: return "floor";
+                case XPathFunction::Ceiling: return "ceiling";
+                case XPathFunction::Round: return "round";
+            }
+            return "";
+        }
+
+        const char* typeName(XPathType type) {
+            switch (type) {
+                case XPathType::NodeSet: return "node-set";
+                case XPathType::Boolean: return "boolean";
+                case XPathType::Number: return "number";
+                case XPathType::String: return "string";
+            }
+            return "";
+        }
+
+        std::string stepText(const XPathStep& step) {
+            std::string text = std::string(axisName(step.axis)) + "::";
+            switch (step.test) {
+                case XPathTest::Name: text += (step.uri.empty() ? "" : "{" + step.uri + "}") + step.name; break;
+                case XPathTest::AnyName: text += "*"; break;
+                case XPathTest::AnyLocalName: text += "{" + step.uri + "}*"; break;
+                case XPathTest::Node: text += "node()"; break;
+                case XPathTest::Text: text += "text()"; break;
+                case XPathTest::Comment: text += "comment()"; break;
+                case XPathTest::ProcessingInstruction: text += "processing-instruction(" + (step.name.empty() ? "" : "'" + step.name + "'") + ")"; break;
+            }
+            return text;
+        }
+
+        void describeExpr(std::string& out, const std::vector<XPathExpr>& tree, uint32_t index, size_t depth) {
+            const XPathExpr& expr = tree[index];
+            std::string indent(2 * depth, ' ');
+            out += indent + opName(expr.op);
+            switch (expr.op) {
+                case XPathOp::Literal: out += " '" + expr.literal + "'"; break;
+                case XPathOp::Number: out += " " + xpathNumberToString(expr.number); break;
+                case XPathOp::Function: out += std::string(" ") + functionName(expr.function) + "()"; break;
+                case XPathOp::Path: out += expr.absolute ? " from the root" : (expr.hasStart ? " from a node-set" : " from the context"); break;
+                default: break;
+            }
+            out += std::string(" : ") + typeName(expr.type) + "\n";
+
+            for (uint32_t arg : expr.args)
+                describeExpr(out, tree, arg, depth + 1);
+            for (uint32_t predicate : expr.predicates) {
+                out += indent + "  predicate\n";
+                describeExpr(out, tree, predicate, depth + 2);
+            }
+            for (const XPathStep& step : expr.steps) {
+                out += indent + "  step " + stepText(step) + "\n";
+                for (uint32_t predicate : step.predicates) {
+                    out += indent + "    predicate\n";
+                    describeExpr(out, tree, predicate, depth + 3);
+                }
+            }
+        }
+    }
+
+    XPathPlan::XPathPlan(std::string_view expression, const XPathNamespaces& namespaces)
+        : compiled(expression, namespaces), bindings(namespaces), chosen(XPathStrategy::Stream), lookups(xpathIndexLookups(compiled)) {
+        why = XPathStream::unstreamable(compiled);
+        if (!why.empty())
+            chosen = XPathStrategy::Document;
+    }
+
+    std::string XPathPlan::describe() const {
+        std::string out = "expression: " + compiled.expression() + "\n";
+        for (const auto& binding : bindings)
+            out += "namespace: " + binding.first + "=" + binding.second + "\n";
+        out += std::string("strategy: ") + (chosen == XPathStrategy::Stream ? "stream" : "document model (" + why + ")") + "\n";
+        for (const auto& lookup : lookups)
+            out += "index: " + lookup + "\n";
+        out += "folded constants: " + std::to_string(compiled.folded()) + "\n";
+        describeExpr(out, compiled.tree(), compiled.root(), 0);
+        return out;
+    }
+
+    std::shared_ptr<const XPathPlan> XPathPlanCache::get(std::string_view expression, const XPathNamespaces& namespaces) {
+        // the expression and its bindings, separated by characters a name or an expression cannot hold
+        std::string key(expression);
+        for (const auto& binding : namespaces)
+            key += '\0' + binding.first + '\1' + binding.second;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = index.find(key);
+            if (found != index.end()) {
+                ++counters.hits;
+                entries.splice(entries.begin(), entries, found->second);
+                return found->second->second;
+            }
+            ++counters.misses;
+        }
+
+        std::shared_ptr<const XPathPlan> plan = std::make_shared<const XPathPlan>(expression, namespaces);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (capacity > 0 && index.find(key) == index.end()) {
+            entries.emplace_front(key, plan);
+            index[key] = entries.begin();
+            evict();
+        }
+        return plan;
+    }
+
+    void XPathPlanCache::setCapacity(size_t plans) {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = plans;
+        evict();
+    }
+
+    void XPathPlanCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+    }
+
+    XPathPlanCache::Stats XPathPlanCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats stats = counters;
+        stats.entries = entries.size();
+        return stats;
+    }
+
+    void XPathPlanCache::evict() {
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+            ++counters.evictions;
+        }
+    }
+}
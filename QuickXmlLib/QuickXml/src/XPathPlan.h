@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "XPath.h"
+#include "XPathStream.h"
+
+/*
+* Query plans: an expression compiled once (prefixes resolved, constants folded, see
+* XPathExpression), with the way it is to be evaluated, kept in a cache so that evaluating the
+* same expression again costs no compilation. A plan is immutable, and can be shared by several
+* threads.
+* describe() writes the plan as text, to see why a query is slow: the strategy and the reason for
+* it, the steps a DocumentIndex answers when the document model is kept with its index, and the
+* compiled tree.
+*/
+namespace QuickXml {
+    class XPathPlan {
+        XPathExpression compiled;
+        XPathNamespaces bindings;
+        XPathStrategy chosen;
+        std::string why;
+        std::vector<std::string> lookups;
+
+    public:
+        // compiles the expression; throws XPathError as XPathExpression does
+        XPathPlan(std::string_view expression, const XPathNamespaces& namespaces = XPathNamespaces());
+
+        const XPathExpression& expression() const { return compiled; }
+        const XPathNamespaces& namespaces() const { return bindings; }
+        // Stream when the expression selects nodes a forward-only pass can find, Document otherwise
+        XPathStrategy strategy() const { return chosen; }
+        // why the document model is needed; empty when streamed
+        const std::string& reason() const { return why; }
+        // the steps an index answers, see xpathIndexLookups()
+        const std::vector<std::string>& indexLookups() const { return lookups; }
+
+        std::string describe() const;
+    };
+
+    class XPathPlanCache {
+    public:
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;      // compilations
+            size_t evictions = 0;
+            size_t entries = 0;
+        };
+
+        static const size_t DefaultCapacity = 64;
+
+        explicit XPathPlanCache(size_t capacity = DefaultCapacity) : capacity(capacity) {}
+
+        /*
+        * The plan of the expression with these bindings, compiled on the first request; throws
+        * XPathError when it does not compile, and keeps nothing then
+        */
+        std::shared_ptr<const XPathPlan> get(std::string_view expression, const XPathNamespaces& namespaces = XPathNamespaces());
+
+        // keeps the most recently used plans, at most capacity
+        void setCapacity(size_t plans);
+        void clear();
+        Stats stats() const;
+
+    private:
+        typedef std::list<std::pair<std::string, std::shared_ptr<const XPathPlan>>> Entries;
+
+        mutable std::mutex mutex;
+        size_t capacity;
+        Entries entries;    // most recently used first
+        std::unordered_map<std::string, Entries::iterator> index;
+        Stats counters;
+
+        void evict();
+    };
+}
@@ -0,0 +1,920 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "XPathStream.h"
+#include "XmlParser.h"
+
+namespace QuickXml {
+    namespace {
+        bool isWhitespace(const char* text, size_t length) {
+            for (size_t i = 0; i < length; ++i) {
+                char c = text[i];
+                if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                    return false;
+            }
+            return true;
+        }
+
+        std::string_view unquote(const char* chars, size_t size) {
+            if (size >= 2 && (chars[0] == '"' || chars[0] == '\'') && chars[size - 1] == chars[0])
+                return std::string_view(chars + 1, size - 2);
+            return std::string_view(chars, size);
+        }
+
+        bool isNamespaceDeclaration(std::string_view qname) {
+            return qname.size() >= 5 && !qname.compare(0, 5, "xmlns") && (qname.size() == 5 || qname[5] == ':');
+        }
+
+        // value of an attribute, as Document::attributeValue() gives it
+        std::string attributeValue(std::string_view raw) {
+            std::string normalized(raw);
+            for (char& c : normalized) {
+                if (c == '\t' || c == '\n' || c == '\r')
+                    c = ' ';
+            }
+            return Document::decode(normalized);
+        }
+
+        const char* axisName(XPathAxis axis) {
+            switch (axis) {
+                case XPathAxis::Ancestor: return "ancestor";
+                case XPathAxis::AncestorOrSelf: return "ancestor-or-self";
+                case XPathAxis::Following: return "following";
+                case XPathAxis::FollowingSibling: return "following-sibling";
+                case XPathAxis::Namespace: return "namespace";
+                case XPathAxis::Parent: return "parent";
+                case XPathAxis::Preceding: return "preceding";
+                case XPathAxis::PrecedingSibling: return "preceding-sibling";
+                default: return "descendant-or-self";
+            }
+        }
+
+        bool isNameTest(XPathTest test) {
+            return test == XPathTest::Name || test == XPathTest::AnyName || test == XPathTest::AnyLocalName;
+        }
+
+        // @name, @prefix:name, @*: the only node-sets a streamed predicate reads
+        bool isAttributeRef(const XPathExpr& expr) {
+            return expr.op == XPathOp::Path && !expr.absolute && !expr.hasStart && expr.steps.size() == 1 &&
+                   expr.steps[0].axis == XPathAxis::Attribute && isNameTest(expr.steps[0].test) && expr.steps[0].predicates.empty();
+        }
+
+        bool isComparison(XPathOp op) {
+            return op == XPathOp::Equal || op == XPathOp::NotEqual || op == XPathOp::Less ||
+                   op == XPathOp::LessEqual || op == XPathOp::Greater || op == XPathOp::GreaterEqual;
+        }
+
+        bool usesPosition(const std::vector<XPathExpr>& exprs, uint32_t index) {
+            const XPathExpr& expr = exprs[index];
+            if (expr.op == XPathOp::Function && expr.function == XPathFunction::Position)
+                return true;
+            for (uint32_t arg : expr.args) {
+                if (usesPosition(exprs, arg))
+                    return true;
+            }
+            return false;
+        }
+
+        // the step as text: two steps with the same key select the same nodes from the same context
+        void appendKey(std::string& key, const std::vector<XPathExpr>& exprs, uint32_t index);
+
+        void appendKey(std::string& key, const std::vector<XPathExpr>& exprs, const XPathStep& step) {
+            key += std::to_string((int)step.axis) + "," + std::to_string((int)step.test) + "," + std::to_string(step.name.size()) + ":" + step.name +
+                   std::to_string(step.uri.size()) + ":" + step.uri + "[";
+            for (uint32_t predicate : step.predicates)
+                appendKey(key, exprs, predicate);
+            key += "]";
+        }
+
+        void appendKey(std::string& key, const std::vector<XPathExpr>& exprs, uint32_t index) {
+            const XPathExpr& expr = exprs[index];
+            key += "(" + std::to_string((int)expr.op);
+            switch (expr.op) {
+                case XPathOp::Literal: key += "," + std::to_string(expr.literal.size()) + ":" + expr.literal; break;
+                case XPathOp::Number: key += "," + xpathNumberToString(expr.number); break;
+                case XPathOp::Function: key += "," + std::to_string((int)expr.function); break;
+                case XPathOp::Path:
+                    key += expr.absolute ? ",/" : ",";
+                    for (const XPathStep& step : expr.steps)
+                        appendKey(key, exprs, step);
+                    break;
+                default: break;
+            }
+            for (uint32_t arg : expr.args)
+                appendKey(key, exprs, arg);
+            key += ")";
+        }
+
+        class StreamableCheck {
+            const std::vector<XPathExpr>& exprs;
+            bool positions;
+
+            bool operand(uint32_t index) const {
+                const XPathExpr& expr = exprs[index];
+                return expr.op == XPathOp::Literal || expr.op == XPathOp::Number || isAttributeRef(expr) ||
+                       (positions && expr.op == XPathOp::Function && expr.function == XPathFunction::Position);
+            }
+
+        public:
+            StreamableCheck(const std::vector<XPathExpr>& exprs, bool positions) : exprs(exprs), positions(positions) {}
+
+            // a number selects a position at the top of a predicate only
+            bool predicate(uint32_t index, bool top = true) const {
+                const XPathExpr& expr = exprs[index];
+                switch (expr.op) {
+                    case XPathOp::Or:
+                    case XPathOp::And:
+                        return predicate(expr.args[0], false) && predicate(expr.args[1], false);
+                    case XPathOp::Number:
+                        return positions || !top;
+                    case XPathOp::Literal:
+                        return true;
+                    case XPathOp::Path:
+                        return isAttributeRef(expr);
+                    case XPathOp::Function:
+                        switch (expr.function) {
+                            case XPathFunction::Not:
+                            case XPathFunction::Boolean:
+                                return predicate(expr.args[0], false);
+                            case XPathFunction::True:
+                            case XPathFunction::False:
+                                return true;
+                            case XPathFunction::Position:
+                                return positions;
+                            case XPathFunction::Contains:
+                            case XPathFunction::StartsWith:
+                                return operand(expr.args[0]) && operand(expr.args[1]);
+                            default:
+                                return false;
+                        }
+                    default:
+                        return isComparison(expr.op) && operand(expr.args[0]) && operand(expr.args[1]);
+                }
+            }
+        };
+    }
+
+    struct XPathStream::Value {
+        XPathType type = XPathType::Boolean;
+        bool boolean = false;       // for a node-set: it holds an attribute
+        double number = 0;
+        std::string string;         // for a node-set: the value of the attribute
+    };
+
+    std::string XPathStream::unstreamable(const XPathExpression& expression) {
+        const XPathExpr& root = expression.tree()[expression.root()];
+        if (root.op != XPathOp::Path || root.hasStart)
+            return "the expression is not a location path";
+
+        for (size_t k = 0; k < root.steps.size(); ++k) {
+            const XPathStep& step = root.steps[k];
+            bool last = (k + 1 == root.steps.size());
+            switch (step.axis) {
+                case XPathAxis::Child:
+                case XPathAxis::Descendant:
+                case XPathAxis::Self:
+                    break;
+                case XPathAxis::DescendantOrSelf:
+                    if (step.test != XPathTest::Node || !step.predicates.empty())
+                        return "only '//' is streamed on the descendant-or-self axis";
+                    break;
+                case XPathAxis::Attribute:
+                    if (!last)
+                        return "the attribute axis is only streamed in the last step";
+                    if (!step.predicates.empty())
+                        return "predicates on attributes are not streamed";
+                    break;
+                default:
+                    return std::string("the ") + axisName(step.axis) + " axis is not streamed";
+            }
+            if (!last && !isNameTest(step.test) && step.axis != XPathAxis::DescendantOrSelf)
+                return "node type tests are only streamed in the last step";
+
+            StreamableCheck check(expression.tree(), step.axis == XPathAxis::Child);
+            for (uint32_t predicate : step.predicates) {
+                if (!check.predicate(predicate)) {
+                    return step.axis == XPathAxis::Child ? "predicates other than tests of the attributes and the position are not streamed"
+                                                         : "predicates other than tests of the attributes are not streamed off the child axis";
+                }
+            }
+        }
+        return std::string();
+    }
+
+    XPathStream::XPathStream(const XPathExpression& expression) : XPathStream(std::vector<XPathExpression>{ expression }) {}
+
+    XPathStream::XPathStream(const std::vector<XPathExpression>& list) : expressions(list) {
+        states.emplace_back();
+        for (size_t query = 0; query < expressions.size(); ++query) {
+            std::string reason = unstreamable(expressions[query]);
+            if (!reason.empty()) {
+                throw XPathError(expressions.size() == 1 ? "the expression cannot be streamed: " + reason
+                                                         : "expression " + std::to_string(query + 1) + " cannot be streamed: " + reason);
+            }
+
+            const std::vector<XPathExpr>& tree = expressions[query].tree();
+            uint32_t current = 0;
+            for (const XPathStep& step : tree[expressions[query].root()].steps) {
+                std::string key;
+                appendKey(key, tree, step);
+                std::vector<uint32_t>& edges = step.axis == XPathAxis::Attribute ? states[current].attributeEdges
+                                             : (step.axis == XPathAxis::Child || step.axis == XPathAxis::Descendant) ? states[current].childEdges
+                                             : states[current].closureEdges;
+                uint32_t next = 0;
+                for (uint32_t edge : edges) {
+                    if (states[edge].key == key) {
+                        next = edge;
+                        break;
+                    }
+                }
+                if (!next) {
+                    next = (uint32_t)states.size();
+                    edges.push_back(next);      // before the new state moves the others
+                    State state;
+                    state.step = &step;
+                    state.tree = &tree;
+                    state.key = std::move(key);
+                    // the positions are counted per context node and predicate
+                    if (step.axis == XPathAxis::Child) {
+                        for (uint32_t predicate : step.predicates) {
+                            if (tree[predicate].type == XPathType::Number || usesPosition(tree, predicate))
+                                state.counted = true;
+                        }
+                        if (state.counted) {
+                            state.counterBase = (uint32_t)counterStride;
+                            counterStride += step.predicates.size();
+                        }
+                    }
+                    states.push_back(std::move(state));
+                }
+                current = next;
+            }
+            states[current].queries.push_back((uint32_t)query);
+        }
+        reachedMark.resize(states.size(), 0);
+        inheritedMark.resize(states.size(), 0);
+    }
+
+    void XPathStream::fail(size_t pos, const std::string& message) {
+        if (errorPos == SIZE_MAX) {
+            errorPos = pos;
+            error = message;
+        }
+    }
+
+    std::string_view XPathStream::lookupNamespace(std::string_view prefix) const {
+        if (prefix == "xml")
+            return "http://www.w3.org/XML/1998/namespace";
+        for (size_t i = namespaces.size(); i-- > 0;) {
+            if (namespaces[i].first == prefix)
+                return namespaces[i].second;
+        }
+        return std::string_view();
+    }
+
+    bool XPathStream::testElement(const XPathStep& step, std::string_view qname) const {
+        switch (step.test) {
+            case XPathTest::Node:
+            case XPathTest::AnyName:
+                return true;
+            case XPathTest::AnyLocalName:
+                return lookupNamespace(Document::prefixOf(qname)) == step.uri;
+            case XPathTest::Name:
+                return Document::localNameOf(qname) == step.name && lookupNamespace(Document::prefixOf(qname)) == step.uri;
+            default:
+                return false;
+        }
+    }
+
+    bool XPathStream::testAttribute(const XPathStep& step, const Attr& attr) const {
+        if (isNamespaceDeclaration(attr.name))
+            return false;
+        // an unprefixed attribute has no namespace
+        std::string_view prefix = Document::prefixOf(attr.name);
+        switch (step.test) {
+            case XPathTest::AnyName:
+                return true;
+            case XPathTest::AnyLocalName:
+                return !prefix.empty() && lookupNamespace(prefix) == step.uri;
+            case XPathTest::Name:
+                return Document::localNameOf(attr.name) == step.name && (prefix.empty() ? step.uri.empty() : lookupNamespace(prefix) == step.uri);
+            default:
+                return false;
+        }
+    }
+
+    bool XPathStream::testLeaf(const XPathStep& step, NodeKind kind, std::string_view target) const {
+        switch (step.test) {
+            case XPathTest::Node: return true;
+            case XPathTest::Text: return kind == NodeKind::Text || kind == NodeKind::CData;
+            case XPathTest::Comment: return kind == NodeKind::Comment;
+            case XPathTest::ProcessingInstruction: return kind == NodeKind::ProcessingInstruction && (step.name.empty() || step.name == target);
+            default: return false;
+        }
+    }
+
+    bool XPathStream::test(const XPathStep& step, NodeKind kind, std::string_view name) const {
+        return kind == NodeKind::Element ? testElement(step, name) : testLeaf(step, kind, name);
+    }
+
+    /*
+    * Predicates
+    */
+    bool XPathStream::toBoolean(const Value& value) {
+        switch (value.type) {
+            case XPathType::Number: return value.number != 0 && !std::isnan(value.number);
+            case XPathType::String: return !value.string.empty();
+            default: return value.boolean;
+        }
+    }
+
+    double XPathStream::toNumber(const Value& value) {
+        switch (value.type) {
+            case XPathType::Number: return value.number;
+            case XPathType::Boolean: return value.boolean ? 1 : 0;
+            default: return xpathStringToNumber(value.string);
+        }
+    }
+
+    std::string XPathStream::toString(const Value& value) {
+        switch (value.type) {
+            case XPathType::Number: return xpathNumberToString(value.number);
+            case XPathType::Boolean: return value.boolean ? "true" : "false";
+            default: return value.string;
+        }
+    }
+
+    // XPath 1.0, 3.4, with node-sets of at most one node
+    bool XPathStream::compare(XPathOp op, const Value& left, const Value& right) {
+        auto numbers = [op](double a, double b) {
+            switch (op) {
+                case XPathOp::Equal: return a == b;
+                case XPathOp::NotEqual: return a != b;
+                case XPathOp::Less: return a < b;
+                case XPathOp::LessEqual: return a <= b;
+                case XPathOp::Greater: return a > b;
+                default: return a >= b;
+            }
+        };
+        bool equality = (op == XPathOp::Equal || op == XPathOp::NotEqual);
+        bool leftNodes = (left.type == XPathType::NodeSet);
+        bool rightNodes = (right.type == XPathType::NodeSet);
+
+        if (leftNodes || rightNodes) {
+            if (left.type == XPathType::Boolean || right.type == XPathType::Boolean)
+                return numbers(toBoolean(left), toBoolean(right));
+            // an empty node-set compares false with anything
+            if ((leftNodes && !left.boolean) || (rightNodes && !right.boolean))
+                return false;
+            if (equality && left.type != XPathType::Number && right.type != XPathType::Number)
+                return (left.string == right.string) == (op == XPathOp::Equal);
+            return numbers(toNumber(left), toNumber(right));
+        }
+        if (equality) {
+            bool equal;
+            if (left.type == XPathType::Boolean || right.type == XPathType::Boolean)
+                equal = (toBoolean(left) == toBoolean(right));
+            else if (left.type == XPathType::Number || right.type == XPathType::Number)
+                equal = (toNumber(left) == toNumber(right));
+            else
+                equal = (left.string == right.string);
+            return equal == (op == XPathOp::Equal);
+        }
+        return numbers(toNumber(left), toNumber(right));
+    }
+
+    XPathStream::Value XPathStream::evalValue(const std::vector<XPathExpr>& tree, uint32_t index, size_t position, const Attr* attrBegin, const Attr* attrEnd) const {
+        const XPathExpr& expr = tree[index];
+        Value value;
+        switch (expr.op) {
+            case XPathOp::Literal:
+                value.type = XPathType::String;
+                value.string = expr.literal;
+                break;
+            case XPathOp::Number:
+                value.type = XPathType::Number;
+                value.number = expr.number;
+                break;
+            case XPathOp::Path:
+                value.type = XPathType::NodeSet;
+                for (const Attr* attr = attrBegin; attr < attrEnd; ++attr) {
+                    if (testAttribute(expr.steps[0], *attr)) {
+                        value.boolean = true;
+                        value.string = attributeValue(attr->raw);
+                        break;
+                    }
+                }
+                break;
+            case XPathOp::Function:
+                if (expr.function == XPathFunction::Position) {
+                    value.type = XPathType::Number;
+                    value.number = (double)position;
+                }
+                else if (expr.function == XPathFunction::Contains || expr.function == XPathFunction::StartsWith) {
+                    std::string s = toString(evalValue(tree, expr.args[0], position, attrBegin, attrEnd));
+                    std::string part = toString(evalValue(tree, expr.args[1], position, attrBegin, attrEnd));
+                    value.boolean = (expr.function == XPathFunction::Contains) ? s.find(part) != std::string::npos : !s.compare(0, part.size(), part);
+                }
+                else {
+                    value.boolean = evalPredicate(tree, index, position, attrBegin, attrEnd);
+                }
+                break;
+            default:
+                value.boolean = evalPredicate(tree, index, position, attrBegin, attrEnd);
+                break;
+        }
+        return value;
+    }
+
+    bool XPathStream::evalPredicate(const std::vector<XPathExpr>& tree, uint32_t index, size_t position, const Attr* attrBegin, const Attr* attrEnd) const {
+        const XPathExpr& expr = tree[index];
+        switch (expr.op) {
+            case XPathOp::Or:
+                return evalPredicate(tree, expr.args[0], position, attrBegin, attrEnd) || evalPredicate(tree, expr.args[1], position, attrBegin, attrEnd);
+            case XPathOp::And:
+                return evalPredicate(tree, expr.args[0], position, attrBegin, attrEnd) && evalPredicate(tree, expr.args[1], position, attrBegin, attrEnd);
+            case XPathOp::Function:
+                switch (expr.function) {
+                    case XPathFunction::Not: return !evalPredicate(tree, expr.args[0], position, attrBegin, attrEnd);
+                    case XPathFunction::Boolean: return evalPredicate(tree, expr.args[0], position, attrBegin, attrEnd);
+                    case XPathFunction::True: return true;
+                    case XPathFunction::False: return false;
+                    case XPathFunction::Position: return true;
+                    default: return toBoolean(evalValue(tree, index, position, attrBegin, attrEnd));
+                }
+            case XPathOp::Number:
+                return expr.number != 0 && !std::isnan(expr.number);
+            default:
+                if (isComparison(expr.op))
+                    return compare(expr.op, evalValue(tree, expr.args[0], position, attrBegin, attrEnd), evalValue(tree, expr.args[1], position, attrBegin, attrEnd));
+                return toBoolean(evalValue(tree, index, position, attrBegin, attrEnd));
+        }
+    }
+
+    // the predicates of the step to a state, in turn: a position counts the nodes which passed the predicates before
+    bool XPathStream::predicates(const State& state, uint32_t* positions, const Attr* attrBegin, const Attr* attrEnd) const {
+        const std::vector<uint32_t>& list = state.step->predicates;
+        const std::vector<XPathExpr>& tree = *state.tree;
+        for (size_t i = 0; i < list.size(); ++i) {
+            size_t position = positions ? ++positions[i] : 1;
+            const XPathExpr& expr = tree[list[i]];
+            // a number selects a position
+            bool passed = (expr.op == XPathOp::Number) ? expr.number == (double)position : evalPredicate(tree, list[i], position, attrBegin, attrEnd);
+            if (!passed)
+                return false;
+        }
+        return true;
+    }
+
+    /*
+    * Matching
+    */
+    void XPathStream::addReached(uint32_t state) {
+        if (reachedMark[state] != mark) {
+            reachedMark[state] = mark;
+            reached.push_back(state);
+        }
+    }
+
+    void XPathStream::addInherited(uint32_t state) {
+        if (inheritedMark[state] != mark) {
+            inheritedMark[state] = mark;
+            inheritedNow.push_back(state);
+        }
+    }
+
+    // the states a node reaches by itself from those it reached: after self steps, and '//'
+    void XPathStream::closure(NodeKind kind, std::string_view name, const Attr* attrBegin, const Attr* attrEnd) {
+        for (size_t i = 0; i < reached.size(); ++i) {
+            for (uint32_t next : states[reached[i]].closureEdges) {
+                const State& state = states[next];
+                if (state.step->axis == XPathAxis::DescendantOrSelf) {
+                    addReached(next);
+                    addInherited(next);
+                }
+                else if (test(*state.step, kind, name) && predicates(state, nullptr, attrBegin, attrEnd)) {
+                    addReached(next);
+                }
+            }
+        }
+    }
+
+    // the states reached by a child of open[parentIndex], and those its children inherit
+    void XPathStream::reach(size_t parentIndex, NodeKind kind, std::string_view name, const Attr* attrBegin, const Attr* attrEnd) {
+        const Open& parent = open[parentIndex];
+        bool element = (kind == NodeKind::Element);
+        ++mark;
+        reached.clear();
+        inheritedNow.clear();
+        if (element) {
+            for (size_t i = parent.inherited; i < parent.end; ++i)
+                addInherited(active[i]);
+        }
+
+        for (size_t i = parent.contexts; i < parent.inherited; ++i) {
+            for (uint32_t next : states[active[i]].childEdges) {
+                const State& state = states[next];
+                if (element && state.step->axis == XPathAxis::Descendant)
+                    addInherited(next);
+                if (!test(*state.step, kind, name))
+                    continue;
+                uint32_t* positions = state.counted ? counters.data() + parentIndex * counterStride + state.counterBase : nullptr;
+                if (predicates(state, positions, attrBegin, attrEnd))
+                    addReached(next);
+            }
+        }
+        for (size_t i = parent.inherited; i < parent.end; ++i) {
+            const State& state = states[active[i]];
+            if (state.step->axis == XPathAxis::DescendantOrSelf || (test(*state.step, kind, name) && predicates(state, nullptr, attrBegin, attrEnd)))
+                addReached(active[i]);
+        }
+        if (!reached.empty())
+            closure(kind, name, attrBegin, attrEnd);
+        matchQueries();
+    }
+
+    // the expressions selecting the node
+    void XPathStream::matchQueries() {
+        matched.clear();
+        for (uint32_t state : reached)
+            matched.insert(matched.end(), states[state].queries.begin(), states[state].queries.end());
+        if (matched.size() > 1)
+            std::sort(matched.begin(), matched.end());
+    }
+
+    void XPathStream::report(XPathMatch&& match, bool done) {
+        if (done && pending.empty()) {
+            (*handler)(match);
+            return;
+        }
+        pendingBytes += sizeof(Pending) + match.entry.type.size() + match.entry.name.size() + match.entry.value.size();
+        pending.push_back({ std::move(match), done });
+    }
+
+    void XPathStream::flush() {
+        while (!pending.empty() && pending.front().done) {
+            const XPathEntry& entry = pending.front().match.entry;
+            pendingBytes -= sizeof(Pending) + entry.type.size() + entry.name.size() + entry.value.size();
+            (*handler)(pending.front().match);
+            pending.pop_front();
+            ++pendingBase;
+        }
+    }
+
+    void XPathStream::updatePeak() {
+        size_t bytes = open.capacity() * sizeof(Open) + active.capacity() * sizeof(uint32_t) + counters.capacity() * sizeof(uint32_t) +
+                       namespaces.capacity() * sizeof(namespaces[0]) + attrs.capacity() * sizeof(Attr) +
+                       (reached.capacity() + inheritedNow.capacity() + matched.capacity()) * sizeof(uint32_t) + pendingBytes;
+        peakBytes = std::max(peakBytes, bytes);
+    }
+
+    void XPathStream::openElement(std::string_view name, size_t pos) {
+        size_t parentIndex = open.size() - 1;
+        const Open& parent = open.back();
+        Open element = { name, pos, active.size(), active.size(), active.size(), namespaces.size(), SIZE_MAX, 0, parent.preserveSpace };
+        for (const Attr& attr : attrs) {
+            if (attr.name == "xmlns")
+                namespaces.emplace_back(std::string_view(), attr.raw);
+            else if (isNamespaceDeclaration(attr.name))
+                namespaces.emplace_back(attr.name.substr(6), attr.raw);
+            else if (attr.name == "xml:space")
+                element.preserveSpace = (attr.raw == "preserve");
+        }
+
+        // nothing to look for below a node which reached no state
+        if (parent.contexts != parent.end) {
+            const Attr* attrBegin = attrs.data();
+            const Attr* attrEnd = attrs.data() + attrs.size();
+            reach(parentIndex, NodeKind::Element, name, attrBegin, attrEnd);
+
+            if (!matched.empty()) {
+                element.pending = pendingBase + pending.size();
+                element.pendingCount = matched.size();
+                for (uint32_t query : matched)
+                    report({ { "element", std::string(name), std::string() }, pos, query }, false);
+            }
+            bool attributeSteps = false;
+            for (uint32_t state : reached)
+                attributeSteps = attributeSteps || !states[state].attributeEdges.empty();
+            if (attributeSteps) {
+                // the attributes in document order, each for the expressions selecting it
+                for (const Attr& attr : attrs) {
+                    matched.clear();
+                    for (uint32_t from : reached) {
+                        for (uint32_t next : states[from].attributeEdges) {
+                            if (testAttribute(*states[next].step, attr))
+                                matched.insert(matched.end(), states[next].queries.begin(), states[next].queries.end());
+                        }
+                    }
+                    if (matched.empty())
+                        continue;
+                    std::sort(matched.begin(), matched.end());
+                    std::string value = attributeValue(attr.raw);
+                    for (uint32_t query : matched)
+                        report({ { "attribute", std::string(attr.name), value }, attr.offset, query }, true);
+                }
+            }
+
+            active.insert(active.end(), reached.begin(), reached.end());
+            element.inherited = active.size();
+            active.insert(active.end(), inheritedNow.begin(), inheritedNow.end());
+            element.end = active.size();
+        }
+
+        open.push_back(element);
+        counters.resize(counters.size() + counterStride, 0);
+        updatePeak();
+    }
+
+    void XPathStream::closeElement() {
+        const Open& element = open.back();
+        for (size_t i = 0; i < element.pendingCount; ++i)
+            pending[element.pending + i - pendingBase].done = true;
+        namespaces.resize(element.namespaces);
+        active.resize(element.contexts);
+        counters.resize(counters.size() - counterStride);
+        open.pop_back();
+        flush();
+    }
+
+    void XPathStream::leaf(NodeKind kind, std::string_view markup, size_t pos) {
+        size_t parentIndex = open.size() - 1;
+        const Open& parent = open.back();
+
+        std::string_view target;
+        if (kind == NodeKind::ProcessingInstruction) {
+            size_t end = 2;
+            while (end < markup.size() && !strchr(" \t\r\n?", markup[end]))
+                ++end;
+            target = markup.substr(2, end - 2);
+        }
+
+        // the direct text of a selected element is its value
+        if (kind == NodeKind::Text && parent.pendingCount) {
+            std::string text = Document::decode(markup);
+            for (size_t i = 0; i < parent.pendingCount; ++i) {
+                pendingBytes += text.size();
+                pending[parent.pending + i - pendingBase].match.entry.value += text;
+            }
+        }
+        if (parent.contexts == parent.end)
+            return;
+        reach(parentIndex, kind, target, nullptr, nullptr);
+        if (matched.empty())
+            return;
+
+        XPathEntry entry;
+        switch (kind) {
+            case NodeKind::Text:
+                entry = { "text", "#text", Document::decode(markup) };
+                break;
+            case NodeKind::CData:       // <![CDATA[ .. ]]>
+                entry = { "cdatasection", "#cdata-section", std::string(markup.size() >= 12 ? markup.substr(9, markup.size() - 12) : std::string_view()) };
+                break;
+            case NodeKind::Comment:     // <!-- .. -->
+                entry = { "comment", "#comment", std::string(markup.size() >= 7 ? markup.substr(4, markup.size() - 7) : std::string_view()) };
+                break;
+            default: {
+                size_t start = 2 + target.size();
+                size_t end = markup.size() >= start + 2 && markup.substr(markup.size() - 2) == "?>" ? markup.size() - 2 : markup.size();
+                while (start < end && strchr(" \t\r\n", markup[start]))
+                    ++start;
+                entry = { "processinginstruction", std::string(target), std::string(markup.substr(start, end - start)) };
+                break;
+            }
+        }
+        for (uint32_t query : matched)
+            report({ entry, pos, query }, true);
+    }
+
+    bool XPathStream::run(const char* data, size_t length, const XPathMatchHandler& onMatch) {
+        handler = &onMatch;
+        open.clear();
+        active.clear();
+        counters.clear();
+        namespaces.clear();
+        attrs.clear();
+        pending.clear();
+        pendingBase = 0;
+        pendingBytes = 0;
+        peakBytes = 0;
+        errorPos = SIZE_MAX;
+        error.clear();
+
+        // the document node, context of the first steps
+        ++mark;
+        reached.clear();
+        inheritedNow.clear();
+        addReached(0);
+        closure(NodeKind::Document, std::string_view(), nullptr, nullptr);
+        matchQueries();
+        for (uint32_t query : matched)
+            report({ { "document", "#document", "" }, 0, query }, true);
+        active.assign(reached.begin(), reached.end());
+        active.insert(active.end(), inheritedNow.begin(), inheritedNow.end());
+        open.push_back({ std::string_view(), 0, 0, reached.size(), active.size(), 0, SIZE_MAX, 0, false });
+        counters.resize(counterStride, 0);
+
+        XmlParser parser(data, length);
+        parser.skipByteOrderMark();
+        bool hasRoot = false;
+        bool inTag = false;             // attributes of the tag are being read
+        std::string_view tagName;
+        size_t tagPos = 0;
+        bool attrName = false;
+        std::string_view attrNameView;
+        size_t attrPos = 0;
+        size_t closeDepth = 0;
+
+        for (XmlToken token = parser.parseNext(); token.type != XmlTokenType::EndOfFile; token = parser.parseNext()) {
+            switch (token.type) {
+                case XmlTokenType::TagOpening:
+                    if (inTag)
+                        openElement(tagName, tagPos);
+                    if (open.size() == 1) {
+                        if (hasRoot)
+                            fail(token.pos, "more than one root element");
+                        hasRoot = true;
+                    }
+                    inTag = true;
+                    tagName = std::string_view(token.chars + 1, token.size - 1);
+                    tagPos = token.pos;
+                    attrs.clear();
+                    attrName = false;
+                    break;
+                case XmlTokenType::AttrName:
+                    if (attrName)
+                        fail(attrPos, "attribute without value");
+                    attrName = true;
+                    attrNameView = std::string_view(token.chars, token.size);
+                    attrPos = token.pos;
+                    break;
+                case XmlTokenType::AttrValue: {
+                    if (!attrName) {
+                        fail(token.pos, "attribute value without name");
+                        break;
+                    }
+                    std::string_view value = unquote(token.chars, token.size);
+                    attrs.push_back({ attrNameView, value, token.pos + (value.data() - token.chars) });
+                    attrName = false;
+                    break;
+                }
+                case XmlTokenType::TagOpeningEnd:
+                case XmlTokenType::TagSelfClosingEnd:
+                    if (attrName)
+                        fail(attrPos, "attribute without value");
+                    attrName = false;
+                    if (inTag) {
+                        openElement(tagName, tagPos);
+                        inTag = false;
+                        if (token.type == XmlTokenType::TagSelfClosingEnd)
+                            closeElement();
+                    }
+                    break;
+                case XmlTokenType::TagClosing: {
+                    if (inTag) {
+                        openElement(tagName, tagPos);
+                        inTag = false;
+                    }
+                    std::string_view name(token.chars + 2, token.size - 2);
+                    closeDepth = 0;
+                    for (size_t depth = open.size() - 1; depth > 0; --depth) {
+                        if (open[depth].name == name) {
+                            closeDepth = depth;
+                            break;
+                        }
+                    }
+                    if (!closeDepth) {
+                        fail(token.pos, "closing tag without opening tag");
+                        break;
+                    }
+                    if (closeDepth + 1 < open.size())
+                        fail(open.back().offset, "element not closed");
+                    while (open.size() > closeDepth + 1)
+                        closeElement();
+                    break;
+                }
+                case XmlTokenType::TagClosingEnd:
+                    if (closeDepth && open.size() == closeDepth + 1)
+                        closeElement();
+                    closeDepth = 0;
+                    break;
+                case XmlTokenType::Text:
+                    if (inTag) {
+                        openElement(tagName, tagPos);
+                        inTag = false;
+                    }
+                    if (!open.back().preserveSpace && isWhitespace(token.chars, token.size))
+                        break;
+                    if (open.size() == 1 && !isWhitespace(token.chars, token.size))
+                        fail(token.pos, "text outside the root element");
+                    leaf(NodeKind::Text, std::string_view(token.chars, token.size), token.pos);
+                    break;
+                case XmlTokenType::CDATA:
+                case XmlTokenType::Comment:
+                    if (inTag) {
+                        openElement(tagName, tagPos);
+                        inTag = false;
+                    }
+                    leaf(token.type == XmlTokenType::CDATA ? NodeKind::CData : NodeKind::Comment, std::string_view(token.chars, token.size), token.pos);
+                    break;
+                case XmlTokenType::Instruction: {
+                    if (inTag) {
+                        openElement(tagName, tagPos);
+                        inTag = false;
+                    }
+                    // <% .. %> blocks are not XML, and the XML declaration is not a processing instruction
+                    std::string_view markup(token.chars, token.size);
+                    if (markup.size() < 4 || markup[1] != '?' || (markup.compare(2, 3, "xml") == 0 && (markup.size() == 5 || strchr(" \t\r\n?", markup[5]))))
+                        break;
+                    leaf(NodeKind::ProcessingInstruction, markup, token.pos);
+                    break;
+                }
+                default:
+                    break;
+            }
+            // what follows an error is not reported
+            if (errorPos != SIZE_MAX)
+                break;
+        }
+
+        if (inTag && errorPos == SIZE_MAX)
+            openElement(tagName, tagPos);
+        if (open.size() > 1)
+            fail(open.back().offset, "element not closed");
+        while (open.size() > 1)
+            closeElement();
+        if (!hasRoot)
+            fail(length, "no root element");
+        flush();
+        handler = nullptr;
+        return errorPos == SIZE_MAX;
+    }
+
+    XPathRun selectMatches(const char* data, size_t length, const XPathExpression& expression, const XPathMatchHandler& onMatch, const XPathOptions& options) {
+        return selectMatches(data, length, std::vector<XPathExpression>{ expression }, onMatch, options).front();
+    }
+
+    std::vector<XPathRun> selectMatches(const char* data, size_t length, const std::vector<XPathExpression>& expressions, const XPathMatchHandler& onMatch, const XPathOptions& options) {
+        auto notNodeSet = [&expressions](size_t query) {
+            return XPathError(expressions.size() == 1 ? "expression does not evaluate to a node-set"
+                                                      : "expression " + std::to_string(query + 1) + " does not evaluate to a node-set");
+        };
+        std::vector<XPathRun> runs(expressions.size());
+        std::vector<size_t> streamed, others;
+        for (size_t query = 0; query < expressions.size(); ++query) {
+            const XPathExpression& expression = expressions[query];
+            if (expression.tree()[expression.root()].type != XPathType::NodeSet)
+                throw notNodeSet(query);
+            runs[query].reason = XPathStream::unstreamable(expression);
+            if (runs[query].reason.empty()) {
+                streamed.push_back(query);
+            }
+            else {
+                runs[query].strategy = XPathStrategy::Document;
+                others.push_back(query);
+            }
+        }
+
+        if (!streamed.empty()) {
+            std::vector<XPathExpression> list;
+            for (size_t query : streamed)
+                list.push_back(expressions[query]);
+            XPathStream stream(list);
+            bool wellFormed = stream.run(data, length, [&](const XPathMatch& match) {
+                XPathMatch tagged = match;
+                tagged.query = streamed[match.query];
+                ++runs[tagged.query].count;
+                onMatch(tagged);
+            });
+            for (size_t query : streamed) {
+                runs[query].wellFormed = wellFormed;
+                runs[query].errorOffset = stream.errorOffset();
+                runs[query].errorMessage = stream.errorMessage();
+            }
+        }
+
+        if (!others.empty()) {
+            Document document(data, length);
+            XPathOptions documentOptions = options;
+            documentOptions.index = nullptr;
+            for (size_t query : others) {
+                if (!document.wellFormed()) {
+                    runs[query].wellFormed = false;
+                    runs[query].errorOffset = document.errorOffset();
+                    runs[query].errorMessage = document.errorMessage();
+                    continue;
+                }
+                XPathValue value = expressions[query].evaluate(document, XPathNode::tree(document.root()), documentOptions);
+                if (value.type != XPathType::NodeSet)
+                    throw notNodeSet(query);
+                for (const XPathNode& node : value.nodes) {
+                    ++runs[query].count;
+                    onMatch({ xpathEntry(document, node), xpathNodeOffset(document, node), query });
+                }
+            }
+        }
+        return runs;
+    }
+}
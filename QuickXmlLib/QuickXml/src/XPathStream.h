@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "XPath.h"
+
+/*
+* Streaming evaluation of the forward-only XPath expressions: location paths on the child,
+* descendant, descendant-or-self, self and attribute axes, whose predicates only test the
+* attributes of the node and its position among its siblings (ex. /feed/entry[@type='x']/id,
+* //record/@key, //item[2]). The source is read once with the QuickXml parser and the matches are
+* reported as they are found, in document order, with their offset in the source: memory grows
+* with the depth of the document, not with its size, and the source may be larger than the 4GB
+* the document model accepts.
+* An element is reported when it closes, as its value is the text of its direct children; the
+* nodes selected inside a selected element wait for it.
+* Several expressions are evaluated in the same pass: their steps make one automaton, where the
+* expressions starting with the same steps share the states of those steps (as in YFilter), so
+* that the cost of a node grows with the states it reaches rather than with the expressions.
+* selectMatches() falls back to the document model for the other expressions, and tells which way
+* it went.
+*/
+namespace QuickXml {
+    struct XPathMatch {
+        XPathEntry entry;
+        size_t offset;      // start of the node markup, or of the value of an attribute
+        size_t query = 0;   // index of the expression which selected the node
+    };
+
+    typedef std::function<void(const XPathMatch&)> XPathMatchHandler;
+
+    class XPathStream {
+        /*
+        * A state is reached by the nodes selected by the steps from the root to it: the
+        * automaton is the tree of the steps of the expressions, the ones starting alike sharing
+        * their first states.
+        */
+        struct State {
+            const XPathStep* step = nullptr;            // from the parent state; none for the root
+            const std::vector<XPathExpr>* tree = nullptr;   // of the expression the step comes from
+            std::string key;                            // the step as text, to share the states
+            uint32_t counterBase = 0;                   // first position counter, for the child steps with positional predicates
+            bool counted = false;
+            std::vector<uint32_t> childEdges;           // child and descendant steps
+            std::vector<uint32_t> closureEdges;         // descendant-or-self and self steps, reached by the node itself
+            std::vector<uint32_t> attributeEdges;
+            std::vector<uint32_t> queries;              // the expressions ending here
+        };
+
+        struct Open {
+            std::string_view name;
+            size_t offset;
+            size_t contexts;        // states reached by this node: active[contexts, inherited)
+            size_t inherited;       // descendant steps whose candidates are the children of this node: active[inherited, end)
+            size_t end;
+            size_t namespaces;      // size of the namespace stack before the declarations of this node
+            size_t pending;         // index of the first match of this node among the pending ones, SIZE_MAX when not selected
+            size_t pendingCount;
+            bool preserveSpace;
+        };
+
+        struct Attr {
+            std::string_view name;
+            std::string_view raw;   // without the quotes
+            size_t offset;
+        };
+
+        struct Pending {
+            XPathMatch match;
+            bool done;
+        };
+
+        // value of a predicate operand: an attribute (a node-set of at most one node), a literal...
+        struct Value;
+        static bool toBoolean(const Value& value);
+        static double toNumber(const Value& value);
+        static std::string toString(const Value& value);
+        static bool compare(XPathOp op, const Value& left, const Value& right);
+
+        std::vector<XPathExpression> expressions;
+        std::vector<State> states;
+        size_t counterStride = 0;           // position counters of a context node
+
+        // state of a run, bounded by the depth of the document
+        std::vector<Open> open;
+        std::vector<uint32_t> active;       // states of the open nodes
+        std::vector<uint32_t> counters;
+        std::vector<std::pair<std::string_view, std::string_view>> namespaces;     // prefix, URI
+        std::vector<Attr> attrs;            // of the tag being read
+        std::deque<Pending> pending;
+        size_t pendingBase = 0;             // index of pending.front()
+        size_t pendingBytes = 0;
+        const XPathMatchHandler* handler = nullptr;
+        size_t peakBytes = 0;
+
+        // states reached by the current node, without duplicates
+        std::vector<uint32_t> reached, inheritedNow, matched;
+        std::vector<size_t> reachedMark, inheritedMark;
+        size_t mark = 0;
+
+        size_t errorPos = SIZE_MAX;
+        std::string error;
+
+        void fail(size_t pos, const std::string& message);
+        std::string_view lookupNamespace(std::string_view prefix) const;
+        bool testElement(const XPathStep& step, std::string_view qname) const;
+        bool testAttribute(const XPathStep& step, const Attr& attr) const;
+        bool testLeaf(const XPathStep& step, NodeKind kind, std::string_view target) const;
+        bool test(const XPathStep& step, NodeKind kind, std::string_view name) const;
+        bool predicates(const State& state, uint32_t* positions, const Attr* attrBegin, const Attr* attrEnd) const;
+        Value evalValue(const std::vector<XPathExpr>& tree, uint32_t index, size_t position, const Attr* attrBegin, const Attr* attrEnd) const;
+        bool evalPredicate(const std::vector<XPathExpr>& tree, uint32_t index, size_t position, const Attr* attrBegin, const Attr* attrEnd) const;
+
+        void addReached(uint32_t state);
+        void addInherited(uint32_t state);
+        void reach(size_t parentIndex, NodeKind kind, std::string_view name, const Attr* attrBegin, const Attr* attrEnd);
+        void closure(NodeKind kind, std::string_view name, const Attr* attrBegin, const Attr* attrEnd);
+        void matchQueries();
+
+        void report(XPathMatch&& match, bool done);
+        void flush();
+        void openElement(std::string_view name, size_t pos);
+        void closeElement();
+        void leaf(NodeKind kind, std::string_view markup, size_t pos);
+        void updatePeak();
+
+    public:
+        /*
+        * Why the expression cannot be streamed; empty when it can
+        */
+        static std::string unstreamable(const XPathExpression& expression);
+
+        /*
+        * Prepares the streaming evaluation of expressions, in one pass; throws XPathError when one
+        * cannot be streamed (see unstreamable())
+        */
+        explicit XPathStream(const XPathExpression& expression);
+        explicit XPathStream(const std::vector<XPathExpression>& expressions);
+        XPathStream(const XPathStream&) = delete;
+        XPathStream& operator=(const XPathStream&) = delete;
+
+        /*
+        * Reads the source and reports the selected nodes in document order
+        * @param data The source; it does not need to be null terminated
+        * @param length The source length
+        * @param onMatch Called for each selected node, and each expression selecting it
+        * @return false when the source is not well-formed: the matches before the problem are reported
+        */
+        bool run(const char* data, size_t length, const XPathMatchHandler& onMatch);
+
+        size_t errorOffset() const { return errorPos; }
+        const std::string& errorMessage() const { return error; }
+        // the most bytes the evaluator held during the last run, the parser excluded
+        size_t peakMemory() const { return peakBytes; }
+        // states of the automaton, the root included: the steps of the expressions, less the shared ones
+        size_t stateCount() const { return states.size(); }
+    };
+
+    enum class XPathStrategy { Stream, Document };
+
+    struct XPathRun {
+        XPathStrategy strategy = XPathStrategy::Stream;
+        std::string reason;             // why the document model was used
+        size_t count = 0;               // reported matches
+        bool wellFormed = true;
+        size_t errorOffset = SIZE_MAX;
+        std::string errorMessage;
+    };
+
+    /*
+    * Reports the nodes the expression selects in the source, streaming when the expression
+    * allows it, with the document model otherwise. On a source which is not well-formed, the
+    * document model reports nothing, the stream what it found before the problem. Throws
+    * XPathError when the expression does not give a node-set.
+    * The options apply to the document model (threads, cancellation); there is no index to use.
+    */
+    XPathRun selectMatches(const char* data, size_t length, const XPathExpression& expression, const XPathMatchHandler& onMatch, const XPathOptions& options = XPathOptions());
+
+    /*
+    * The same for several expressions, in a single read of the source: the matches of the streamed
+    * expressions come first, in document order, then those of the others, expression after
+    * expression, from a single document model. XPathMatch::query tells the expression.
+    */
+    std::vector<XPathRun> selectMatches(const char* data, size_t length, const std::vector<XPathExpression>& expressions, const XPathMatchHandler& onMatch, const XPathOptions& options = XPathOptions());
+}
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "XmlDocument.h"
+#include "XmlParser.h"
+
+namespace QuickXml {
+    namespace {
+        const size_t maxBlockSize = 1024 * 1024;
+
+        bool isWhitespace(const char* text, size_t length) {
+            for (size_t i = 0; i < length; ++i) {
+                char c = text[i];
+                if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                    return false;
+            }
+            return true;
+        }
+
+        bool startsWith(std::string_view s, const char* prefix) {
+            size_t n = strlen(prefix);
+            return s.size() >= n && !memcmp(s.data(), prefix, n);
+        }
+
+        // the value of an attribute token, without its quotes
+        std::string_view unquote(const char* chars, size_t size) {
+            if (size >= 2 && (chars[0] == '"' || chars[0] == '\'') && chars[size - 1] == chars[0])
+                return std::string_view(chars + 1, size - 2);
+            return std::string_view(chars, size);
+        }
+
+        void appendUtf8(std::string& out, unsigned long cp) {
+            if (cp < 0x80) {
+                out += (char)cp;
+            }
+            else if (cp < 0x800) {
+                out += (char)(0xC0 | (cp >> 6));
+                out += (char)(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000) {
+                out += (char)(0xE0 | (cp >> 12));
+                out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                out += (char)(0x80 | (cp & 0x3F));
+            }
+            else {
+                out += (char)(0xF0 | (cp >> 18));
+                out += (char)(0x80 | ((cp >> 12) & 0x3F));
+                out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                out += (char)(0x80 | (cp & 0x3F));
+            }
+        }
+
+        // one node, and the last child appended to it, while its content is read
+        struct OpenNode {
+            NodeId node;
+            NodeId lastChild;
+            bool preserveSpace;
+        };
+    }
+
+    Arena::Arena(size_t blockSize) : blockSize(blockSize) {}
+
+    Arena::~Arena() {
+        while (blocks) {
+            Block* next = blocks->next;
+            ::operator delete(blocks);
+            blocks = next;
+        }
+    }
+
+    void* Arena::allocate(size_t size, size_t align) {
+        uintptr_t at = ((uintptr_t)pos + align - 1) & ~(uintptr_t)(align - 1);
+        if (!pos || at + size > (uintptr_t)end) {
+            size_t header = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+            size_t bytes = std::max(blockSize, header + size + align);
+            Block* block = static_cast<Block*>(::operator new(bytes));
+            block->next = blocks;
+            block->size = bytes;
+            blocks = block;
+            reserved += bytes;
+            pos = reinterpret_cast<char*>(block) + header;
+            end = reinterpret_cast<char*>(block) + bytes;
+            at = ((uintptr_t)pos + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        pos = reinterpret_cast<char*>(at + size);
+        return reinterpret_cast<void*>(at);
+    }
+
+    Document::Document(const char* data, size_t length, const DocumentParms& parms)
+        : src(data), srcLength(length), arena(std::min<size_t>(maxBlockSize, std::max<size_t>(4096, length / 8))) {
+        if (length >= UINT32_MAX)
+            throw std::length_error("document larger than 4GB");
+
+        // pages of about a node every 32 bytes of source, from 64 to 4096 entries
+        size_t bits = 6;
+        while (bits < 12 && (size_t(1) << bits) * 32 < length)
+            ++bits;
+        kinds.setPageBits(bits);
+        parents.setPageBits(bits);
+        nextSiblings.setPageBits(bits);
+        names.setPageBits(bits);
+        offsets.setPageBits(bits);
+        lengths.setPageBits(bits);
+        attrBegins.setPageBits(bits);
+        attrNames.setPageBits(bits);
+        valueOffsets.setPageBits(bits);
+        valueLengths.setPageBits(bits);
+
+        build(parms);
+    }
+
+    NameId Document::intern(std::string_view name) {
+        auto found = nameIndex.find(name);
+        if (found != nameIndex.end())
+            return found->second;
+        NameId id = (NameId)nameTable.size();
+        nameTable.push_back(name);
+        nameIndex.emplace(name, id);
+        return id;
+    }
+
+    NodeId Document::addNode(NodeKind kind, NodeId parent, NameId name, size_t offset, size_t length) {
+        NodeId node = (NodeId)kinds.size();
+        kinds.push(arena, kind);
+        parents.push(arena, parent);
+        nextSiblings.push(arena, NoNode);
+        names.push(arena, name);
+        offsets.push(arena, (uint32_t)offset);
+        lengths.push(arena, (uint32_t)length);
+        attrBegins.push(arena, (AttrId)attrNames.size());
+        return node;
+    }
+
+    void Document::fail(size_t pos, const std::string& message) {
+        if (errorPos == SIZE_MAX) {
+            errorPos = pos;
+            error = message;
+        }
+    }
+
+    void Document::build(const DocumentParms& parms) {
+        std::vector<OpenNode> open;
+        open.push_back({ addNode(NodeKind::Document, NoNode, NoName, 0, srcLength), NoNode, false });
+        bool hasRoot = false;
+
+        auto append = [this, &open](NodeKind kind, NameId name, size_t offset, size_t length) {
+            OpenNode& parent = open.back();
+            NodeId node = addNode(kind, parent.node, name, offset, length);
+            if (parent.lastChild != NoNode)
+                nextSiblings[parent.lastChild] = node;
+            parent.lastChild = node;
+            return node;
+        };
+        // ends the element on top of the stack at end
+        auto close = [this, &open](size_t end) {
+            NodeId node = open.back().node;
+            lengths[node] = (uint32_t)(end - offsets[node]);
+            open.pop_back();
+        };
+
+        XmlParser parser(src, srcLength);
+        parser.skipByteOrderMark();
+        NameId attrName = NoName;
+        size_t attrPos = 0;
+        size_t closeDepth = 0;      // depth of the element closed by the current closing tag, 0 when none
+        bool inDoctype = false;
+
+        for (XmlToken token = parser.parseNext(); token.type != XmlTokenType::EndOfFile; token = parser.parseNext()) {
+            switch (token.type) {
+                case XmlTokenType::TagOpening: {
+                    if (open.size() == 1) {
+                        if (hasRoot)
+                            fail(token.pos, "more than one root element");
+                        hasRoot = true;
+                    }
+                    NodeId node = append(NodeKind::Element, intern(std::string_view(token.chars + 1, token.size - 1)), token.pos, token.size);
+                    open.push_back({ node, NoNode, open.back().preserveSpace });
+                    attrName = NoName;
+                    break;
+                }
+                case XmlTokenType::AttrName:
+                    if (attrName != NoName)
+                        fail(attrPos, "attribute without value");
+                    attrName = intern(std::string_view(token.chars, token.size));
+                    attrPos = token.pos;
+                    break;
+                case XmlTokenType::AttrValue: {
+                    if (attrName == NoName) {
+                        fail(token.pos, "attribute value without name");
+                        break;
+                    }
+                    std::string_view value = unquote(token.chars, token.size);
+                    attrNames.push(arena, attrName);
+                    valueOffsets.push(arena, (uint32_t)(value.data() - src));
+                    valueLengths.push(arena, (uint32_t)value.size());
+                    if (nameTable[attrName] == "xml:space")
+                        open.back().preserveSpace = (value == "preserve");
+                    attrName = NoName;
+                    break;
+                }
+                case XmlTokenType::TagOpeningEnd:
+                    if (attrName != NoName)
+                        fail(attrPos, "attribute without value");
+                    attrName = NoName;
+                    break;
+                case XmlTokenType::TagSelfClosingEnd:
+                    if (attrName != NoName)
+                        fail(attrPos, "attribute without value");
+                    attrName = NoName;
+                    if (open.size() > 1)
+                        close(token.pos + token.size);
+                    break;
+                case XmlTokenType::TagClosing: {
+                    std::string_view name(token.chars + 2, token.size - 2);
+                    closeDepth = 0;
+                    for (size_t depth = open.size() - 1; depth > 0; --depth) {
+                        if (nameTable[names[open[depth].node]] == name) {
+                            closeDepth = depth;
+                            break;
+                        }
+                    }
+                    if (!closeDepth) {
+                        fail(token.pos, "closing tag without opening tag");
+                        break;
+                    }
+                    if (closeDepth + 1 < open.size())
+                        fail(offsets[open.back().node], "element not closed");
+                    while (open.size() > closeDepth + 1)
+                        close(token.pos);
+                    break;
+                }
+                case XmlTokenType::TagClosingEnd:
+                    if (closeDepth && open.size() == closeDepth + 1)
+                        close(token.pos + token.size);
+                    closeDepth = 0;
+                    break;
+                case XmlTokenType::Text:
+                    if (!open.back().preserveSpace && !parms.keepWhitespace && isWhitespace(token.chars, token.size))
+                        break;
+                    if (open.size() == 1 && !isWhitespace(token.chars, token.size))
+                        fail(token.pos, "text outside the root element");
+                    append(NodeKind::Text, NoName, token.pos, token.size);
+                    break;
+                case XmlTokenType::CDATA:
+                    append(NodeKind::CData, NoName, token.pos, token.size);
+                    break;
+                case XmlTokenType::Comment:
+                    append(NodeKind::Comment, NoName, token.pos, token.size);
+                    break;
+                case XmlTokenType::Instruction: {
+                    // <% .. %> blocks are not XML, and the XML declaration is not a processing instruction
+                    if (token.size < 4 || token.chars[1] != '?')
+                        break;
+                    size_t end = 2;
+                    while (end < token.size && !strchr(" \t\r\n?", token.chars[end]))
+                        ++end;
+                    std::string_view target(token.chars + 2, end - 2);
+                    if (target == "xml")
+                        break;
+                    append(NodeKind::ProcessingInstruction, intern(target), token.pos, token.size);
+                    break;
+                }
+                case XmlTokenType::DeclarationBeg:
+                case XmlTokenType::DeclarationSelfClosing:
+                    if (open.size() == 1 && !hasRoot && !doctypeLength && startsWith(std::string_view(token.chars, token.size), "<!DOCTYPE")) {
+                        doctypeOffset = token.pos;
+                        doctypeLength = token.size;
+                        inDoctype = (token.type == XmlTokenType::DeclarationBeg);
+                    }
+                    break;
+                case XmlTokenType::DeclarationEnd:
+                    if (inDoctype) {
+                        doctypeLength = token.pos + token.size - doctypeOffset;
+                        inDoctype = false;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (open.size() > 1)
+            fail(offsets[open.back().node], "element not closed");
+        while (open.size() > 1)
+            close(srcLength);
+        if (!hasRoot)
+            fail(srcLength, "no root element");
+    }
+
+    NodeId Document::documentElement() const {
+        for (NodeId node = firstChild(root()); node != NoNode; node = nextSibling(node)) {
+            if (kind(node) == NodeKind::Element)
+                return node;
+        }
+        return NoNode;
+    }
+
+    NameId Document::findName(std::string_view name) const {
+        auto found = nameIndex.find(name);
+        return found == nameIndex.end() ? NoName : found->second;
+    }
+
+    std::string_view Document::prefixOf(std::string_view qname) {
+        size_t colon = qname.find(':');
+        return colon == std::string_view::npos ? std::string_view() : qname.substr(0, colon);
+    }
+
+    std::string_view Document::localNameOf(std::string_view qname) {
+        size_t colon = qname.find(':');
+        return colon == std::string_view::npos ? qname : qname.substr(colon + 1);
+    }
+
+    std::string_view Document::rawValue(NodeId node) const {
+        std::string_view markup = source(node);
+        switch (kind(node)) {
+            case NodeKind::Text:
+                return markup;
+            case NodeKind::CData:       // <![CDATA[ .. ]]>
+                return markup.size() >= 12 ? markup.substr(9, markup.size() - 12) : std::string_view();
+            case NodeKind::Comment:     // <!-- .. -->
+                return markup.size() >= 7 ? markup.substr(4, markup.size() - 7) : std::string_view();
+            case NodeKind::ProcessingInstruction: {
+                size_t start = 2 + name(node).size();
+                size_t end = markup.size() >= start + 2 && markup.substr(markup.size() - 2) == "?>" ? markup.size() - 2 : markup.size();
+                while (start < end && strchr(" \t\r\n", markup[start]))
+                    ++start;
+                return markup.substr(start, end - start);
+            }
+            default:
+                return std::string_view();
+        }
+    }
+
+    std::string Document::value(NodeId node) const {
+        switch (kind(node)) {
+            case NodeKind::Text:
+                return decode(rawValue(node));
+            case NodeKind::Element:
+            case NodeKind::Document: {
+                std::string res;
+                NodeId current = firstChild(node);
+                while (current != NoNode) {
+                    NodeKind currentKind = kind(current);
+                    if (currentKind == NodeKind::Text)
+                        res += decode(rawValue(current));
+                    else if (currentKind == NodeKind::CData)
+                        res += rawValue(current);
+
+                    if (currentKind == NodeKind::Element && firstChild(current) != NoNode) {
+                        current = firstChild(current);
+                        continue;
+                    }
+                    while (current != node && nextSibling(current) == NoNode)
+                        current = parent(current);
+                    current = (current == node ? NoNode : nextSibling(current));
+                }
+                return res;
+            }
+            default:
+                return std::string(rawValue(node));
+        }
+    }
+
+    AttrId Document::findAttribute(NodeId element, std::string_view qname) const {
+        NameId id = findName(qname);
+        if (id == NoName)
+            return NoAttr;
+        for (AttrId attr = attributesBegin(element), end = attributesEnd(element); attr < end; ++attr) {
+            if (attrNames[attr] == id)
+                return attr;
+        }
+        return NoAttr;
+    }
+
+    AttrId Document::findAttribute(NodeId element, std::string_view namespaceUri, std::string_view localName) const {
+        for (AttrId attr = attributesBegin(element), end = attributesEnd(element); attr < end; ++attr) {
+            std::string_view qname = attributeName(attr);
+            if (localNameOf(qname) == localName && qname != "xmlns" && prefixOf(qname) != "xmlns" &&
+                attributeNamespaceUri(element, attr) == namespaceUri)
+                return attr;
+        }
+        return NoAttr;
+    }
+
+    std::string Document::attributeValue(AttrId attr) const {
+        // line breaks and tabs written in a value are read as spaces; the character references are not
+        std::string normalized(rawAttributeValue(attr));
+        for (char& c : normalized) {
+            if (c == '\t' || c == '\n' || c == '\r')
+                c = ' ';
+        }
+        return decode(normalized);
+    }
+
+    std::string_view Document::lookupNamespace(NodeId element, std::string_view prefix) const {
+        if (prefix == "xml")
+            return "http://www.w3.org/XML/1998/namespace";
+        if (prefix == "xmlns")
+            return "http://www.w3.org/2000/xmlns/";
+        for (NodeId node = element; node != NoNode; node = parent(node)) {
+            if (kind(node) != NodeKind::Element)
+                continue;
+            for (AttrId attr = attributesBegin(node), end = attributesEnd(node); attr < end; ++attr) {
+                std::string_view qname = attributeName(attr);
+                bool declares = prefix.empty() ? qname == "xmlns"
+                                               : (qname.size() == 6 + prefix.size() && startsWith(qname, "xmlns:") && qname.substr(6) == prefix);
+                if (declares)
+                    return rawAttributeValue(attr);
+            }
+        }
+        return std::string_view();
+    }
+
+    std::string_view Document::namespaceUri(NodeId node) const {
+        if (kind(node) != NodeKind::Element)
+            return std::string_view();
+        return lookupNamespace(node, prefixOf(name(node)));
+    }
+
+    std::string_view Document::attributeNamespaceUri(NodeId element, AttrId attr) const {
+        std::string_view prefix = prefixOf(attributeName(attr));
+        return prefix.empty() ? std::string_view() : lookupNamespace(element, prefix);
+    }
+
+    size_t Document::memoryUsage() const {
+        size_t tables = kinds.tableBytes() + parents.tableBytes() + nextSiblings.tableBytes() +
+                        names.tableBytes() + offsets.tableBytes() + lengths.tableBytes() + attrBegins.tableBytes() +
+                        attrNames.tableBytes() + valueOffsets.tableBytes() + valueLengths.tableBytes();
+        // a hash node holds the key, the value and the link to the next node
+        size_t index = nameIndex.size() * (sizeof(std::pair<const std::string_view, NameId>) + 2 * sizeof(void*)) +
+                       nameIndex.bucket_count() * sizeof(void*);
+        return arena.bytes() + tables + nameTable.capacity() * sizeof(std::string_view) + index + error.capacity();
+    }
+
+    std::string Document::decode(std::string_view raw) {
+        size_t amp = raw.find('&');
+        if (amp == std::string_view::npos)
+            return std::string(raw);
+
+        std::string res(raw.substr(0, amp));
+        res.reserve(raw.size());
+        size_t pos = amp;
+        while (pos < raw.size()) {
+            if (raw[pos] != '&') {
+                size_t next = raw.find('&', pos);
+                if (next == std::string_view::npos)
+                    next = raw.size();
+                res.append(raw.data() + pos, next - pos);
+                pos = next;
+                continue;
+            }
+            size_t semicolon = raw.find(';', pos);
+            if (semicolon == std::string_view::npos) {
+                res.append(raw.data() + pos, raw.size() - pos);
+                break;
+            }
+            std::string_view entity = raw.substr(pos + 1, semicolon - pos - 1);
+            bool known = true;
+            if (entity == "lt") res += '<';
+            else if (entity == "gt") res += '>';
+            else if (entity == "amp") res += '&';
+            else if (entity == "quot") res += '"';
+            else if (entity == "apos") res += '\'';
+            else if (entity.size() > 1 && entity[0] == '#') {
+                bool hex = (entity[1] == 'x');
+                std::string digits(entity.substr(hex ? 2 : 1));
+                char* end = nullptr;
+                unsigned long cp = digits.empty() ? 0 : strtoul(digits.c_str(), &end, hex ? 16 : 10);
+                known = (end && *end == '\0' && cp > 0 && cp <= 0x10FFFF);
+                if (known)
+                    appendUtf8(res, cp);
+            }
+            else {
+                known = false;
+            }
+            if (!known)
+                res.append(raw.data() + pos, semicolon + 1 - pos);
+            pos = semicolon + 1;
+        }
+        return res;
+    }
+}
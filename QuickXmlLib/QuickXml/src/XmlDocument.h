@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+* A read-only document model built in one pass over the QuickXml tokens. The nodes are kept as
+* columns (kind, parent, next sibling, name, source span) rather than objects, in pages taken
+* from a bump arena. Nodes are numbered in document order, so that the first child of a node is
+* the next node, when its parent is that node; names are interned, and names, texts and attribute values are
+* views into the source buffer, which must outlive the document. Entities are only decoded when
+* a value is asked for.
+* The model does not check the document: it builds what it can from a malformed one, and tells
+* where the first problem is (see wellFormed()).
+*/
+namespace QuickXml {
+    // bump allocator: blocks are only given back when the arena is destroyed
+    class Arena {
+        struct Block {
+            Block* next;
+            size_t size;
+        };
+        Block* blocks = nullptr;
+        char* pos = nullptr;
+        char* end = nullptr;
+        size_t blockSize;
+        size_t reserved = 0;
+
+    public:
+        explicit Arena(size_t blockSize = 16 * 1024);
+        ~Arena();
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+        template <class T>
+        T* allocateArray(size_t count) {
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // bytes taken from the system
+        size_t bytes() const { return reserved; }
+    };
+
+    // a growing array in fixed pages from an arena: it never moves what it holds. The page size
+    // is set before the first push, after the expected size, so that small documents stay small.
+    template <class T>
+    class PagedColumn {
+        size_t pageBits = 12;
+        size_t pageMask = (size_t(1) << 12) - 1;
+        std::vector<T*> pages;
+        size_t count = 0;
+
+    public:
+        void setPageBits(size_t bits) {
+            pageBits = bits;
+            pageMask = (size_t(1) << bits) - 1;
+        }
+        void push(Arena& arena, T value) {
+            if ((count & pageMask) == 0)
+                pages.push_back(arena.allocateArray<T>(pageMask + 1));
+            pages.back()[count & pageMask] = value;
+            ++count;
+        }
+        T& operator[](size_t i) { return pages[i >> pageBits][i & pageMask]; }
+        const T& operator[](size_t i) const { return pages[i >> pageBits][i & pageMask]; }
+        size_t size() const { return count; }
+        size_t tableBytes() const { return pages.capacity() * sizeof(T*); }
+    };
+
+    enum class NodeKind : uint8_t {
+        Document,
+        Element,
+        Text,
+        CData,
+        Comment,
+        ProcessingInstruction
+    };
+
+    typedef uint32_t NodeId;
+    typedef uint32_t AttrId;
+    typedef uint32_t NameId;
+    const NodeId NoNode = UINT32_MAX;
+    const AttrId NoAttr = UINT32_MAX;
+    const NameId NoName = UINT32_MAX;
+
+    struct DocumentParms {
+        bool keepWhitespace = false;    // keep the whitespace-only texts everywhere, not only under xml:space="preserve"
+    };
+
+    class Document {
+        const char* src;
+        size_t srcLength;
+        Arena arena;
+
+        // node columns; the document node is node 0
+        PagedColumn<NodeKind> kinds;
+        PagedColumn<NodeId> parents;
+        PagedColumn<NodeId> nextSiblings;
+        PagedColumn<NameId> names;          // elements and processing instructions
+        PagedColumn<uint32_t> offsets;      // span of the node markup in the source
+        PagedColumn<uint32_t> lengths;
+        PagedColumn<AttrId> attrBegins;     // attributes of node i are [attrBegins[i], attrBegins[i + 1])
+
+        // attribute columns
+        PagedColumn<NameId> attrNames;
+        PagedColumn<uint32_t> valueOffsets; // value without its quotes
+        PagedColumn<uint32_t> valueLengths;
+
+        std::vector<std::string_view> nameTable;
+        std::unordered_map<std::string_view, NameId> nameIndex;
+
+        size_t doctypeOffset = 0;
+        size_t doctypeLength = 0;
+        size_t errorPos = SIZE_MAX;
+        std::string error;
+
+        NameId intern(std::string_view name);
+        NodeId addNode(NodeKind kind, NodeId parent, NameId name, size_t offset, size_t length);
+        void build(const DocumentParms& parms);
+        void fail(size_t pos, const std::string& message);
+
+    public:
+        /*
+        * Builds the document model of the source
+        * @param data The source; it does not need to be null terminated, and must outlive the document
+        * @param length The source length (less than 4GB)
+        * @param parms Building options
+        */
+        Document(const char* data, size_t length, const DocumentParms& parms = DocumentParms());
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+
+        /*
+        * Structure
+        */
+        NodeId root() const { return 0; }
+        NodeId documentElement() const;
+        size_t nodeCount() const { return kinds.size(); }
+        NodeKind kind(NodeId node) const { return kinds[node]; }
+        NodeId parent(NodeId node) const { return parents[node]; }
+        NodeId firstChild(NodeId node) const { return node + 1 < kinds.size() && parents[node + 1] == node ? node + 1 : NoNode; }
+        NodeId nextSibling(NodeId node) const { return nextSiblings[node]; }
+
+        /*
+        * Names: the qualified name of an element, or the target of a processing instruction
+        */
+        NameId nameId(NodeId node) const { return names[node]; }
+        std::string_view name(NodeId node) const { return names[node] == NoName ? std::string_view() : nameTable[names[node]]; }
+        std::string_view nameOf(NameId id) const { return nameTable[id]; }
+        size_t nameCount() const { return nameTable.size(); }
+        // id of an interned name, NoName when no node or attribute has it
+        NameId findName(std::string_view name) const;
+        static std::string_view prefixOf(std::string_view qname);
+        static std::string_view localNameOf(std::string_view qname);
+
+        /*
+        * Source and values. rawValue() is the text of a text or CDATA node, the content of a
+        * comment, or the data of a processing instruction, as written in the source. value() is
+        * the same with entities decoded for texts, and the concatenated texts of the descendants
+        * for an element or the document (XPath string-value).
+        */
+        size_t offset(NodeId node) const { return offsets[node]; }
+        std::string_view source(NodeId node) const { return std::string_view(src + offsets[node], lengths[node]); }
+        std::string_view rawValue(NodeId node) const;
+        std::string value(NodeId node) const;
+
+        /*
+        * Attributes of an element, namespace declarations included
+        */
+        AttrId attributesBegin(NodeId node) const { return attrBegins[node]; }
+        AttrId attributesEnd(NodeId node) const { return node + 1 < attrBegins.size() ? attrBegins[node + 1] : (AttrId)attrNames.size(); }
+        size_t attributeCount() const { return attrNames.size(); }
+        NameId attributeNameId(AttrId attr) const { return attrNames[attr]; }
+        std::string_view attributeName(AttrId attr) const { return nameTable[attrNames[attr]]; }
+        std::string_view rawAttributeValue(AttrId attr) const { return std::string_view(src + valueOffsets[attr], valueLengths[attr]); }
+        // value with entities decoded and whitespace normalized
+        std::string attributeValue(AttrId attr) const;
+        size_t attributeOffset(AttrId attr) const { return valueOffsets[attr]; }
+        // attribute of the element by its qualified name, NoAttr when missing
+        AttrId findAttribute(NodeId element, std::string_view qname) const;
+        // attribute of the element by namespace URI and local name, NoAttr when missing
+        AttrId findAttribute(NodeId element, std::string_view namespaceUri, std::string_view localName) const;
+
+        /*
+        * Namespaces, from the xmlns declarations in scope. The URIs are taken as written.
+        */
+        // URI bound to the prefix ("" for the default namespace) at the element; empty when unbound
+        std::string_view lookupNamespace(NodeId element, std::string_view prefix) const;
+        // namespace URI of an element
+        std::string_view namespaceUri(NodeId node) const;
+        // namespace URI of an attribute of the element: none without a prefix
+        std::string_view attributeNamespaceUri(NodeId element, AttrId attr) const;
+
+        /*
+        * The <!DOCTYPE ...> declaration, empty when there is none
+        */
+        std::string_view doctype() const { return std::string_view(src + doctypeOffset, doctypeLength); }
+
+        /*
+        * Well-formedness problems met while building: only the first one is kept
+        */
+        bool wellFormed() const { return errorPos == SIZE_MAX; }
+        size_t errorOffset() const { return errorPos; }
+        const std::string& errorMessage() const { return error; }
+
+        // bytes held by the model, the source excluded
+        size_t memoryUsage() const;
+
+        // decodes the predefined entities and the character references; unknown entities are kept
+        static std::string decode(std::string_view raw);
+    };
+}
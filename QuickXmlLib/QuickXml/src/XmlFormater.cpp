@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cctype>
 #include "XmlFormater.h"
 
 namespace QuickXml {
@@ -33,7 +34,7 @@ namespace QuickXml {
 	}
 
 	static inline std::string to_lowercase(std::string text) {
-		std::transform(text.begin(), text.end(), text.begin(), std::tolower);
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
 		return text;
 	}
 
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "XmlIndex.h"
+
+namespace QuickXml {
+    namespace {
+        bool isNamespaceDeclaration(std::string_view qname) {
+            return qname == "xmlns" || (qname.size() > 6 && qname.substr(0, 6) == "xmlns:");
+        }
+    }
+
+    DocumentIndex::NodeRange DocumentIndex::NodeRange::within(NodeId from, NodeId to) const {
+        NodeRange range;
+        range.first = std::lower_bound(first, last, from);
+        range.last = std::lower_bound(range.first, last, to);
+        return range;
+    }
+
+    DocumentIndex::NodeRange DocumentIndex::Groups::group(NameId name) const {
+        NodeRange range;
+        if (name + (size_t)1 < starts.size()) {
+            range.first = nodes.data() + starts[name];
+            range.last = nodes.data() + starts[name + 1];
+        }
+        return range;
+    }
+
+    const std::vector<std::string>& DocumentIndex::defaultIdentityAttributes() {
+        static const std::vector<std::string> attributes = { "id", "name" };
+        return attributes;
+    }
+
+    DocumentIndex::DocumentIndex(const Document& document, const std::vector<std::string>& identityAttributes)
+        : doc(document), identity(identityAttributes) {}
+
+    bool DocumentIndex::isIdentityAttribute(std::string_view qname) const {
+        return std::find(identity.begin(), identity.end(), qname) != identity.end();
+    }
+
+    void DocumentIndex::ensure(Part part, size_t (DocumentIndex::*build)() const) const {
+        Built& state = parts[(size_t)part];
+        if (state.done.load(std::memory_order_acquire))
+            return;
+        std::lock_guard<std::mutex> lock(building);
+        if (state.done.load(std::memory_order_relaxed))
+            return;
+        auto start = std::chrono::steady_clock::now();
+        state.stats.bytes = (this->*build)();
+        state.stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        state.stats.built = true;
+        state.done.store(true, std::memory_order_release);
+    }
+
+    size_t DocumentIndex::buildNames() const {
+        // counted first, so that each group is filled in place, in document order
+        names.starts.assign(doc.nameCount() + 1, 0);
+        for (NodeId node = 0; node < doc.nodeCount(); ++node) {
+            if (doc.kind(node) == NodeKind::Element)
+                ++names.starts[doc.nameId(node) + 1];
+        }
+        for (size_t i = 1; i < names.starts.size(); ++i)
+            names.starts[i] += names.starts[i - 1];
+        names.nodes.resize(names.starts.back());
+        std::vector<uint32_t> next(names.starts.begin(), names.starts.end() - 1);
+        for (NodeId node = 0; node < doc.nodeCount(); ++node) {
+            if (doc.kind(node) == NodeKind::Element)
+                names.nodes[next[doc.nameId(node)]++] = node;
+        }
+        return names.bytes();
+    }
+
+    size_t DocumentIndex::buildAttributes() const {
+        attributes.starts.assign(doc.nameCount() + 1, 0);
+        std::vector<NodeId> last(doc.nameCount(), NoNode);     // an attribute repeated in a malformed element counts once
+        for (int pass = 0; pass < 2; ++pass) {
+            std::vector<uint32_t> next;
+            if (pass == 1) {
+                for (size_t i = 1; i < attributes.starts.size(); ++i)
+                    attributes.starts[i] += attributes.starts[i - 1];
+                attributes.nodes.resize(attributes.starts.back());
+                next.assign(attributes.starts.begin(), attributes.starts.end() - 1);
+                std::fill(last.begin(), last.end(), NoNode);
+            }
+            for (NodeId node = 0; node < doc.nodeCount(); ++node) {
+                if (doc.kind(node) != NodeKind::Element)
+                    continue;
+                for (AttrId attr = doc.attributesBegin(node), end = doc.attributesEnd(node); attr < end; ++attr) {
+                    NameId name = doc.attributeNameId(attr);
+                    if (last[name] == node || isNamespaceDeclaration(doc.nameOf(name)))
+                        continue;
+                    last[name] = node;
+                    if (pass == 0)
+                        ++attributes.starts[name + 1];
+                    else
+                        attributes.nodes[next[name]++] = node;
+                }
+            }
+        }
+        return attributes.bytes();
+    }
+
+    size_t DocumentIndex::buildValues() const {
+        std::vector<bool> indexed(doc.nameCount(), false);
+        bool any = false;
+        for (const std::string& qname : identity) {
+            NameId name = doc.findName(qname);
+            if (name != NoName && !isNamespaceDeclaration(qname)) {
+                indexed[name] = true;
+                any = true;
+            }
+        }
+        if (any) {
+            std::string scratch;
+            for (NodeId node = 0; node < doc.nodeCount(); ++node) {
+                if (doc.kind(node) != NodeKind::Element)
+                    continue;
+                for (AttrId attr = doc.attributesBegin(node), end = doc.attributesEnd(node); attr < end; ++attr) {
+                    if (indexed[doc.attributeNameId(attr)])
+                        values.push_back({ hash(attributeString(attr, scratch)), node, attr });
+                }
+            }
+            std::sort(values.begin(), values.end());
+            values.shrink_to_fit();
+        }
+        return values.capacity() * sizeof(Value);
+    }
+
+    DocumentIndex::NodeRange DocumentIndex::elementsNamed(NameId name) const {
+        ensure(Part::Names, &DocumentIndex::buildNames);
+        return names.group(name);
+    }
+
+    DocumentIndex::NodeRange DocumentIndex::elementsWithAttribute(NameId name) const {
+        ensure(Part::Attributes, &DocumentIndex::buildAttributes);
+        return attributes.group(name);
+    }
+
+    std::vector<NodeId> DocumentIndex::elementsWithValue(NameId attribute, std::string_view value) const {
+        std::vector<NodeId> elements;
+        if (attribute == NoName || !isIdentityAttribute(doc.nameOf(attribute)))
+            return elements;
+        ensure(Part::Values, &DocumentIndex::buildValues);
+
+        Value key = { hash(value), 0, 0 };
+        auto found = std::lower_bound(values.begin(), values.end(), key);
+        std::string scratch;
+        // the equal hashes are in document order; a hash may be shared by other values
+        for (; found != values.end() && found->hash == key.hash; ++found) {
+            if (doc.attributeNameId(found->attr) != attribute || attributeString(found->attr, scratch) != value)
+                continue;
+            if (elements.empty() || elements.back() != found->element)
+                elements.push_back(found->element);
+        }
+        return elements;
+    }
+
+    bool DocumentIndex::built(Part part) const {
+        return parts[(size_t)part].done.load(std::memory_order_acquire);
+    }
+
+    DocumentIndex::Stats DocumentIndex::stats(Part part) const {
+        return built(part) ? parts[(size_t)part].stats : Stats();
+    }
+
+    size_t DocumentIndex::memoryUsage() const {
+        size_t bytes = 0;
+        for (Part part : { Part::Names, Part::Attributes, Part::Values })
+            bytes += stats(part).bytes;
+        return bytes;
+    }
+
+    std::string_view DocumentIndex::attributeString(AttrId attr, std::string& scratch) const {
+        std::string_view raw = doc.rawAttributeValue(attr);
+        if (raw.find_first_of("&\t\r\n") == std::string_view::npos)
+            return raw;
+        scratch = doc.attributeValue(attr);
+        return scratch;
+    }
+
+    uint64_t DocumentIndex::hash(std::string_view value) {
+        return std::hash<std::string_view>()(value);
+    }
+}
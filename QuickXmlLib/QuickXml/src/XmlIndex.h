@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "XmlDocument.h"
+
+/*
+* Inverted indexes over a Document, so that the XPath evaluator finds the candidates of a
+* descendant step (//order, //item[@id='A123'], //item[@sku]) without scanning the subtree:
+*   names        element name -> elements
+*   attributes   attribute name -> elements having it (namespace declarations excluded)
+*   values       identity attribute (id and name by default) -> hash of its value -> elements
+* Names are the qualified names, as interned by the document. The node lists are in document
+* order, so that the part in the subtree of a node is found by a binary search.
+* Each index is built on its first use, in one pass over the nodes or the attributes, and kept
+* until the DocumentIndex is destroyed; the building is guarded, so that an index can be shared
+* by several threads. The document must outlive its index.
+*/
+namespace QuickXml {
+    class DocumentIndex {
+    public:
+        enum class Part { Names, Attributes, Values };
+
+        // what an index cost: nothing when it has not been built
+        struct Stats {
+            bool built = false;
+            size_t bytes = 0;
+            double milliseconds = 0;
+        };
+
+        // nodes in document order, a view into an index
+        struct NodeRange {
+            const NodeId* first = nullptr;
+            const NodeId* last = nullptr;
+
+            const NodeId* begin() const { return first; }
+            const NodeId* end() const { return last; }
+            size_t size() const { return last - first; }
+            bool empty() const { return first == last; }
+            // the nodes in [from, to)
+            NodeRange within(NodeId from, NodeId to) const;
+        };
+
+        static const std::vector<std::string>& defaultIdentityAttributes();
+
+        /*
+        * Prepares the indexes of the document; none is built yet
+        * @param document The document, which must outlive the index
+        * @param identityAttributes Qualified names of the attributes whose values are indexed
+        */
+        explicit DocumentIndex(const Document& document, const std::vector<std::string>& identityAttributes = defaultIdentityAttributes());
+        DocumentIndex(const DocumentIndex&) = delete;
+        DocumentIndex& operator=(const DocumentIndex&) = delete;
+
+        const Document& document() const { return doc; }
+        const std::vector<std::string>& identityAttributes() const { return identity; }
+        bool isIdentityAttribute(std::string_view qname) const;
+
+        // elements with this name
+        NodeRange elementsNamed(NameId name) const;
+        // elements having an attribute with this name
+        NodeRange elementsWithAttribute(NameId name) const;
+        /*
+        * Elements whose identity attribute has this value, compared as XPath compares strings
+        * (entities decoded, whitespace normalized); none when the attribute is not an identity one
+        */
+        std::vector<NodeId> elementsWithValue(NameId attribute, std::string_view value) const;
+
+        bool built(Part part) const;
+        Stats stats(Part part) const;
+        // bytes held by the indexes built so far
+        size_t memoryUsage() const;
+
+    private:
+        // nodes grouped by name: the nodes of name i are nodes[starts[i], starts[i + 1])
+        struct Groups {
+            std::vector<uint32_t> starts;
+            std::vector<NodeId> nodes;
+
+            NodeRange group(NameId name) const;
+            size_t bytes() const { return starts.capacity() * sizeof(uint32_t) + nodes.capacity() * sizeof(NodeId); }
+        };
+
+        struct Value {
+            uint64_t hash;
+            NodeId element;
+            AttrId attr;
+
+            bool operator<(const Value& other) const { return hash != other.hash ? hash < other.hash : attr < other.attr; }
+        };
+
+        struct Built {
+            std::atomic<bool> done{ false };
+            Stats stats;        // written once, before done
+        };
+
+        const Document& doc;
+        std::vector<std::string> identity;
+
+        mutable Groups names;
+        mutable Groups attributes;
+        mutable std::vector<Value> values;      // sorted by hash, then in document order
+        mutable Built parts[3];
+        mutable std::mutex building;
+
+        // builds the part unless it is already, and times it; the build function gives the bytes it took
+        void ensure(Part part, size_t (DocumentIndex::*build)() const) const;
+        size_t buildNames() const;
+        size_t buildAttributes() const;
+        size_t buildValues() const;
+
+        // the string-value of an attribute, without copy when the source holds it as is
+        std::string_view attributeString(AttrId attr, std::string& scratch) const;
+        static uint64_t hash(std::string_view value);
+    };
+}
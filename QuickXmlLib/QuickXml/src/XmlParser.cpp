@@ -1,6 +1,28 @@
+#include <cstdint>
+#include <cstring>
+
 #include "XmlParser.h"
 
 namespace QuickXml {
+	namespace {
+		// set of chars, faster to test than strchr() on each char of the source
+		struct CharSet {
+			uint64_t bits[4] = { 0, 0, 0, 0 };
+
+			CharSet(const char* characters) {
+				for (; *characters; ++characters) {
+					unsigned char c = static_cast<unsigned char>(*characters);
+					bits[c >> 6] |= uint64_t(1) << (c & 63);
+				}
+			}
+
+			bool contains(char ch) const {
+				unsigned char c = static_cast<unsigned char>(ch);
+				return (bits[c >> 6] >> (c & 63)) & 1;
+			}
+		};
+	}
+
 	XmlParser::XmlParser(const char* data, size_t length) {
 		this->srcText = data;
 		this->srcLength = length;
@@ -26,6 +48,12 @@ namespace QuickXml {
 		this->nexttoken = { XmlTokenType::Undefined, NULL, 0, 0, this->currcontext };
 	}
 
+	bool XmlParser::skipByteOrderMark() {
+		if (this->currpos != 0 || !this->startsWith("\xEF\xBB\xBF")) return false;
+		this->currpos = 3;
+		return true;
+	}
+
 	bool XmlParser::isSpacePreserve() {
 		if (this->currtoken.context.inOpeningTag || this->currtoken.context.inClosingTag) return false;
 		if (this->preserveSpace.empty()) return false;
@@ -106,8 +134,7 @@ namespace QuickXml {
 			currentchar = cursor[0];
 			currpos_bak = this->currpos;
 			if (currentchar == '<') {
-				// @todo : prevent reading outside chars buffer
-				if (cursor[1] == '?') {
+				if (this->peek(1) == '?') {
 					// <?xml ...?>
 					// let's leave it untouched
 					this->currcontext.inOpeningTag = false;
@@ -118,7 +145,7 @@ namespace QuickXml {
 						     this->readUntil("?>", 0, true),
 							 this->currcontext };
 				}
-				else if (cursor[1] == '%') {
+				else if (this->peek(1) == '%') {
 					// not really xml, but for jsp compatibility
 					// let's leave it untouched
 					this->currcontext.inOpeningTag = false;
@@ -129,7 +156,7 @@ namespace QuickXml {
 							 this->readUntil("%>", 0, true),
 							 this->currcontext };
 				}
-				else if (cursor[1] == '!' && cursor[2] == '-' && cursor[3] == '-') {
+				else if (this->startsWith("<!--")) {
 					// <!--
 					// let's leave it untouched
 					this->currcontext.inOpeningTag = false;
@@ -140,8 +167,7 @@ namespace QuickXml {
 							 this->readUntil("-->", 0, true),
 							 this->currcontext };
 				}
-				else if (cursor[1] == '!' && cursor[2] == '[' && cursor[3] == 'C' && cursor[4] == 'D' &&
-					cursor[5] == 'A' && cursor[6] == 'T' && cursor[7] == 'A' && cursor[8] == '[') {
+				else if (this->startsWith("<![CDATA[")) {
 					// <![CDATA[
 					// let's leave it untouched
 					this->currcontext.inOpeningTag = false;
@@ -152,7 +178,7 @@ namespace QuickXml {
 							 this->readUntil("]]>", 0, true),
 							 this->currcontext };
 				}
-				else if (cursor[1] == '!') {
+				else if (this->peek(1) == '!') {
 					// <!  for instance "<![INCLUDE or <!DOCTYPE
 					// some other declaration
 					this->currcontext.inOpeningTag = false;
@@ -172,8 +198,7 @@ namespace QuickXml {
 					// parse declarations
 					// we must decide if we have a DeclarationBeg or DeclarationSelfClosing
 					size_t ncharsread = this->readDeclaration();
-					cursor = this->srcText + this->currpos - 1;
-					XmlTokenType tokentype = (cursor[0] == '>' ? XmlTokenType::DeclarationSelfClosing : XmlTokenType::DeclarationBeg);
+					XmlTokenType tokentype = (this->srcText[this->currpos - 1] == '>' ? XmlTokenType::DeclarationSelfClosing : XmlTokenType::DeclarationBeg);
 					if (tokentype == XmlTokenType::DeclarationSelfClosing) this->currcontext.declarationObjects--;
 
 					XmlToken token = { tokentype,
@@ -187,7 +212,7 @@ namespace QuickXml {
 					}*/
 					return token;
 				}
-				else if (cursor[1] == '/') {
+				else if (this->peek(1) == '/') {
 					// </ns:sample
 					this->currcontext.inOpeningTag = false;
 					this->currcontext.inClosingTag = true;
@@ -219,7 +244,7 @@ namespace QuickXml {
 				break;
 			}
 			else if (this->currcontext.declarationObjects > 0) {
-				if (currentchar == ']' && cursor[1] == '>') {
+				if (currentchar == ']' && this->peek(1) == '>') {
 					if (this->currcontext.declarationObjects > 0) {
 						this->currcontext.declarationObjects--;
 					}
@@ -320,7 +345,7 @@ namespace QuickXml {
 							 this->currcontext };
 				}
 				else if (currentchar == '/') {
-					if (cursor[1] == '>') {
+					if (this->peek(1) == '>') {
 						this->hasAttrName = false;
 						this->currcontext.inOpeningTag = false;
 						return { XmlTokenType::TagSelfClosingEnd,
@@ -370,7 +395,7 @@ namespace QuickXml {
 							        this->currcontext };
 						}
 
-						if (!this->preserveSpace.empty() && !strncmp(this->attrnametoken.chars, "xml:space", this->attrnametoken.size)) {
+						if (!this->preserveSpace.empty() && tmp.size >= 2 && !strncmp(this->attrnametoken.chars, "xml:space", this->attrnametoken.size)) {
 							if (!strncmp(tmp.chars + 1, "preserve", tmp.size - 2)) {
 								this->preserveSpace.pop();	// replace the actual stack top
 								this->preserveSpace.push(true);
@@ -430,21 +455,43 @@ namespace QuickXml {
 		return nchars;
 	}
 
+	char XmlParser::peek(size_t offset) {
+		size_t pos = this->currpos + offset;
+		return (pos < this->srcLength) ? this->srcText[pos] : '\0';
+	}
+
+	bool XmlParser::startsWith(const char* str) {
+		size_t len = strlen(str);
+		return this->currpos + len <= this->srcLength && !memcmp(this->srcText + this->currpos, str, len);
+	}
+
+	const char* XmlParser::find(const char* from, const char* str) {
+		const char* end = this->srcText + this->srcLength;
+		size_t len = strlen(str);
+		while (from + len <= end) {
+			from = static_cast<const char*>(memchr(from, str[0], end - from));
+			if (from == NULL || from + len > end) break;
+			if (!memcmp(from, str, len)) return from;
+			++from;
+		}
+		return NULL;
+	}
+
 	size_t XmlParser::readNextWord(bool skipQuotedStrings) {
 		if (skipQuotedStrings) {
-			const char* cursor = this->srcText + this->currpos;
 			size_t num = 0;
 			size_t n = this->readChars(1);
 			while (n > 0) {
 				num += n;
-				if (cursor[num] == ' ' || cursor[num] == '\t' || cursor[num] == '\r' || cursor[num] == '\n') {
+				char c = this->peek();
+				if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
 					break;
 				}
-				else if (cursor[num] == '"') {
+				else if (c == '"') {
 					num += this->readUntil("\"", 1, true);
 					break;
 				}
-				else if (cursor[num] == '\'') {
+				else if (c == '\'') {
 					num += this->readUntil("'", 1, true);
 					break;
 				}
@@ -462,8 +509,17 @@ namespace QuickXml {
 		size_t res = 0;
 		if (offset > 0) offset = this->readChars(offset);
 		const char* cursor = this->srcText + this->currpos;
-		const char* tmp = strpbrk(cursor, characters);
-		if (!tmp) tmp = this->srcText + this->srcLength;
+		const char* end = this->srcText + this->srcLength;
+		const char* tmp = cursor;
+		if (characters[0] != '\0' && characters[1] == '\0') {
+			// a single character (text content, attribute values) is the most frequent case
+			tmp = static_cast<const char*>(memchr(cursor, characters[0], end - cursor));
+			if (!tmp) tmp = end;
+		}
+		else {
+			CharSet set(characters);
+			while (tmp < end && !set.contains(*tmp)) ++tmp;
+		}
 		res = tmp - cursor;
 		if (goAfter) {
 			++res;
@@ -478,7 +534,12 @@ namespace QuickXml {
 
 	size_t XmlParser::readUntilFirstNotOf(const char* characters, size_t offset) {
 		if (offset > 0) offset = this->readChars(offset);
-		size_t res = strspn(this->srcText + this->currpos, characters);
+		CharSet set(characters);
+		const char* cursor = this->srcText + this->currpos;
+		const char* end = this->srcText + this->srcLength;
+		const char* tmp = cursor;
+		while (tmp < end && set.contains(*tmp)) ++tmp;
+		size_t res = tmp - cursor;
 		this->currpos += res;
 		return res + offset;
 	}
@@ -487,14 +548,14 @@ namespace QuickXml {
 		size_t res = 0;
 		if (offset > 0) offset = this->readChars(offset);
 		const char* cursor = this->srcText + this->currpos;
+		const char* end;
 		if (skipDelimiter.length() > 0) {
 			size_t lvl = 0;
 			const char* beg;
-			const char* end;
 			do {
-				end = strstr(cursor, delimiter);
-				beg = strstr(cursor, skipDelimiter.c_str());
-				if (beg != NULL && beg < end) {
+				end = this->find(cursor, delimiter);
+				beg = this->find(cursor, skipDelimiter.c_str());
+				if (beg != NULL && (end == NULL || beg < end)) {
 					++lvl;
 					cursor = beg + 1;
 				}
@@ -502,23 +563,23 @@ namespace QuickXml {
 					--lvl;
 					cursor = end + 1;
 				}
+				else {
+					break;
+				}
 			} while (lvl > 0);
-			if (!end) end = this->srcText + this->srcLength;
-			res = end - (this->srcText + this->currpos);
-			if (goAfter) {
-				res += strlen(delimiter);
-			}
-			this->currpos += res;
 		}
 		else {
-			const char* end = strstr(cursor, delimiter);
-			if (!end) end = this->srcText + this->srcLength;
-			res = end - cursor;
-			if (goAfter) {
-				res += strlen(delimiter);
+			end = this->find(cursor, delimiter);
+		}
+		if (!end) end = this->srcText + this->srcLength;
+		res = end - (this->srcText + this->currpos);
+		if (goAfter) {
+			res += strlen(delimiter);
+			if (this->currpos + res > this->srcLength) {
+				res = this->srcLength - this->currpos;
 			}
-			this->currpos += res;
 		}
+		this->currpos += res;
 		return res + offset;
 	}
 
@@ -541,10 +602,9 @@ namespace QuickXml {
 		*/
 
 		size_t res = 0;
-		const char* cursor = this->srcText + this->currpos;
 		bool continueloop = true;
 
-		if (cursor[2] == '[') {
+		if (this->peek(2) == '[') {
 			res += this->readChars(3);
 		}
 		else {
@@ -552,10 +612,10 @@ namespace QuickXml {
 		}
 		while (continueloop) {
 			res += this->readUntilFirstOf("[>\"'", 0, false);
-			cursor = this->srcText + this->currpos;
-			if (cursor[0] == '\"') {
+			char c = this->peek();
+			if (c == '\"') {
 				res += this->readUntil("\"", 1, true);
-			} else if (cursor[0] == '\'') {
+			} else if (c == '\'') {
 				res += this->readUntil("'", 1, true);
 			}
 			else {
@@ -70,6 +70,12 @@ namespace QuickXml {
 
         XmlToken fetchToken();
 
+        // the source is read within srcLength only: it does not need to be null terminated,
+        // so that a range of the editor buffer can be parsed without copying it
+        char peek(size_t offset = 0);           // char at currpos + offset, or '\0' after the end
+        bool startsWith(const char* str);       // does the source continue with str at currpos
+        const char* find(const char* from, const char* str);  // first str after from, or NULL
+
         // a queue of read tokens
         std::list<XmlToken> buffer;
 
@@ -78,7 +84,7 @@ namespace QuickXml {
     public:
         /*
         * Constructor
-        * @param data The data to parse
+        * @param data The data to parse; it does not need to be null terminated
         * @param length The data length
         */
         XmlParser(const char* data, size_t length);
@@ -93,6 +99,13 @@ namespace QuickXml {
         */
         void reset();
 
+        /*
+        * Skip a UTF-8 byte order mark at the start of the source
+        * Token positions stay offsets into the source
+        * @return True when a byte order mark was skipped
+        */
+        bool skipByteOrderMark();
+
         /*
         * Getters
         */
@@ -1,6 +1,8 @@
 #include "CppUnitTest.h"
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <fstream>
 #include <string>
 #include <streambuf>
@@ -14,7 +16,11 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace QuickXml;
 
 namespace QuickXmlTests {
+#ifdef XMLTOOLS_TESTFILES
+	std::string xmltestsfileshome(XMLTOOLS_TESTFILES);
+#else
 	std::string xmltestsfileshome("D:\\Progs\\C++\\xmltools\\SimpleXmlLib\\SimpleXmlTests\\TestFiles\\");
+#endif
 
 	TEST_CLASS(QuickXmlTests) {
 		std::string readFile(std::string filepath) {
@@ -24,7 +30,7 @@ namespace QuickXmlTests {
 			return res;
 		}
 
-		void writeFile(std::string data, std::wstring filepath) {
+		void writeFile(std::string data, std::string filepath) {
 			std::ofstream ofs(filepath);
 			ofs << data;
 			ofs.close();
@@ -130,6 +136,20 @@ namespace QuickXmlTests {
 			testParser(xml, ref);
 		}
 
+		TEST_METHOD(ParserTest03) {
+			// the text after length must never be read: every prefix of the document is parsed
+			// in place, with the rest of the document (delimiters included) right after it
+			std::string xml("<?xml?><!DOCTYPE a [<!ENTITY e \"v\">]><a x='1' y=\"2\"><!--c--><![CDATA[d]]>t<b/></a>");
+			for (size_t length = 0; length <= xml.length(); ++length) {
+				XmlParser parser(xml.c_str(), length);
+				XmlToken token;
+				do {
+					token = parser.parseNext();
+					Assert::IsTrue(token.pos + token.size <= length);
+				} while (token.type != XmlTokenType::EndOfFile);
+			}
+		}
+
 		//--------------------------------------------------------------------------------------------
 
 		// Pretty print
@@ -179,14 +199,14 @@ namespace QuickXmlTests {
 			params.indentOnly = false;
 			params.applySpacePreserve = true;
 
-			std::string xml = readFile("PrettyPrint\\FullTest.in.xml");
-			std::string ref = readFile("PrettyPrint\\FullTest.out.xml");
+			std::string xml = readFile("PrettyPrint/FullTest.in.xml");
+			std::string ref = readFile("PrettyPrint/FullTest.out.xml");
 
 			XmlFormater formater(xml.c_str(), xml.length(), params);
 			std::stringstream* out = formater.prettyPrint();
 			std::string tmp(out->str());
 			tmp.append(params.eolChars);	// the sample has as added final CRLF
-			//writeFile(tmp, L"D:\\Progs\\C++\\xmltools\\SimpleXmlLib\\SimpleXmlTests\\TestFiles\\PrettyPrint\\FullTest.test.xml");
+			//writeFile(tmp, xmltestsfileshome + "PrettyPrint/FullTest.test.xml");
 
 			Assert::IsTrue(0 == tmp.compare(ref.c_str()));
 
@@ -0,0 +1,105 @@
+#include "CppUnitTest.h"
+
+#include <memory>
+#include <string>
+
+#include "XPathPlan.h"
+#include "XPathPlan.cpp"  // required, to avoid unresolved linked symbol error
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace QuickXml;
+
+namespace QuickXmlTests {
+	TEST_CLASS(XPathPlanTests) {
+		const std::string xml = "<r><a x=\"ab\" n=\"3\">1</a><a x=\"b\" n=\"4\">2</a><a>3</a></r>";
+
+		static std::string values(const Document& doc, const XPathExpression& expression) {
+			std::string res;
+			for (const XPathEntry& entry : selectEntries(doc, expression))
+				res += entry.value + ";";
+			return res;
+		}
+
+	public:
+		TEST_METHOD(ConstantsAreFolded) {
+			Document doc(xml.c_str(), xml.length());
+
+			XPathExpression folded("//a[@x = concat('a', 'b')]");
+			Assert::AreEqual((size_t)1, folded.folded());
+			Assert::AreEqual(std::string("1;"), values(doc, folded));
+
+			// nested constants fold into one, positions too
+			XPathExpression position("/r/a[1 + 1]");
+			Assert::AreEqual((size_t)1, position.folded());
+			Assert::AreEqual(std::string("2;"), values(doc, position));
+			Assert::AreEqual(std::string("3;"), values(doc, XPathExpression("/r/a[number('3') * (2 - 1)]")));
+			Assert::AreEqual((size_t)3, XPathExpression("/r/a[number('3') * (2 - 1)]").folded());
+			Assert::AreEqual(std::string("1;2;3;"), values(doc, XPathExpression("/r/a[not(1 > 2)]")));
+			Assert::AreEqual(std::string(""), values(doc, XPathExpression("/r/a[string-length('') > 0]")));
+			XPathExpression number("1 div 2");
+			Assert::IsTrue(number.tree()[number.root()].op == XPathOp::Number);
+			Assert::AreEqual(0.5, number.evaluate(doc).number);
+
+			// the context and the document are not constants
+			Assert::AreEqual((size_t)0, XPathExpression("/r/a[position() = last()]").folded());
+			Assert::AreEqual((size_t)0, XPathExpression("/r/a[string-length() = 1]").folded());
+			Assert::AreEqual((size_t)0, XPathExpression("/r/a[@n = count(/r/a)]").folded());
+			Assert::AreEqual(std::string("1;"), values(doc, XPathExpression("/r/a[@n = count(/r/a)]")));
+		}
+
+		TEST_METHOD(Strategy) {
+			XPathPlan streamed("//a[@x = concat('a', 'b')]/@n");
+			Assert::IsTrue(streamed.strategy() == XPathStrategy::Stream);
+			Assert::IsTrue(streamed.reason().empty());
+
+			XPathPlan document("//a[last()]");
+			Assert::IsTrue(document.strategy() == XPathStrategy::Document);
+			Assert::IsFalse(document.reason().empty());
+
+			XPathNamespaces namespaces = { { "p", "urn:p" } };
+			XPathPlan prefixed("/p:r/p:a", namespaces);
+			std::string description = prefixed.describe();
+			Assert::IsTrue(description.find("namespace: p=urn:p") != std::string::npos);
+			Assert::IsTrue(description.find("strategy: stream") != std::string::npos);
+			Assert::IsTrue(description.find("step child::{urn:p}a") != std::string::npos);
+			Assert::IsTrue(document.describe().find("strategy: document model (") != std::string::npos);
+			Assert::IsTrue(XPathPlan("//a[1 + 1]").describe().find("folded constants: 1") != std::string::npos);
+		}
+
+		TEST_METHOD(CacheKeyedByExpressionAndBindings) {
+			XPathPlanCache cache;
+			std::shared_ptr<const XPathPlan> plan = cache.get("//p:a", { { "p", "urn:1" } });
+			Assert::IsTrue(plan == cache.get("//p:a", { { "p", "urn:1" } }));
+			Assert::IsTrue(plan != cache.get("//p:a", { { "p", "urn:2" } }));
+			Assert::IsTrue(plan != cache.get("//p:a ", { { "p", "urn:1" } }));
+
+			XPathPlanCache::Stats stats = cache.stats();
+			Assert::AreEqual((size_t)1, stats.hits);
+			Assert::AreEqual((size_t)3, stats.misses);
+			Assert::AreEqual((size_t)3, stats.entries);
+
+			// nothing kept for an expression which does not compile
+			Assert::ExpectException<XPathError>([&cache]() { cache.get("//p:a"); });
+			Assert::ExpectException<XPathError>([&cache]() { cache.get("//a["); });
+			Assert::AreEqual((size_t)3, cache.stats().entries);
+		}
+
+		TEST_METHOD(CacheEvictsLeastRecentlyUsed) {
+			XPathPlanCache cache(2);
+			std::shared_ptr<const XPathPlan> a = cache.get("//a");
+			std::shared_ptr<const XPathPlan> b = cache.get("//b");
+			cache.get("//a");
+			cache.get("//c");
+
+			Assert::AreEqual((size_t)1, cache.stats().evictions);
+			Assert::IsTrue(a == cache.get("//a"));
+			Assert::IsTrue(b != cache.get("//b"));
+			// a plan given out stays valid once evicted
+			Assert::AreEqual(std::string("//b"), b->expression().expression());
+
+			cache.setCapacity(0);
+			Assert::AreEqual((size_t)0, cache.stats().entries);
+			Assert::IsTrue(cache.get("//a") != cache.get("//a"));
+		}
+	};
+}
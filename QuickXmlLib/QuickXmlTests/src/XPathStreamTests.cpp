@@ -0,0 +1,253 @@
+#include "CppUnitTest.h"
+
+#include <string>
+#include <vector>
+
+#include "XPathStream.h"
+#include "XPathStream.cpp"  // required, to avoid unresolved linked symbol error
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace QuickXml;
+
+namespace QuickXmlTests {
+	TEST_CLASS(XPathStreamTests) {
+		const std::string books =
+			"<?xml version=\"1.0\"?>\n"
+			"<library xmlns:m=\"urn:meta\" xml:lang=\"en\">\n"
+			"  <!-- catalogue -->\n"
+			"  <book code=\"b1\" year=\"1990\" m:state=\"old\"><title>Alpha</title><price>10.5</price></book>\n"
+			"  <book code=\"b2\" year=\"2005\"><title>Beta &amp; co</title><price>20</price></book>\n"
+			"  <book code=\"b3\" year=\"2010\"><title>Gamma</title><price>30</price><?note keep?></book>\n"
+			"  <shelf>left<book code=\"b4\"><title>Delta</title><book code=\"b5\"/></book>right<![CDATA[<raw>]]></shelf>\n"
+			"  <m:index><m:entry ref=\"b1\"/><entry ref=\"b2\"/></m:index>\n"
+			"</library>\n";
+
+		static std::string describe(const XPathEntry& entry) {
+			return entry.type + " " + entry.name + "=" + entry.value;
+		}
+
+		// the matches of the stream, as "type name=value@offset" separated by "|"
+		static std::string stream(const std::string& xml, const std::string& expression, const XPathNamespaces& namespaces = XPathNamespaces()) {
+			XPathStream evaluator(XPathExpression(expression, namespaces));
+			std::string res;
+			evaluator.run(xml.c_str(), xml.length(), [&res](const XPathMatch& match) {
+				if (!res.empty())
+					res += "|";
+				res += describe(match.entry) + "@" + std::to_string(match.offset);
+			});
+			return res;
+		}
+
+		// the same with the document model
+		static std::string document(const std::string& xml, const std::string& expression, const XPathNamespaces& namespaces = XPathNamespaces()) {
+			Document doc(xml.c_str(), xml.length());
+			XPathValue value = XPathExpression(expression, namespaces).evaluate(doc);
+			std::string res;
+			for (const XPathNode& node : value.nodes) {
+				if (!res.empty())
+					res += "|";
+				size_t offset = node.type == XPathNode::Attribute ? doc.attributeOffset(node.index) : doc.offset(node.node);
+				res += describe(xpathEntry(doc, node)) + "@" + std::to_string(offset);
+			}
+			return res;
+		}
+
+		static XPathRun run(const std::string& xml, const std::string& expression, std::string& res) {
+			return selectMatches(xml.c_str(), xml.length(), XPathExpression(expression), [&res](const XPathMatch& match) {
+				if (!res.empty())
+					res += "|";
+				res += describe(match.entry);
+			});
+		}
+
+	public:
+		TEST_METHOD(MatchesDocumentModel) {
+			const char* expressions[] = {
+				"/", "/library", "/library/book", "//book", "//title", "//book/title", "/library//title",
+				"//*", "//node()", "//text()", "//comment()", "//processing-instruction()", "//processing-instruction('note')",
+				"//@*", "//@code", "//book/@code", "/library/shelf/book/book/@code", "//book//book",
+				"/library/*", "/library/node()", "/library/book/self::book", "//book/self::*/title",
+				"/descendant::book", "/descendant::book/descendant::title", "//shelf/text()", "//shelf/node()",
+				"//book[@year]", "//book[not(@year)]", "//book[@year > 2000]", "//book[@year >= '2005' and @code != 'b3']",
+				"//book[@code = 'b2' or @code = 'b4']/title", "//book[contains(@code, '1')]", "//book[starts-with(@code, 'b')]",
+				"//book[@missing = '']", "//book[@code = @year]", "//book[true()]", "//book[false()]", "//book[boolean(@m:state)]",
+				"//book[1]", "//book[2]", "//title[1]", "/library/book[last() = 0]", "/library/book[position() > 1]",
+				"/library/book[position() = 1 or @code = 'b3']", "/library/book[@year][2]", "/library/book[2][@year]",
+				"/library/*[3]", "/library/node()[1]", "//book[1 and @year]", "//m:index/*", "//m:entry/@ref", "//*[@m:state]/@m:state",
+				"//m:*", "/library/m:index/entry", "//@m:*"
+			};
+			XPathNamespaces namespaces = { { "m", "urn:meta" } };
+			for (const char* expression : expressions) {
+				XPathExpression compiled(expression, namespaces);
+				if (!XPathStream::unstreamable(compiled).empty())
+					continue;
+				Assert::AreEqual(document(books, expression, namespaces), stream(books, expression, namespaces));
+			}
+		}
+
+		TEST_METHOD(ByteOrderMark) {
+			std::string xml = "\xEF\xBB\xBF" + books;
+			const char* expressions[] = { "/", "/library/book", "//title", "//@code", "//comment()", "//book[@year > 2000]/title", "//m:entry/@ref" };
+			XPathNamespaces namespaces = { { "m", "urn:meta" } };
+			for (const char* expression : expressions)
+				Assert::AreEqual(document(xml, expression, namespaces), stream(xml, expression, namespaces));
+
+			// offsets stay offsets into the source, mark included
+			Assert::AreEqual(std::string("attribute code=b1@") + std::to_string(xml.find("b1")), stream(xml, "/library/book[1]/@code"));
+			std::string res;
+			Assert::IsTrue(run(xml, "//title", res).wellFormed);
+		}
+
+		TEST_METHOD(SeveralExpressionsInOnePass) {
+			const char* expressions[] = {
+				"/library/book/title", "//book/@code", "//book[2]", "//title", "/", "//book[@year > 2000]/title",
+				"//book/title", "//text()", "//m:*", "/library/book/title", "//*", "//book//book", "//@*"
+			};
+			XPathNamespaces namespaces = { { "m", "urn:meta" } };
+			std::vector<XPathExpression> list;
+			for (const char* expression : expressions)
+				list.emplace_back(expression, namespaces);
+
+			XPathStream evaluator(list);
+			std::vector<std::string> results(list.size());
+			size_t lastOffset = 0;
+			bool ordered = true;
+			evaluator.run(books.c_str(), books.length(), [&](const XPathMatch& match) {
+				std::string& res = results[match.query];
+				if (!res.empty())
+					res += "|";
+				res += describe(match.entry) + "@" + std::to_string(match.offset);
+				ordered = ordered && match.offset >= lastOffset;
+				lastOffset = match.offset;
+			});
+			Assert::IsTrue(ordered);
+			for (size_t query = 0; query < list.size(); ++query)
+				Assert::AreEqual(stream(books, expressions[query], namespaces), results[query]);
+		}
+
+		TEST_METHOD(SharedStates) {
+			std::vector<XPathExpression> list = { XPathExpression("/library/book/title"), XPathExpression("/library/book/price"), XPathExpression("/library/book/@code") };
+			Assert::AreEqual(size_t(6), XPathStream(list).stateCount());
+			list.push_back(XPathExpression("/library/book/title"));
+			list.push_back(XPathExpression("library/book[@code='b1']/title"));
+			list.push_back(XPathExpression("/library/book[ @code = \"b1\" ]"));
+			Assert::AreEqual(size_t(8), XPathStream(list).stateCount());
+		}
+
+		TEST_METHOD(SeveralExpressionsWithFallback) {
+			std::vector<XPathExpression> list = { XPathExpression("//title/.."), XPathExpression("//book/@code"), XPathExpression("//price") };
+			std::vector<std::string> results(list.size());
+			std::vector<XPathRun> runs = selectMatches(books.c_str(), books.length(), list, [&results](const XPathMatch& match) {
+				results[match.query] += match.entry.value + ";";
+			});
+			Assert::AreEqual(size_t(3), runs.size());
+			Assert::IsTrue(runs[0].strategy == XPathStrategy::Document);
+			Assert::IsTrue(runs[1].strategy == XPathStrategy::Stream);
+			Assert::IsTrue(runs[2].strategy == XPathStrategy::Stream);
+			Assert::AreEqual(size_t(4), runs[0].count);
+			Assert::AreEqual(size_t(5), runs[1].count);
+			Assert::AreEqual(std::string("b1;b2;b3;b4;b5;"), results[1]);
+			Assert::AreEqual(std::string("10.5;20;30;"), results[2]);
+
+			list.push_back(XPathExpression("count(//book)"));
+			Assert::ExpectException<XPathError>([&]() { selectMatches(books.c_str(), books.length(), list, [](const XPathMatch&) {}); });
+		}
+
+		TEST_METHOD(Offsets) {
+			std::string xml = "<a><b id=\"1\">x</b><!--c--><b id='2'/></a>";
+			Assert::AreEqual(std::string("element b=x@3|element b=@26"), stream(xml, "/a/b"));
+			Assert::AreEqual(std::string("attribute id=1@10|attribute id=2@33"), stream(xml, "//@id"));
+			Assert::AreEqual(std::string("comment #comment=c@18"), stream(xml, "//comment()"));
+			Assert::AreEqual(std::string("document #document=@0"), stream(xml, "/"));
+		}
+
+		TEST_METHOD(NestedMatchesWaitForTheirAncestor) {
+			std::string xml = "<a><b>1<b>2</b>3<c x='y'/></b></a>";
+			std::vector<std::string> order;
+			XPathStream evaluator(XPathExpression("//*"));
+			evaluator.run(xml.c_str(), xml.length(), [&order](const XPathMatch& match) { order.push_back(match.entry.name + "=" + match.entry.value); });
+			Assert::AreEqual(size_t(4), order.size());
+			Assert::AreEqual(std::string("a="), order[0]);
+			Assert::AreEqual(std::string("b=13"), order[1]);
+			Assert::AreEqual(std::string("b=2"), order[2]);
+			Assert::AreEqual(std::string("c="), order[3]);
+		}
+
+		TEST_METHOD(Strategy) {
+			std::string res;
+			XPathRun streamed = run(books, "//book[@year > 2000]/title", res);
+			Assert::IsTrue(streamed.strategy == XPathStrategy::Stream);
+			Assert::AreEqual(std::string(), streamed.reason);
+			Assert::AreEqual(size_t(2), streamed.count);
+			Assert::AreEqual(std::string("element title=Beta & co|element title=Gamma"), res);
+
+			res.clear();
+			XPathRun fallback = run(books, "//title/parent::book/@code", res);
+			Assert::IsTrue(fallback.strategy == XPathStrategy::Document);
+			Assert::AreEqual(std::string("the parent axis is not streamed"), fallback.reason);
+			Assert::AreEqual(size_t(4), fallback.count);
+			Assert::AreEqual(std::string("attribute code=b1|attribute code=b2|attribute code=b3|attribute code=b4"), res);
+
+			res.clear();
+			Assert::IsTrue(run(books, "(//book)[last()]/@code", res).strategy == XPathStrategy::Document);
+			Assert::AreEqual(std::string("attribute code=b5"), res);
+			Assert::IsTrue(run(books, "//book[last()]", res).strategy == XPathStrategy::Document);
+			Assert::IsTrue(run(books, "//book[title = 'Alpha']", res).strategy == XPathStrategy::Document);
+			Assert::IsTrue(run(books, "/descendant::book[1]", res).strategy == XPathStrategy::Document);
+			Assert::IsTrue(run(books, "//book/@code/..", res).strategy == XPathStrategy::Document);
+			Assert::IsTrue(run(books, "//text()/..", res).strategy == XPathStrategy::Document);
+			Assert::IsTrue(run(books, "//book | //title", res).strategy == XPathStrategy::Document);
+
+			Assert::ExpectException<XPathError>([this, &res]() { run(books, "count(//book)", res); });
+			Assert::ExpectException<XPathError>([]() { XPathStream evaluator(XPathExpression("//book/following::*")); });
+		}
+
+		TEST_METHOD(NotWellFormed) {
+			std::string xml = "<a><b id='1'/><c>text</a>";
+			std::string res;
+			XPathRun streamed = run(xml, "//@id", res);
+			Assert::IsFalse(streamed.wellFormed);
+			Assert::AreEqual(std::string("attribute id=1"), res);
+			Document doc(xml.c_str(), xml.length());
+			Assert::AreEqual(doc.errorOffset(), streamed.errorOffset);
+			Assert::AreEqual(doc.errorMessage(), streamed.errorMessage);
+
+			res.clear();
+			XPathRun fallback = run(xml, "//b/..", res);
+			Assert::IsFalse(fallback.wellFormed);
+			Assert::AreEqual(size_t(0), fallback.count);
+			Assert::AreEqual(doc.errorOffset(), fallback.errorOffset);
+
+			const char* sources[] = { "", "text", "<a/><b/>", "<a>", "</a>", "<a x/>", "<a/>x" };
+			for (const char* source : sources) {
+				std::string text(source);
+				Document expected(text.c_str(), text.length());
+				XPathStream evaluator(XPathExpression("//*"));
+				Assert::IsFalse(evaluator.run(text.c_str(), text.length(), [](const XPathMatch&) {}));
+				Assert::AreEqual(expected.errorOffset(), evaluator.errorOffset());
+				Assert::AreEqual(expected.errorMessage(), evaluator.errorMessage());
+			}
+		}
+
+		TEST_METHOD(MemoryBoundedByDepth) {
+			auto flat = [](size_t items) {
+				std::string xml = "<root>";
+				for (size_t i = 0; i < items; ++i)
+					xml += "<item id=\"" + std::to_string(i) + "\"><name>n</name></item>";
+				return xml + "</root>";
+			};
+			std::string small = flat(100), large = flat(50000);
+			const char* expressions[] = { "//item/@id", "/root/item[@id = '7']/name", "//name", "/root/item[3]" };
+			for (const char* expression : expressions) {
+				XPathStream evaluator{ XPathExpression(expression) };
+				size_t matches = 0;
+				auto onMatch = [&matches](const XPathMatch&) { ++matches; };
+				evaluator.run(small.c_str(), small.length(), onMatch);
+				size_t smallPeak = evaluator.peakMemory();
+				evaluator.run(large.c_str(), large.length(), onMatch);
+				Assert::IsTrue(evaluator.peakMemory() <= smallPeak + 64);
+				Assert::IsTrue(evaluator.peakMemory() < 4096);
+			}
+		}
+	};
+}
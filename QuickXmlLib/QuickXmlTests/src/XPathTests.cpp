@@ -0,0 +1,311 @@
+#include "CppUnitTest.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "XPath.h"
+#include "XPath.cpp"  // required, to avoid unresolved linked symbol error
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace QuickXml;
+
+namespace QuickXmlTests {
+	TEST_CLASS(XPathTests) {
+		const std::string books =
+			"<?xml version=\"1.0\"?>\n"
+			"<!DOCTYPE library [<!ATTLIST book code ID #REQUIRED>]>\n"
+			"<library xml:lang=\"en-GB\">\n"
+			"  <!-- catalogue -->\n"
+			"  <book code=\"b1\" year=\"1990\"><title>Alpha</title><price>10.5</price></book>\n"
+			"  <book code=\"b2\" year=\"2005\"><title>Beta &amp; co</title><price>20</price></book>\n"
+			"  <book code=\"b3\" year=\"2010\"><title>Gamma</title><price>30</price><?note keep?></book>\n"
+			"  <shelf>left<book code=\"b4\"><title>Delta</title></book>right<![CDATA[<raw>]]></shelf>\n"
+			"</library>\n";
+
+		// the selected nodes, as "type name=value" separated by "|"
+		static std::string select(const std::string& xml, const std::string& expression, const XPathNamespaces& namespaces = XPathNamespaces()) {
+			Document doc(xml.c_str(), xml.length());
+			std::string res;
+			for (const XPathEntry& entry : selectEntries(doc, XPathExpression(expression, namespaces))) {
+				if (!res.empty())
+					res += "|";
+				res += entry.type + " " + entry.name + "=" + entry.value;
+			}
+			return res;
+		}
+
+		// the string value of an expression
+		static std::string eval(const std::string& xml, const std::string& expression) {
+			Document doc(xml.c_str(), xml.length());
+			XPathValue value = XPathExpression(expression).evaluate(doc);
+			switch (value.type) {
+				case XPathType::NodeSet: return value.nodes.empty() ? "" : xpathStringValue(doc, value.nodes.front());
+				case XPathType::Boolean: return value.boolean ? "true" : "false";
+				case XPathType::Number: return xpathNumberToString(value.number);
+				default: return value.string;
+			}
+		}
+
+		static size_t count(const std::string& xml, const std::string& expression) {
+			Document doc(xml.c_str(), xml.length());
+			return XPathExpression(expression).evaluate(doc).nodes.size();
+		}
+
+		static size_t errorPosition(const std::string& expression) {
+			try {
+				XPathExpression compiled(expression);
+			}
+			catch (const XPathError& e) {
+				return e.position();
+			}
+			return SIZE_MAX;
+		}
+
+	public:
+		TEST_METHOD(Entries) {
+			// an element gives the text of its direct children only, as MSXML selectNodes()
+			Assert::AreEqual(std::string("element title=Beta & co"), select(books, "/library/book[2]/title"));
+			Assert::AreEqual(std::string("element shelf=leftright"), select(books, "//shelf"));
+			Assert::AreEqual(std::string("element book="), select(books, "//book[@code='b3']"));
+			Assert::AreEqual(std::string("attribute year=1990|attribute year=2005"), select(books, "//book[position() < 3]/@year"));
+			Assert::AreEqual(std::string("text #text=left|text #text=right|cdatasection #cdata-section=<raw>"), select(books, "//shelf/text()"));
+			Assert::AreEqual(std::string("comment #comment= catalogue "), select(books, "//comment()"));
+			Assert::AreEqual(std::string("processinginstruction note=keep"), select(books, "//processing-instruction('note')"));
+			Assert::AreEqual(std::string("document #document="), select(books, "/"));
+			Assert::AreEqual(std::string(""), select(books, "//missing"));
+		}
+
+		TEST_METHOD(Axes) {
+			Assert::AreEqual((size_t)4, count(books, "//book"));
+			Assert::AreEqual((size_t)3, count(books, "/library/book"));
+			Assert::AreEqual((size_t)4, count(books, "/descendant::book"));
+			Assert::AreEqual((size_t)2, count(books, "//book/ancestor::*"));
+			Assert::AreEqual((size_t)2, count(books, "//title[.='Delta']/ancestor-or-self::book | /library"));
+			Assert::AreEqual(std::string("Beta & co"), eval(books, "//book[1]/following-sibling::book/title"));
+			Assert::AreEqual(std::string("Beta & co"), eval(books, "//book[3]/preceding-sibling::book[1]/title"));
+			Assert::AreEqual(std::string("Alpha"), eval(books, "(//book[3]/preceding-sibling::book)[1]/title"));
+			Assert::AreEqual(std::string("b4"), eval(books, "//book[3]/following::book/@code"));
+			Assert::AreEqual((size_t)9, count(books, "//shelf/preceding::*"));
+			Assert::AreEqual(std::string("library"), eval(books, "name(//book[1]/..)"));
+			Assert::AreEqual(std::string("b1"), eval(books, "//book[1]/title/parent::node()/attribute::code"));
+			Assert::AreEqual((size_t)2, count(books, "//book[1]/self::book"));
+			Assert::AreEqual((size_t)0, count(books, "//book[1]/self::title"));
+			// from an attribute, the following nodes start with the children of its element
+			Assert::AreEqual(std::string("Gamma"), eval(books, "//book[3]/@year/following::title"));
+			Assert::AreEqual((size_t)2, count(books, "//book[3]/@year/ancestor::*"));
+		}
+
+		TEST_METHOD(Predicates) {
+			Assert::AreEqual(std::string("b4"), eval(books, "(//book)[last()]/@code"));
+			Assert::AreEqual(std::string("b2"), eval(books, "//book[@year > 2000][1]/@code"));
+			Assert::AreEqual(std::string("b3"), eval(books, "//book[@year > 2000][last()]/@code"));
+			Assert::AreEqual((size_t)2, count(books, "//book[price >= 20]"));
+			Assert::AreEqual((size_t)3, count(books, "//book[not(parent::shelf)]"));
+			Assert::AreEqual((size_t)1, count(books, "//book[title = 'Alpha' or title = 'Delta'][@year]"));
+			// positions count in the step, not in the whole path
+			Assert::AreEqual((size_t)2, count(books, "//book/title[1][starts-with(., 'D') or starts-with(., 'A')]"));
+			Assert::AreEqual((size_t)4, count(books, "//*[1][self::title]"));
+			Assert::AreEqual((size_t)1, count(books, "(//title)[4]"));
+		}
+
+		TEST_METHOD(Functions) {
+			Assert::AreEqual(std::string("4"), eval(books, "count(//book)"));
+			Assert::AreEqual(std::string("60.5"), eval(books, "sum(//price)"));
+			Assert::AreEqual(std::string("b3"), eval(books, "id('b3 missing')/@code"));
+			Assert::AreEqual(std::string("2"), eval(books, "count(id('b1 b4'))"));
+			Assert::AreEqual(std::string("4"), eval(books, "count(//title[lang('en')])"));
+			Assert::AreEqual(std::string("false"), eval(books, "boolean(//title[lang('fr')])"));
+			Assert::AreEqual(std::string("BCD"), eval(books, "substring('ABCDE', 2, 3)"));
+			Assert::AreEqual(std::string("BCDE"), eval(books, "substring('ABCDE', 1.5)"));
+			Assert::AreEqual(std::string(""), eval(books, "substring('ABCDE', 0 div 0, 3)"));
+			Assert::AreEqual(std::string("\xC3\xA9t\xC3\xA9"), eval(books, "substring('\xC3\xA9t\xC3\xA9s', 1, 3)"));
+			Assert::AreEqual(std::string("4"), eval(books, "string-length('\xC3\xA9t\xC3\xA9s')"));
+			Assert::AreEqual(std::string("a b c"), eval(books, "normalize-space('  a \n b   c ')"));
+			Assert::AreEqual(std::string("BAr"), eval(books, "translate('bar', 'abc', 'AB')"));
+			Assert::AreEqual(std::string("1999-12"), eval(books, "concat(substring-before('1999-12-31', '-'), '-', substring-before(substring-after('1999-12-31', '-'), '-'))"));
+			Assert::AreEqual(std::string("true"), eval(books, "contains(//book[2]/title, '&')"));
+			Assert::AreEqual(std::string("-2"), eval(books, "round(-2.5)"));
+			Assert::AreEqual(std::string("3"), eval(books, "round(2.5)"));
+			Assert::AreEqual(std::string("0"), eval(books, "round(-0.2)"));
+			Assert::AreEqual(std::string("-2"), eval(books, "floor(-1.5) + ceiling(-0.5)"));
+			Assert::AreEqual(std::string("1"), eval(books, "7 mod 3"));
+			Assert::AreEqual(std::string("Infinity"), eval(books, "1 div 0"));
+			Assert::AreEqual(std::string("NaN"), eval(books, "number('x')"));
+			Assert::AreEqual(std::string("0.1"), eval(books, "number(' .1 ')"));
+			Assert::AreEqual(std::string("1000000"), eval(books, "1000 * 1000"));
+			Assert::AreEqual(std::string("true"), eval(books, "boolean(//book) and not(false()) and true()"));
+			Assert::AreEqual(std::string("title"), eval(books, "local-name(//book/*)"));
+		}
+
+		TEST_METHOD(Comparisons) {
+			Assert::AreEqual(std::string("true"), eval(books, "//book/@year = 2005"));
+			Assert::AreEqual(std::string("true"), eval(books, "//book/@year != 2005"));
+			Assert::AreEqual(std::string("false"), eval(books, "//book/@year > 2010"));
+			Assert::AreEqual(std::string("true"), eval(books, "2010 >= //book/@year"));
+			Assert::AreEqual(std::string("true"), eval(books, "//book/title = //shelf/book/title"));
+			Assert::AreEqual(std::string("false"), eval(books, "//missing = //missing"));
+			Assert::AreEqual(std::string("true"), eval(books, "//missing = false()"));
+			Assert::AreEqual(std::string("true"), eval(books, "'1.0' = 1"));
+			Assert::AreEqual(std::string("false"), eval(books, "'1.0' = '1'"));
+			Assert::AreEqual(std::string("true"), eval(books, "1 < 2 = true()"));
+		}
+
+		TEST_METHOD(Namespaces) {
+			std::string xml =
+				"<r xmlns=\"urn:d\" xmlns:x=\"urn:x\">"
+				"<x:a x:at=\"1\" at=\"2\"><b xmlns=\"\"/></x:a><c/>"
+				"</r>";
+			XPathNamespaces ns = parseSelectionNamespaces("xmlns:d='urn:d' xmlns:y=\"urn:x\"");
+			Assert::AreEqual((size_t)2, ns.size());
+
+			// an unprefixed name test selects no namespace, whatever the default namespace of the document
+			Assert::AreEqual(std::string(""), select(xml, "/r"));
+			Assert::AreEqual(std::string("element r="), select(xml, "/d:r", ns));
+			Assert::AreEqual(std::string("element x:a="), select(xml, "/d:r/y:a", ns));
+			Assert::AreEqual(std::string("element b="), select(xml, "//y:a/b", ns));
+			Assert::AreEqual(std::string("element c="), select(xml, "//d:c", ns));
+			Assert::AreEqual(std::string("attribute x:at=1"), select(xml, "//y:a/@y:*", ns));
+			Assert::AreEqual(std::string("attribute at=2"), select(xml, "//y:a/@at", ns));
+			// namespace declarations are not attributes
+			Assert::AreEqual((size_t)0, count(xml, "/*/@*"));
+			Assert::AreEqual(std::string("urn:x"), eval(xml, "namespace-uri(/*/*)"));
+
+			// default, x and xml in scope of a; b undeclares the default namespace
+			Assert::AreEqual((size_t)3, count(xml, "/*/*[1]/namespace::*"));
+			Assert::AreEqual((size_t)2, count(xml, "//*[not(namespace::*[name() = ''])]/namespace::*"));
+			Assert::AreEqual(std::string("attribute xmlns:x=urn:x"), select(xml, "/*/*[1]/namespace::x", ns));
+
+			Assert::ExpectException<XPathError>([]() { XPathExpression("//z:a"); });
+			Assert::ExpectException<XPathError>([]() { parseSelectionNamespaces("xmlns:a"); });
+		}
+
+		TEST_METHOD(Errors) {
+			Assert::AreEqual((size_t)2, errorPosition("a[$v]"));
+			Assert::AreEqual((size_t)0, errorPosition("unknown(1)"));
+			Assert::AreEqual((size_t)0, errorPosition("count()"));
+			Assert::AreEqual((size_t)5, errorPosition("//a[1"));
+			Assert::AreEqual((size_t)2, errorPosition("a b"));
+			Assert::AreEqual((size_t)0, errorPosition(""));
+			Assert::AreEqual((size_t)2, errorPosition("a/!"));
+			Assert::AreEqual(SIZE_MAX, errorPosition("a/b | c[d and e]"));
+
+			// selectNodes() only accepts node-sets
+			std::string xml = "<a/>";
+			Document doc(xml.c_str(), xml.length());
+			Assert::ExpectException<XPathError>([&doc]() { selectEntries(doc, XPathExpression("count(/a)")); });
+			Assert::ExpectException<XPathError>([&doc]() { XPathExpression("'a'/b").evaluate(doc); });
+		}
+
+		TEST_METHOD(Operators) {
+			// '*', 'and', 'div'... are names or operators depending on what precedes them
+			std::string xml = "<r><div>6</div><mod>4</mod><and>1</and></r>";
+			Assert::AreEqual(std::string("1.5"), eval(xml, "/r/div div /r/mod"));
+			Assert::AreEqual(std::string("2"), eval(xml, "/r/div mod /r/mod"));
+			Assert::AreEqual(std::string("24"), eval(xml, "/r/div * /r/*[2]"));
+			Assert::AreEqual(std::string("true"), eval(xml, "/r/and and -/r/and = -1"));
+			Assert::AreEqual(std::string("3"), eval(xml, "count(/r/*)"));
+		}
+
+		TEST_METHOD(DescendantRewriteKeepsPositions) {
+			std::string xml = "<r><a><b/><b/></a><a><b/></a></r>";
+			// //b[1] is the first b of each parent, not the first b of the document
+			Assert::AreEqual((size_t)2, count(xml, "//b[1]"));
+			Assert::AreEqual((size_t)1, count(xml, "//b[last() = 1]"));
+			Assert::AreEqual((size_t)1, count(xml, "(//b)[1]"));
+			Assert::AreEqual((size_t)3, count(xml, "//b[not(@x)]"));
+			// the rewrite to descendant::b does not change the order of the result
+			XPathExpression expression("//b[count(../b) > 1]");
+			const XPathExpr& path = expression.tree()[expression.root()];
+			Assert::AreEqual((size_t)1, path.steps.size());
+			Assert::IsTrue(path.steps[0].axis == XPathAxis::Descendant);
+			Assert::AreEqual((size_t)2, count(xml, "//b[count(../b) > 1]"));
+		}
+
+		TEST_METHOD(ContextNode) {
+			Document doc(books.c_str(), books.length());
+			XPathValue shelf = XPathExpression("//shelf").evaluate(doc);
+			Assert::AreEqual((size_t)1, shelf.nodes.size());
+			XPathValue titles = XPathExpression("book/title").evaluate(doc, shelf.nodes.front());
+			Assert::AreEqual((size_t)1, titles.nodes.size());
+			Assert::AreEqual(std::string("Delta"), xpathStringValue(doc, titles.nodes.front()));
+		}
+
+		TEST_METHOD(Cursor) {
+			Document doc(books.c_str(), books.length());
+			XPathCursor cursor(doc, XPathExpression("//book/@code | //title | //comment()"));
+			std::vector<XPathEntry> all = selectEntries(doc, XPathExpression("//book/@code | //title | //comment()"));
+			Assert::AreEqual(all.size(), cursor.size());
+			Assert::AreEqual((size_t)9, cursor.size());
+
+			// type and offset without building the entries
+			Assert::AreEqual(std::string("comment"), std::string(cursor.type(0)));
+			Assert::AreEqual(books.find("<!--"), cursor.offset(0));
+			Assert::AreEqual(std::string("attribute"), std::string(cursor.type(1)));
+			Assert::AreEqual(books.find("b1"), cursor.offset(1));
+			Assert::AreEqual(std::string("element"), std::string(cursor.type(2)));
+			Assert::AreEqual(books.find("<title>"), cursor.offset(2));
+
+			// a page of the entries, clipped at the end
+			std::vector<XPathEntry> page = cursor.entries(3, 2);
+			Assert::AreEqual((size_t)2, page.size());
+			Assert::AreEqual(all[3].name + "=" + all[3].value, page[0].name + "=" + page[0].value);
+			Assert::AreEqual(all[4].value, cursor.entry(4).value);
+			Assert::AreEqual((size_t)1, cursor.entries(8, 5).size());
+			Assert::AreEqual(std::string("Delta"), cursor.entries(8, 5)[0].value);
+			Assert::IsTrue(cursor.entries(9, 1).empty());
+
+			Assert::ExpectException<XPathError>([&doc]() { XPathCursor(doc, XPathExpression("count(//book)")); });
+		}
+
+		TEST_METHOD(ParallelMatchesSequential) {
+			std::string xml = "<r>";
+			for (int g = 0; g < 20; ++g) {
+				xml += "<g n=\"" + std::to_string(g) + "\">";
+				for (int e = 0; e < 30; ++e)
+					xml += "<entry id=\"e" + std::to_string(g * 30 + e) + "\"><title>" + (e % 7 == 0 ? "foo " : "bar ") + std::to_string(e) + "</title><entry/></entry>";
+				xml += "</g>";
+			}
+			xml += "</r>";
+			Document doc(xml.c_str(), xml.length());
+			DocumentIndex index(doc);
+
+			XPathOptions parallel;
+			parallel.threads = 4;
+			parallel.parallelNodes = 16;
+			XPathOptions indexed = parallel;
+			indexed.index = &index;
+
+			const char* expressions[] = {
+				"//entry[contains(title, 'foo')]", "count(//entry[contains(title, 'foo')])", "//entry[title][starts-with(@id, 'e1')]/title",
+				"//g[@n > 10]//entry[not(title)]", "//*[@id = 'e42']", "//entry[@id][contains(title, '1')]", "//g/entry[contains(., 'foo')]",
+				"//entry[contains(title, 'foo')][2]", "//entry[last()]", "sum(//g[count(entry[contains(title, 'foo')]) > 4]/@n)"
+			};
+			for (const char* text : expressions) {
+				XPathExpression expression(text);
+				XPathValue sequential = expression.evaluate(doc);
+				for (const XPathOptions* options : { &parallel, &indexed }) {
+					XPathValue value = expression.evaluate(doc, XPathNode::tree(doc.root()), *options);
+					Assert::IsTrue(value.nodes == sequential.nodes);
+					Assert::AreEqual(sequential.number, value.number);
+				}
+			}
+			Assert::AreEqual((size_t)100, XPathCursor(doc, XPathExpression("//entry[contains(title, 'foo')]"), parallel).size());
+		}
+
+		TEST_METHOD(Cancel) {
+			Document doc(books.c_str(), books.length());
+			std::atomic<bool> cancel{ true };
+			XPathOptions options;
+			options.cancel = &cancel;
+			XPathExpression expression("//book[contains(title, 'a')]");
+			Assert::ExpectException<XPathCancelled>([&]() { expression.evaluate(doc, XPathNode::tree(doc.root()), options); });
+			options.threads = 4;
+			options.parallelNodes = 1;
+			Assert::ExpectException<XPathCancelled>([&]() { expression.evaluate(doc, XPathNode::tree(doc.root()), options); });
+
+			cancel = false;
+			Assert::AreEqual((size_t)4, expression.evaluate(doc, XPathNode::tree(doc.root()), options).nodes.size());
+		}
+	};
+}
@@ -0,0 +1,208 @@
+#include "CppUnitTest.h"
+
+#include <string>
+
+#include "XmlDocument.h"
+#include "XmlDocument.cpp"  // required, to avoid unresolved linked symbol error
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace QuickXml;
+
+namespace QuickXmlTests {
+	TEST_CLASS(XmlDocumentTests) {
+		static std::string str(std::string_view view) {
+			return std::string(view);
+		}
+
+		static size_t childCount(const Document& doc, NodeId node) {
+			size_t count = 0;
+			for (NodeId child = doc.firstChild(node); child != NoNode; child = doc.nextSibling(child))
+				++count;
+			return count;
+		}
+
+	public:
+		TEST_METHOD(Structure) {
+			std::string xml = "<?xml version=\"1.0\"?><!-- head --><root a='1' b=\"x &amp; y\">\n  <c>t&lt;1</c>\n  <![CDATA[<raw>]]><?pi some data?><d/></root>";
+			Document doc(xml.c_str(), xml.length());
+
+			Assert::IsTrue(doc.wellFormed());
+			// the XML declaration is not a node
+			Assert::AreEqual((size_t)2, childCount(doc, doc.root()));
+			Assert::IsTrue(doc.kind(doc.firstChild(doc.root())) == NodeKind::Comment);
+			Assert::AreEqual(std::string(" head "), str(doc.rawValue(doc.firstChild(doc.root()))));
+
+			NodeId root = doc.documentElement();
+			Assert::AreEqual(std::string("root"), str(doc.name(root)));
+			Assert::AreEqual((size_t)4, childCount(doc, root));
+			Assert::AreEqual(xml.substr(xml.find("<root")), str(doc.source(root)));
+
+			NodeId c = doc.firstChild(root);
+			Assert::AreEqual(std::string("<c>t&lt;1</c>"), str(doc.source(c)));
+			Assert::AreEqual(std::string("t<1"), doc.value(c));
+			Assert::IsTrue(doc.parent(c) == root);
+
+			NodeId cdata = doc.nextSibling(c);
+			Assert::IsTrue(doc.kind(cdata) == NodeKind::CData);
+			Assert::AreEqual(std::string("<raw>"), str(doc.rawValue(cdata)));
+
+			NodeId pi = doc.nextSibling(cdata);
+			Assert::IsTrue(doc.kind(pi) == NodeKind::ProcessingInstruction);
+			Assert::AreEqual(std::string("pi"), str(doc.name(pi)));
+			Assert::AreEqual(std::string("some data"), str(doc.rawValue(pi)));
+
+			NodeId d = doc.nextSibling(pi);
+			Assert::AreEqual(std::string("<d/>"), str(doc.source(d)));
+			Assert::IsTrue(doc.nextSibling(d) == NoNode);
+			Assert::IsTrue(doc.firstChild(d) == NoNode);
+
+			Assert::AreEqual(std::string("t<1<raw>"), doc.value(root));
+		}
+
+		TEST_METHOD(Attributes) {
+			std::string xml = "<root a='1' b=\"x &amp; y\" c=\"l1\nl2&#10;\"><e a='2'/></root>";
+			Document doc(xml.c_str(), xml.length());
+			NodeId root = doc.documentElement();
+
+			Assert::AreEqual(3u, doc.attributesEnd(root) - doc.attributesBegin(root));
+			AttrId b = doc.findAttribute(root, "b");
+			Assert::AreEqual(std::string("b"), str(doc.attributeName(b)));
+			Assert::AreEqual(std::string("x &amp; y"), str(doc.rawAttributeValue(b)));
+			Assert::AreEqual(std::string("x & y"), doc.attributeValue(b));
+			// a written line break reads as a space, a character reference does not
+			Assert::AreEqual(std::string("l1 l2\n"), doc.attributeValue(doc.findAttribute(root, "c")));
+			Assert::IsTrue(doc.findAttribute(root, "z") == NoAttr);
+
+			// names are shared between elements and attributes
+			NodeId e = doc.firstChild(root);
+			AttrId a = doc.findAttribute(e, "a");
+			Assert::AreEqual(std::string("2"), doc.attributeValue(a));
+			Assert::IsTrue(doc.attributeNameId(a) == doc.attributeNameId(doc.attributesBegin(root)));
+			Assert::AreEqual((size_t)5, doc.nameCount());
+		}
+
+		TEST_METHOD(Namespaces) {
+			std::string xml = "<r xmlns='urn:d' xmlns:x='urn:x'><x:a x:at='1' at='2'><b xmlns=''/></x:a></r>";
+			Document doc(xml.c_str(), xml.length());
+			NodeId r = doc.documentElement();
+			NodeId a = doc.firstChild(r);
+			NodeId b = doc.firstChild(a);
+
+			Assert::AreEqual(std::string("urn:d"), str(doc.namespaceUri(r)));
+			Assert::AreEqual(std::string("urn:x"), str(doc.namespaceUri(a)));
+			Assert::AreEqual(std::string(""), str(doc.namespaceUri(b)));
+			Assert::AreEqual(std::string("a"), str(Document::localNameOf(doc.name(a))));
+			Assert::AreEqual(std::string("x"), str(Document::prefixOf(doc.name(a))));
+
+			AttrId at = doc.findAttribute(a, "urn:x", "at");
+			Assert::AreEqual(std::string("x:at"), str(doc.attributeName(at)));
+			AttrId plain = doc.findAttribute(a, "", "at");
+			Assert::AreEqual(std::string("2"), doc.attributeValue(plain));
+			Assert::AreEqual(std::string(""), str(doc.attributeNamespaceUri(a, plain)));
+			Assert::AreEqual(std::string("http://www.w3.org/XML/1998/namespace"), str(doc.lookupNamespace(b, "xml")));
+		}
+
+		TEST_METHOD(Whitespace) {
+			std::string xml = "<r>\n\t<a> </a>\n\t<b xml:space=\"preserve\"> <c> </c></b>\n</r>";
+			Document doc(xml.c_str(), xml.length());
+			NodeId r = doc.documentElement();
+			NodeId a = doc.firstChild(r);
+			NodeId b = doc.nextSibling(a);
+
+			Assert::AreEqual((size_t)2, childCount(doc, r));
+			Assert::AreEqual((size_t)0, childCount(doc, a));
+			Assert::AreEqual((size_t)2, childCount(doc, b));
+			Assert::AreEqual((size_t)1, childCount(doc, doc.nextSibling(doc.firstChild(b))));
+
+			DocumentParms parms;
+			parms.keepWhitespace = true;
+			Document kept(xml.c_str(), xml.length(), parms);
+			Assert::AreEqual((size_t)5, childCount(kept, kept.documentElement()));
+		}
+
+		TEST_METHOD(Malformed) {
+			std::string xml = "<a><b><c></a>";
+			Document doc(xml.c_str(), xml.length());
+			Assert::IsFalse(doc.wellFormed());
+			Assert::AreEqual(xml.find("<c"), doc.errorOffset());
+			// the closing tag ends the elements left open in it
+			NodeId a = doc.documentElement();
+			Assert::AreEqual(xml, str(doc.source(a)));
+			Assert::AreEqual(std::string("<b><c>"), str(doc.source(doc.firstChild(a))));
+
+			std::string roots = "<a/><b/>";
+			Document twoRoots(roots.c_str(), roots.length());
+			Assert::IsFalse(twoRoots.wellFormed());
+			Assert::AreEqual((size_t)4, twoRoots.errorOffset());
+			Assert::AreEqual((size_t)2, childCount(twoRoots, twoRoots.root()));
+
+			std::string unclosed = "<a><b>text";
+			Document open(unclosed.c_str(), unclosed.length());
+			Assert::IsFalse(open.wellFormed());
+			Assert::AreEqual(std::string("text"), open.value(open.root()));
+
+			std::string empty = "<!-- nothing -->";
+			Document none(empty.c_str(), empty.length());
+			Assert::IsFalse(none.wellFormed());
+			Assert::IsTrue(none.documentElement() == NoNode);
+		}
+
+		TEST_METHOD(NotNullTerminated) {
+			std::string xml = "<a><b/></a><c/>";
+			Document doc(xml.c_str(), xml.find("<c"));
+			Assert::IsTrue(doc.wellFormed());
+			Assert::AreEqual((size_t)3, doc.nodeCount());
+		}
+
+		TEST_METHOD(ByteOrderMark) {
+			std::string xml = "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?><a><b/></a>";
+			Document doc(xml.c_str(), xml.length());
+			Assert::IsTrue(doc.wellFormed());
+			Assert::AreEqual(xml.find("<a"), doc.offset(doc.documentElement()));
+
+			// only the start of the source is a byte order mark
+			std::string trailing = "<a/>\xEF\xBB\xBF";
+			Document after(trailing.c_str(), trailing.length());
+			Assert::IsFalse(after.wellFormed());
+			Assert::AreEqual((size_t)4, after.errorOffset());
+		}
+
+		TEST_METHOD(Doctype) {
+			std::string xml = "<?xml version=\"1.0\"?><!DOCTYPE a [<!ELEMENT a (#PCDATA)>]><a/>";
+			Document doc(xml.c_str(), xml.length());
+			Assert::AreEqual(std::string("<!DOCTYPE a [<!ELEMENT a (#PCDATA)>]>"), str(doc.doctype()));
+
+			std::string external = "<!DOCTYPE a SYSTEM \"a.dtd\"><a/>";
+			Document ext(external.c_str(), external.length());
+			Assert::AreEqual(std::string("<!DOCTYPE a SYSTEM \"a.dtd\">"), str(ext.doctype()));
+
+			std::string none = "<a/>";
+			Assert::IsTrue(Document(none.c_str(), none.length()).doctype().empty());
+		}
+
+		TEST_METHOD(Decode) {
+			Assert::AreEqual(std::string("plain"), Document::decode("plain"));
+			Assert::AreEqual(std::string("<&>\"'"), Document::decode("&lt;&amp;&gt;&quot;&apos;"));
+			Assert::AreEqual(std::string("AB\xE2\x82\xAC\xF0\x9F\x98\x80"), Document::decode("&#65;&#x42;&#x20AC;&#128512;"));
+			Assert::AreEqual(std::string("&unknown; &#xZZ; &amp"), Document::decode("&unknown; &#xZZ; &amp"));
+		}
+
+		TEST_METHOD(MemoryUnderTwiceTheSource) {
+			std::string xml = "<root>\n";
+			for (int i = 0; xml.size() < 1024 * 1024; ++i) {
+				xml += "\t<item id=\"" + std::to_string(i) + "\" kind=\"sample\">\n\t\t<name>item " + std::to_string(i) +
+				       "</name>\n\t\t<value unit=\"mm\">" + std::to_string(i * 7) + "</value>\n\t</item>\n";
+			}
+			xml += "</root>\n";
+
+			Document doc(xml.c_str(), xml.length());
+			Assert::IsTrue(doc.wellFormed());
+			Assert::IsTrue(doc.memoryUsage() < 2 * xml.length());
+
+			// a small document does not reserve for a large one
+			std::string small = "<a x=\"1\"><b>text</b></a>";
+			Document smallDoc(small.c_str(), small.length());
+			Assert::IsTrue(smallDoc.memoryUsage() < 16 * 1024);
+		}
+	};
+}
@@ -0,0 +1,112 @@
+#include "CppUnitTest.h"
+
+#include <string>
+#include <vector>
+
+#include "XmlIndex.h"
+#include "XmlIndex.cpp"  // required, to avoid unresolved linked symbol error
+#include "XPath.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace QuickXml;
+
+namespace QuickXmlTests {
+	TEST_CLASS(XmlIndexTests) {
+		const std::string xml =
+			"<r xmlns:p=\"urn:p\" xmlns:q=\"urn:p\">"
+			"<order id=\"A1\" sku=\"s\"><item name=\"x\"/><item id=\"A1\"/></order>"
+			"<order id=\"A2\"><p:item id=\"a &amp; b\"/><q:item id=\"A\t3\"/></order>"
+			"<order><item sku=\"t\" name=\"y\"/><item xmlns=\"urn:d\" id=\"A2\"/></order>"
+			"</r>";
+
+		static std::vector<NodeId> nodes(DocumentIndex::NodeRange range) {
+			return std::vector<NodeId>(range.begin(), range.end());
+		}
+
+		static std::string offsets(const Document& doc, const XPathValue& value) {
+			std::string res;
+			for (const XPathNode& node : value.nodes)
+				res += std::to_string(xpathNodeOffset(doc, node)) + ";";
+			return res;
+		}
+
+	public:
+		TEST_METHOD(BuiltOnFirstUse) {
+			Document doc(xml.c_str(), xml.length());
+			DocumentIndex index(doc);
+			Assert::IsFalse(index.built(DocumentIndex::Part::Names));
+			Assert::AreEqual((size_t)0, index.memoryUsage());
+
+			std::vector<NodeId> orders = nodes(index.elementsNamed(doc.findName("order")));
+			Assert::AreEqual((size_t)3, orders.size());
+			for (NodeId order : orders)
+				Assert::AreEqual(std::string("order"), std::string(doc.name(order)));
+			Assert::IsTrue(index.built(DocumentIndex::Part::Names));
+			Assert::IsFalse(index.built(DocumentIndex::Part::Values));
+			Assert::IsTrue(index.stats(DocumentIndex::Part::Names).bytes > 0);
+			Assert::AreEqual(index.stats(DocumentIndex::Part::Names).bytes, index.memoryUsage());
+
+			// the part in the subtree of the second order
+			NodeId second = orders[1];
+			Assert::AreEqual((size_t)1, index.elementsNamed(doc.findName("p:item")).within(second, doc.nextSibling(second)).size());
+			Assert::AreEqual((size_t)0, index.elementsNamed(doc.findName("item")).within(second, doc.nextSibling(second)).size());
+		}
+
+		TEST_METHOD(AttributesAndValues) {
+			Document doc(xml.c_str(), xml.length());
+			DocumentIndex index(doc);
+
+			Assert::AreEqual((size_t)2, index.elementsWithAttribute(doc.findName("sku")).size());
+			// namespace declarations are not attributes
+			Assert::AreEqual((size_t)0, index.elementsWithAttribute(doc.findName("xmlns")).size());
+
+			NameId id = doc.findName("id");
+			Assert::AreEqual((size_t)2, index.elementsWithValue(id, "A1").size());
+			Assert::AreEqual((size_t)1, index.elementsWithValue(id, "a & b").size());
+			Assert::AreEqual((size_t)1, index.elementsWithValue(id, "A 3").size());
+			Assert::AreEqual((size_t)0, index.elementsWithValue(id, "A3").size());
+			Assert::AreEqual((size_t)1, index.elementsWithValue(doc.findName("name"), "y").size());
+			// sku is not an identity attribute
+			Assert::AreEqual((size_t)0, index.elementsWithValue(doc.findName("sku"), "s").size());
+
+			DocumentIndex skus(doc, { "sku" });
+			Assert::AreEqual((size_t)1, skus.elementsWithValue(doc.findName("sku"), "s").size());
+			Assert::AreEqual((size_t)0, skus.elementsWithValue(id, "A1").size());
+		}
+
+		TEST_METHOD(XPathWithIndex) {
+			Document doc(xml.c_str(), xml.length());
+			DocumentIndex index(doc);
+			XPathNamespaces namespaces = { { "p", "urn:p" }, { "d", "urn:d" } };
+			const char* expressions[] = {
+				"//order", "//item", "//p:item", "//d:item", "//*[@id='A1']", "//item[@id = 'A1']", "//*['A2' = @id]",
+				"//*[@id='a &amp; b']", "//*[@id='a & b']", "//*[@id='A 3']", "//*[@sku]", "//item[@sku]", "//*[@sku='t']",
+				"//*[@name='x']", "//*[@nothing]", "//*[@nothing='x']", "//order[@id][2]", "//item[@name][1]",
+				"/r/order//item", "//order[2]//*[@id]", "descendant::item[@id='A1'][1]", "//*[@xmlns]"
+			};
+			for (const char* text : expressions) {
+				XPathExpression expression(text, namespaces);
+				Assert::AreEqual(offsets(doc, expression.evaluate(doc)), offsets(doc, expression.evaluate(index)));
+			}
+			Assert::IsTrue(index.built(DocumentIndex::Part::Names));
+			Assert::IsTrue(index.built(DocumentIndex::Part::Attributes));
+			Assert::IsTrue(index.built(DocumentIndex::Part::Values));
+
+			XPathCursor cursor(index, XPathExpression("//*[@id='A1']"));
+			Assert::AreEqual((size_t)2, cursor.size());
+			Assert::AreEqual(std::string("item"), cursor.entry(1).name);
+		}
+
+		TEST_METHOD(Lookups) {
+			Assert::AreEqual((size_t)0, xpathIndexLookups(XPathExpression("/r/order/item")).size());
+			Assert::AreEqual((size_t)0, xpathIndexLookups(XPathExpression("//*")).size());
+			Assert::AreEqual((size_t)0, xpathIndexLookups(XPathExpression("//*[@p:id='x']", { { "p", "urn:p" } })).size());
+
+			std::vector<std::string> lookups = xpathIndexLookups(XPathExpression("//order[@sku]/item[@id = 'A1'] | //p:item", { { "p", "urn:p" } }));
+			Assert::AreEqual((size_t)2, lookups.size());
+			Assert::AreEqual(std::string("descendant::order: attribute @sku"), lookups[0]);
+			Assert::AreEqual(std::string("descendant::{urn:p}item: element name"), lookups[1]);
+			Assert::AreEqual(std::string("descendant::*: value of @id, attribute @id when not an identity attribute"), xpathIndexLookups(XPathExpression("//*[@id='x']"))[0]);
+		}
+	};
+}
@@ -0,0 +1,171 @@
+#include "StdAfx.h"
+
+#include "QuickXmlWrapper.h"
+#include "DocumentCache.h"
+#include "Debug.h"
+#include "Report.h"
+#include "XPath.h"
+#include "XPathPlan.h"
+
+#include <algorithm>
+#include <thread>
+
+// the expressions evaluated again and again from the dialog are compiled once
+static QuickXml::XPathPlanCache xpathPlans;
+
+QuickXmlWrapper::QuickXmlWrapper(const char* xml, size_t size, UniMode encoding)
+    : document(std::make_shared<const QuickXml::Document>(xml, size)), encoding(encoding) {}
+
+QuickXmlWrapper::QuickXmlWrapper(std::shared_ptr<const ParsedDocument> parsed, UniMode encoding)
+    : document(parsed, &parsed->document), index(parsed, &parsed->index), encoding(encoding) {}
+
+QuickXmlWrapper::~QuickXmlWrapper() {
+    this->resetErrors();
+}
+
+int QuickXmlWrapper::getCapabilities() {
+    return XmlCapabilityType::GET_ERROR_DETAILS | XmlCapabilityType::CHECK_SYNTAX | XmlCapabilityType::EVALUATE_XPATH;
+}
+
+static std::wstring toWide(const std::string& text, UniMode encoding) {
+    if (encoding == UniMode::uni8Bit) {
+        return Report::s2ws(text);
+    }
+    return Report::utf8ToUcs2(text);
+}
+
+std::wstring QuickXmlWrapper::toWide(const std::string& text) const {
+    return ::toWide(text, this->encoding);
+}
+
+// the rows are built, and converted, when they are read
+class QuickXmlResultCursor : public XPathResultCursor {
+    std::shared_ptr<const QuickXml::Document> document;     // kept alive for the cursor, which refers to it
+    QuickXml::XPathCursor cursor;
+    UniMode encoding;
+
+public:
+    // the index of the options lives with the document in the parsed buffer, which the document pointer keeps alive
+    QuickXmlResultCursor(std::shared_ptr<const QuickXml::Document> document, const QuickXml::XPathExpression& expression, const QuickXml::XPathOptions& options, UniMode encoding)
+        : document(std::move(document)), cursor(*this->document, expression, options), encoding(encoding) {}
+
+    size_t size() {
+        return this->cursor.size();
+    }
+
+    size_t offset(size_t index) {
+        return this->cursor.offset(index);
+    }
+
+    XPathResultEntryType entry(size_t index) {
+        QuickXml::XPathEntry entry = this->cursor.entry(index);
+        return { ::toWide(entry.type, this->encoding), ::toWide(entry.name, this->encoding), ::toWide(entry.value, this->encoding) };
+    }
+};
+
+// what the indexes built so far cost, for the debug output
+static void logIndexStats(const QuickXml::DocumentIndex& index) {
+    const std::pair<QuickXml::DocumentIndex::Part, const char*> parts[] = {
+        { QuickXml::DocumentIndex::Part::Names, "names" },
+        { QuickXml::DocumentIndex::Part::Attributes, "attributes" },
+        { QuickXml::DocumentIndex::Part::Values, "values" }
+    };
+    std::string line = "index:";
+    for (const auto& part : parts) {
+        QuickXml::DocumentIndex::Stats stats = index.stats(part.first);
+        if (!stats.built) continue;
+        char text[96];
+        snprintf(text, sizeof(text), " %s %.1f ms %zu KB", part.second, stats.milliseconds, stats.bytes / 1024);
+        line += text;
+    }
+    dbgln(line.c_str(), DBG_LEVEL::DBG_INFO);
+}
+
+void QuickXmlWrapper::addError(size_t offset, const std::string& reason) {
+    // positions are given as MSXML gives them: 1-based
+    std::string_view source = this->document->source(this->document->root());
+    size_t line = 1;
+    size_t lineStart = 0;
+    for (size_t i = 0; i < offset && i < source.length(); ++i) {
+        if (source[i] == '\n') {
+            ++line;
+            lineStart = i + 1;
+        }
+    }
+
+    this->errors.push_back({
+        TRUE,
+        line,
+        offset - lineStart + 1,
+        offset + 1,
+        this->toWide(reason)
+    });
+}
+
+bool QuickXmlWrapper::checkSyntax() {
+    this->resetErrors();
+
+    if (!this->document->wellFormed()) {
+        this->addError(this->document->errorOffset(), this->document->errorMessage());
+        return false;
+    }
+    return true;
+}
+
+bool QuickXmlWrapper::checkValidity(std::wstring schemaFilename, std::wstring validationNamespace) {
+    this->resetErrors();
+    this->errors.push_back({ FALSE, 0, 0, 0, L"Error: validation is not supported by this wrapper." });
+    return false;
+}
+
+std::unique_ptr<XPathResultCursor> QuickXmlWrapper::xpathCursor(std::wstring xpath, std::wstring ns) {
+    // as MSXML, nothing is evaluated on a document which is not well-formed
+    if (!this->checkSyntax()) {
+        return std::make_unique<XPathResultVectorCursor>(std::vector<XPathResultEntryType>());
+    }
+
+    try {
+        QuickXml::XPathNamespaces namespaces = QuickXml::parseSelectionNamespaces(Report::castChar(ns, this->encoding));
+        std::shared_ptr<const QuickXml::XPathPlan> plan = xpathPlans.get(Report::castChar(xpath, this->encoding), namespaces);
+        dbgln(plan->describe().c_str(), DBG_LEVEL::DBG_INFO);
+
+        // the descendant steps over large documents are split across the cores
+        QuickXml::XPathOptions options;
+        options.index = this->index.get();
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+        auto cursor = std::make_unique<QuickXmlResultCursor>(this->document, plan->expression(), options, this->encoding);
+        if (this->index) {
+            logIndexStats(*this->index);
+        }
+        return cursor;
+    }
+    catch (const QuickXml::XPathError& e) {
+        this->errors.push_back({ FALSE, 0, 0, 0, this->toWide(e.what()) });
+        this->errors.push_back({
+            FALSE,
+            0,
+            0,
+            0,
+            L"Error: error on XPath expression, or missing namespace definition."
+        });
+    }
+
+    return std::make_unique<XPathResultVectorCursor>(std::vector<XPathResultEntryType>());
+}
+
+std::vector<XPathResultEntryType> QuickXmlWrapper::xpathEvaluate(std::wstring xpath, std::wstring ns) {
+    std::unique_ptr<XPathResultCursor> cursor = this->xpathCursor(xpath, ns);
+
+    std::vector<XPathResultEntryType> res;
+    res.reserve(cursor->size());
+    for (size_t i = 0; i < cursor->size(); ++i) {
+        res.push_back(cursor->entry(i));
+    }
+    return res;
+}
+
+bool QuickXmlWrapper::xslTransform(std::wstring xslfile, XSLTransformResultType* out, std::wstring options, UniMode srcEncoding) {
+    this->resetErrors();
+    this->errors.push_back({ FALSE, 0, 0, 0, L"Error: XSL transformations are not supported by this wrapper." });
+    return false;
+}
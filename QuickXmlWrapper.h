@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include "XmlWrapperInterface.h"
+#include "XmlDocument.h"
+#include "XmlIndex.h"
+
+struct ParsedDocument;
+
+/*
+* Wrapper over the QuickXml document model and XPath engine: syntax check and XPath evaluation,
+* without the copy of the buffer into MSXML. Validation and XSL transformations are left to
+* MSXMLWrapper.
+* The document model is either built from the given text, or shared with the document cache,
+* whose indexes then answer the XPath queries which can use them.
+*/
+class QuickXmlWrapper : public XmlWrapperInterface {
+	std::shared_ptr<const QuickXml::Document> document;
+	std::shared_ptr<const QuickXml::DocumentIndex> index;	// with a document of the cache only
+	UniMode encoding;
+
+	void addError(size_t offset, const std::string& reason);
+	std::wstring toWide(const std::string& text) const;
+
+public:
+	QuickXmlWrapper(const char* xml, size_t size, UniMode encoding = UniMode::uniCookie);
+	QuickXmlWrapper(std::shared_ptr<const ParsedDocument> parsed, UniMode encoding = UniMode::uniCookie);
+	~QuickXmlWrapper();
+
+	int getCapabilities();
+	bool checkSyntax();
+	bool checkValidity(std::wstring schemaFilename = L"", std::wstring validationNamespace = L"");
+	std::vector<XPathResultEntryType> xpathEvaluate(std::wstring xpath, std::wstring ns = L"");
+	std::unique_ptr<XPathResultCursor> xpathCursor(std::wstring xpath, std::wstring ns = L"");
+	bool xslTransform(std::wstring xslfile, XSLTransformResultType* out, std::wstring options = L"", UniMode srcEncoding = UniMode::uniEnd);
+};
@@ -25,6 +25,17 @@ struct ScintillaDoc {
 		}
 	};
 
+	// text read in place from the editor buffer, valid until the document is modified; never freed
+	struct sciTextView {
+		const char* text;
+		intptr_t length;
+		intptr_t selstart;
+
+		operator bool() {
+			return text != NULL;
+		}
+	};
+
 	ScintillaDoc(HWND scHandle) {
 		hCurrentEditView = scHandle;
 		inSelection = false;
@@ -169,6 +180,36 @@ struct ScintillaDoc {
 		return ret;
 	}
 
+	Sci_PositionCR CurrentPosition() {
+		return (Sci_PositionCR) ::SendMessage(hCurrentEditView, SCI_GETCURRENTPOS, 0, 0);
+	}
+
+	// the whole text, without copy; Scintilla moves its gap to the end and null terminates the text
+	sciTextView GetCharacterPointer() {
+		auto length = GetTextLength();
+		const char* text = reinterpret_cast<const char*>(::SendMessage(hCurrentEditView, SCI_GETCHARACTERPOINTER, 0, 0));
+		return { text, (intptr_t)length, -1 };
+	}
+
+	// a range of the text, without copy; the gap is only moved when it is inside the range,
+	// and the range is not null terminated
+	sciTextView GetRangePointer(Sci_PositionCR start, Sci_PositionCR length) {
+		const char* text = reinterpret_cast<const char*>(::SendMessage(hCurrentEditView, SCI_GETRANGEPOINTER, start, length));
+		return { text, (intptr_t)length, (intptr_t)start };
+	}
+
+	// same as GetWorkText(), for the commands which only read the text
+	sciTextView GetWorkTextView() {
+		auto selstart = this->SelectionStart();
+		auto selend = this->SelectionEnd();
+
+		inSelection = (selend > selstart);
+		if (inSelection) {
+			return this->GetRangePointer(selstart, selend - selstart);
+		}
+		return this->GetCharacterPointer();
+	}
+
 	void SetWorkText(const char* text) {
 		if (inSelection) {
 			this->ReplaceSelection(text);
@@ -178,6 +219,20 @@ struct ScintillaDoc {
 		}
 	}
 
+	// replaces length chars at start by textLength chars of text; the selection and the caret follow the change
+	void ReplaceTarget(Sci_PositionCR start, Sci_PositionCR length, const char* text, Sci_PositionCR textLength) {
+		::SendMessage(hCurrentEditView, SCI_SETTARGETRANGE, start, start + length);
+		::SendMessage(hCurrentEditView, SCI_REPLACETARGET, textLength, reinterpret_cast<LPARAM>(text));
+	}
+
+	void BeginUndoAction() {
+		::SendMessage(hCurrentEditView, SCI_BEGINUNDOACTION, 0, 0);
+	}
+
+	void EndUndoAction() {
+		::SendMessage(hCurrentEditView, SCI_ENDUNDOACTION, 0, 0);
+	}
+
 	void SetXOffset(int offset = 0) {
 		::SendMessage(hCurrentEditView, SCI_SETXOFFSET, offset, 0);
 	}
@@ -0,0 +1,323 @@
+#include <ctype.h>
+#include <string.h>
+
+#include "Checker.h"
+
+namespace SimpleXml {
+
+    namespace {
+        // keeps the size and the last few bytes of a token without copying it
+        class TailSink : public OutputSink {
+        public:
+            using OutputSink::write;
+
+            static const size_t TailSize = 3;
+            char tail[TailSize] = { 0,0,0 };
+            size_t size = 0;
+
+            void write(const char* data, size_t len) override {
+                size += len;
+                if (len >= TailSize) {
+                    memcpy(tail, data + len - TailSize, TailSize);
+                    return;
+                }
+                memmove(tail, tail + len, TailSize - len);
+                memcpy(tail + TailSize - len, data, len);
+            }
+
+            bool endsWith(const char* end) const {
+                size_t len = strlen(end);
+                return memcmp(tail + TailSize - len, end, len) == 0;
+            }
+        };
+    }
+
+    Checker::Checker(ChunkedStream& s, ErrorList& e) : inputStream(&s), lexer(s), errors(&e) {
+        lexer.parms.trackPosition = true;
+        lexer.parms.deferPosition = true;
+    }
+
+    void Checker::error(size_t line, size_t column, const std::string& message) {
+        if (full())
+            return;
+        errors->add({ Error::Type::Error, parms.resourceLocation, line, column, message });
+        reported++;
+    }
+
+    void Checker::pushElement(size_t line, size_t column) {
+        openElements.push_back({ openNames.size(), name.size(), line, column });
+        openNames.append(name);
+        rootSeen = true;
+    }
+
+    void Checker::popElement() {
+        openNames.resize(openElements.back().nameOffset);
+        openElements.pop_back();
+    }
+
+    void Checker::skipWhitespace() {
+        while (!lexer.Done() && lexer.peekToken() == Token::Whitespace)
+            lexer.eatToken();
+    }
+
+    // skips to the next '<' or '>'; returns true when a '>' ended the broken tag
+    bool Checker::resync() {
+        if (lexer.readUntilTagEndOrStart())
+            lexer.eatToken();
+        bool tagEnd = !lexer.Done() && lexer.peekChar() == '>';
+        if (tagEnd)
+            lexer.readChar();
+        lexer.cancelInTag();
+        return tagEnd;
+    }
+
+    void Checker::checkTag() {
+        size_t line = lexer.currentLine();
+        size_t column = lexer.currentColumn();
+        lexer.eatToken(); // <
+
+        Token token = lexer.Done() ? Token::InputEnd : lexer.peekToken();
+        if (token != Token::Name) {
+            error(line, column, Lexer::isIdentifier(token) ? "invalid element name" : "missing element name after '<'");
+            resync();
+            return;
+        }
+        lexer.readTokenData(name);
+
+        if (openElements.empty() && rootSeen)
+            error(line, column, "more than one root element, found <" + name + ">");
+
+        attributeNames.clear();
+        while (!lexer.Done()) {
+            size_t tokenLine = lexer.currentLine();
+            size_t tokenColumn = lexer.currentColumn();
+            token = lexer.peekToken();
+            switch (token) {
+            case Token::Whitespace:
+            case Token::Linebreak:
+                lexer.eatToken();
+                continue;
+            case Token::TagEnd:
+                lexer.eatToken();
+                pushElement(line, column);
+                return;
+            case Token::SelfClosingTagEnd:
+                lexer.eatToken();
+                rootSeen = true;
+                return;
+            case Token::Name:
+            case Token::Nmtoken: {
+                std::string attribute;
+                lexer.readTokenData(attribute);
+                if (token == Token::Nmtoken)
+                    error(tokenLine, tokenColumn, "invalid attribute name '" + attribute + "'");
+                for (auto& a : attributeNames) {
+                    if (a == attribute) {
+                        error(tokenLine, tokenColumn, "duplicate attribute '" + attribute + "' in <" + name + ">");
+                        break;
+                    }
+                }
+
+                skipWhitespace();
+                if (!lexer.Done() && lexer.peekToken() == Token::Eq) {
+                    lexer.eatToken();
+                    skipWhitespace();
+                    Token value = lexer.Done() ? Token::InputEnd : lexer.peekToken();
+                    if (value == Token::SystemLiteral) {
+                        lexer.eatToken();
+                    }
+                    else if (Lexer::isIdentifier(value)) {
+                        error(lexer.currentLine(), lexer.currentColumn(), "value of attribute '" + attribute + "' is not quoted");
+                        lexer.eatToken();
+                    }
+                    else if (lexer.Done() || (lexer.peekChar() != '"' && lexer.peekChar() != '\'')) {
+                        // an unterminated value is reported by the loop
+                        error(lexer.currentLine(), lexer.currentColumn(), "missing value of attribute '" + attribute + "'");
+                    }
+                }
+                else {
+                    error(lexer.currentLine(), lexer.currentColumn(), "attribute '" + attribute + "' has no value");
+                }
+                attributeNames.push_back(std::move(attribute));
+                continue;
+            }
+            case Token::TagStart:
+            case Token::ClosingTag:
+            case Token::ProcessingInstructionStart:
+            case Token::DeclStart:
+            case Token::Comment:
+            case Token::CDSect:
+                // assume the '>' is missing and the element was opened
+                error(tokenLine, tokenColumn, "missing '>' after <" + name);
+                lexer.cancelInTag();
+                pushElement(line, column);
+                return;
+            default: {
+                char c = lexer.peekChar();
+                error(tokenLine, tokenColumn, c == '"' || c == '\'' ? std::string("unterminated attribute value in <") + name + ">" : std::string("unexpected '") + c + "' in <" + name + ">");
+                if (resync())
+                    pushElement(line, column);
+                return;
+            }
+            }
+        }
+        error(line, column, "tag <" + name + " is not closed");
+    }
+
+    void Checker::checkEndTag() {
+        size_t line = lexer.currentLine();
+        size_t column = lexer.currentColumn();
+        lexer.eatToken(); // </
+
+        Token token = lexer.Done() ? Token::InputEnd : lexer.peekToken();
+        if (!Lexer::isIdentifier(token)) {
+            error(line, column, "missing element name after '</'");
+            resync();
+            return;
+        }
+        lexer.readTokenData(name);
+
+        skipWhitespace();
+        if (lexer.Done()) {
+            error(line, column, "end tag </" + name + " is not closed");
+        }
+        else {
+            token = lexer.peekToken();
+            if (token == Token::TagEnd) {
+                lexer.eatToken();
+            }
+            else if (lexer.isTagStart(token) || token == Token::Comment || token == Token::CDSect) {
+                error(lexer.currentLine(), lexer.currentColumn(), "missing '>' after </" + name);
+                lexer.cancelInTag();
+            }
+            else {
+                error(lexer.currentLine(), lexer.currentColumn(), "unexpected content in end tag </" + name + ">");
+                resync();
+            }
+        }
+
+        if (openElements.empty()) {
+            error(line, column, "end tag </" + name + "> without start tag");
+            return;
+        }
+        if (openName(openElements.back()) == name) {
+            popElement();
+            return;
+        }
+
+        // an element further up matches: everything in between was not closed
+        for (size_t i = openElements.size() - 1; i-- > 0;) {
+            if (openName(openElements[i]) == name) {
+                while (openElements.size() > i + 1) {
+                    auto& e = openElements.back();
+                    error(e.line, e.column, "element <" + std::string(openName(e)) + "> is not closed before </" + name + ">");
+                    popElement();
+                }
+                popElement();
+                return;
+            }
+        }
+        error(line, column, "end tag </" + name + "> does not match <" + std::string(openName(openElements.back())) + ">");
+    }
+
+    void Checker::checkProcessingInstruction() {
+        size_t line = lexer.currentLine();
+        size_t column = lexer.currentColumn();
+        size_t offset = inputStream->offset();
+        lexer.eatToken(); // <?
+
+        Token token = lexer.Done() ? Token::InputEnd : lexer.peekToken();
+        if (Lexer::isIdentifier(token)) {
+            lexer.readTokenData(name);
+            if (offset > documentStart && name.size() == 3 && tolower(name[0]) == 'x' && tolower(name[1]) == 'm' && tolower(name[2]) == 'l')
+                error(line, column, "XML declaration is only allowed at the start of the document");
+        }
+        else {
+            error(line, column, "missing processing instruction target");
+        }
+
+        bool closed = lexer.readUntil("?>", true);
+        lexer.eatToken();
+        lexer.cancelInTag();
+        if (!closed)
+            error(line, column, "processing instruction is not closed");
+    }
+
+    void Checker::checkDeclaration() {
+        size_t line = lexer.currentLine();
+        size_t column = lexer.currentColumn();
+        lexer.eatToken(); // <!
+
+        if (!openElements.empty())
+            error(line, column, "declaration inside of an element");
+        bool closed = lexer.readDeclaration();
+        lexer.eatToken();
+        lexer.cancelInTag();
+        if (!closed)
+            error(line, column, "declaration is not closed");
+    }
+
+    // comments and CDATA sections run to the end of the input when their end is missing
+    void Checker::checkTerminated(const char* start, const char* end, const char* what) {
+        size_t line = lexer.currentLine();
+        size_t column = lexer.currentColumn();
+        TailSink tail;
+        lexer.writeTokenData(tail);
+        if (tail.size < strlen(start) + strlen(end) || !tail.endsWith(end))
+            error(line, column, std::string(what) + " is not closed");
+    }
+
+    void Checker::checkText() {
+        if (openElements.empty())
+            error(lexer.currentLine(), lexer.currentColumn(), rootSeen ? "text after the root element" : "text before the root element");
+        lexer.eatToken();
+    }
+
+    bool Checker::Check() {
+        if (lexer.skipByteOrderMark())
+            documentStart = inputStream->offset();
+
+        while (!lexer.Done() && !full()) {
+            Token token = lexer.peekToken();
+            switch (token) {
+            case Token::TagStart:
+                checkTag();
+                break;
+            case Token::ClosingTag:
+                checkEndTag();
+                break;
+            case Token::ProcessingInstructionStart:
+                checkProcessingInstruction();
+                break;
+            case Token::DeclStart:
+                checkDeclaration();
+                break;
+            case Token::Comment:
+                checkTerminated("<!--", "-->", "comment");
+                break;
+            case Token::CDSect:
+                if (openElements.empty())
+                    error(lexer.currentLine(), lexer.currentColumn(), "CDATA section outside of the root element");
+                checkTerminated("<![CDATA[", "]]>", "CDATA section");
+                break;
+            case Token::Text:
+                checkText();
+                break;
+            default:
+                lexer.eatToken();
+                break;
+            }
+        }
+
+        if (!full()) {
+            if (!rootSeen)
+                error(lexer.currentLine(), lexer.currentColumn(), "no root element");
+            while (!openElements.empty()) {
+                auto& e = openElements.back();
+                error(e.line, e.column, "element <" + std::string(openName(e)) + "> is not closed");
+                popElement();
+            }
+        }
+        return reported == 0;
+    }
+}
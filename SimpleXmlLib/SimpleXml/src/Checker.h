@@ -0,0 +1,74 @@
+#ifndef CHECKER_HEADER_FILE_H
+#define CHECKER_HEADER_FILE_H
+
+#include <string>
+#include <vector>
+
+#include "ErrorList.h"
+#include "Lexer.h"
+
+namespace SimpleXml {
+
+    /*
+    * Streaming well-formedness check on top of the Lexer. Unlike the PrettyPrinter it does not
+    * stop at the first problem: after an error it skips to the next '<' or '>' and goes on, so one
+    * run reports as many problems as possible, each with the line and column where it starts.
+    * Memory use only depends on the nesting depth, not on the size of the input.
+    *
+    *     ErrorList errors;
+    *     Checker checker(stream, errors);
+    *     if (!checker.Check()) ...
+    */
+    class Checker {
+        struct OpenElement {
+            size_t nameOffset;  // into openNames
+            size_t nameLength;
+            size_t line;
+            size_t column;
+        };
+
+        ChunkedStream* inputStream;
+        Lexer lexer;
+        ErrorList* errors;
+        size_t reported = 0;
+
+        // names of the open elements back to back, so that deep documents do not allocate per element
+        std::string openNames;
+        std::vector<OpenElement> openElements;
+        std::vector<std::string> attributeNames;
+        std::string name;
+        bool rootSeen = false;
+        size_t documentStart = 0; // stream offset after a byte order mark
+
+        void error(size_t line, size_t column, const std::string& message);
+        bool full() const { return parms.maxErrors > 0 && reported >= parms.maxErrors; }
+
+        void checkTag();
+        void checkEndTag();
+        void checkProcessingInstruction();
+        void checkDeclaration();
+        void checkTerminated(const char* start, const char* end, const char* what);
+        void checkText();
+        void skipWhitespace();
+        bool resync();
+
+        void pushElement(size_t line, size_t column);
+        std::string_view openName(const OpenElement& e) const { return std::string_view(openNames).substr(e.nameOffset, e.nameLength); }
+        void popElement();
+    public:
+        struct Parms {
+            size_t maxErrors = 100;         // checking stops when this many errors are found, 0 for no limit
+            std::string resourceLocation;   // copied into every error, usually the file name
+        } parms;
+
+        Checker(ChunkedStream& s, ErrorList& errors);
+
+        // checks the rest of the stream; returns true when no errors were found
+        bool Check();
+
+        // number of errors added by Check
+        size_t errorCount() const { return reported; }
+    };
+}
+
+#endif
@@ -87,29 +87,16 @@ namespace SimpleXml {
 	}
 
 	bool ChunkedStream::peekMatch(const char* match,size_t len) {
-		while (len > 0) {
-			auto copysize = available();
-			if (!copysize) {
-				if (bufUsed.empty()) {
-					break;
-				}
-				auto b = bufUsed.front();
-				bufUsed.erase(bufUsed.begin());
-				setCurBuff(b);
-				copysize = available();
-			}
-			if (len < copysize)
-				copysize = len;
+		if (len <= available()) {
+			return memcmp(__curpos, match, len) == 0;
+		}
 
-			for (size_t i = 0; i < copysize; i ++) {
-				if (__curpos [i]!= match[i])
-					return false;
-			}
-				
-			len-=copysize;
-			match+=copysize;
+		// spans chunks: peek without moving the read position
+		for (size_t i = 0; i < len; i++) {
+			if (peekChar(i) != match[i])
+				return false;
 		}
-		return len == 0;
+		return true;
 	}
 
 	char ChunkedStream::peekCharInternal(size_t idx) {
@@ -145,7 +132,7 @@ namespace SimpleXml {
 				}
 				auto b = bufUsed.front();
 				bufUsed.erase(bufUsed.begin());
-				moveActiveToAvailable();
+				retireActive();
 				setCurBuff(b);
 				copysize = available();
 			}
@@ -158,6 +145,7 @@ namespace SimpleXml {
 			}
 			__curpos += copysize;
 			len -= copysize;
+			copied += copysize;
 		}
 		read_offset += copied;
 		return copied;
@@ -1,6 +1,7 @@
 #ifndef CHUNKEDSTREAM_HEADER_FILE_H
 #define CHUNKEDSTREAM_HEADER_FILE_H
 
+#include <cstring>
 #include <list>
 #include <stack>
 #include <vector>
@@ -52,6 +53,14 @@ namespace SimpleXml {
 			}
 		}
 
+		void retireActive() {
+			if (onRetire && __curBuf.data != NULL && __curBuf.data != staticSource.data) {
+				onRetire(__curBuf);
+				return;
+			}
+			moveActiveToAvailable();
+		}
+
 	public:
 
 		ChunkedStream(size_t chunksize, std::function<size_t(size_t, char*, size_t)>&readChunk) { bufferSize = chunksize+1; chunkProviderCopy = readChunk; reset(); }
@@ -112,6 +121,11 @@ namespace SimpleXml {
 		size_t skip(size_t size);
 
 		size_t offset() { return read_offset; }
+
+		// When set, a chunk that has been read completely is handed to this function instead of being
+		// reused for the next chunk. Its owner gives it back with recycle() once nothing points into it.
+		std::function<void(buf)> onRetire = NULL;
+		void recycle(buf b) { bufavailable.push(b); }
 	};
 }
 
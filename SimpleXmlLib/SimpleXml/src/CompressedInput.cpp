@@ -0,0 +1,358 @@
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef SIMPLEXML_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SIMPLEXML_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "CompressedInput.h"
+
+namespace SimpleXml {
+
+    namespace {
+        const size_t InputBufferSize = 256 * 1024;
+
+        // sequential source of decompressed bytes; read returns 0 only at the end of the data
+        class Decoder {
+        public:
+            virtual ~Decoder() {}
+            virtual size_t read(char* target, size_t len) = 0;
+        };
+
+        class PlainDecoder : public Decoder {
+            std::ifstream* file;
+        public:
+            PlainDecoder(std::ifstream& f) : file(&f) {}
+
+            size_t read(char* target, size_t len) override {
+                file->read(target, len);
+                return (size_t)file->gcount();
+            }
+        };
+
+        // reads compressed input in blocks
+        class InputBuffer {
+            std::ifstream* file;
+            std::vector<char> buffer;
+        public:
+            const char* data = NULL;
+            size_t size = 0;
+
+            InputBuffer(std::ifstream& f) : file(&f), buffer(InputBufferSize) {}
+
+            bool fill() {
+                if (size > 0)
+                    return true;
+                file->read(buffer.data(), buffer.size());
+                data = buffer.data();
+                size = (size_t)file->gcount();
+                return size > 0;
+            }
+
+            void consumed(size_t len) {
+                data += len;
+                size -= len;
+            }
+        };
+
+#ifdef SIMPLEXML_WITH_ZLIB
+        class GzipDecoder : public Decoder {
+            InputBuffer input;
+            z_stream zs;
+            bool finished = false;
+        public:
+            GzipDecoder(std::ifstream& f) : input(f) {
+                memset(&zs, 0, sizeof(zs));
+                if (inflateInit2(&zs, 15 + 32) != Z_OK) // 32: accept gzip and zlib headers
+                    throw std::runtime_error("zlib initialization failed");
+            }
+
+            ~GzipDecoder() {
+                inflateEnd(&zs);
+            }
+
+            size_t read(char* target, size_t len) override {
+                size_t produced = 0;
+                while (produced == 0 && !finished) {
+                    if (!input.fill()) {
+                        finished = true;
+                        if (zs.total_in > 0)
+                            throw std::runtime_error("gzip input is truncated");
+                        break;
+                    }
+
+                    zs.next_in = (Bytef*)input.data;
+                    zs.avail_in = (uInt)input.size;
+                    zs.next_out = (Bytef*)target;
+                    zs.avail_out = (uInt)len;
+
+                    int ret = inflate(&zs, Z_NO_FLUSH);
+                    input.consumed(input.size - zs.avail_in);
+                    produced = len - zs.avail_out;
+
+                    if (ret == Z_STREAM_END) {
+                        // concatenated gzip members are one stream
+                        if (input.fill()) {
+                            inflateReset(&zs);
+                        }
+                        else {
+                            finished = true;
+                        }
+                    }
+                    else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                        throw std::runtime_error(std::string("gzip input is corrupt: ") + (zs.msg ? zs.msg : "unknown error"));
+                    }
+                }
+                return produced;
+            }
+        };
+#endif
+
+#ifdef SIMPLEXML_WITH_ZSTD
+        class ZstdDecoder : public Decoder {
+            InputBuffer input;
+            ZSTD_DStream* ds;
+            size_t lastResult = 0;  // 0 when the last frame is complete
+            bool finished = false;
+        public:
+            ZstdDecoder(std::ifstream& f) : input(f) {
+                ds = ZSTD_createDStream();
+                if (ds == NULL)
+                    throw std::runtime_error("zstd initialization failed");
+                ZSTD_initDStream(ds);
+            }
+
+            ~ZstdDecoder() {
+                ZSTD_freeDStream(ds);
+            }
+
+            size_t read(char* target, size_t len) override {
+                ZSTD_outBuffer out = { target, len, 0 };
+                while (out.pos == 0 && !finished) {
+                    if (!input.fill()) {
+                        finished = true;
+                        if (lastResult != 0)
+                            throw std::runtime_error("zstd input is truncated");
+                        break;
+                    }
+
+                    ZSTD_inBuffer in = { input.data, input.size, 0 };
+                    lastResult = ZSTD_decompressStream(ds, &out, &in);
+                    if (ZSTD_isError(lastResult))
+                        throw std::runtime_error(std::string("zstd input is corrupt: ") + ZSTD_getErrorName(lastResult));
+                    input.consumed(in.pos);
+                }
+                return out.pos;
+            }
+        };
+#endif
+
+        CompressedChunkProvider::Format detect(std::ifstream& f) {
+            unsigned char magic[4] = { 0,0,0,0 };
+            f.read((char*)magic, 4);
+            auto n = f.gcount();
+            f.clear();
+            f.seekg(0);
+
+            if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+                return CompressedChunkProvider::Format::Gzip;
+            if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+                return CompressedChunkProvider::Format::Zstd;
+            return CompressedChunkProvider::Format::Plain;
+        }
+    }
+
+    class CompressedChunkProvider::Impl {
+        std::ifstream file;
+        std::unique_ptr<Decoder> decoder;
+        Parms parms;
+        size_t delivered = 0;
+
+        // prefetching: blocks go from the worker to the reader through "ready" and back through "spare"
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size = 0;
+            size_t pos = 0;
+        };
+        std::thread worker;
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<Block> ready;
+        std::vector<Block> spare;
+        Block current;
+        bool workerDone = false;
+        bool stopping = false;
+        std::exception_ptr workerError;
+
+        void work() {
+            try {
+                while (true) {
+                    Block b;
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        changed.wait(guard, [this] { return stopping || !spare.empty(); });
+                        if (stopping)
+                            return;
+                        b = std::move(spare.back());
+                        spare.pop_back();
+                    }
+
+                    b.size = 0;
+                    b.pos = 0;
+                    while (b.size < parms.blockSize) {
+                        size_t n = decoder->read(b.data.get() + b.size, parms.blockSize - b.size);
+                        if (n == 0)
+                            break;
+                        b.size += n;
+                    }
+
+                    std::lock_guard<std::mutex> guard(lock);
+                    bool last = b.size < parms.blockSize;
+                    if (b.size > 0)
+                        ready.push_back(std::move(b));
+                    if (last) {
+                        workerDone = true;
+                        changed.notify_all();
+                        return;
+                    }
+                    changed.notify_all();
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> guard(lock);
+                workerError = std::current_exception();
+                workerDone = true;
+                changed.notify_all();
+            }
+        }
+
+        size_t readPrefetched(char* target, size_t len) {
+            if (current.pos == current.size) {
+                std::unique_lock<std::mutex> guard(lock);
+                if (current.data)
+                    spare.push_back(std::move(current));
+                changed.notify_all();
+                changed.wait(guard, [this] { return !ready.empty() || workerDone; });
+                if (ready.empty()) {
+                    if (workerError)
+                        std::rethrow_exception(workerError);
+                    return 0;
+                }
+                current = std::move(ready.front());
+                ready.pop_front();
+            }
+
+            size_t n = current.size - current.pos;
+            if (n > len)
+                n = len;
+            memcpy(target, current.data.get() + current.pos, n);
+            current.pos += n;
+            return n;
+        }
+
+    public:
+        Format format;
+
+        Impl(const std::string& path, Parms p) : parms(p) {
+            file.open(path, std::ios::binary);
+            if (!file)
+                throw std::runtime_error("cannot open " + path);
+
+            format = parms.format == Format::Auto ? detect(file) : parms.format;
+            if (!supported(format))
+                throw std::runtime_error("compression format of " + path + " is not supported by this build");
+
+            switch (format) {
+#ifdef SIMPLEXML_WITH_ZLIB
+            case Format::Gzip:
+                decoder.reset(new GzipDecoder(file));
+                break;
+#endif
+#ifdef SIMPLEXML_WITH_ZSTD
+            case Format::Zstd:
+                decoder.reset(new ZstdDecoder(file));
+                break;
+#endif
+            default:
+                decoder.reset(new PlainDecoder(file));
+                break;
+            }
+
+            if (parms.prefetch) {
+                if (parms.blockSize == 0)
+                    parms.blockSize = 1;
+                for (size_t i = 0; i < parms.blockCount + 1; i++) {
+                    Block b;
+                    b.data.reset(new char[parms.blockSize]);
+                    spare.push_back(std::move(b));
+                }
+                worker = std::thread(&Impl::work, this);
+            }
+        }
+
+        ~Impl() {
+            if (worker.joinable()) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    stopping = true;
+                }
+                changed.notify_all();
+                worker.join();
+            }
+        }
+
+        size_t read(size_t offset, char* target, size_t len) {
+            if (offset != delivered)
+                throw std::runtime_error("compressed input can only be read sequentially");
+
+            size_t n = parms.prefetch ? readPrefetched(target, len) : decoder->read(target, len);
+            delivered += n;
+            return n;
+        }
+    };
+
+    CompressedChunkProvider::CompressedChunkProvider(const std::string& path) : CompressedChunkProvider(path, Parms()) {
+    }
+
+    CompressedChunkProvider::CompressedChunkProvider(const std::string& path, Parms parms) : impl(std::make_shared<Impl>(path, parms)) {
+    }
+
+    size_t CompressedChunkProvider::operator()(size_t offset, char* target, size_t len) {
+        return impl->read(offset, target, len);
+    }
+
+    CompressedChunkProvider::Format CompressedChunkProvider::format() const {
+        return impl->format;
+    }
+
+    bool CompressedChunkProvider::supported(Format format) {
+        switch (format) {
+        case Format::Auto:
+        case Format::Plain:
+            return true;
+        case Format::Gzip:
+#ifdef SIMPLEXML_WITH_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case Format::Zstd:
+#ifdef SIMPLEXML_WITH_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        }
+        return false;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef COMPRESSEDINPUT_HEADER_FILE_H
+#define COMPRESSEDINPUT_HEADER_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/*
+* Decoders are optional at build time:
+*   SIMPLEXML_WITH_ZLIB  enables .gz (and zlib) input, link with zlib
+*   SIMPLEXML_WITH_ZSTD  enables .zst input, link with libzstd
+*/
+
+namespace SimpleXml {
+
+    /*
+    * Chunk provider for ChunkedStream that reads a file and decompresses it on the fly:
+    *
+    *     CompressedChunkProvider provider("huge.xml.gz");
+    *     std::function<size_t(size_t, char*, size_t)> chunker = provider;
+    *     ChunkedStream stream(1024 * 1024, chunker);
+    *
+    * Chunks are requested in order; seeking back is not supported. With prefetching, decompression
+    * runs on a separate thread a few blocks ahead of the reader so memory stays bounded.
+    * Errors (missing file, corrupt data, unsupported format) are thrown as std::runtime_error.
+    */
+    class CompressedChunkProvider {
+    public:
+        enum class Format {
+            Auto,   // detected from the first bytes of the file
+            Plain,
+            Gzip,
+            Zstd
+        };
+
+        struct Parms {
+            Format format = Format::Auto;
+            bool prefetch = true;
+            size_t blockSize = 1024 * 1024;    // decompressed bytes per prefetched block
+            size_t blockCount = 4;             // blocks decompressed ahead of the reader
+        };
+
+        CompressedChunkProvider(const std::string& path);
+        CompressedChunkProvider(const std::string& path, Parms parms);
+
+        size_t operator()(size_t offset, char* target, size_t len);
+
+        // the format that was detected or requested
+        Format format() const;
+
+        // true when this build can decode the format
+        static bool supported(Format format);
+
+        class Impl;
+    private:
+        // shared so that the provider can be copied into a std::function
+        std::shared_ptr<Impl> impl;
+    };
+}
+
+#endif
@@ -3,7 +3,7 @@
 
 
 #include <string>
-#include <list>
+#include <vector>
 
 namespace SimpleXml {
 	
@@ -22,19 +22,23 @@ namespace SimpleXml {
 	};
 
 	class ErrorList {
-		std::list<Error> _errors;
+		std::vector<Error> _errors;
 	public:
 		void add(Error e) {
-			_errors.push_back(e);
+			_errors.push_back(std::move(e));
 		}
 
 		void clear() {
 			_errors.clear();
 		}
 
-		bool empty() { return _errors.empty(); }
+		bool empty() const { return _errors.empty(); }
+		size_t size() const { return _errors.size(); }
+		const Error& operator[](size_t idx) const { return _errors[idx]; }
 		auto begin() { return _errors.begin(); }
 		auto end() { return _errors.end(); }
+		auto begin() const { return _errors.begin(); }
+		auto end() const { return _errors.end(); }
 	};
 }
 
@@ -1,9 +1,16 @@
 #include <cstddef>
 #include <string.h>
-#include <ostream>
 
 #include "Lexer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMPLEXML_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #define ISTAGSTART(x) ((x=='<'))
 #define ISTAGEND(x) ((x=='>'))
 
@@ -60,6 +67,17 @@ namespace SimpleXml {
         currentTokenSize = 0;
         pos_col = 1;
         pos_row = 1;
+        pos_offset = 0;
+    }
+
+    bool Lexer::skipByteOrderMark() {
+        if (inputStream->offset() != 0 || inputStream->peekChar(0) != '\xEF' || inputStream->peekChar(1) != '\xBB' || inputStream->peekChar(2) != '\xBF')
+            return false;
+
+        inputStream->skip(3);
+        currentTokenSize = 0;
+        pos_offset = inputStream->offset();
+        return true;
     }
 
     template <typename Function>
@@ -157,6 +175,49 @@ namespace SimpleXml {
 */
     }
 
+    bool Lexer::readDeclaration() {
+        currentToken = Token::Unknown;
+
+        char quote = 0;
+        int depth = 0;
+        bool inComment = false;
+        char prev[3] = { 0,0,0 };
+        bool found = SimpleXml::readUntil(inputStream, 0, currentTokenSize, [&](char c) {
+            bool end = false;
+            if (inComment) {
+                if (c == '>' && prev[1] == '-' && prev[2] == '-')
+                    inComment = false;
+            }
+            else if (quote) {
+                if (c == quote)
+                    quote = 0;
+            }
+            else if (c == '-' && prev[0] == '<' && prev[1] == '!' && prev[2] == '-') {
+                inComment = true;
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+            }
+            else if (c == '[') {
+                depth++;
+            }
+            else if (c == ']') {
+                if (depth > 0) depth--;
+            }
+            else if (c == '>' && depth == 0) {
+                end = true;
+            }
+            prev[0] = prev[1];
+            prev[1] = prev[2];
+            prev[2] = c;
+            return end;
+        });
+        if (found) {
+            currentTokenSize += 1;
+        }
+        return found;
+    }
+
     bool Lexer::readUntil(int startpos, const char*match, bool includeEnd) {
         currentToken = Token::Unknown;
         currentTokenSize = startpos;
@@ -467,37 +528,110 @@ namespace SimpleXml {
     }
 
     void Lexer::trackPosition(size_t len) {
+        if (parms.deferPosition) {
+            if (len < inputStream->available()) {
+                return; // the bytes stay in the active chunk; counted when queried
+            }
+            resolvePosition(); // the active chunk is about to be left
+            pos_offset = inputStream->offset() + len;
+        }
+
         if (len < inputStream->available()) {
             trackPosition(inputStream->begin(), len);
-            return;
         }
+        else {
+            auto avail = inputStream->available();
+            trackPosition(inputStream->begin(), avail);
+            len -= avail;
+
+            ChunkedStream::buf b;
+            int bidx = -1;
+            while (len > 0) {
+                b = inputStream->peekBuf(++bidx);
+                if (b.data == NULL)
+                    break;
+
+                size_t copysize;
+                if (b.size > len)
+                    copysize = len;
+                else
+                    copysize = b.size;
+
+                trackPosition(b.data, copysize);
+                len -= copysize;
+            }
+        }
+    }
 
-        trackPosition(inputStream->begin(), inputStream->available());
-        ChunkedStream::buf b;
-        int bidx = -1;
-        do {
-            b = inputStream->peekBuf(++bidx);
-            size_t copysize;
-            if (b.size > len)
-                copysize = len;
-            else
-                copysize = b.size;
+    void Lexer::resolvePosition() {
+        if (!parms.trackPosition || !parms.deferPosition)
+            return;
+
+        // everything between pos_offset and the read position is in the active chunk
+        size_t pending = inputStream->offset() - pos_offset;
+        trackPosition(inputStream->begin() - pending, pending);
+        pos_offset = inputStream->offset();
+    }
 
-            trackPosition(b.data, copysize);
-            len -= copysize;
-        } while (len > 0 && b.size > 0);
+    static inline unsigned popcount16(unsigned x) {
+#if defined(__GNUC__)
+        return __builtin_popcount(x);
+#else
+        x = x - ((x >> 1) & 0x5555);
+        x = (x & 0x3333) + ((x >> 2) & 0x3333);
+        x = (x + (x >> 4)) & 0x0F0F;
+        return (x + (x >> 8)) & 0x1F;
+#endif
     }
 
+    static inline unsigned highestBit16(unsigned x) {
+#if defined(__GNUC__)
+        return 31 - __builtin_clz(x);
+#else
+        unsigned long idx;
+        _BitScanReverse(&idx, x);
+        return idx;
+#endif
+    }
+
+    /*
+    * Columns count characters, not bytes: \r and utf-8 continuation bytes (10xxxxxx) are not
+    * counted. A \n starts a new row.
+    */
     void Lexer::trackPosition(const char* data, size_t len) {
-        for (size_t i = 0; i < len; i++){
-            char c = data[i];
+        size_t i = 0;
+#ifdef SIMPLEXML_SSE2
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i contMask = _mm_set1_epi8((char)0xC0);
+        const __m128i contVal = _mm_set1_epi8((char)0x80);
+
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            unsigned lfbits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf));
+            unsigned crbits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cr));
+            unsigned contbits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, contMask), contVal));
+            unsigned charbits = ~(lfbits | crbits | contbits) & 0xFFFF;
+
+            if (lfbits) {
+                unsigned last = highestBit16(lfbits);
+                pos_row += popcount16(lfbits);
+                pos_col = 1 + popcount16(charbits >> last); // bit "last" itself is a \n, never set in charbits
+            }
+            else {
+                pos_col += popcount16(charbits);
+            }
+        }
+#endif
+        for (; i < len; i++){
+            unsigned char c = (unsigned char)data[i];
 
             if (c == '\n') {
                 pos_row++;
                 pos_col = 1;
             }
             else if (c == '\r'); // just eat em up
-            else if (((unsigned char)c)<0x80) {// utf-8 marker means 2nd byte... not a char
+            else if ((c & 0xC0) != 0x80) {// utf-8 continuation byte... not a char
                 pos_col++;
             }
         }
@@ -537,35 +671,31 @@ namespace SimpleXml {
         currentTokenSize = 0;
     }
 
-    void Lexer::writeTokenData(std::ostream& out) {
-        char tmp[128];
+    void Lexer::writeTokenData(OutputSink& out) {
+        if (parms.trackPosition) {
+            trackPosition(currentTokenSize);
+        }
 
         auto size = inputStream->available();
         if (size >= currentTokenSize) { // happy flow
-            auto begin = inputStream->begin();
-            out.write(begin, currentTokenSize);
-            if (parms.trackPosition) {
-                trackPosition(begin, currentTokenSize);
-            }
-            inputStream->skip(currentTokenSize);
+            out.write(inputStream->begin(), currentTokenSize);
         }
-        else { // not so happy flow
-            while (currentTokenSize > 0) {
+        else { // not so happy flow: hand over the token chunk by chunk
+            out.write(inputStream->begin(), size);
 
-                auto copysize = currentTokenSize;
-                if (copysize > sizeof(tmp))
-                    copysize = sizeof(tmp);
-
-                inputStream->read(tmp, copysize);
-                if (parms.trackPosition) {
-                    trackPosition(tmp, copysize);
-                }
+            size_t len = currentTokenSize - size;
+            int bidx = -1;
+            while (len > 0) {
+                auto b = inputStream->peekBuf(++bidx);
+                if (b.data == NULL)
+                    break;
 
-                out.write(tmp, copysize);
-                currentTokenSize -= copysize;
+                size_t copysize = (b.size > len) ? len : b.size;
+                out.write(b.data, copysize);
+                len -= copysize;
             }
-
         }
+        inputStream->skip(currentTokenSize);
 
         if (isTagStart(currentToken))
             _isInTag = true;
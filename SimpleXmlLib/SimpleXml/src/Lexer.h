@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "ChunkedStream.h"
+#include "OutputSink.h"
 
 namespace SimpleXml {
     enum class Token {
@@ -52,9 +53,11 @@ namespace SimpleXml {
 
         size_t pos_row = 1;
         size_t pos_col = 1;
+        size_t pos_offset = 0; // stream offset pos_row/pos_col refer to (deferred mode)
 
         void trackPosition(const char *data, size_t len);
         void trackPosition(size_t len);
+        void resolvePosition();
 
         ChunkedStream* inputStream;
     public:
@@ -65,10 +68,12 @@ namespace SimpleXml {
         struct Parms {
             bool registerLinebreaks = false;
             bool trackPosition = false;
+            // with trackPosition: only count lines when a chunk is left or when the position is queried
+            bool deferPosition = false;
         }parms;
 
-        size_t currentLine() { return pos_row; }
-        size_t currentColumn() { return pos_col; }
+        size_t currentLine() { resolvePosition(); return pos_row; }
+        size_t currentColumn() { resolvePosition(); return pos_col; }
 
         bool readUntil(const char* end, bool includeEnd) {
             return readUntil(0, end, includeEnd);
@@ -77,6 +82,10 @@ namespace SimpleXml {
         // can be used for error recovery. 
         bool readUntilTagEndOrStart();
 
+        // reads a markup declaration (after "<!") up to its closing '>', skipping quoted
+        // literals, comments and a [...] internal subset
+        bool readDeclaration();
+
         bool tryReadWhitespace();
         bool tryReadName();
         bool tryReadNmtoken();
@@ -132,23 +141,20 @@ namespace SimpleXml {
             return inputStream->peekChar(0);
         }
 
+        // skips a UTF-8 byte order mark at the start of the stream without counting it as a
+        // column; returns true when one was skipped
+        bool skipByteOrderMark();
+
         char readChar() {
             char c = inputStream->peekChar(0);
             if (inputStream->eod())
                 return c;
 
             currentTokenSize = 0;
-            inputStream->skip(1);
-            
             if (parms.trackPosition) {
-                if (c == '\n') {
-                    pos_row++;
-                    pos_col =1;
-                }
-                else {
-                    pos_col++;
-                }
+                trackPosition(1);
             }
+            inputStream->skip(1);
             return c;
         }
 
@@ -161,7 +167,7 @@ namespace SimpleXml {
         }
         void readSystemLiteral(std::string& s);
 
-        void writeTokenData(std::ostream& out);
+        void writeTokenData(OutputSink& out);
 
     };
 }
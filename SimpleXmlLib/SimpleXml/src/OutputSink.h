@@ -0,0 +1,50 @@
+#ifndef OUTPUTSINK_HEADER_FILE_H
+#define OUTPUTSINK_HEADER_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <ostream>
+
+namespace SimpleXml {
+
+    // Destination of formatted text. Writers only append; implementations decide where the bytes go.
+    class OutputSink {
+    public:
+        virtual ~OutputSink() {}
+
+        virtual void write(const char* data, size_t len) = 0;
+
+        inline void write(std::string_view s) {
+            write(s.data(), s.size());
+        }
+    };
+
+    // Appends to an owned std::string; the result can be handed over without copy.
+    class StringOutputSink : public OutputSink {
+        std::string _text;
+    public:
+        using OutputSink::write;
+
+        void write(const char* data, size_t len) override {
+            _text.append(data, len);
+        }
+
+        void reserve(size_t len) { _text.reserve(len); }
+        std::string& str() { return _text; }
+    };
+
+    // Forwards to an existing std::ostream (file, stringstream, ...)
+    class StreamOutputSink : public OutputSink {
+        std::ostream* _out;
+    public:
+        using OutputSink::write;
+
+        StreamOutputSink(std::ostream& out) : _out(&out) {}
+
+        void write(const char* data, size_t len) override {
+            _out->write(data, len);
+        }
+    };
+}
+
+#endif
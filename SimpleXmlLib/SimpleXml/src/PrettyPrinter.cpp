@@ -1,11 +1,11 @@
-#include <sstream>
+#include <stdexcept>
 
 #include "PrettyPrinter.h"
 
 namespace SimpleXml {
 
     inline void PrettyPrinter::WriteCloseTag() {
-        outText.write(">", 1);
+        out->write(">", 1);
         tagIsOpen = false;
         inTag = false;
     }
@@ -20,7 +20,7 @@ namespace SimpleXml {
     inline void PrettyPrinter::Indent() {
         if (!indented && parms.insertIndents) {
             for (int i = 0; i < indentlevel && i < parms.maxElementDepth; i++) {
-                outText.write(parms.tab.c_str(), parms.tab.length());
+                out->write(parms.tab.c_str(), parms.tab.length());
             }
         }
         indented = true;
@@ -35,7 +35,7 @@ namespace SimpleXml {
 
     inline void PrettyPrinter::AddNewline() {
         if (parms.insertNewLines && !parms.keepExistingBreaks) {
-            outText.write(parms.eol.c_str(), parms.eol.length());
+            out->write(parms.eol.c_str(), parms.eol.length());
             indented = false;
         }
     }
@@ -51,21 +51,18 @@ namespace SimpleXml {
     }
 
     inline void PrettyPrinter::WriteToken() {
-        lexer.writeTokenData(outText);
-        //outText.write(lexer.TokenText(), lexer.TokenSize());
+        tokens.writeTokenData(*out);
     }
 
     inline void PrettyPrinter::WriteEatToken() {
-        lexer.writeTokenData(outText);
-        //    outText.write(lexer.TokenText(), lexer.TokenSize());
-        //    lexer.eatToken();
+        tokens.writeTokenData(*out);
     }
 
     bool PrettyPrinter::ParseAttributes() {
         bool insertWhitespaceBeforeAttribute = false;
         int numAttribute = 0;   // count the attributes (this is used for attributes indentation)
         Token token;
-        for (token = lexer.peekToken(); token != Token::InputEnd; token = lexer.peekToken()) {
+        for (token = tokens.peekToken(); token != Token::InputEnd; token = tokens.peekToken()) {
             if (token == Token::Name || token == Token::Nmtoken) {
                 if (insertWhitespaceBeforeAttribute) {
                     if (parms.indentAttributes && prevTag.size() > 0 && numAttribute > 0) {
@@ -73,14 +70,14 @@ namespace SimpleXml {
                         Indent();
 
                         for (size_t i = 0; i < prevTag.size() + 2; i++) {
-                            outText.write(" ", 1);
+                            out->write(" ", 1);
                         }
                     }
                     else if (!indented && indentlevel > 0 && parms.insertIndents) {
                         Indent();
                     }
                     else {
-                        outText.write(" ", 1);
+                        out->write(" ", 1);
                     }
 
                     insertWhitespaceBeforeAttribute = false;
@@ -105,7 +102,7 @@ namespace SimpleXml {
                 else {
                     insertWhitespaceBeforeAttribute = true;
                 }
-                lexer.eatToken();
+                tokens.eatToken();
             }
             else if (token == Token::Linebreak) {
                 insertWhitespaceBeforeAttribute = true;
@@ -114,7 +111,7 @@ namespace SimpleXml {
                     indented = false;
                 }
 
-                lexer.eatToken();
+                tokens.eatToken();
             }
             else if (token == Token::SelfClosingTagEnd) {
                 break;
@@ -132,10 +129,10 @@ namespace SimpleXml {
     void PrettyPrinter::trimTextAndOutput(std::string_view is) {
         auto len = is.size();
         auto start = is.data();
-#define trimText__isWhiteSpace(c) (lexer.isWhitespace(c) || (!parms.keepExistingBreaks && lexer.isLinebreak(c)))
+#define trimText__isWhiteSpace(c) (Lexer::isWhitespace(c) || (!parms.keepExistingBreaks && Lexer::isLinebreak(c)))
 
         bool prefixTrimmed = false;
-        if (trimText__isWhiteSpace(*start)) {
+        if (len > 0 && trimText__isWhiteSpace(*start)) {
             start++;
             len--;
             prefixTrimmed = true;
@@ -159,10 +156,10 @@ namespace SimpleXml {
 
             if (parms.keepStartEndWhitespace) {
                 if (prefixTrimmed)
-                    outText.write(" ", 1);
+                    out->write(" ", 1);
             }
             if (parms.keepExistingBreaks)
-                outText.write(start, len);
+                out->write(start, len);
             else {
                 auto end = start + len;
                 while (start < end) {
@@ -171,10 +168,10 @@ namespace SimpleXml {
                         pos++;
                     }
 
-                    outText.write(start, pos - start);
+                    out->write(start, pos - start);
                     if (pos < end) {
                         while (pos < end && trimText__isWhiteSpace(*pos)) pos++; // eat whitespace
-                        outText.write(" ", 1); // only put 1 back
+                        out->write(" ", 1); // only put 1 back
                     }
 
                     start = pos;
@@ -182,7 +179,7 @@ namespace SimpleXml {
 
                 if (parms.keepStartEndWhitespace) {
                     if (postfixTrimmed) {
-                        outText.write(" ", 1);
+                        out->write(" ", 1);
                     }
                 }
             }
@@ -190,8 +187,8 @@ namespace SimpleXml {
     }
 
     void PrettyPrinter::Parse() {
-        while (!lexer.Done()) {
-            auto token = lexer.peekToken();
+        while (!tokens.Done()) {
+            auto token = tokens.peekToken();
             switch (token) {
             case Token::CDSect:
             case Token::Comment: {
@@ -203,22 +200,19 @@ namespace SimpleXml {
             case Token::Text: {
                 TryCloseTag();
                 if (parms.removeWhitespace) {
-                    std::string tmp;
-                    tmp.resize(lexer.tokenSize());
-                    lexer.readTokenData(&tmp[0]);
-                    trimTextAndOutput(tmp);
+                    trimTextAndOutput(tokens.tokenView());
                 }
                 else {
                     TryIndent();
                     WriteToken();
                 }
-                lexer.eatToken();
+                tokens.eatToken();
                 break;
             }
             case Token::Whitespace: {
                 if (parms.removeWhitespace) {
                     if (inTag) { // attributes need to be separated
-                        outText.write(" ", 1);
+                        out->write(" ", 1);
                     }
                 }
                 else {
@@ -226,7 +220,7 @@ namespace SimpleXml {
                     indented = true;
                 }
 
-                lexer.eatToken();
+                tokens.eatToken();
                 break;
             }
             case Token::Linebreak: {
@@ -238,7 +232,7 @@ namespace SimpleXml {
                     WriteToken();
                     indented = false;
                 }
-                lexer.eatToken();
+                tokens.eatToken();
                 break;
             }
             case Token::ClosingTag: {
@@ -246,27 +240,26 @@ namespace SimpleXml {
                     TryCloseTag();
                 }
                 indentlevel--;
-                lexer.eatToken();
-                if (!lexer.isIdentifier(lexer.peekToken())) {
+                tokens.eatToken();
+                if (!Lexer::isIdentifier(tokens.peekToken())) {
                     TryCloseTag();
-                    outText.write("</", 2);
+                    out->write("</", 2);
                     break; // back to default processing
                 }
-                std::string tag;
-                lexer.readTokenData(tag);
+                auto tag = tokens.tokenView();
 
-                bool matchesPrevTag = prevTag == tag;
+                bool matchesPrevTag = std::string_view(prevTag) == tag;
                 if (tagIsOpen) {
                     if (parms.autocloseEmptyElements) {
                         if (matchesPrevTag) {
-                            outText.write("/>", 2);
+                            out->write("/>", 2);
                             Token nextToken;
                             do {// not really charming but at least we will end up with valid XML.. in valid XML cases the first token would be a tag end
-                                nextToken = lexer.peekToken();
-                                lexer.eatToken();
-                            } while (nextToken != Token::TagEnd && !lexer.Done());
+                                nextToken = tokens.peekToken();
+                                tokens.eatToken();
+                            } while (nextToken != Token::TagEnd && !tokens.Done());
 
-                            prevTag = "";
+                            prevTag.clear();
                             tagIsOpen = false;
                             inTag = false;
                             indentlevel++; // correction for previous decrease
@@ -284,13 +277,13 @@ namespace SimpleXml {
                     }
                 }
 
-                outText.write("</", 2);
-                outText.write(tag.c_str(), tag.size());
+                out->write("</", 2);
+                out->write(tag);
 
                 bool ateWhitespace = false;
-                for (token = lexer.peekToken(); token != Token::InputEnd; token = lexer.peekToken()) {
+                for (token = tokens.peekToken(); token != Token::InputEnd; token = tokens.peekToken()) {
                     if (token == Token::Whitespace) {
-                        lexer.eatToken();
+                        tokens.eatToken();
                         ateWhitespace = true;
                     }
                     else if (token == Token::TagEnd) {
@@ -304,7 +297,7 @@ namespace SimpleXml {
                     }
                     else {
                         if (ateWhitespace) {
-                            outText.write(" ", 1); // put it back
+                            out->write(" ", 1); // put it back
                         }
                         // unexpected ... whatever
                         break;
@@ -325,15 +318,14 @@ namespace SimpleXml {
                 tagIsOpen = true;
                 inTag = true;
 
-                if (lexer.isIdentifier(lexer.peekToken())) {
-                    std::string tag;
-                    lexer.readTokenData(tag);
-                    outText.write(tag.c_str(), tag.size());
+                if (Lexer::isIdentifier(tokens.peekToken())) {
+                    auto tag = tokens.tokenView();
+                    out->write(tag);
 
                     if (tag == "xml") {
                         ParseAttributes();
 
-                        if (lexer.peekToken() != Token::ProcessingInstructionEnd) {
+                        if (tokens.peekToken() != Token::ProcessingInstructionEnd) {
                             // well dont know... didnt close?
                         }
                         else {
@@ -341,15 +333,14 @@ namespace SimpleXml {
                         }
                     }
                     else {
-                        lexer.readUntil("?>", true);
+                        tokens.peekToken(); // rest of the processing instruction, up to and including "?>"
                         WriteEatToken();
                     }
                 }
                 else {
-                    lexer.readUntil("?>", true);
+                    tokens.peekToken();
                     WriteEatToken();
                 }
-                lexer.cancelInTag();
                 inTag = false;
                 tagIsOpen = false;
                 AddNewline();
@@ -366,9 +357,10 @@ namespace SimpleXml {
                 tagIsOpen = true;
                 inTag = true;
 
-                if (lexer.isIdentifier(lexer.peekToken())) {
-                    lexer.readTokenData(prevTag);
-                    outText.write(prevTag.c_str(), prevTag.size());
+                if (Lexer::isIdentifier(tokens.peekToken())) {
+                    auto tag = tokens.tokenView();
+                    prevTag.assign(tag.data(), tag.size());
+                    out->write(prevTag);
                 }
                 else {
                     // ill-formed XML.. dump as is until next >
@@ -380,13 +372,13 @@ namespace SimpleXml {
                 break;
             }
             case Token::TagEnd: {
-                lexer.eatToken();
+                tokens.eatToken();
                 tagIsOpen = true;
                 break;
             }
             case Token::SelfClosingTagEnd: {
                 WriteEatToken();
-                prevTag = "";
+                prevTag.clear();
                 AddNewline();
                 inTag = false;
                 tagIsOpen = false;
@@ -398,26 +390,21 @@ namespace SimpleXml {
                     AddNewline();
                 }
                 WriteEatToken();
-                auto res = lexer.readUntilTagEndOrStart();
+                tokens.peekToken(); // declaration body, up to the next '<' or '>'
+                auto res = tokens.tokenFound();
                 if (parms.removeWhitespace) {
-                    std::string tmp;
-                    lexer.readTokenData(tmp);
-                    trimTextAndOutput(tmp);
+                    trimTextAndOutput(tokens.tokenView());
                 }
                 else {
                     TryIndent();
                     WriteToken();
                 }
-                lexer.eatToken();
+                tokens.eatToken();
                 if (res) {
-                    if (lexer.peekChar() == '<') {
+                    if (tokens.readDeclarationEnd()) {
+                        out->write(">", 1);
                     }
-                    else {
-                        lexer.readChar();
-                        outText.write(">", 1);
-                    }
-                    lexer.cancelInTag(); // always self-closing
-                    inTag = false;
+                    inTag = false; // always self-closing
                 }
 
                 break;
@@ -427,7 +414,7 @@ namespace SimpleXml {
 
             default: {
                 //WriteEatToken();
-                throw std::exception("The pretty print parser encountered an unexpected error. This might be caused by invalid XML structure. Please try using another formating engine, for instance QuickXml, in pretty print options (go in XMLTools options dialog in order to change formating engine). If issue still happens, please get in touch with the developers @ https://github.com/morbac/XMLTools");
+                throw std::runtime_error("The pretty print parser encountered an unexpected error. This might be caused by invalid XML structure. Please try using another formating engine, for instance QuickXml, in pretty print options (go in XMLTools options dialog in order to change formating engine). If issue still happens, please get in touch with the developers @ https://github.com/morbac/XMLTools");
             }
             }
         }
@@ -440,13 +427,22 @@ namespace SimpleXml {
         indentlevel = 0;
         indented = false;
         tagIsOpen = false;
-        prevTag = "";
+        prevTag.clear();
 
-        if (outText.tellp()) {
+        if (converted) {
             return false; // single use class
         }
+        converted = true;
 
-        Parse();
+        tokens.start(parms.pipelined);
+        try {
+            Parse();
+        }
+        catch (...) {
+            tokens.finish();
+            throw;
+        }
+        tokens.finish();
 
         return true;
     }
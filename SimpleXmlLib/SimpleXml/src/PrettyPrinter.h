@@ -2,8 +2,10 @@
 #define PRETTYPRINTER_HEADER_FILE_H
 
 
-#include <sstream>
+#include <string>
 #include "Lexer.h"
+#include "TokenPipeline.h"
+#include "OutputSink.h"
 
 namespace SimpleXml {
 
@@ -38,18 +40,25 @@ namespace SimpleXml {
 
         // when indenting, put each attribute on a separate line + indent
         bool indentAttributes = false;
+
+        // lex on a second thread while formatting; the output is the same.
+        // The chunk provider of the stream is then called from that thread.
+        bool pipelined = false;
     };
 
     class PrettyPrinter {
-        std::stringstream outText;
-        SimpleXml::Lexer lexer;
+        StringOutputSink outText;   // default sink, used when none is given
+        OutputSink* out;
+        SimpleXml::TokenReader tokens;
         PrettyPrintParms parms;
+        bool converted = false;
 
         bool inTag = false;
         int indentlevel = 0;
         bool indented = false;
         bool tagIsOpen = false;
 
+        // reused buffer: capacity is kept between tokens so steady state does not allocate
         std::string prevTag;
 
         inline void WriteCloseTag();
@@ -65,11 +74,17 @@ namespace SimpleXml {
 
         void trimTextAndOutput(std::string_view is);
     public:
-        PrettyPrinter(SimpleXml::ChunkedStream& s, PrettyPrintParms parms) :lexer(s), parms(parms) {
-            lexer.parms.registerLinebreaks = parms.keepExistingBreaks;
+        PrettyPrinter(SimpleXml::ChunkedStream& s, PrettyPrintParms parms) :out(&outText), tokens(s, parms.keepExistingBreaks), parms(parms) {
+        }
+
+        PrettyPrinter(SimpleXml::ChunkedStream& s, PrettyPrintParms parms, OutputSink& sink) :out(&sink), tokens(s, parms.keepExistingBreaks), parms(parms) {
         }
 
-        std::stringstream* Stream() { return &outText; }
+        PrettyPrinter(const PrettyPrinter&) = delete;
+        PrettyPrinter& operator=(const PrettyPrinter&) = delete;
+
+        // formatted text, when no external sink was given; can be moved out or cleared by the caller
+        std::string& Text() { return outText.str(); }
 
         bool Convert();
     };
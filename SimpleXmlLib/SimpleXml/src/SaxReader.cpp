@@ -0,0 +1,255 @@
+#include <string.h>
+
+#include "SaxReader.h"
+
+namespace SimpleXml {
+
+    SaxReader::SaxReader(ChunkedStream& s) : inputStream(&s), lexer(s) {
+    }
+
+    void SaxReader::startEvent(SaxLocation& loc) {
+        scratch.clear();
+        spilled = false;
+        pieces.clear();
+        attributes.clear();
+
+        loc.offset = inputStream->offset();
+        if (parms.trackPosition) {
+            loc.line = lexer.currentLine();
+            loc.column = lexer.currentColumn();
+        }
+    }
+
+    // pieces point into the active chunk until a token leaves it: from then on everything goes to scratch
+    void SaxReader::spill() {
+        if (spilled)
+            return;
+        spilled = true;
+        for (auto& p : pieces) {
+            if (p.data != NULL) {
+                p.offset = scratch.size();
+                scratch.append(p.data, p.size);
+                p.data = NULL;
+            }
+        }
+    }
+
+    size_t SaxReader::take() {
+        size_t len = lexer.tokenSize();
+        if (!spilled && len < inputStream->available()) {
+            pieces.push_back({ inputStream->begin(), 0, len });
+            lexer.eatToken();
+        }
+        else {
+            spill();
+            size_t offset = scratch.size();
+            scratch.resize(offset + len);
+            lexer.readTokenData(&scratch[offset]);
+            pieces.push_back({ NULL, offset, len });
+        }
+        return pieces.size() - 1;
+    }
+
+    void SaxReader::skip() {
+        if (!spilled && !pieces.empty() && lexer.tokenSize() >= inputStream->available())
+            spill();
+        lexer.eatToken();
+    }
+
+    std::string_view SaxReader::view(size_t idx) {
+        const Piece& p = pieces[idx];
+        if (p.data != NULL)
+            return std::string_view(p.data, p.size);
+        return std::string_view(scratch.data() + p.offset, p.size);
+    }
+
+    static inline std::string_view trimDelimiters(std::string_view s, size_t startLen, const char* end) {
+        s.remove_prefix(startLen < s.size() ? startLen : s.size());
+        size_t endLen = strlen(end);
+        if (s.size() >= endLen && s.compare(s.size() - endLen, endLen, end) == 0)
+            s.remove_suffix(endLen);
+        return s;
+    }
+
+    void SaxReader::readStartTag(SaxHandler& handler) {
+        SaxLocation loc;
+        startEvent(loc);
+
+        lexer.eatToken(); // <
+        size_t name = SIZE_MAX;
+        if (lexer.peekToken() == Token::Name || lexer.peekToken() == Token::Nmtoken)
+            name = take();
+
+        // attributes are stored as name/value piece pairs, value SIZE_MAX when absent
+        std::vector<std::pair<size_t, size_t>>& attrs = attributePieces;
+        attrs.clear();
+
+        bool selfClosing = false;
+        while (!lexer.Done()) {
+            Token token = lexer.peekToken();
+            if (token == Token::TagEnd) {
+                skip();
+                break;
+            }
+            if (token == Token::SelfClosingTagEnd) {
+                skip();
+                selfClosing = true;
+                break;
+            }
+            if (lexer.isTagStart(token) || token == Token::Comment || token == Token::CDSect) {
+                // missing '>': leave the next markup for the main loop
+                lexer.cancelInTag();
+                break;
+            }
+            if (Lexer::isIdentifier(token)) {
+                attrs.push_back({ take(), SIZE_MAX });
+                continue;
+            }
+            if (token == Token::SystemLiteral && !attrs.empty() && attrs.back().second == SIZE_MAX) {
+                size_t value = take();
+                Piece& p = pieces[value];
+                if (p.data != NULL) p.data++; else p.offset++;
+                p.size -= 2;
+                attrs.back().second = value;
+                continue;
+            }
+            skip(); // whitespace, '=' and whatever we do not understand
+        }
+
+        for (auto& a : attrs) {
+            attributes.push_back({ view(a.first), a.second == SIZE_MAX ? std::string_view() : view(a.second) });
+        }
+        std::string_view elementName = name == SIZE_MAX ? std::string_view() : view(name);
+        SaxAttributes attributeRange(attributes.data(), attributes.data() + attributes.size());
+
+        handler.startElement(loc, elementName, attributeRange);
+        if (selfClosing)
+            handler.endElement(loc, elementName);
+    }
+
+    void SaxReader::readEndTag(SaxHandler& handler) {
+        SaxLocation loc;
+        startEvent(loc);
+
+        lexer.eatToken(); // </
+        size_t name = SIZE_MAX;
+        if (Lexer::isIdentifier(lexer.peekToken()))
+            name = take();
+
+        while (!lexer.Done()) {
+            Token token = lexer.peekToken();
+            if (token == Token::TagEnd) {
+                skip();
+                break;
+            }
+            if (lexer.isTagStart(token) || token == Token::Comment || token == Token::CDSect) {
+                lexer.cancelInTag();
+                break;
+            }
+            skip();
+        }
+
+        handler.endElement(loc, name == SIZE_MAX ? std::string_view() : view(name));
+    }
+
+    void SaxReader::readProcessingInstruction(SaxHandler& handler) {
+        SaxLocation loc;
+        startEvent(loc);
+
+        lexer.eatToken(); // <?
+        size_t target = SIZE_MAX;
+        if (Lexer::isIdentifier(lexer.peekToken()))
+            target = take();
+
+        bool found = lexer.readUntil("?>", true);
+        size_t data = take();
+        lexer.cancelInTag();
+
+        std::string_view dataView = view(data);
+        if (found)
+            dataView.remove_suffix(2);
+        while (!dataView.empty() && (Lexer::isWhitespace(dataView.front()) || Lexer::isLinebreak(dataView.front())))
+            dataView.remove_prefix(1);
+        while (!dataView.empty() && (Lexer::isWhitespace(dataView.back()) || Lexer::isLinebreak(dataView.back())))
+            dataView.remove_suffix(1);
+
+        handler.processingInstruction(loc, target == SIZE_MAX ? std::string_view() : view(target), dataView);
+    }
+
+    void SaxReader::readDeclaration(SaxHandler& handler) {
+        SaxLocation loc;
+        startEvent(loc);
+
+        lexer.eatToken(); // <!
+        bool found = lexer.readDeclaration();
+        size_t content = take();
+        lexer.cancelInTag();
+
+        std::string_view contentView = view(content);
+        if (found)
+            contentView.remove_suffix(1);
+
+        handler.doctype(loc, contentView);
+    }
+
+    bool SaxReader::Parse(SaxHandler& handler) {
+        lexer.parms.registerLinebreaks = false;
+        lexer.parms.trackPosition = parms.trackPosition;
+        lexer.parms.deferPosition = parms.trackPosition;
+
+        while (!lexer.Done()) {
+            Token token = lexer.peekToken();
+            switch (token) {
+            case Token::TagStart:
+                readStartTag(handler);
+                break;
+            case Token::ClosingTag:
+                readEndTag(handler);
+                break;
+            case Token::ProcessingInstructionStart:
+                readProcessingInstruction(handler);
+                break;
+            case Token::DeclStart:
+                readDeclaration(handler);
+                break;
+            case Token::Comment:
+            case Token::CDSect: {
+                SaxLocation loc;
+                startEvent(loc);
+                std::string_view data = view(take());
+                if (token == Token::Comment)
+                    handler.comment(loc, trimDelimiters(data, 4, "-->"));
+                else
+                    handler.cdata(loc, trimDelimiters(data, 9, "]]>"));
+                break;
+            }
+            case Token::Text:
+            case Token::Whitespace:
+            case Token::Linebreak: {
+                if (lexer.tokenSize() == 0) { // end of the input
+                    lexer.readChar();
+                    break;
+                }
+                if (token != Token::Text && parms.skipWhitespaceText) {
+                    lexer.eatToken();
+                    break;
+                }
+                SaxLocation loc;
+                startEvent(loc);
+                handler.text(loc, view(take()));
+                break;
+            }
+            default:
+                if (lexer.tokenSize() == 0)
+                    lexer.readChar();
+                else
+                    lexer.eatToken();
+                break;
+            }
+
+            if (handler.stopRequested())
+                return false;
+        }
+        return true;
+    }
+}
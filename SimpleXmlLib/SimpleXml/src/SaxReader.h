@@ -0,0 +1,116 @@
+#ifndef SAXREADER_HEADER_FILE_H
+#define SAXREADER_HEADER_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Lexer.h"
+#include "XMLAttribute.h"
+
+namespace SimpleXml {
+
+    // Where an event starts in the input
+    struct SaxLocation {
+        size_t offset = 0;  // byte offset
+        size_t line = 0;    // 1 based, 0 when position tracking is off
+        size_t column = 0;  // 1 based, 0 when position tracking is off
+    };
+
+    // Attributes of a start tag. Values are raw: quotes are removed, entities are not expanded.
+    class SaxAttributes {
+        const XMLAttribute* _begin = NULL;
+        const XMLAttribute* _end = NULL;
+    public:
+        SaxAttributes() {}
+        SaxAttributes(const XMLAttribute* begin, const XMLAttribute* end) : _begin(begin), _end(end) {}
+
+        const XMLAttribute* begin() const { return _begin; }
+        const XMLAttribute* end() const { return _end; }
+        size_t size() const { return _end - _begin; }
+        bool empty() const { return _begin == _end; }
+        const XMLAttribute& operator[](size_t idx) const { return _begin[idx]; }
+
+        // returns NULL when the attribute is not present
+        const XMLAttribute* find(std::string_view name) const {
+            for (auto it = _begin; it != _end; ++it) {
+                if (it->name == name)
+                    return it;
+            }
+            return NULL;
+        }
+    };
+
+    /*
+    * Receives the events of a SaxReader. All string_views are only valid during the call:
+    * they point either into the input chunk or into a scratch buffer that is reused.
+    */
+    class SaxHandler {
+    public:
+        virtual ~SaxHandler() {}
+
+        virtual void startElement(const SaxLocation& /*loc*/, std::string_view /*name*/, const SaxAttributes& /*attributes*/) {}
+        virtual void endElement(const SaxLocation& /*loc*/, std::string_view /*name*/) {}
+        // character data between tags, whitespace included
+        virtual void text(const SaxLocation& /*loc*/, std::string_view /*text*/) {}
+        virtual void comment(const SaxLocation& /*loc*/, std::string_view /*text*/) {}
+        virtual void cdata(const SaxLocation& /*loc*/, std::string_view /*text*/) {}
+        virtual void processingInstruction(const SaxLocation& /*loc*/, std::string_view /*target*/, std::string_view /*data*/) {}
+        // declaration content between "<!" and ">", for instance: DOCTYPE note SYSTEM "note.dtd"
+        virtual void doctype(const SaxLocation& /*loc*/, std::string_view /*content*/) {}
+
+        // return true to stop reading after the current event
+        virtual bool stopRequested() { return false; }
+    };
+
+    /*
+    * Event driven reader on top of the Lexer. Memory use does not depend on the input size:
+    * only the tokens of the current event are kept.
+    * A self closing tag <a/> produces startElement followed by endElement.
+    */
+    class SaxReader {
+        // piece of token data, either still in the active chunk (data != NULL) or copied into scratch
+        struct Piece {
+            const char* data;
+            size_t offset;
+            size_t size;
+        };
+
+        ChunkedStream* inputStream;
+        Lexer lexer;
+
+        std::string scratch;
+        bool spilled = false;
+        std::vector<Piece> pieces;
+        std::vector<XMLAttribute> attributes;
+        std::vector<std::pair<size_t, size_t>> attributePieces;
+
+        void startEvent(SaxLocation& loc);
+        size_t take();
+        void skip();
+        void spill();
+        std::string_view view(size_t idx);
+
+        void readStartTag(SaxHandler& handler);
+        void readEndTag(SaxHandler& handler);
+        void readProcessingInstruction(SaxHandler& handler);
+        void readDeclaration(SaxHandler& handler);
+    public:
+        struct Parms {
+            // report line/column of the events
+            bool trackPosition = false;
+            // do not report text that only contains whitespace and linebreaks
+            bool skipWhitespaceText = false;
+        }parms;
+
+        SaxReader(ChunkedStream& s);
+
+        SaxReader(const SaxReader&) = delete;
+        SaxReader& operator=(const SaxReader&) = delete;
+
+        // reads the whole input (or until the handler requests to stop); returns false if stopped
+        bool Parse(SaxHandler& handler);
+    };
+}
+
+#endif
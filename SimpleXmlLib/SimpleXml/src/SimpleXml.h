@@ -3,6 +3,9 @@
 
 
 #include "PrettyPrinter.h"
+#include "SaxReader.h"
+#include "CompressedInput.h"
+#include "Checker.h"
 
 namespace SimpleXml {
 
@@ -0,0 +1,43 @@
+#ifndef SPSCRING_HEADER_FILE_H
+#define SPSCRING_HEADER_FILE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace SimpleXml {
+
+    /*
+    * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+    * Size must be a power of two.
+    */
+    template <typename T, size_t Size>
+    class SpscRing {
+        static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+        T items[Size];
+        alignas(64) std::atomic<size_t> head{ 0 }; // next slot to read, written by the consumer
+        alignas(64) std::atomic<size_t> tail{ 0 }; // next slot to write, written by the producer
+    public:
+        // producer side; returns false when the ring is full
+        bool tryPush(const T& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == Size)
+                return false;
+            items[t & (Size - 1)] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side; returns false when the ring is empty
+        bool tryPop(T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+            item = items[h & (Size - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+    };
+}
+
+#endif
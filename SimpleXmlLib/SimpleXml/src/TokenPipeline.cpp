@@ -0,0 +1,239 @@
+#include "TokenPipeline.h"
+
+namespace SimpleXml {
+
+    TokenScanner::TokenScanner(ChunkedStream& s, bool registerLinebreaks) : inputStream(&s), lexer(s) {
+        lexer.parms.registerLinebreaks = registerLinebreaks;
+        inputStream->onRetire = [this](ChunkedStream::buf b) {
+            filling->retired.push_back(b);
+        };
+    }
+
+    TokenScanner::~TokenScanner() {
+        inputStream->onRetire = NULL;
+    }
+
+    void TokenScanner::release(TokenBatch& batch) {
+        for (auto& b : batch.retired) {
+            inputStream->recycle(b);
+        }
+        batch.retired.clear();
+    }
+
+    // records the current lexer token and consumes it
+    std::string_view TokenScanner::emit(Token kind, unsigned char flags) {
+        TokenDescriptor d = { kind, flags, inputStream->offset(), lexer.tokenSize(), NULL };
+        std::string_view ret;
+        if (lexer.Done()) {
+            // the lexer still reports a token at the end of the input; it has no data
+            d.flags |= TokenDescriptor::AtEnd;
+            d.length = 0;
+            d.data = "";
+            lexer.eatToken();
+        }
+        else if (!lexer.isBroken()) {
+            d.data = lexer.tokenStart();
+            ret = std::string_view(d.data, d.length);
+            lexer.eatToken();
+        }
+        else {
+            auto& spill = filling->spill;
+            size_t offset = spill.size();
+            spill.resize(offset + d.length);
+            lexer.readTokenData(&spill[offset]);
+            filling->spilled.push_back({ filling->tokens.size(), offset });
+            ret = std::string_view(spill.data() + offset, d.length);
+        }
+        filling->tokens.push_back(d);
+        return ret;
+    }
+
+    void TokenScanner::emitEnd() {
+        TokenDescriptor d = { lexer.peekToken(), TokenDescriptor::End, inputStream->offset(), 0, "" };
+        filling->tokens.push_back(d);
+        filling->last = true;
+    }
+
+    void TokenScanner::step() {
+        switch (state) {
+        case State::Normal: {
+            if (lexer.Done()) {
+                emitEnd();
+                break;
+            }
+            Token token = lexer.peekToken();
+            emit(token, 0);
+            if (token == Token::ProcessingInstructionStart)
+                state = State::PITarget;
+            else if (token == Token::DeclStart)
+                state = State::Declaration;
+            break;
+        }
+        case State::PITarget: {
+            Token token = lexer.peekToken();
+            state = State::PIData;
+            if (lexer.isIdentifier(token)) {
+                if (emit(token, 0) == "xml")
+                    state = State::PIAttributes;
+            }
+            break;
+        }
+        case State::PIAttributes: {
+            // mirrors PrettyPrinter::ParseAttributes followed by the optional "?>"
+            Token token = lexer.peekToken();
+            switch (token) {
+            case Token::Name:
+            case Token::Nmtoken:
+            case Token::Eq:
+            case Token::SystemLiteral:
+            case Token::Whitespace:
+            case Token::Linebreak:
+                emit(token, 0);
+                break;
+            case Token::ProcessingInstructionEnd:
+                emit(token, 0);
+                lexer.cancelInTag();
+                state = State::Normal;
+                break;
+            default:
+                if (lexer.Done()) {
+                    // the printer sees this token before it leaves the tag
+                    emitEnd();
+                    break;
+                }
+                // the token is lexed again outside of the tag
+                lexer.cancelInTag();
+                state = State::Normal;
+                break;
+            }
+            break;
+        }
+        case State::PIData:
+            lexer.readUntil("?>", true);
+            emit(Token::Unknown, 0);
+            lexer.cancelInTag();
+            state = State::Normal;
+            break;
+        case State::Declaration: {
+            bool found = lexer.readUntilTagEndOrStart();
+            emit(Token::Unknown, found ? TokenDescriptor::Found : 0);
+            state = State::Normal;
+            if (found) {
+                if (lexer.peekChar() == '<')
+                    lexer.cancelInTag();
+                else
+                    state = State::DeclarationEnd;
+            }
+            break;
+        }
+        case State::DeclarationEnd: {
+            TokenDescriptor d = { Token::TagEnd, TokenDescriptor::DeclarationEnd, inputStream->offset(), 1, ">" };
+            filling->tokens.push_back(d);
+            lexer.readChar();
+            lexer.cancelInTag();
+            state = State::Normal;
+            break;
+        }
+        }
+    }
+
+    void TokenScanner::fill(TokenBatch& batch, size_t maxTokens) {
+        filling = &batch;
+        batch.tokens.clear();
+        batch.spill.clear();
+        batch.spilled.clear();
+
+        while (batch.tokens.size() < maxTokens && !batch.last) {
+            step();
+        }
+
+        // the spill buffer does not move anymore
+        for (auto& s : batch.spilled) {
+            batch.tokens[s.first].data = batch.spill.data() + s.second;
+        }
+    }
+
+    TokenReader::~TokenReader() {
+        finish();
+    }
+
+    void TokenReader::start(bool usePipeline) {
+        pipelined = usePipeline;
+        pos = 0;
+        peeked = false;
+
+        if (!pipelined) {
+            batch = &batches[0];
+            scanner.fill(*batch, BatchTokens);
+            return;
+        }
+
+        for (size_t i = 1; i < BatchCount; i++) {
+            freeBatches.tryPush(&batches[i]);
+        }
+        stopProducer = false;
+        producerFailed = false;
+        producer = std::thread(&TokenReader::produce, this);
+
+        // start with an empty batch, the first peek fetches the first real one
+        batch = &batches[0];
+        batch->tokens.clear();
+    }
+
+    void TokenReader::produce() {
+        try {
+            while (true) {
+                TokenBatch* b = NULL;
+                waitFor([this, &b]() { return stopProducer || freeBatches.tryPop(b); });
+                if (b == NULL)
+                    return;
+                scanner.release(*b);
+                scanner.fill(*b, BatchTokens);
+
+                // there is a slot for every batch
+                fullBatches.tryPush(b);
+                signal();
+                if (b->last)
+                    return;
+            }
+        }
+        catch (...) {
+            producerError = std::current_exception();
+            producerFailed = true;
+            signal();
+        }
+    }
+
+    void TokenReader::nextBatch() {
+        if (!pipelined) {
+            scanner.release(*batch);
+            scanner.fill(*batch, BatchTokens);
+            pos = 0;
+            return;
+        }
+
+        TokenBatch* b = NULL;
+        waitFor([this, &b]() { return fullBatches.tryPop(b) || producerFailed; });
+        if (b == NULL) {
+            finish();
+            std::rethrow_exception(producerError);
+        }
+        // there is a slot for every batch
+        freeBatches.tryPush(batch);
+        signal();
+        batch = b;
+        pos = 0;
+    }
+
+    void TokenReader::finish() {
+        if (producer.joinable()) {
+            stopProducer = true;
+            signal();
+            producer.join();
+        }
+        // nobody looks at the batches anymore
+        for (auto& b : batches) {
+            scanner.release(b);
+        }
+    }
+}
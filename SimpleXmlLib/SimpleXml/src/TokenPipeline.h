@@ -0,0 +1,190 @@
+#ifndef TOKENPIPELINE_HEADER_FILE_H
+#define TOKENPIPELINE_HEADER_FILE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Lexer.h"
+#include "SpscRing.h"
+
+namespace SimpleXml {
+
+    struct TokenDescriptor {
+        enum Flags : unsigned char {
+            End = 1,                // end of input; kind is what the lexer reports there
+            AtEnd = 2,              // token without data, peeked when the input was already exhausted
+            Found = 4,              // readUntilTagEndOrStart found the end of the declaration
+            DeclarationEnd = 8      // the '>' closing a declaration
+        };
+
+        Token kind;
+        unsigned char flags;
+        size_t offset;              // stream offset of the token
+        size_t length;
+        const char* data;           // into a chunk of the stream, or into the spill buffer of the batch
+    };
+
+    struct TokenBatch {
+        std::vector<TokenDescriptor> tokens;
+        std::string spill;          // data of tokens spanning chunks
+        std::vector<std::pair<size_t, size_t>> spilled;     // token index, offset in spill
+        std::vector<ChunkedStream::buf> retired;            // chunks left while filling this batch
+        bool last = false;
+    };
+
+    /*
+    * Runs the lexer the way the PrettyPrinter drives it and records the tokens. Besides plain
+    * peek/eat this replays the few places where the printer steers the lexer: the rest of a
+    * processing instruction, the attributes of <?xml ...?> and the body of a <!...> declaration.
+    */
+    class TokenScanner {
+        enum class State { Normal, PITarget, PIAttributes, PIData, Declaration, DeclarationEnd };
+
+        ChunkedStream* inputStream;
+        Lexer lexer;
+        State state = State::Normal;
+        TokenBatch* filling = NULL;
+
+        std::string_view emit(Token kind, unsigned char flags);
+        void emitEnd();
+        void step();
+    public:
+        TokenScanner(ChunkedStream& s, bool registerLinebreaks);
+        ~TokenScanner();
+
+        TokenScanner(const TokenScanner&) = delete;
+        TokenScanner& operator=(const TokenScanner&) = delete;
+
+        // gives the chunks retired by a batch back to the stream; the batch data must not be used anymore
+        void release(TokenBatch& batch);
+
+        // replaces the content of the batch with up to maxTokens tokens; the last batch ends with an End token
+        void fill(TokenBatch& batch, size_t maxTokens);
+    };
+
+    /*
+    * Token source of the PrettyPrinter, with the same peek/eat semantics as the Lexer.
+    * Inline mode fills the batches on demand. Pipelined mode fills them on a producer thread and
+    * hands them over through a ring; chunks are recycled once the consumer has released the batch
+    * that saw them leave. A side finding its ring empty retries a few times, then sleeps until the
+    * other side hands a batch over, so that a stalled reader or printer does not burn a core.
+    */
+    class TokenReader {
+        static const size_t BatchTokens = 512;
+        static const size_t BatchCount = 8;
+        static const int SpinCount = 64;
+
+        TokenScanner scanner;
+        TokenBatch batches[BatchCount];
+
+        TokenBatch* batch = NULL;
+        size_t pos = 0;
+        bool peeked = false;
+
+        bool pipelined = false;
+        std::thread producer;
+        SpscRing<TokenBatch*, BatchCount> fullBatches;
+        SpscRing<TokenBatch*, BatchCount> freeBatches;
+        std::atomic<bool> stopProducer{ false };
+        std::atomic<bool> producerFailed{ false };
+        std::exception_ptr producerError;
+        std::mutex handOver;
+        std::condition_variable handedOver;
+
+        // waits until ready() holds: a bounded spin, then blocks until the other side signals
+        template <class Ready>
+        void waitFor(Ready ready) {
+            for (int i = 0; i < SpinCount; i++) {
+                if (ready())
+                    return;
+                std::this_thread::yield();
+            }
+            std::unique_lock<std::mutex> lock(handOver);
+            handedOver.wait(lock, ready);
+        }
+        // wakes the other side after a batch was pushed or a flag set; taking the lock orders it
+        // with a waiter that checked its condition just before blocking
+        void signal() {
+            std::lock_guard<std::mutex> lock(handOver);
+            handedOver.notify_all();
+        }
+
+        void produce();
+        void nextBatch();
+
+        inline const TokenDescriptor& current() {
+            if (!peeked) {
+                if (pos == batch->tokens.size())
+                    nextBatch();
+                peeked = true;
+            }
+            return batch->tokens[pos];
+        }
+    public:
+        TokenReader(ChunkedStream& s, bool registerLinebreaks) : scanner(s, registerLinebreaks) {}
+        ~TokenReader();
+
+        TokenReader(const TokenReader&) = delete;
+        TokenReader& operator=(const TokenReader&) = delete;
+
+        void start(bool usePipeline);
+        // stops the producer and gives all chunks back to the stream
+        void finish();
+
+        // same answer as Lexer::Done() at this point of the input
+        bool Done() {
+            if (peeked)
+                return (batch->tokens[pos].flags & (TokenDescriptor::End | TokenDescriptor::AtEnd)) != 0;
+            if (pos == batch->tokens.size())
+                nextBatch();
+            return (batch->tokens[pos].flags & TokenDescriptor::End) != 0;
+        }
+
+        Token peekToken() {
+            return current().kind;
+        }
+
+        void eatToken() {
+            if (peeked) {
+                if (!(batch->tokens[pos].flags & TokenDescriptor::End))
+                    pos++;
+                peeked = false;
+            }
+        }
+
+        bool tokenFound() {
+            return (current().flags & TokenDescriptor::Found) != 0;
+        }
+
+        // consumes the current token; the view is valid until the next token is peeked
+        std::string_view tokenView() {
+            auto& d = current();
+            std::string_view ret(d.data, d.length);
+            eatToken();
+            return ret;
+        }
+
+        void writeTokenData(OutputSink& out) {
+            auto& d = current();
+            if (d.length > 0)
+                out.write(d.data, d.length);
+            eatToken();
+        }
+
+        // consumes the '>' of a declaration when there is one
+        bool readDeclarationEnd() {
+            if (current().flags & TokenDescriptor::DeclarationEnd) {
+                eatToken();
+                return true;
+            }
+            return false;
+        }
+    };
+}
+
+#endif
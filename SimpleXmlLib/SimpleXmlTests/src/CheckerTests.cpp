@@ -0,0 +1,119 @@
+#include <functional>
+#include <algorithm>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "Checker.h"
+#include "EmbeddedResources.h"
+
+using namespace SimpleXml;
+
+namespace {
+    // one "line:column message" entry per line
+    std::string check(const std::string& in, size_t chunkSize = 0, size_t maxErrors = 100) {
+        std::function chunker = [&in](size_t offset, char* target, size_t len) {
+            if (offset >= in.size())
+                return (size_t)0;
+            len = std::min(len, in.size() - offset);
+            memcpy(target, in.c_str() + offset, len);
+            return len;
+        };
+        ChunkedStream chunked(chunkSize, chunker);
+        ChunkedStream whole(in.c_str(), in.size());
+
+        ErrorList errors;
+        Checker checker(chunkSize ? chunked : whole, errors);
+        checker.parms.maxErrors = maxErrors;
+        bool ok = checker.Check();
+        EXPECT_EQ(ok, errors.empty());
+        EXPECT_EQ(checker.errorCount(), errors.size());
+
+        std::stringstream log;
+        for (auto& e : errors)
+            log << e.line << ":" << e.column << " " << e.message << "\n";
+        return log.str();
+    }
+
+    TEST(Checker, WellFormed) {
+        ASSERT_EQ(check("<?xml version=\"1.0\"?>\n<!DOCTYPE a [<!ELEMENT a ANY>]>\n<a x=\"1\" y='2'>text<b/><!-- c --><![CDATA[<raw>]]><?pi data?></a>\n"), "");
+        ASSERT_EQ(check(LoadEmbeddedResourceText(RC_test_pp_FullTest_in)), "");
+    }
+
+    TEST(Checker, Nesting) {
+        ASSERT_EQ(check("<a>\n  <b>\n</a>"), "2:3 element <b> is not closed before </a>\n");
+        ASSERT_EQ(check("<a></b></a>"), "1:4 end tag </b> does not match <a>\n");
+        ASSERT_EQ(check("<a/></a>"), "1:5 end tag </a> without start tag\n");
+        ASSERT_EQ(check("<a>\n<b>"), "2:1 element <b> is not closed\n1:1 element <a> is not closed\n");
+        ASSERT_EQ(check("<a/><b/>"), "1:5 more than one root element, found <b>\n");
+        ASSERT_EQ(check(""), "1:1 no root element\n");
+    }
+
+    TEST(Checker, Tags) {
+        ASSERT_EQ(check("<a x='1' x='2'/>"), "1:10 duplicate attribute 'x' in <a>\n");
+        ASSERT_EQ(check("<a x/>"), "1:5 attribute 'x' has no value\n");
+        ASSERT_EQ(check("<a x=1/>"), "1:6 value of attribute 'x' is not quoted\n");
+        ASSERT_EQ(check("<a x=/>"), "1:6 missing value of attribute 'x'\n");
+        ASSERT_EQ(check("<a x='1/>"), "1:6 unterminated attribute value in <a>\n1:1 element <a> is not closed\n");
+        ASSERT_EQ(check("<a><b</a>"), "1:6 missing '>' after <b\n1:4 element <b> is not closed before </a>\n");
+        ASSERT_EQ(check("<a>< b/></a>"), "1:4 missing element name after '<'\n");
+        ASSERT_EQ(check("<a></a"), "1:4 end tag </a is not closed\n");
+    }
+
+    TEST(Checker, Markup) {
+        ASSERT_EQ(check("<a><!-- open</a>"), "1:4 comment is not closed\n1:1 element <a> is not closed\n");
+        ASSERT_EQ(check("<a><![CDATA[ open</a>"), "1:4 CDATA section is not closed\n1:1 element <a> is not closed\n");
+        ASSERT_EQ(check("<a/><?pi open"), "1:5 processing instruction is not closed\n");
+        ASSERT_EQ(check("<a/>\n<?xml version='1.0'?>"), "2:1 XML declaration is only allowed at the start of the document\n");
+        ASSERT_EQ(check("text<a/>tail"), "1:1 text before the root element\n1:9 text after the root element\n");
+        ASSERT_EQ(check("<a><!DOCTYPE a></a>"), "1:4 declaration inside of an element\n");
+    }
+
+    TEST(Checker, Recovery) {
+        // every broken line is reported on its own
+        std::string in =
+            "<root>\n"
+            "<a x=1>\n"
+            "<b></c>\n"
+            "<d y='1' y='2'/>\n"
+            "</root>\n";
+        ASSERT_EQ(check(in),
+            "2:6 value of attribute 'x' is not quoted\n"
+            "3:4 end tag </c> does not match <b>\n"
+            "4:10 duplicate attribute 'y' in <d>\n"
+            "3:1 element <b> is not closed before </root>\n"
+            "2:1 element <a> is not closed before </root>\n");
+    }
+
+    TEST(Checker, MaxErrors) {
+        std::string in = "<a>";
+        for (int i = 0; i < 50; i++)
+            in += "</b>";
+        in += "</a>";
+
+        std::string all = check(in, 0, 0);
+        ASSERT_EQ(std::count(all.begin(), all.end(), '\n'), 50);
+
+        std::string capped = check(in, 0, 10);
+        ASSERT_EQ(std::count(capped.begin(), capped.end(), '\n'), 10);
+        ASSERT_EQ(capped, all.substr(0, capped.size()));
+    }
+
+    TEST(Checker, ChunkedInput) {
+        std::string in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in) + "<x a='1' a='2'><!-- <y> --></z>\n<p x=1>";
+        auto reference = check(in);
+        ASSERT_FALSE(reference.empty());
+
+        for (size_t chunkSize : { 1, 2, 3, 7, 13, 64 }) {
+            ASSERT_EQ(reference, check(in, chunkSize)) << "chunk size " << chunkSize;
+        }
+    }
+    TEST(Checker, ByteOrderMark) {
+        const std::string bom = "\xEF\xBB\xBF";
+        ASSERT_EQ(check(bom + "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<a/>\n"), "");
+        for (size_t chunkSize : { 0, 1, 2, 64 }) {
+            ASSERT_EQ(check(bom + "<a x='1' x='2'/>", chunkSize), "1:10 duplicate attribute 'x' in <a>\n") << "chunk size " << chunkSize;
+        }
+        // only the first bytes of the document are a byte order mark
+        ASSERT_EQ(check("<a/>" + bom), "1:5 text after the root element\n");
+    }
+}
@@ -0,0 +1,148 @@
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+
+#ifdef SIMPLEXML_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SIMPLEXML_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#include "gtest/gtest.h"
+#include "CompressedInput.h"
+#include "PrettyPrinter.h"
+#include "EmbeddedResources.h"
+
+using namespace SimpleXml;
+
+namespace {
+    std::string tempFile(const char* name, const std::string& content) {
+        auto path = (fs::temp_directory_path() / name).string();
+        std::ofstream f(path, std::ios::binary);
+        f.write(content.data(), content.size());
+        return path;
+    }
+
+    std::string prettyPrint(ChunkedStream& stream) {
+        PrettyPrintParms parms;
+        parms.eol = "\n";
+        parms.tab = "\t";
+        parms.insertIndents = true;
+        parms.insertNewLines = true;
+        parms.removeWhitespace = true;
+
+        PrettyPrinter prettyPrinter(stream, parms);
+        prettyPrinter.Convert();
+        return prettyPrinter.Text();
+    }
+
+    std::string prettyPrintFile(const std::string& path, CompressedChunkProvider::Parms parms, CompressedChunkProvider::Format expected) {
+        CompressedChunkProvider provider(path, parms);
+        EXPECT_EQ(provider.format(), expected);
+        std::function<size_t(size_t, char*, size_t)> chunker = provider;
+        ChunkedStream stream(1000, chunker);
+        return prettyPrint(stream);
+    }
+
+    std::string referenceOutput(const std::string& in) {
+        ChunkedStream stream(in.c_str(), in.size());
+        return prettyPrint(stream);
+    }
+
+    CompressedChunkProvider::Parms smallBlocks(bool prefetch) {
+        CompressedChunkProvider::Parms parms;
+        parms.prefetch = prefetch;
+        parms.blockSize = 17;
+        parms.blockCount = 2;
+        return parms;
+    }
+
+    TEST(CompressedInput, Plain) {
+        auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+        auto path = tempFile("simplexml_plain.xml", in);
+        auto expected = referenceOutput(in);
+
+        ASSERT_EQ(prettyPrintFile(path, CompressedChunkProvider::Parms(), CompressedChunkProvider::Format::Plain), expected);
+        ASSERT_EQ(prettyPrintFile(path, smallBlocks(true), CompressedChunkProvider::Format::Plain), expected);
+        ASSERT_EQ(prettyPrintFile(path, smallBlocks(false), CompressedChunkProvider::Format::Plain), expected);
+        fs::remove(path);
+    }
+
+    TEST(CompressedInput, Errors) {
+        ASSERT_THROW(CompressedChunkProvider("/this/file/does/not/exist.xml.gz"), std::runtime_error);
+
+        auto path = tempFile("simplexml_seq.xml", "<a/>");
+        CompressedChunkProvider provider(path);
+        char buf[8];
+        ASSERT_THROW(provider(2, buf, sizeof(buf)), std::runtime_error);
+        ASSERT_EQ(provider(0, buf, sizeof(buf)), 4);
+        ASSERT_EQ(provider(4, buf, sizeof(buf)), 0);
+        fs::remove(path);
+    }
+
+#ifdef SIMPLEXML_WITH_ZLIB
+    std::string gzip(const std::string& in) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        std::string out(deflateBound(&zs, (uLong)in.size()), '\0');
+        zs.next_in = (Bytef*)in.data();
+        zs.avail_in = (uInt)in.size();
+        zs.next_out = (Bytef*)&out[0];
+        zs.avail_out = (uInt)out.size();
+        deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return out;
+    }
+
+    TEST(CompressedInput, Gzip) {
+        auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+        auto path = tempFile("simplexml_test.xml.gz", gzip(in));
+        auto expected = referenceOutput(in);
+
+        ASSERT_EQ(prettyPrintFile(path, CompressedChunkProvider::Parms(), CompressedChunkProvider::Format::Gzip), expected);
+        ASSERT_EQ(prettyPrintFile(path, smallBlocks(true), CompressedChunkProvider::Format::Gzip), expected);
+        ASSERT_EQ(prettyPrintFile(path, smallBlocks(false), CompressedChunkProvider::Format::Gzip), expected);
+        fs::remove(path);
+    }
+
+    TEST(CompressedInput, GzipMultipleMembers) {
+        std::string first = "<root><a>1</a>";
+        std::string second = "<b>2</b></root>";
+        auto path = tempFile("simplexml_members.xml.gz", gzip(first) + gzip(second));
+        ASSERT_EQ(prettyPrintFile(path, smallBlocks(true), CompressedChunkProvider::Format::Gzip), referenceOutput(first + second));
+        fs::remove(path);
+    }
+
+    TEST(CompressedInput, GzipTruncated) {
+        auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+        auto compressed = gzip(in);
+        auto path = tempFile("simplexml_truncated.xml.gz", compressed.substr(0, compressed.size() / 2));
+        ASSERT_THROW(prettyPrintFile(path, CompressedChunkProvider::Parms(), CompressedChunkProvider::Format::Gzip), std::runtime_error);
+        fs::remove(path);
+    }
+#else
+    TEST(CompressedInput, GzipNotSupported) {
+        ASSERT_FALSE(CompressedChunkProvider::supported(CompressedChunkProvider::Format::Gzip));
+    }
+#endif
+
+#ifdef SIMPLEXML_WITH_ZSTD
+    TEST(CompressedInput, Zstd) {
+        auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+        std::string compressed(ZSTD_compressBound(in.size()), '\0');
+        compressed.resize(ZSTD_compress(&compressed[0], compressed.size(), in.data(), in.size(), 3));
+        auto path = tempFile("simplexml_test.xml.zst", compressed);
+        auto expected = referenceOutput(in);
+
+        ASSERT_EQ(prettyPrintFile(path, CompressedChunkProvider::Parms(), CompressedChunkProvider::Format::Zstd), expected);
+        ASSERT_EQ(prettyPrintFile(path, smallBlocks(false), CompressedChunkProvider::Format::Zstd), expected);
+        fs::remove(path);
+    }
+#endif
+}
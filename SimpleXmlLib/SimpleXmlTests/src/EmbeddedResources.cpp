@@ -1,4 +1,6 @@
 #include "EmbeddedResources.h"
+
+#ifdef _WIN32
 #include <wtypes.h>
 
 std::string LoadEmbeddedResourceText(int assetId)
@@ -38,4 +40,43 @@ std::string LoadEmbeddedResourceText(int assetId)
     }
 
     return output;
-}
\ No newline at end of file
+}
+#else
+#include <fstream>
+#include <iterator>
+#include <map>
+
+// Without Win32 resources the test files are read from TESTFILES_DIR, with the names used in Resource.rc.
+std::string LoadEmbeddedResourceText(int assetId)
+{
+    static const std::map<int, const char*> files = {
+        { RC_test_pp_indent_input_1, "PrettyPrintIndentOnly/Test1.in.xml" },
+        { RC_test_pp_indent_output_1, "PrettyPrintIndentOnly/Test1.out.xml" },
+        { RC_test_pp_AutoCloseEmptyElement_in, "PrettyPrint/AutoCloseEmptyElement.in.xml" },
+        { RC_test_pp_AutoCloseEmptyElement_out, "PrettyPrint/AutoCloseEmptyElement.out.xml" },
+        { RC_test_pp_AutoCloseEmptyElement_child_in, "PrettyPrint/AutoCloseEmptyElement_child.in.xml" },
+        { RC_test_pp_AutoCloseEmptyElement_child_out, "PrettyPrint/AutoCloseEmptyElement_child.out.xml" },
+        { RC_test_pp_Comment_After_PI_in, "PrettyPrint/Comment_After_PI.in.xml" },
+        { RC_test_pp_Comment_After_PI_out, "PrettyPrint/Comment_After_PI.out.xml" },
+        { RC_test_pp_FullTest_in, "PrettyPrint/FullTest.in.xml" },
+        { RC_test_pp_FullTest_out, "PrettyPrint/FullTest.out.xml" },
+        { RC_test_pp_markupdecl_in, "PrettyPrint/markupdecl.in.xml" },
+        { RC_test_pp_markupdecl_out, "PrettyPrint/markupdecl.out.xml" },
+        { RC_test_pp_Test1_in, "PrettyPrint/Test1.in.xml" },
+        { RC_test_pp_Test1_out, "PrettyPrint/Test1.out.xml" },
+        { RC_test_pp_xmltag_not_closed_in, "PrettyPrint/xmltag_not_closed.in.xml" },
+        { RC_test_pp_xmltag_not_closed_out, "PrettyPrint/xmltag_not_closed.out.xml" },
+        { RC_test_pp_attributes_space_indented_in, "PrettyPrintIndentAttributes/space-indented.in.xml" },
+        { RC_test_pp_attributes_space_indented_out, "PrettyPrintIndentAttributes/space-indented.out.xml" },
+        { RC_test_pp_attributes_tab_indented_in, "PrettyPrintIndentAttributes/tab-indented.in.xml" },
+        { RC_test_pp_attributes_tab_indented_out, "PrettyPrintIndentAttributes/tab-indented.out.xml" },
+    };
+
+    auto file = files.find(assetId);
+    if (file == files.end())
+        return std::string();
+
+    std::ifstream ifs(std::string(TESTFILES_DIR) + file->second, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+#endif
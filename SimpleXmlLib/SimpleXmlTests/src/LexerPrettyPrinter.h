@@ -0,0 +1,54 @@
+#ifndef LEXERPRETTYPRINTER_HEADER_FILE_H
+#define LEXERPRETTYPRINTER_HEADER_FILE_H
+
+#include <string>
+#include "Lexer.h"
+#include "OutputSink.h"
+#include "PrettyPrinter.h"
+
+namespace SimpleXmlReference {
+
+    // reference printer driving the Lexer directly, on the calling thread; parms.pipelined is ignored
+    class LexerPrettyPrinter {
+        SimpleXml::StringOutputSink outText;
+        SimpleXml::OutputSink* out;
+        SimpleXml::Lexer lexer;
+        SimpleXml::PrettyPrintParms parms;
+        bool converted = false;
+
+        bool inTag = false;
+        int indentlevel = 0;
+        bool indented = false;
+        bool tagIsOpen = false;
+
+        std::string prevTag;
+        std::string scratch;
+
+        inline void WriteCloseTag();
+        inline void TryCloseTag();
+        inline void Indent();
+        inline void TryIndent();
+        inline void AddNewline();
+        inline void StartNewElement();
+        inline void WriteToken();
+        inline void WriteEatToken();
+        void Parse();
+        bool ParseAttributes();
+
+        void trimTextAndOutput(std::string_view is);
+        std::string_view tokenView();
+    public:
+        LexerPrettyPrinter(SimpleXml::ChunkedStream& s, SimpleXml::PrettyPrintParms parms) :out(&outText), lexer(s), parms(parms) {
+            lexer.parms.registerLinebreaks = parms.keepExistingBreaks;
+        }
+
+        LexerPrettyPrinter(const LexerPrettyPrinter&) = delete;
+        LexerPrettyPrinter& operator=(const LexerPrettyPrinter&) = delete;
+
+        std::string& Text() { return outText.str(); }
+
+        bool Convert();
+    };
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <string>
+#include <functional>
+#include <algorithm>
 
 #include "Lexer.h"
 
@@ -548,4 +550,96 @@ TestLex(lex);
 		lex.readTokenData(name);
 		ASSERT_EQ(name, "5x");
 	}
+
+	// reference implementation of the position rules: \n starts a row, \r and utf-8 continuation bytes are not counted
+	void naivePosition(const std::string& txt, size_t len, size_t& row, size_t& col) {
+		row = 1;
+		col = 1;
+		for (size_t i = 0; i < len; i++) {
+			unsigned char c = (unsigned char)txt[i];
+			if (c == '\n') {
+				row++;
+				col = 1;
+			}
+			else if (c != '\r' && (c & 0xC0) != 0x80) {
+				col++;
+			}
+		}
+	}
+
+	std::string positionSample() {
+		std::string txt;
+		for (int i = 0; i < 200; i++) {
+			txt += "<elem attr=\"v\xC3\xA9\">text \xE2\x82\xAC " + std::to_string(i) + "</elem>";
+			txt += (i % 3 == 0) ? "\r\n" : (i % 3 == 1 ? "\n" : "   ");
+		}
+		return txt;
+	}
+
+	void TestPosition(ChunkedStream& s, const std::string& txt, bool deferPosition) {
+		Lexer lex(s);
+		lex.parms.trackPosition = true;
+		lex.parms.deferPosition = deferPosition;
+
+		size_t consumed = 0;
+		size_t row, col;
+		while (!lex.Done()) {
+			lex.peekToken();
+			consumed += lex.tokenSize();
+			lex.eatToken();
+
+			naivePosition(txt, consumed, row, col);
+			ASSERT_EQ(lex.currentLine(), row) << "offset " + std::to_string(consumed);
+			ASSERT_EQ(lex.currentColumn(), col) << "offset " + std::to_string(consumed);
+		}
+		ASSERT_EQ(consumed, txt.size());
+	}
+
+	TEST(Lexer, trackPosition) {
+		auto txt = positionSample();
+		ChunkedStream s(txt.c_str(), txt.size());
+		TestPosition(s, txt, false);
+	}
+
+	TEST(Lexer, trackPosition_deferred) {
+		auto txt = positionSample();
+		ChunkedStream s(txt.c_str(), txt.size());
+		TestPosition(s, txt, true);
+	}
+
+	TEST(Lexer, trackPosition_chunks) {
+		auto txt = positionSample();
+		for (bool deferPosition : { false, true }) {
+			std::function chunker = [&txt](size_t offset, char* target, size_t len) {
+				if (offset >= txt.size())
+					return (size_t)0;
+				len = std::min(len, txt.size() - offset);
+				memcpy(target, txt.c_str() + offset, len);
+				return len;
+			};
+			ChunkedStream s(37, chunker);
+			TestPosition(s, txt, deferPosition);
+		}
+	}
+
+	TEST(Lexer, trackPosition_readChar) {
+		// split, or the b would be read as part of the hex escape
+		const char* txt = "a\r\n\xC3\xA9" "b";
+		ChunkedStream s(txt);
+		auto lex = Lexer(s);
+		lex.parms.trackPosition = true;
+
+		lex.readChar();
+		lex.readChar();
+		lex.readChar();
+		ASSERT_EQ(lex.currentLine(), 2);
+		ASSERT_EQ(lex.currentColumn(), 1);
+		// the two bytes of \xC3\xA9 are one character
+		lex.readChar();
+		lex.readChar();
+		ASSERT_EQ(lex.currentColumn(), 2);
+		lex.readChar();
+		ASSERT_EQ(lex.currentLine(), 2);
+		ASSERT_EQ(lex.currentColumn(), 3);
+	}
 }
\ No newline at end of file
@@ -1,12 +1,17 @@
 #include <fstream>
 #include <filesystem>
 #include <functional>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 #include "gtest/gtest.h"
 #include "PrettyPrinter.h"
 #include "EmbeddedResources.h"
+#include "LexerPrettyPrinter.h"
 
 using namespace SimpleXml;
 
@@ -14,7 +19,7 @@ bool testPrettyPrint(PrettyPrintParms parms, std::string &input, std::string &ex
     ChunkedStream stream(input.c_str(), input.size());
     auto prettyPrinter = PrettyPrinter(stream, parms);
     prettyPrinter.Convert();
-    const std::string& output = prettyPrinter.Stream()->str();
+    const std::string& output = prettyPrinter.Text();
     return expectedOutput == output;
 }
 
@@ -154,3 +159,130 @@ TEST(PrettyPrint, xmltag_not_closed) {
     ASSERT_TRUE(testPrettyPrint(parmsDefault(),in, out));
 }
 
+TEST(PrettyPrint, ChunkedInput) {
+    auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+    auto parms = parmsDefault();
+
+    ChunkedStream whole(in.c_str(), in.size());
+    PrettyPrinter reference(whole, parms);
+    reference.Convert();
+
+    // tiny chunks make names, text and comments span several buffers
+    std::function chunker = [&in](size_t offset, char* target, size_t len) {
+        if (offset >= in.size())
+            return (size_t)0;
+        len = std::min(len, in.size() - offset);
+        memcpy(target, in.c_str() + offset, len);
+        return len;
+    };
+    ChunkedStream chunked(7, chunker);
+    PrettyPrinter prettyPrinter(chunked, parms);
+    prettyPrinter.Convert();
+
+    ASSERT_EQ(reference.Text(), prettyPrinter.Text());
+}
+
+TEST(PrettyPrint, StreamOutputSink) {
+    auto in = LoadEmbeddedResourceText(RC_test_pp_Test1_in);
+    auto out = LoadEmbeddedResourceText(RC_test_pp_Test1_out);
+
+    std::stringstream ss;
+    StreamOutputSink sink(ss);
+    ChunkedStream stream(in.c_str(), in.size());
+    PrettyPrinter prettyPrinter(stream, parmsDefault(), sink);
+    prettyPrinter.Convert();
+
+    ASSERT_EQ(ss.str(), out);
+    ASSERT_TRUE(prettyPrinter.Text().empty());
+}
+
+TEST(PrettyPrint, Pipelined) {
+    auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+
+    std::function chunker = [&in](size_t offset, char* target, size_t len) {
+        if (offset >= in.size())
+            return (size_t)0;
+        len = std::min(len, in.size() - offset);
+        memcpy(target, in.c_str() + offset, len);
+        return len;
+    };
+
+    for (auto parms : { parmsDefault(), parmsIndentAttribute(), parmsIndentOnly(), parmsIndentAttributeTab() }) {
+        ChunkedStream whole(in.c_str(), in.size());
+        PrettyPrinter reference(whole, parms);
+        reference.Convert();
+
+        parms.pipelined = true;
+        for (size_t chunkSize : { 0, 3, 64 }) {
+            ChunkedStream chunked(chunkSize, chunker);
+            ChunkedStream wholeAgain(in.c_str(), in.size());
+            PrettyPrinter prettyPrinter(chunkSize ? chunked : wholeAgain, parms);
+            prettyPrinter.Convert();
+
+            ASSERT_EQ(reference.Text(), prettyPrinter.Text()) << "chunk size " << chunkSize;
+        }
+    }
+}
+
+TEST(PrettyPrint, PipelinedProviderError) {
+    std::string in = "<a><b>text</b></a>";
+    std::function chunker = [&in](size_t offset, char* target, size_t len) {
+        if (offset >= 8)
+            throw std::runtime_error("read error");
+        len = std::min(len, in.size() - offset);
+        memcpy(target, in.c_str() + offset, len);
+        return len;
+    };
+    ChunkedStream chunked(4, chunker);
+    auto parms = parmsDefault();
+    parms.pipelined = true;
+    PrettyPrinter prettyPrinter(chunked, parms);
+    ASSERT_THROW(prettyPrinter.Convert(), std::runtime_error);
+}
+
+// output of a printer, or "throws" when it gave up
+template <class Printer>
+std::string printed(const std::string& in, size_t chunkSize, const PrettyPrintParms& parms) {
+    std::function chunker = [&in](size_t offset, char* target, size_t len) {
+        if (offset >= in.size())
+            return (size_t)0;
+        len = std::min(len, in.size() - offset);
+        memcpy(target, in.c_str() + offset, len);
+        return len;
+    };
+    ChunkedStream chunked(chunkSize, chunker);
+    ChunkedStream whole(in.c_str(), in.size());
+    Printer printer(chunkSize ? chunked : whole, parms);
+    try {
+        printer.Convert();
+    }
+    catch (const std::runtime_error&) {
+        return "throws";
+    }
+    return printer.Text();
+}
+
+TEST(PrettyPrint, MatchesLexerDrivenPrinter) {
+    std::vector<std::string> inputs;
+    for (int id : { RC_test_pp_indent_input_1, RC_test_pp_AutoCloseEmptyElement_in, RC_test_pp_AutoCloseEmptyElement_child_in,
+                    RC_test_pp_Comment_After_PI_in, RC_test_pp_FullTest_in, RC_test_pp_markupdecl_in, RC_test_pp_Test1_in,
+                    RC_test_pp_xmltag_not_closed_in, RC_test_pp_attributes_space_indented_in, RC_test_pp_attributes_tab_indented_in })
+        inputs.push_back(LoadEmbeddedResourceText(id));
+    // malformed and truncated inputs, where the printer steers the lexer the most
+    for (const char* malformed : { "<?xml version=\"1.0\"", "<?xml version='1.0' <a/>", "<?pi data", "<!DOCTYPE a [<!ELEMENT a ANY>",
+                                   "<!DOCTYPE a <b/>", "<a><b></c></a>", "<a x=\"1\" y", "</>", "<a>text<!-- c", "<![CDATA[ x", "<a/>\r\n\r\n<b>  t  </b>" })
+        inputs.push_back(malformed);
+
+    for (auto parms : { parmsDefault(), parmsIndentAttribute(), parmsIndentAttributeSpace(), parmsIndentOnly() }) {
+        for (const std::string& in : inputs) {
+            std::string reference = printed<SimpleXmlReference::LexerPrettyPrinter>(in, 0, parms);
+            for (bool pipelined : { false, true }) {
+                parms.pipelined = pipelined;
+                for (size_t chunkSize : { 0, 3, 64, 4096 }) {
+                    ASSERT_EQ(reference, printed<PrettyPrinter>(in, chunkSize, parms))
+                        << "chunk size " << chunkSize << (pipelined ? ", pipelined" : "") << ", input " << in.substr(0, 40);
+                }
+            }
+        }
+    }
+}
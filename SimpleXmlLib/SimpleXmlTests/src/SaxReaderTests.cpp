@@ -0,0 +1,169 @@
+#include <functional>
+#include <algorithm>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "SaxReader.h"
+#include "EmbeddedResources.h"
+
+using namespace SimpleXml;
+
+namespace {
+    // writes every event on its own line so that sequences can be compared as text
+    class RecordingHandler : public SaxHandler {
+    public:
+        std::stringstream log;
+        bool withLocation = false;
+        size_t stopAfter = SIZE_MAX;
+        size_t events = 0;
+
+        void location(const SaxLocation& loc) {
+            events++;
+            if (withLocation)
+                log << loc.offset << ":" << loc.line << ":" << loc.column << " ";
+        }
+
+        void startElement(const SaxLocation& loc, std::string_view name, const SaxAttributes& attributes) override {
+            location(loc);
+            log << "start " << name;
+            for (auto& a : attributes)
+                log << " " << a.name << "=[" << a.value << "]";
+            log << "\n";
+        }
+        void endElement(const SaxLocation& loc, std::string_view name) override {
+            location(loc);
+            log << "end " << name << "\n";
+        }
+        void text(const SaxLocation& loc, std::string_view text) override {
+            location(loc);
+            log << "text [" << text << "]\n";
+        }
+        void comment(const SaxLocation& loc, std::string_view text) override {
+            location(loc);
+            log << "comment [" << text << "]\n";
+        }
+        void cdata(const SaxLocation& loc, std::string_view text) override {
+            location(loc);
+            log << "cdata [" << text << "]\n";
+        }
+        void processingInstruction(const SaxLocation& loc, std::string_view target, std::string_view data) override {
+            location(loc);
+            log << "pi " << target << " [" << data << "]\n";
+        }
+        void doctype(const SaxLocation& loc, std::string_view content) override {
+            location(loc);
+            log << "doctype [" << content << "]\n";
+        }
+        bool stopRequested() override {
+            return events >= stopAfter;
+        }
+    };
+
+    std::string saxLog(const std::string& in, size_t chunkSize, bool withLocation) {
+        std::function chunker = [&in](size_t offset, char* target, size_t len) {
+            if (offset >= in.size())
+                return (size_t)0;
+            len = std::min(len, in.size() - offset);
+            memcpy(target, in.c_str() + offset, len);
+            return len;
+        };
+        ChunkedStream chunked(chunkSize, chunker);
+        ChunkedStream whole(in.c_str(), in.size());
+
+        SaxReader reader(chunkSize ? chunked : whole);
+        reader.parms.trackPosition = withLocation;
+        RecordingHandler handler;
+        handler.withLocation = withLocation;
+        reader.Parse(handler);
+        return handler.log.str();
+    }
+
+    TEST(SaxReader, Events) {
+        std::string in = "<?xml version=\"1.0\"?>\n<!DOCTYPE note [<!ELEMENT note (#PCDATA)> <!-- > -->]>"
+            "<a x=\"1\" y='two words'>text<b/><!-- remark --><![CDATA[<raw>]]></a>";
+        std::string expected =
+            "pi xml [version=\"1.0\"]\n"
+            "text [\n]\n"
+            "doctype [DOCTYPE note [<!ELEMENT note (#PCDATA)> <!-- > -->]]\n"
+            "start a x=[1] y=[two words]\n"
+            "text [text]\n"
+            "start b\n"
+            "end b\n"
+            "comment [ remark ]\n"
+            "cdata [<raw>]\n"
+            "end a\n";
+        ASSERT_EQ(saxLog(in, 0, false), expected);
+    }
+
+    TEST(SaxReader, Attributes) {
+        std::string in = "<a  first = \"1\"\r\n\tsecond='' third/>";
+        ChunkedStream stream(in.c_str(), in.size());
+        SaxReader reader(stream);
+
+        class Handler : public SaxHandler {
+        public:
+            std::vector<std::pair<std::string, std::string>> attributes;
+            bool foundSecond = false;
+            void startElement(const SaxLocation& /*loc*/, std::string_view /*name*/, const SaxAttributes& attr) override {
+                for (auto& a : attr)
+                    attributes.push_back({ std::string(a.name), std::string(a.value) });
+                foundSecond = attr.find("second") != NULL;
+                ASSERT_EQ(attr.find("fourth"), nullptr);
+            }
+        } handler;
+        reader.Parse(handler);
+
+        ASSERT_EQ(handler.attributes.size(), 3);
+        ASSERT_EQ(handler.attributes[0].first, "first");
+        ASSERT_EQ(handler.attributes[0].second, "1");
+        ASSERT_EQ(handler.attributes[1].first, "second");
+        ASSERT_EQ(handler.attributes[1].second, "");
+        ASSERT_EQ(handler.attributes[2].first, "third");
+        ASSERT_EQ(handler.attributes[2].second, "");
+        ASSERT_TRUE(handler.foundSecond);
+    }
+
+    TEST(SaxReader, Location) {
+        std::string in = "<a>\n  <b c=\"d\"/>\n</a>";
+        std::string expected =
+            "0:1:1 start a\n"
+            "3:1:4 text [\n  ]\n"
+            "6:2:3 start b c=[d]\n"
+            "6:2:3 end b\n"
+            "16:2:13 text [\n]\n"
+            "17:3:1 end a\n";
+        ASSERT_EQ(saxLog(in, 0, true), expected);
+        ASSERT_EQ(saxLog(in, 3, true), expected);
+    }
+
+    TEST(SaxReader, SkipWhitespaceText) {
+        std::string in = "<a>\n  <b> x </b>\n</a>";
+        ChunkedStream stream(in.c_str(), in.size());
+        SaxReader reader(stream);
+        reader.parms.skipWhitespaceText = true;
+        RecordingHandler handler;
+        reader.Parse(handler);
+        ASSERT_EQ(handler.log.str(), "start a\nstart b\ntext [ x ]\nend b\nend a\n");
+    }
+
+    TEST(SaxReader, Stop) {
+        std::string in = "<a><b/><c/></a>";
+        ChunkedStream stream(in.c_str(), in.size());
+        SaxReader reader(stream);
+        RecordingHandler handler;
+        handler.stopAfter = 3;
+        ASSERT_FALSE(reader.Parse(handler));
+        ASSERT_EQ(handler.log.str(), "start a\nstart b\nend b\n");
+    }
+
+    TEST(SaxReader, ChunkedInput) {
+        auto in = LoadEmbeddedResourceText(RC_test_pp_FullTest_in);
+        auto reference = saxLog(in, 0, true);
+        ASSERT_FALSE(reference.empty());
+
+        // tiny chunks make names, values and comments span several buffers
+        for (size_t chunkSize : { 1, 2, 3, 7, 13, 64 }) {
+            ASSERT_EQ(reference, saxLog(in, chunkSize, true)) << "chunk size " << chunkSize;
+        }
+    }
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace StringXml {
+    /*
+    * Text being rewritten front to back, with the std::string members the formater uses and the
+    * same results (npos handling and out_of_range included).
+    *
+    * The text is kept as an output part followed by the unread rest of the input. Edits first pull
+    * input up to the edited range into the output, then change the output near its end, so the
+    * rest of the text is never shifted and a full pass stays linear in the size of the text.
+    */
+    class EditBuffer {
+        std::string head;           // output: positions [0, head.size())
+        std::string tail;           // input, consumed up to tailStart
+        size_t tailStart = 0;
+
+        inline std::string_view rest() const { return std::string_view(tail).substr(tailStart); }
+
+        // moves input into the output until the output covers [0, pos)
+        void pull(size_t pos) {
+            if (pos > head.size()) {
+                size_t len = pos - head.size();
+                head.append(tail, tailStart, len);
+                tailStart += len;
+            }
+        }
+
+        void check(size_t pos, const char* what) const {
+            if (pos > size())
+                throw std::out_of_range(what);
+        }
+
+        bool matchAt(size_t pos, std::string_view s) const {
+            if (s.size() > size() - pos)
+                return false;
+            for (size_t i = 0; i < s.size(); ++i) {
+                if ((*this)[pos + i] != s[i])
+                    return false;
+            }
+            return true;
+        }
+
+        // searches the output and then the input with a std::string_view search function
+        template <typename Search>
+        size_t findForward(size_t pos, Search search) const {
+            if (pos < head.size()) {
+                size_t found = search(std::string_view(head), pos);
+                if (found != std::string::npos)
+                    return found;
+                pos = head.size();
+            }
+            size_t found = search(rest(), pos - head.size());
+            return found == std::string::npos ? std::string::npos : found + head.size();
+        }
+    public:
+        static const size_t npos = std::string::npos;
+
+        EditBuffer(std::string&& text) : tail(std::move(text)) {
+            head.reserve(tail.size() + tail.size() / 4);
+        }
+
+        // the edited text; the buffer is empty afterwards
+        std::string str() {
+            head.append(tail, tailStart, std::string::npos);
+            tail.clear();
+            tailStart = 0;
+            return std::move(head);
+        }
+
+        inline size_t size() const { return head.size() + tail.size() - tailStart; }
+        inline size_t length() const { return size(); }
+
+        inline char operator[](size_t pos) const {
+            return pos < head.size() ? head[pos] : tail[tailStart + pos - head.size()];
+        }
+
+        char at(size_t pos) const {
+            if (pos >= size())
+                throw std::out_of_range("EditBuffer::at");
+            return (*this)[pos];
+        }
+
+        int compare(size_t pos, size_t len, std::string_view s) const {
+            check(pos, "EditBuffer::compare");
+            if (len > size() - pos)
+                len = size() - pos;
+            for (size_t i = 0; i < len && i < s.size(); ++i) {
+                unsigned char a = (*this)[pos + i], b = s[i];
+                if (a != b)
+                    return a < b ? -1 : 1;
+            }
+            return len < s.size() ? -1 : (len > s.size() ? 1 : 0);
+        }
+
+        std::string substr(size_t pos, size_t len = npos) const {
+            check(pos, "EditBuffer::substr");
+            if (len > size() - pos)
+                len = size() - pos;
+            std::string ret;
+            ret.reserve(len);
+            if (pos < head.size()) {
+                size_t n = len < head.size() - pos ? len : head.size() - pos;
+                ret.append(head, pos, n);
+                pos += n;
+                len -= n;
+            }
+            if (len > 0)
+                ret.append(tail, tailStart + pos - head.size(), len);
+            return ret;
+        }
+
+        size_t find(char c, size_t pos = 0) const {
+            return findForward(pos, [c](std::string_view s, size_t p) { return s.find(c, p); });
+        }
+
+        size_t find(std::string_view s, size_t pos = 0) const {
+            if (s.empty())
+                return pos <= size() ? pos : npos;
+            for (size_t p = find(s[0], pos); p != npos; p = find(s[0], p + 1)) {
+                if (matchAt(p, s))
+                    return p;
+            }
+            return npos;
+        }
+
+        size_t find_first_of(std::string_view chars, size_t pos = 0) const {
+            return findForward(pos, [chars](std::string_view s, size_t p) { return s.find_first_of(chars, p); });
+        }
+
+        size_t find_first_not_of(std::string_view chars, size_t pos = 0) const {
+            return findForward(pos, [chars](std::string_view s, size_t p) { return s.find_first_not_of(chars, p); });
+        }
+
+        size_t find_last_not_of(std::string_view chars, size_t pos = npos) const {
+            if (size() == 0)
+                return npos;
+            if (pos >= size())
+                pos = size() - 1;
+            if (pos >= head.size()) {
+                size_t found = rest().find_last_not_of(chars, pos - head.size());
+                if (found != std::string::npos)
+                    return found + head.size();
+                if (head.empty())
+                    return npos;
+                pos = head.size() - 1;
+            }
+            return std::string_view(head).find_last_not_of(chars, pos);
+        }
+
+        EditBuffer& erase(size_t pos, size_t len = npos) {
+            check(pos, "EditBuffer::erase");
+            if (len > size() - pos)
+                len = size() - pos;
+            pull(pos);
+            if (pos + len <= head.size()) {
+                head.erase(pos, len);
+            }
+            else {
+                // the input part of the range is skipped without being copied
+                tailStart += pos + len - head.size();
+                head.resize(pos);
+            }
+            return *this;
+        }
+
+        EditBuffer& insert(size_t pos, std::string_view s) {
+            check(pos, "EditBuffer::insert");
+            pull(pos);
+            head.insert(pos, s);
+            return *this;
+        }
+
+        EditBuffer& insert(size_t pos, size_t count, char c) {
+            check(pos, "EditBuffer::insert");
+            pull(pos);
+            head.insert(pos, count, c);
+            return *this;
+        }
+
+        EditBuffer& replace(size_t pos, size_t len, std::string_view s) {
+            check(pos, "EditBuffer::replace");
+            erase(pos, len);
+            return insert(pos, s);
+        }
+    };
+}
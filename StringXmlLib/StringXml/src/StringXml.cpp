@@ -1,5 +1,5 @@
 #include "StringXml.h"
-#include "../../../Report.h"
+#include "EditBuffer.h"
 
 namespace StringXml {
     static inline std::string& ltrim(std::string& str, const std::string& chars = "\t\n\v\f\r ") {
@@ -16,6 +16,16 @@ namespace StringXml {
         return ltrim(rtrim(str, chars), chars);
     }
 
+    // runs a pass on an EditBuffer and hands the text back, also when the pass throws
+    class Rewrite {
+        std::string* target;
+    public:
+        EditBuffer buffer;
+
+        Rewrite(std::string* str) : target(str), buffer(std::move(*str)) {}
+        ~Rewrite() { *target = buffer.str(); }
+    };
+
     XmlFormater::XmlFormater(std::string *str) {
         this->init(str, this->getDefaultParams());
     }
@@ -47,31 +57,34 @@ namespace StringXml {
         std::string::size_type curpos = 0, nexwchar_t;
         bool enableInsert = false;
 
-        while ((curpos = this->str->find_first_of(this->params.eolChars, curpos)) != std::string::npos) {
-            nexwchar_t = this->str->find_first_not_of(this->params.eolChars, curpos);
-            this->str->erase(curpos, nexwchar_t - curpos);
+        Rewrite rewrite(this->str);
+        EditBuffer* text = &rewrite.buffer;
+
+        while ((curpos = text->find_first_of(this->params.eolChars, curpos)) != std::string::npos) {
+            nexwchar_t = text->find_first_not_of(this->params.eolChars, curpos);
+            text->erase(curpos, nexwchar_t - curpos);
 
             // Let erase leading space chars on line
-            if (curpos != std::string::npos && curpos < this->str->length()) {
-                nexwchar_t = this->str->find_first_not_of(" \t", curpos);
+            if (curpos != std::string::npos && curpos < text->length()) {
+                nexwchar_t = text->find_first_not_of(" \t", curpos);
                 if (nexwchar_t != std::string::npos && nexwchar_t >= curpos) {
                     // And if the 1st char of next line is not '<' and last char of preceding
                     // line is not '>', then we consider we are in text content, then let put
                     // a space char
                     enableInsert = false;
-                    if (curpos > 0 && this->str->at(nexwchar_t) != '<' && this->str->at(curpos - 1) != '>') {
+                    if (curpos > 0 && text->at(nexwchar_t) != '<' && text->at(curpos - 1) != '>') {
                         enableInsert = true;
                         if (nexwchar_t > curpos) --nexwchar_t;
                     }
 
-                    if (nexwchar_t > curpos) this->str->erase(curpos, nexwchar_t - curpos);
-                    else if (enableInsert) this->str->insert(nexwchar_t, " ");
+                    if (nexwchar_t > curpos) text->erase(curpos, nexwchar_t - curpos);
+                    else if (enableInsert) text->insert(nexwchar_t, " ");
                 }
             }
         }
     }
 
-    void trimxml(std::string* str, std::string eolchar, bool breaklines, bool breaktags, bool indentOnly = false, const std::string& chars = "\t\n\v\f\r ") {
+    void trimxml(EditBuffer* str, std::string eolchar, bool breaklines, bool breaktags, bool indentOnly = false, const std::string& chars = "\t\n\v\f\r ") {
         bool in_tag = false, in_header = false;
         std::string tagname = "";
         char cc = '\0';
@@ -283,27 +296,33 @@ namespace StringXml {
         size_t eolcharpos = this->params.eolChars.find('\n');
 
         // first pass: trim lines
-        trimxml(this->str, this->params.eolChars, true, indentattributes, indentonly);
+        {
+            Rewrite rewrite(this->str);
+            trimxml(&rewrite.buffer, this->params.eolChars, true, indentattributes, indentonly);
+        }
+
+        Rewrite rewrite(this->str);
+        EditBuffer* text = &rewrite.buffer;
 
         // second pass: indentation
-        size_t strlen = this->str->size();
-        while (curpos < strlen && (curpos = this->str->find_first_of("<>\"'\n", curpos)) != std::string::npos) {
-            switch (cc = this->str->at(curpos)) {
+        size_t strlen = text->size();
+        while (curpos < strlen && (curpos = text->find_first_of("<>\"'\n", curpos)) != std::string::npos) {
+            switch (cc = text->at(curpos)) {
                 case '<': {
-                    if (curpos < strlen - 2 && !this->str->compare(curpos, 2, "<?")) {                   // is "<?xml ...?>" definition ?
+                    if (curpos < strlen - 2 && !text->compare(curpos, 2, "<?")) {                   // is "<?xml ...?>" definition ?
                         // skip the comment
-                        curpos = this->str->find("?>", curpos + 1) + 1;
+                        curpos = text->find("?>", curpos + 1) + 1;
                     }
-                    else if (curpos < strlen - 4 && !this->str->compare(curpos, 4, "<!--")) {            // is comment start ?
+                    else if (curpos < strlen - 4 && !text->compare(curpos, 4, "<!--")) {            // is comment start ?
                         // skip the comment
-                        curpos = this->str->find("-->", curpos + 1) + 2;
+                        curpos = text->find("-->", curpos + 1) + 2;
                     }
-                    else if (curpos < strlen - 9 && !this->str->compare(curpos, 9, "<![CDATA[")) {       // is CDATA start ?
+                    else if (curpos < strlen - 9 && !text->compare(curpos, 9, "<![CDATA[")) {       // is CDATA start ?
                         // skip the CDATA
-                        curpos = this->str->find("]]>", curpos + 1) + 2;
+                        curpos = text->find("]]>", curpos + 1) + 2;
                     }
-                    else if (curpos < strlen - 2 && !this->str->compare(curpos, 2, "</")) {              // end tag (ex: "</sample>")
-                        curpos = this->str->find(">", curpos + 1);
+                    else if (curpos < strlen - 2 && !text->compare(curpos, 2, "</")) {              // end tag (ex: "</sample>")
+                        curpos = text->find(">", curpos + 1);
                         if (xmllevel > 0) --xmllevel;
                     }
                     else {                                                                              // beg tag
@@ -311,12 +330,12 @@ namespace StringXml {
                         ++xmllevel;
 
                         // skip the tag name
-                        tmppos = this->str->find_first_of("\t\n\v\f\r />", curpos + 1);
+                        tmppos = text->find_first_of("\t\n\v\f\r />", curpos + 1);
                         if (tmppos != std::string::npos) {
                             // calculate tag name length
                             tagnamelen = tmppos - curpos - 1;
                             tagname.clear();
-                            tagname = this->str->substr(curpos + 1, tagnamelen);
+                            tagname = text->substr(curpos + 1, tagnamelen);
 
                             curpos = tmppos - 1;
                         }
@@ -326,12 +345,12 @@ namespace StringXml {
                 case '>': {
                     if (in_tag) {
                         in_tag = false;
-                        if (this->params.autoCloseTags && !this->str->compare(curpos + 1, 3 + tagname.length(), "</" + tagname + ">")) {
+                        if (this->params.autoCloseTags && !text->compare(curpos + 1, 3 + tagname.length(), "</" + tagname + ">")) {
                             // let's replace <a></a> with <a/>
-                            this->str->insert(curpos++, "/");
-                            this->str->erase(curpos + 1, 3 + tagname.length());
+                            text->insert(curpos++, "/");
+                            text->erase(curpos + 1, 3 + tagname.length());
                         }
-                        if (curpos > 0 && !this->str->compare(curpos - 1, 1, "/")) {                             // auto-closing tag (ex: "<sample/>")
+                        if (curpos > 0 && !text->compare(curpos - 1, 1, "/")) {                             // auto-closing tag (ex: "<sample/>")
                             --xmllevel;
                         }
                     }
@@ -341,7 +360,7 @@ namespace StringXml {
                 case '\'': {
                     if (in_tag) {
                         // skip attribute text
-                        tmppos = this->str->find(cc, curpos + 1);
+                        tmppos = text->find(cc, curpos + 1);
                         if (tmppos != std::string::npos && tmppos < strlen) {
                             curpos = tmppos;
                         }
@@ -358,7 +377,7 @@ namespace StringXml {
                     if (xmllevel > 0) {
                         size_t delta = 0;
                         tmppos = curpos + eolcharlen;
-                        if (tmppos < strlen - 1 && this->str->at(tmppos) == '<' && this->str->at(tmppos + 1) == '/') {
+                        if (tmppos < strlen - 1 && text->at(tmppos) == '<' && text->at(tmppos + 1) == '/') {
                             ++delta;
                         }
                         if (in_tag && indentattributes) {
@@ -367,7 +386,7 @@ namespace StringXml {
 
                         // apply indentation
                         for (size_t i = 0; i < xmllevel - delta; ++i) {
-                            this->str->insert(curpos + eolcharlen, this->params.indentChars);
+                            text->insert(curpos + eolcharlen, this->params.indentChars);
                             curpos += this->params.indentChars.length();
                         }
                     }
@@ -376,7 +395,7 @@ namespace StringXml {
 
                     if (in_tag && indentattributes) {
                         // add indentation for attribute
-                        this->str->insert(curpos, tagnamelen + 2, ' ');
+                        text->insert(curpos, tagnamelen + 2, ' ');
                     }
 
                     break;
@@ -386,7 +405,7 @@ namespace StringXml {
             ++curpos;
 
             // inifinite loop protection
-            strlen = this->str->length();
+            strlen = text->length();
             if (curpos == lastpos && lastlen == strlen) {
                 //dbgln("PRETTYPRINT: INIFINITE LOOP DETECTED");
                 break;
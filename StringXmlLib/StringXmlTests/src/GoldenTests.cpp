@@ -0,0 +1,187 @@
+#include "CppUnitTest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <streambuf>
+#include <vector>
+
+#include "StringXml.h"
+#include "LegacyXmlFormater.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace StringXmlTests {
+	extern std::string xmltestsfileshome;
+
+	// The formater must produce exactly what the legacy implementation produced, byte for byte.
+	TEST_CLASS(GoldenTests) {
+		enum class Operation { PrettyPrint, PrettyPrintAttr, PrettyPrintIndent, Linearize };
+
+		template <typename Formater>
+		std::string format(std::string text, StringXml::XmlFormaterParamsType params, Operation op) {
+			Formater formater(&text, params);
+			try {
+				switch (op) {
+					case Operation::PrettyPrint: formater.prettyPrint(); break;
+					case Operation::PrettyPrintAttr: formater.prettyPrintAttr(); break;
+					case Operation::PrettyPrintIndent: formater.prettyPrintIndent(); break;
+					case Operation::Linearize: formater.linearize(); break;
+				}
+			}
+			catch (const std::out_of_range&) {
+				// broken input can run past the end; what was edited until then must match too
+				return "out_of_range: " + text;
+			}
+			return text;
+		}
+
+		void compareWithLegacy(const std::string& xml, const std::string& name) {
+			for (int variant = 0; variant < 8; ++variant) {
+				StringXml::XmlFormaterParamsType params;
+				params.indentChars = (variant & 1) ? "\t" : "  ";
+				params.eolChars = (variant & 2) ? "\r\n" : "\n";
+				params.autoCloseTags = (variant & 4) != 0;
+
+				for (auto op : { Operation::PrettyPrint, Operation::PrettyPrintAttr, Operation::PrettyPrintIndent, Operation::Linearize }) {
+					std::string expected = format<StringXmlLegacy::XmlFormater>(xml, params, op);
+					std::string actual = format<StringXml::XmlFormater>(xml, params, op);
+
+					std::wstring message(name.begin(), name.end());
+					message += L" variant " + std::to_wstring(variant) + L" operation " + std::to_wstring((int)op);
+					Assert::IsTrue(expected == actual, message.c_str());
+				}
+			}
+		}
+
+		std::string readFile(const std::string& filepath) {
+			std::ifstream ifs(filepath, std::ios::binary);
+			std::string res((std::istreambuf_iterator<char>(ifs)),
+				(std::istreambuf_iterator<char>()));
+			return res;
+		}
+
+		std::vector<std::string> listFiles(const std::string& dir, const std::string& extension) {
+			std::vector<std::string> files;
+			std::error_code ec;
+			for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+				if (entry.is_regular_file() && entry.path().extension() == extension) {
+					files.push_back(entry.path().string());
+				}
+			}
+			return files;
+		}
+
+		// deterministic pseudo random document mixing the constructs the formater treats differently
+		std::string generateXml(unsigned int seed, size_t elements) {
+			auto next = [&seed](unsigned int range) {
+				seed = seed * 1103515245 + 12345;
+				return (seed >> 16) % range;
+			};
+			const char* names[] = { "a", "item", "ns:value", "longer-name", "x_1" };
+			const char* spaces[] = { "", " ", "  ", "\n", "\r\n", "\t", "\n    " };
+			const char* texts[] = { "text", "two words", " padded ", "a &amp; b", "line\nbreak" };
+
+			std::string xml;
+			if (next(2)) xml += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+			std::vector<std::string> open;
+			xml += "<root>";
+			open.push_back("root");
+
+			for (size_t i = 0; i < elements; ++i) {
+				xml += spaces[next(7)];
+				switch (next(8)) {
+					case 0:
+						if (open.size() > 1) {
+							xml += "</" + open.back() + spaces[next(3)] + ">";
+							open.pop_back();
+						}
+						break;
+					case 1:
+						xml += texts[next(5)];
+						break;
+					case 2:
+						xml += "<!-- comment " + std::to_string(i) + " -->";
+						break;
+					case 3:
+						xml += "<![CDATA[ <raw> & ]]>";
+						break;
+					case 4: {
+						std::string name = names[next(5)];
+						xml += "<" + name + "></" + name + ">";
+						break;
+					}
+					default: {
+						std::string name = names[next(5)];
+						xml += "<" + name;
+						for (unsigned int a = next(4); a > 0; --a) {
+							char quote = next(2) ? '"' : '\'';
+							xml += std::string(next(2) ? " " : "\n  ") + "at" + std::to_string(a) + spaces[next(3)] + "=" + spaces[next(3)] + quote + texts[next(4)] + quote;
+						}
+						xml += spaces[next(3)];
+						if (open.size() > 6 || next(3) == 0) {
+							xml += "/>";
+						}
+						else {
+							xml += ">";
+							open.push_back(name);
+						}
+						break;
+					}
+				}
+			}
+			while (!open.empty()) {
+				xml += spaces[next(7)];
+				xml += "</" + open.back() + ">";
+				open.pop_back();
+			}
+			return xml;
+		}
+
+	public:
+
+		TEST_METHOD(CorpusFiles) {
+			std::string corpus = xmltestsfileshome + "../../../tests/";
+			auto files = listFiles(corpus, ".xml");
+			for (auto& dir : { "PrettyPrint/", "PrettyPrintIndentAttributes/", "PrettyPrintIndentOnly/" }) {
+				auto more = listFiles(xmltestsfileshome + dir, ".xml");
+				files.insert(files.end(), more.begin(), more.end());
+			}
+			Assert::IsFalse(files.empty());
+
+			for (auto& file : files) {
+				compareWithLegacy(readFile(file), file);
+			}
+		}
+
+		TEST_METHOD(GeneratedFiles) {
+			for (unsigned int seed = 1; seed <= 50; ++seed) {
+				compareWithLegacy(generateXml(seed, 20 * seed), "seed " + std::to_string(seed));
+			}
+		}
+
+		TEST_METHOD(EdgeCases) {
+			const char* samples[] = {
+				"",
+				"<",
+				"<a",
+				"<a>",
+				"</a>",
+				"<!-- open",
+				"<![CDATA[ open",
+				"<?xml open",
+				"<a b='open/>",
+				"text only",
+				"\n\n\n",
+				"<a>\n\n</a>\n\n",
+				"<a  b = \"1\"   c='2'  />",
+				"<a><b></b></a>",
+				"<a>\r\n  <b/>\r\n</a>",
+			};
+			for (auto sample : samples) {
+				compareWithLegacy(sample, sample);
+			}
+		}
+	};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include "StringXml.h"
+
+// reference implementation for the golden tests, see LegacyXmlFormater.cpp
+namespace StringXmlLegacy {
+    using StringXml::XmlFormaterParamsType;
+
+    class XmlFormater {
+        XmlFormaterParamsType params;
+
+        size_t indentLevel;                 // the real applied indent level
+        size_t levelCounter;                // the level counter
+
+        std::string* str;        // pointer to original source text
+    public:
+        XmlFormater(std::string *str);
+        XmlFormater(std::string *str, XmlFormaterParamsType params);
+        ~XmlFormater();
+
+        void init(std::string *str);
+        void init(std::string *str, XmlFormaterParamsType params);
+        void reset();
+
+        void linearize();
+        void prettyPrint(bool autoindenttext, bool addlinebreaks, bool indentattributes, bool indentonly = false);
+
+        void prettyPrint();
+        void prettyPrintAttr();
+        void prettyPrintIndent();
+
+        XmlFormaterParamsType getDefaultParams();
+    };
+}
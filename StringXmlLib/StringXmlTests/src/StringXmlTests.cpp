@@ -1,6 +1,8 @@
 #include "CppUnitTest.h"
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <fstream>
 #include <string>
 #include <streambuf>
@@ -11,7 +13,11 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace StringXml;
 
 namespace StringXmlTests {
+#ifdef XMLTOOLS_TESTFILES
+	std::string xmltestsfileshome(XMLTOOLS_TESTFILES);
+#else
 	std::string xmltestsfileshome("D:\\Progs\\C++\\xmltools\\SimpleXmlLib\\SimpleXmlTests\\TestFiles\\");
+#endif
 
 	TEST_CLASS(StringXmlTests) {
 		std::string readFile(std::string filepath) {
@@ -21,7 +27,7 @@ namespace StringXmlTests {
 			return res;
 		}
 
-		void writeFile(std::string data, std::wstring filepath) {
+		void writeFile(std::string data, std::string filepath) {
 			std::ofstream ofs(filepath);
 			ofs << data;
 			ofs.close();
@@ -115,14 +121,14 @@ namespace StringXmlTests {
 			params.eolChars = '\n';
 			params.autoCloseTags = true;
 
-			std::string xml = readFile("PrettyPrint\\FullTest.in.xml");
-			std::string ref = readFile("PrettyPrint\\FullTest.out.xml");
+			std::string xml = readFile("PrettyPrint/FullTest.in.xml");
+			std::string ref = readFile("PrettyPrint/FullTest.out.xml");
 
 			std::string tmp = xml;
 			XmlFormater formater(&tmp, params);
 			formater.prettyPrint();
 			tmp.append(params.eolChars);	// the sample has as added final CRLF
-			//writeFile(tmp, L"D:\\Progs\\C++\\xmltools\\SimpleXmlLib\\SimpleXmlTests\\TestFiles\\PrettyPrint\\FullTest.test.xml");
+			//writeFile(tmp, xmltestsfileshome + "PrettyPrint/FullTest.test.xml");
 
 			Assert::IsTrue(0 == tmp.compare(ref.c_str()));
 
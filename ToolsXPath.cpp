@@ -4,6 +4,7 @@
 #include "nppHelpers.h"
 #include "Report.h"
 #include "XmlFormater.h"
+#include "DocumentQueries.h"
 
 #include "XPathEvalDlg.h"
 
@@ -12,21 +13,9 @@ using namespace QuickXml;
 std::wstring currentXPath(int xpathMode) {
     dbgln("currentXPath()");
 
-    XmlFormater* formater = NULL;
     int currentEdit;
-    std::wstring nodepath(L"");
-
     ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTSCINTILLA, 0, (LPARAM)&currentEdit);
-    HWND hCurrentEditView = getCurrentHScintilla(currentEdit);
-    size_t currentLength = (size_t) ::SendMessage(hCurrentEditView, SCI_GETLENGTH, 0, 0);
-
-    char* data = new char[currentLength + sizeof(char)];
-    if (!data) return nodepath;  // allocation error, abort check
-    size_t size = (currentLength + sizeof(char)) * sizeof(char);
-    memset(data, '\0', size);
-
-    size_t currentPos = size_t(::SendMessage(hCurrentEditView, SCI_GETCURRENTPOS, 0, 0));
-    ::SendMessage(hCurrentEditView, SCI_GETTEXT, currentLength + sizeof(char), reinterpret_cast<LPARAM>(data));
+    ScintillaDoc doc(getCurrentHScintilla(currentEdit));
 
     XmlFormaterParamsType params = XmlFormater::getDefaultParams();
     if ((xpathMode & XPATH_MODE_KEEPIDATTRIBUTE) != 0 && xmltoolsoptions.identityAttributes.length() > 0) {
@@ -38,12 +27,9 @@ std::wstring currentXPath(int xpathMode) {
             params.identityAttribues.push_back(Report::ws2s(temp));
         }
     }
-    formater = new XmlFormater(data, currentLength, params);
-    nodepath = Report::utf8ToUcs2(formater->currentPath(currentPos, xpathMode)->str());
-    delete[] data;
-    delete formater;
 
-    return nodepath;
+    // the text is parsed in the editor buffer; this runs on each caret move when the path is shown in the status bar
+    return Report::utf8ToUcs2(documentCurrentPath(doc, (size_t)doc.CurrentPosition(), xpathMode, params));
 }
 
 void printCurrentXPathInStatusbar() {
@@ -4,7 +4,7 @@
 #include "nppHelpers.h"
 #include "Report.h"
 #include "XMLTools.h"
-#include "XmlParser.h"
+#include "DocumentQueries.h"
 
 #include "SelectFileDlg.h"
 
@@ -13,8 +13,6 @@
 
 #include <string>
 
-using namespace QuickXml;
-
 int performXMLCheck(int informIfNoError) {
     dbgln("performXMLCheck()");
 
@@ -32,18 +30,14 @@ int performXMLCheck(int informIfNoError) {
 
     clearErrors(hCurrentEditView);
 
-    size_t currentLength = (size_t) ::SendMessage(hCurrentEditView, SCI_GETLENGTH, 0, 0);
-
-    char* data = new char[currentLength + sizeof(char)];
-    if (!data) return -1;  // allocation error, abort check
-    memset(data, '\0', currentLength + sizeof(char));
-
-    ::SendMessage(hCurrentEditView, SCI_GETTEXT, currentLength + sizeof(char), reinterpret_cast<LPARAM>(data));
+    // the wrapper converts the text itself, no need for an intermediate copy
+    ScintillaDoc doc(hCurrentEditView);
+    ScintillaDoc::sciTextView text = doc.GetCharacterPointer();
+    if (!text) return -1;
 
     auto t_start = clock();
 
-    XmlWrapperInterface* wrapper = new MSXMLWrapper(data, currentLength);
-    delete[] data; data = NULL;
+    XmlWrapperInterface* wrapper = new MSXMLWrapper(text.text, (size_t)text.length);
 
     bool isok = wrapper->checkSyntax();
 
@@ -99,42 +93,20 @@ void XMLValidation(int informIfNoError) {
 
     clearErrors(hCurrentEditView);
 
-    size_t currentLength = (size_t) ::SendMessage(hCurrentEditView, SCI_GETLENGTH, 0, 0);
+    // the root element and its schema attributes come from the QuickXml document model shared with
+    // the other commands, rather than from MSXML XPath queries; the syntax check stays with MSXML, as
+    // the model is lenient (duplicate attributes, undeclared entities...) and the check is cheap next
+    // to the validation
+    std::shared_ptr<const ParsedDocument> parsed = currentParsedDocument();
 
-    char* data = new char[currentLength + sizeof(char)];
-    if (!data) return;  // allocation error, abort check
-    memset(data, '\0', currentLength + sizeof(char));
-
-    ::SendMessage(hCurrentEditView, SCI_GETTEXT, currentLength + sizeof(char), reinterpret_cast<LPARAM>(data));
-
-    XmlWrapperInterface* wrapper = new MSXMLWrapper(data, currentLength);
+    XmlWrapperInterface* wrapper = new MSXMLWrapper(parsed->text.c_str(), parsed->text.length());
 
     bool isok = wrapper->checkSyntax();
 
     if (isok) {
         // check if a schema prompt is requested
-        std::vector<XPathResultEntryType> nodes = wrapper->xpathEvaluate(L"/*/@xsi:noNamespaceSchemaLocation", L"xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance'");
-        bool nnsl = (nodes.size() > 0);
-        nodes.clear();
-
-        nodes = wrapper->xpathEvaluate(L"/*/@xsi:schemaLocation", L"xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance'");
-        bool sl = (nodes.size() > 0);
-
-        bool hasSchemaOrDTD = (nnsl || sl);
-
-        if (!hasSchemaOrDTD) {
-            // search for DTD - this will be done using QuickXml
-            XmlParser parser(data, currentLength);
-            XmlToken token = undefinedToken;
-            do {
-                token = parser.parseUntil(XmlTokenType::DeclarationBeg | XmlTokenType::TagOpening);
-                if (token.type == XmlTokenType::DeclarationBeg && !strncmp(token.chars, "<!DOCTYPE", 9)) {
-                    break;
-                }
-            } while (token.type != XmlTokenType::EndOfFile && token.type != XmlTokenType::TagOpening);
-
-            hasSchemaOrDTD = (token.type == XmlTokenType::DeclarationBeg);
-        }
+        const ValidationHints& hints = parsed->hints;
+        bool hasSchemaOrDTD = (hints.schemaLocation || hints.doctype);
 
         if (hasSchemaOrDTD) {
             if (!wrapper->checkValidity()) {
@@ -153,15 +125,7 @@ void XMLValidation(int informIfNoError) {
             }
             //pSelectFileDlg->m_sSelectedFilename = lastXMLSchema.c_str();
 
-            CStringW rootSample = "<";
-            nodes.clear();
-            nodes = wrapper->xpathEvaluate(L"/*", L"");
-            if (nodes.size() == 1) {
-                pSelectFileDlg->m_sRootElementName = nodes.at(0).name.c_str();
-            }
-            else {
-                pSelectFileDlg->m_sRootElementName = L"";
-            }
+            pSelectFileDlg->m_sRootElementName = Report::utf8ToUcs2(hints.rootName).c_str();
 
             if (pSelectFileDlg->DoModal() == IDOK) {
                 //lastXMLSchema = pSelectFileDlg->m_sSelectedFilename;
@@ -179,8 +143,6 @@ void XMLValidation(int informIfNoError) {
         Report::_printf_inf(L"Please fix xml syntax first.");
     }
 
-    delete[] data; data = NULL;
-
     delete wrapper;
 }
 
@@ -408,6 +408,9 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification *notifyCode) {
       break;
     }
     case SCN_MODIFIED: {
+      if (notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
+        documentCache.modified(documentOfView((HWND)notifyCode->nmhdr.hwndFrom));
+      }
       if ((notifyCode->modificationType == SC_MOD_INSERTTEXT || notifyCode->modificationType == SC_MOD_DELETETEXT) && hasCurrentDocAnnotations()) {
         dbgln(Report::str_format("NPP Event: SCN_MODIFIED [%d]", notifyCode->modificationType).c_str());
         clearErrors();
@@ -439,6 +442,7 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification *notifyCode) {
     }
     case NPPN_FILEBEFORECLOSE: {
         clearBufferAnnnotation();
+        documentCache.closed((DocumentCache::BufferId)notifyCode->nmhdr.idFrom);
         break;
     }
     case NPPN_TBMODIFICATION: {
@@ -449,6 +453,7 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification *notifyCode) {
       CoUninitialize();
 
       deleteAnnotations();
+      documentCache.clear();
 
       savePluginParams();
       detroyDebugDlg();
@@ -0,0 +1,74 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+// Counts every allocation of the process; the benchmarks report the difference over their runs.
+// Each block starts with its size, so that the bytes in use, and their peak, are known as well.
+
+namespace {
+    std::atomic<size_t> allocationCount{ 0 };
+    std::atomic<size_t> allocationBytes{ 0 };
+    std::atomic<size_t> liveBytes{ 0 };
+    std::atomic<size_t> peakBytes{ 0 };
+
+    // keeps the blocks aligned as malloc() does
+    const size_t headerSize = alignof(std::max_align_t);
+
+    void* allocate(size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+        char* p = static_cast<char*>(std::malloc(headerSize + (size ? size : 1)));
+        if (p == nullptr)
+            throw std::bad_alloc();
+        *reinterpret_cast<size_t*>(p) = size;
+
+        size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+        return p + headerSize;
+    }
+
+    void deallocate(void* block) {
+        if (block == nullptr)
+            return;
+        char* p = static_cast<char*>(block) - headerSize;
+        liveBytes.fetch_sub(*reinterpret_cast<size_t*>(p), std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+namespace XMLToolsBench {
+    AllocationTotals allocationTotals() {
+        AllocationTotals totals;
+        totals.count = allocationCount.load(std::memory_order_relaxed);
+        totals.bytes = allocationBytes.load(std::memory_order_relaxed);
+        totals.live = liveBytes.load(std::memory_order_relaxed);
+        totals.peak = peakBytes.load(std::memory_order_relaxed);
+        return totals;
+    }
+
+    void resetAllocationPeak() {
+        peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); }
+    catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); }
+    catch (...) { return nullptr; }
+}
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
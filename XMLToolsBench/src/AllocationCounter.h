@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+namespace XMLToolsBench {
+    // totals of the replaced global operator new, since the start of the process
+    struct AllocationTotals {
+        size_t count = 0;
+        size_t bytes = 0;
+        size_t live = 0;    // bytes allocated and not freed yet
+        size_t peak = 0;    // highest live since the last resetAllocationPeak()
+    };
+
+    AllocationTotals allocationTotals();
+
+    // starts a new peak measurement from the bytes in use now
+    void resetAllocationPeak();
+}
@@ -0,0 +1,139 @@
+#include <map>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "AllocationCounter.h"
+#include "CorpusGenerator.h"
+#include "EngineRuns.h"
+
+/*
+* Allocation regression tests: every engine operation runs on every corpus shape at two sizes,
+* which separates the allocations of its work loop (per megabyte of input) from those made once
+* per run (buffers, setup). Both must stay under the limits below, so that a change allocating in
+* a hot loop fails here instead of only showing up in the allocs_per_MB of the benchmarks.
+* The measured figures are recorded as test properties (--gtest_output=xml:<file> to see them).
+*/
+
+using namespace XMLToolsBench;
+
+namespace {
+    struct Limit {
+        double perMegabyte;     // allocations per megabyte of input
+        double perRun;          // allocations independent of the input size
+    };
+
+    // measured with libstdc++ on the default corpus, plus a quarter and some slack; lower them
+    // when an engine allocates less
+    const std::map<std::string, Limit> limits = {
+        { "simplexml/pretty",       { 32, 48 } },
+        { "simplexml/pretty-attr",  { 32, 48 } },
+        { "simplexml/indent-only",  { 32, 48 } },
+        { "simplexml/linearize",    { 32, 48 } },
+        { "simplexml/tokenize",     { 32, 16 } },
+        { "simplexml/check",        { 32, 32 } },
+        // the formatter allocates for each element
+        { "quickxml/pretty",        { 14700, 64 } },
+        { "quickxml/pretty-attr",   { 14700, 64 } },
+        { "quickxml/indent-only",   { 14700, 64 } },
+        { "quickxml/linearize",     { 14700, 64 } },
+        { "quickxml/tokenize",      { 32, 16 } },
+        { "quickxml/path",          { 32, 32 } },
+        { "quickxml/document",      { 24, 160 } },
+        { "quickxml-copy/tokenize", { 32, 16 } },
+        { "quickxml-copy/path",     { 32, 32 } },
+        // edits the text with temporary strings
+        { "stringxml/pretty",       { 29800, 192 } },
+        { "stringxml/pretty-attr",  { 42500, 192 } },
+        { "stringxml/indent-only",  { 29800, 192 } },
+        { "stringxml/linearize",    { 32, 16 } },
+    };
+
+    const size_t smallSize = 256 * 1024;
+    const size_t largeSize = 1024 * 1024;
+
+    const std::string& document(Shape shape, size_t size) {
+        static std::map<std::pair<Shape, size_t>, std::string> documents;
+        auto found = documents.find({ shape, size });
+        if (found == documents.end())
+            found = documents.emplace(std::make_pair(shape, size), CorpusGenerator(shapeParms(shape, size)).generate()).first;
+        return found->second;
+    }
+
+    // allocations of one run, after a first one has done the lazy initializations
+    size_t allocations(const Engine& engine, Operation op, const std::string& xml) {
+        engine(xml, op);
+        AllocationTotals before = allocationTotals();
+        engine(xml, op);
+        return allocationTotals().count - before.count;
+    }
+
+    void checkEngine(const std::string& name) {
+        for (const EngineEntry& entry : engineEntries()) {
+            if (name != entry.name)
+                continue;
+            for (Operation op : entry.operations) {
+                std::string key = name + "/" + operationName(op);
+                auto limit = limits.find(key);
+                ASSERT_NE(limits.end(), limit) << key << " has no allocation limit";
+
+                for (Shape shape : allShapes()) {
+                    const std::string& small = document(shape, smallSize);
+                    const std::string& large = document(shape, largeSize);
+                    double smallMegabytes = small.size() / (1024.0 * 1024.0);
+                    double largeMegabytes = large.size() / (1024.0 * 1024.0);
+                    double smallCount = (double)allocations(entry.engine, op, small);
+                    double largeCount = (double)allocations(entry.engine, op, large);
+
+                    double perMegabyte = (largeCount - smallCount) / (largeMegabytes - smallMegabytes);
+                    double perRun = smallCount - perMegabyte * smallMegabytes;
+                    std::string run = key + "/" + shapeName(shape);
+                    testing::Test::RecordProperty(run + "/allocs_per_MB", std::to_string((long)perMegabyte));
+                    testing::Test::RecordProperty(run + "/allocs_per_run", std::to_string((long)perRun));
+
+                    EXPECT_LE(perMegabyte, limit->second.perMegabyte) << run << ": allocations per megabyte";
+                    EXPECT_LE(perRun, limit->second.perRun) << run << ": allocations per run";
+                }
+            }
+        }
+    }
+}
+
+TEST(Allocations, EveryOperationHasALimit) {
+    for (const EngineEntry& entry : engineEntries()) {
+        for (Operation op : entry.operations)
+            EXPECT_EQ(1u, limits.count(std::string(entry.name) + "/" + operationName(op)));
+    }
+}
+
+TEST(Allocations, SimpleXml) {
+    checkEngine("simplexml");
+}
+
+TEST(Allocations, QuickXml) {
+    checkEngine("quickxml");
+}
+
+TEST(Allocations, QuickXmlCopy) {
+    checkEngine("quickxml-copy");
+}
+
+TEST(Allocations, StringXml) {
+    checkEngine("stringxml");
+}
+
+TEST(Allocations, CounterSeesEveryAllocation) {
+    // volatile, so that the compiler does not drop the allocations
+    void* volatile block = nullptr;
+    AllocationTotals before = allocationTotals();
+    block = ::operator new(1000);
+    AllocationTotals during = allocationTotals();
+    ::operator delete(block);
+
+    EXPECT_EQ(before.count + 1, during.count);
+    EXPECT_EQ(before.bytes + 1000, during.bytes);
+    EXPECT_EQ(before.live + 1000, during.live);
+    EXPECT_LE(before.live + 1000, during.peak);
+    EXPECT_EQ(before.live, allocationTotals().live);
+}
@@ -0,0 +1,107 @@
+#include <map>
+#include <string>
+#include <tuple>
+
+#include <benchmark/benchmark.h>
+
+#include "CorpusGenerator.h"
+
+#include "DocumentFormat.h"
+#include "MemoryScintillaDoc.h"
+
+/*
+* Cost of putting a formatted text into the editor, on the in-memory ScintillaDoc stand-in:
+*   apply/full   the whole text is set, as SCI_SETTEXT does
+*   apply/diff   only the changed parts are replaced (replaceWorkText), diff included
+* on a document formatted before, with a few lines to fix (reformat), and on a document formatted
+* for the first time, where nearly every line changes (first). The editor work which follows
+* a change (styling, folding, undo record) is not part of it: it grows with the replaced bytes,
+* reported as edited_MB.
+*/
+
+namespace XMLToolsBench {
+    namespace {
+        enum class Change { Reformat, First };
+
+        struct ApplyCase {
+            std::string oldText;
+            std::string newText;
+        };
+
+        std::string prettyPrint(const std::string& xml) {
+            FormatEngine::Input input(xml.c_str(), xml.size());
+            SimpleXml::StringOutputSink out;
+            FormatEngine::quickXmlEngine().format(FormatEngine::Operation::PrettyPrint, input, FormatEngine::Options(), out);
+            return out.str();
+        }
+
+        const ApplyCase& applyCase(Change change, Shape shape, size_t size) {
+            static std::map<std::tuple<Change, Shape, size_t>, ApplyCase> cases;
+            auto found = cases.find(std::make_tuple(change, shape, size));
+            if (found == cases.end()) {
+                CorpusParms parms = shapeParms(shape, size);
+                ApplyCase applyCase;
+                if (change == Change::First) {
+                    parms.indent = false;
+                    applyCase.oldText = CorpusGenerator(parms).generate();
+                    applyCase.newText = prettyPrint(applyCase.oldText);
+                }
+                else {
+                    applyCase.newText = prettyPrint(CorpusGenerator(parms).generate());
+                    // one line in a thousand with a wrong indentation
+                    applyCase.oldText = applyCase.newText;
+                    size_t line = 0;
+                    for (size_t pos = applyCase.oldText.find('\n'); pos != std::string::npos; pos = applyCase.oldText.find('\n', pos + 1)) {
+                        if (++line % 1000 == 0)
+                            applyCase.oldText.insert(pos + 1, "\t");
+                    }
+                }
+                found = cases.emplace(std::make_tuple(change, shape, size), std::move(applyCase)).first;
+            }
+            return found->second;
+        }
+
+        void runApply(benchmark::State& state, bool diff, Change change, Shape shape, size_t size) {
+            const ApplyCase& applyCase = XMLToolsBench::applyCase(change, shape, size);
+            MemoryScintillaDoc doc(applyCase.oldText);
+            FormatEngine::TextDiffParms parms;
+
+            for (auto _ : state) {
+                state.PauseTiming();
+                doc.text = applyCase.oldText;
+                doc.replaceCount = 0;
+                doc.replacedBytes = 0;
+                state.ResumeTiming();
+
+                if (diff)
+                    replaceWorkText(doc, applyCase.newText, parms);
+                else
+                    doc.SetWorkText(applyCase.newText.c_str());
+            }
+
+            size_t edited = diff ? doc.replacedBytes : applyCase.oldText.size() + applyCase.newText.size();
+            state.SetBytesProcessed((int64_t)(state.iterations() * applyCase.newText.size()));
+            state.counters["edits"] = (double)(diff ? doc.replaceCount : 1);
+            state.counters["edited_MB"] = edited / (1024.0 * 1024.0);
+            state.SetLabel(std::to_string(applyCase.newText.size()) + " bytes");
+        }
+    }
+
+    void registerApplyBenchmarks() {
+        const size_t sizes[] = { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+        const Shape shapes[] = { Shape::Flat, Shape::Mixed };
+        for (bool diff : { false, true }) {
+            for (Change change : { Change::Reformat, Change::First }) {
+                for (Shape shape : shapes) {
+                    for (size_t size : sizes) {
+                        std::string name = std::string("apply/") + (diff ? "diff" : "full") + "/" + (change == Change::First ? "first" : "reformat") +
+                                           "/" + shapeName(shape) + "/" + std::to_string(size / 1024) + "KB";
+                        benchmark::RegisterBenchmark(name.c_str(), runApply, diff, change, shape, size)
+                            ->Unit(benchmark::kMillisecond)
+                            ->UseRealTime();
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,327 @@
+#include "CorpusGenerator.h"
+
+namespace XMLToolsBench {
+    namespace {
+        const size_t blockSize = 64 * 1024;
+
+        const char* names[] = { "item", "record", "value", "entry", "data", "node", "field", "group" };
+        const char* prefixes[] = { "a", "b", "c", "d" };
+        const char* words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do", "&amp;", "&lt;tag&gt;" };
+        const char* multibyteWords[] = { "\xC3\xA9t\xC3\xA9", "stra\xC3\x9F" "e", "\xE4\xB8\xAD\xE6\x96\x87", "\xE2\x82\xAC" "10", "\xCE\xB1\xCE\xB2\xCE\xB3", "\xF0\x9F\x98\x80" };
+
+        template <typename T, size_t N>
+        constexpr unsigned countOf(T(&)[N]) { return (unsigned)N; }
+
+        template <typename T, size_t N>
+        std::vector<std::string> strings(T(&values)[N]) { return std::vector<std::string>(values, values + N); }
+    }
+
+    CorpusGenerator::CorpusGenerator(const CorpusParms& parms) : parms(parms) {
+        if (this->parms.maxDepth < 2)
+            this->parms.maxDepth = 2;
+        if (this->parms.fanOut < 1)
+            this->parms.fanOut = 1;
+        switch (parms.lineEnding) {
+            case LineEnding::LF: eol = "\n"; break;
+            case LineEnding::CRLF: eol = "\r\n"; break;
+            case LineEnding::CR: eol = "\r"; break;
+            case LineEnding::None: break;
+        }
+
+        // every string that is written repeatedly is prepared once
+        elementNames = strings(names);
+        for (auto prefix : prefixes) {
+            for (auto name : names)
+                prefixedNames.push_back(std::string(prefix) + ":" + name);
+        }
+        textWords = strings(words);
+        multibyteTextWords = strings(multibyteWords);
+        for (unsigned i = 0; i < this->parms.dtdEntities; ++i)
+            entityReferences.push_back("&ent" + std::to_string(i) + ";");
+        for (unsigned i = 0; i <= 2 * this->parms.attributes; ++i)
+            attributeNames.push_back("a" + std::to_string(i));
+    }
+
+    // splitmix64, so the documents do not depend on the standard library implementation
+    uint64_t CorpusGenerator::next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned CorpusGenerator::below(unsigned range) {
+        return range ? (unsigned)(next() % range) : 0;
+    }
+
+    bool CorpusGenerator::chance(double probability) {
+        return probability > 0 && (next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+    }
+
+    void CorpusGenerator::append(const char* s, size_t len) {
+        buffer.append(s, len);
+        written += len;
+        if (buffer.size() >= blockSize)
+            flush();
+    }
+
+    void CorpusGenerator::flush() {
+        if (!buffer.empty())
+            (*sink)(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    void CorpusGenerator::newLine(size_t depth) {
+        if (eol.empty())
+            return;
+        append(eol);
+        if (parms.indent) {
+            buffer.append(depth, '\t');
+            written += depth;
+        }
+    }
+
+    const std::string& CorpusGenerator::elementName() {
+        if (chance(parms.namespaceDensity))
+            return prefixedNames[below((unsigned)prefixedNames.size())];
+        return elementNames[below((unsigned)elementNames.size())];
+    }
+
+    const std::string& CorpusGenerator::word() {
+        if (chance(parms.multibyteDensity))
+            return multibyteTextWords[below((unsigned)multibyteTextWords.size())];
+        if (!entityReferences.empty() && below(16) == 0)
+            return entityReferences[below((unsigned)entityReferences.size())];
+        return textWords[below((unsigned)textWords.size())];
+    }
+
+    void CorpusGenerator::writeWords(unsigned count, bool text) {
+        uint64_t start = written;
+        for (unsigned i = 0; i < count; ++i) {
+            if (i > 0)
+                append(" ");
+            append(word());
+        }
+        if (text)
+            textWritten += written - start;
+    }
+
+    void CorpusGenerator::writeProlog() {
+        append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+        append(eol);
+        if (parms.dtdEntities > 0) {
+            append("<!DOCTYPE root [");
+            std::string separator = eol.empty() ? " " : eol + "\t";
+            for (unsigned i = 0; i < parms.dtdEntities; ++i) {
+                std::string n = std::to_string(i);
+                append(separator + "<!ENTITY ent" + n + " \"entity " + n + "\">");
+                if (i % 3 == 1)
+                    append(separator + "<!ELEMENT e" + n + " (#PCDATA)>");
+                if (i % 3 == 2)
+                    append(separator + "<!ATTLIST e" + n + " a0 CDATA #IMPLIED>");
+            }
+            append(eol);
+            append("]>");
+            append(eol);
+        }
+    }
+
+    void CorpusGenerator::writeStartTag(const std::string& name, bool root) {
+        append("<" + name);
+        if (root && parms.namespaceDensity > 0) {
+            for (auto prefix : prefixes)
+                append(std::string(" xmlns:") + prefix + "=\"urn:xmltools:" + prefix + "\"");
+        }
+        else if (chance(parms.namespaceDensity / 4)) {
+            append(" xmlns=\"urn:xmltools:default\"");
+        }
+        for (unsigned i = 0, count = below(2 * parms.attributes + 1); i < count; ++i) {
+            append(" ");
+            if (chance(parms.namespaceDensity)) {
+                append(prefixes[below(countOf(prefixes))]);
+                append(":");
+            }
+            append(attributeNames[i]);
+            const char* quote = below(4) ? "\"" : "'";
+            append("=");
+            append(quote);
+            writeWords(1 + below(2), false);
+            append(quote);
+        }
+    }
+
+    void CorpusGenerator::writeText(bool preserve) {
+        uint64_t start = written;
+        if (preserve) {
+            // whitespace that a formater must keep as it is
+            append(std::string(1 + below(3), ' '));
+            writeWords(2 + below(4), false);
+            append(eol.empty() ? "  " : eol + "   ");
+            writeWords(1 + below(3), false);
+            append(std::string(below(3), '\t'));
+        }
+        textWritten += written - start;
+
+        // tops the character data up to the requested share of the output
+        while (textWritten < parms.textRatio * written) {
+            writeWords(1 + below(6), true);
+        }
+    }
+
+    void CorpusGenerator::writeMisc(size_t depth, bool preserve) {
+        if (chance(parms.commentDensity)) {
+            if (!preserve)
+                newLine(depth);
+            append("<!-- comment " + std::to_string(below(1000)) + " -->");
+        }
+        if (chance(parms.cdataDensity)) {
+            if (!preserve)
+                newLine(depth);
+            append("<![CDATA[ <raw> & \"data\" ");
+            writeWords(1 + below(4), true);
+            append(" ]]>");
+        }
+    }
+
+    void CorpusGenerator::openElement() {
+        Frame& parent = stack.back();
+        size_t depth = stack.size();
+        bool preserve = parent.preserve;
+        parent.hasChildren = true;
+
+        writeMisc(depth, preserve);
+        if (!preserve)
+            newLine(depth);
+
+        Frame frame;
+        frame.name = elementName();
+        frame.hasChildren = false;
+        writeStartTag(frame.name, false);
+        if (!preserve && chance(parms.spacePreserveDensity)) {
+            append(" xml:space=\"preserve\"");
+            preserve = true;
+        }
+        frame.preserve = preserve;
+
+        if (depth + 1 >= parms.maxDepth) {
+            // leaf: text or empty element
+            if (parms.textRatio > 0 || preserve) {
+                append(">");
+                writeText(preserve);
+                append("</" + frame.name + ">");
+            }
+            else {
+                append("/>");
+            }
+            return;
+        }
+
+        append(">");
+        frame.remainingChildren = parms.fanOut == 1 ? 1 : 1 + below(2 * parms.fanOut - 1);
+        stack.push_back(frame);
+    }
+
+    void CorpusGenerator::closeElement() {
+        Frame& frame = stack.back();
+        if (frame.hasChildren && !frame.preserve)
+            newLine(stack.size() - 1);
+        append("</" + frame.name + ">");
+        stack.pop_back();
+    }
+
+    uint64_t CorpusGenerator::write(const Sink& sink) {
+        this->sink = &sink;
+        state = parms.seed;
+        written = 0;
+        textWritten = 0;
+        buffer.clear();
+        buffer.reserve(blockSize + 4096);
+        stack.clear();
+
+        writeProlog();
+        Frame root{ "root", UINT64_MAX, false, false };
+        writeStartTag(root.name, true);
+        append(">");
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            if (written >= parms.size || frame.remainingChildren == 0) {
+                closeElement();
+                continue;
+            }
+            --frame.remainingChildren;
+            openElement();
+        }
+        append(eol);
+        flush();
+        this->sink = nullptr;
+        return written;
+    }
+
+    std::string CorpusGenerator::generate() {
+        std::string xml;
+        xml.reserve((size_t)parms.size + 4096);
+        write([&xml](const char* data, size_t len) { xml.append(data, len); });
+        return xml;
+    }
+
+    const std::vector<Shape>& allShapes() {
+        static const std::vector<Shape> shapes = { Shape::Flat, Shape::Deep, Shape::Attributes, Shape::Text, Shape::Mixed };
+        return shapes;
+    }
+
+    const char* shapeName(Shape shape) {
+        switch (shape) {
+            case Shape::Flat: return "flat";
+            case Shape::Deep: return "deep";
+            case Shape::Attributes: return "attributes";
+            case Shape::Text: return "text";
+            case Shape::Mixed: return "mixed";
+        }
+        return "";
+    }
+
+    CorpusParms shapeParms(Shape shape, uint64_t size, uint64_t seed) {
+        CorpusParms parms;
+        parms.seed = seed;
+        parms.size = size;
+        switch (shape) {
+            case Shape::Flat:
+                parms.maxDepth = 2;
+                parms.attributes = 1;
+                parms.textRatio = 0.2;
+                break;
+            case Shape::Deep:
+                parms.maxDepth = 120;
+                parms.fanOut = 1;
+                parms.attributes = 1;
+                parms.textRatio = 0.05;
+                break;
+            case Shape::Attributes:
+                parms.maxDepth = 4;
+                parms.attributes = 10;
+                parms.textRatio = 0;
+                break;
+            case Shape::Text:
+                parms.maxDepth = 3;
+                parms.fanOut = 4;
+                parms.attributes = 0;
+                parms.textRatio = 0.9;
+                break;
+            case Shape::Mixed:
+                parms.maxDepth = 10;
+                parms.fanOut = 4;
+                parms.textRatio = 0.3;
+                parms.cdataDensity = 0.05;
+                parms.commentDensity = 0.05;
+                parms.namespaceDensity = 0.2;
+                parms.spacePreserveDensity = 0.02;
+                parms.multibyteDensity = 0.1;
+                parms.dtdEntities = 12;
+                parms.lineEnding = LineEnding::CRLF;
+                break;
+        }
+        return parms;
+    }
+}
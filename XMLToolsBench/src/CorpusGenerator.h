@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace XMLToolsBench {
+    enum class LineEnding { LF, CRLF, CR, None };
+
+    // the shape of a generated document; densities are probabilities per node (0..1)
+    struct CorpusParms {
+        uint64_t seed = 1;
+        uint64_t size = 1024 * 1024;        // target size in bytes; the open elements are closed once it is reached
+
+        unsigned maxDepth = 8;              // element depth, the root being at depth 1
+        unsigned fanOut = 8;                // average number of children per element (the root has as many as needed)
+        unsigned attributes = 2;            // average number of attributes per element
+        double textRatio = 0.3;             // share of the output that is character data
+
+        double cdataDensity = 0.0;          // CDATA sections
+        double commentDensity = 0.0;        // comments
+        double namespaceDensity = 0.0;      // prefixed elements and attributes, local namespace declarations
+        double spacePreserveDensity = 0.0;  // elements starting an xml:space="preserve" region
+        double multibyteDensity = 0.0;      // words made of multibyte UTF-8 characters
+
+        unsigned dtdEntities = 0;           // entities declared in the internal DTD subset (with some element and
+                                            // attribute list declarations) and referenced from the text
+
+        LineEnding lineEnding = LineEnding::LF;
+        bool indent = true;                 // indent the markup (needs line endings)
+    };
+
+    /*
+    * Seeded generator of synthetic documents. The same parms always give the same bytes, on every
+    * platform. The output is produced in blocks through a sink, so documents far bigger than the
+    * memory can be written to a file.
+    */
+    class CorpusGenerator {
+    public:
+        typedef std::function<void(const char*, size_t)> Sink;
+
+        CorpusGenerator(const CorpusParms& parms);
+
+        // writes the whole document, returns its size
+        uint64_t write(const Sink& sink);
+
+        // the whole document in memory
+        std::string generate();
+
+    private:
+        struct Frame {
+            std::string name;
+            uint64_t remainingChildren;
+            bool preserve;                  // inside an xml:space="preserve" region
+            bool hasChildren;
+        };
+
+        CorpusParms parms;
+        uint64_t state;
+        std::string eol;
+        std::string buffer;
+        const Sink* sink = nullptr;
+        uint64_t written = 0;
+        uint64_t textWritten = 0;
+        std::vector<Frame> stack;
+
+        uint64_t next();
+        unsigned below(unsigned range);
+        bool chance(double probability);
+
+        std::vector<std::string> elementNames;
+        std::vector<std::string> prefixedNames;
+        std::vector<std::string> textWords;
+        std::vector<std::string> multibyteTextWords;
+        std::vector<std::string> entityReferences;
+        std::vector<std::string> attributeNames;
+
+        void append(const char* s, size_t len);
+        void append(const char* s) { append(s, strlen(s)); }
+        void append(const std::string& s) { append(s.data(), s.size()); }
+        void flush();
+
+        void newLine(size_t depth);
+        const std::string& elementName();
+        const std::string& word();
+        void writeWords(unsigned count, bool text);
+        void writeProlog();
+        void writeStartTag(const std::string& name, bool root);
+        void writeText(bool preserve);
+        void writeMisc(size_t depth, bool preserve);
+        void openElement();
+        void closeElement();
+    };
+
+    // presets used by the benchmarks
+    enum class Shape {
+        Flat,           // many small sibling elements under the root
+        Deep,           // long chains of nested elements
+        Attributes,     // elements carrying many attributes
+        Text,           // few elements with long text content
+        Mixed           // comments, CDATA, namespaces, xml:space, DTD, CRLF and multibyte text
+    };
+
+    const std::vector<Shape>& allShapes();
+    const char* shapeName(Shape shape);
+    CorpusParms shapeParms(Shape shape, uint64_t size, uint64_t seed = 1);
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "AllocationCounter.h"
+#include "CorpusGenerator.h"
+#include "EngineRuns.h"
+
+/*
+* Cross-engine benchmarks: every engine runs every operation it supports on every document shape
+* and size. Besides the time, each run reports
+*   bytes_per_second   input bytes formatted per second (MB/s)
+*   tokens             lexical tokens of the input per second, counted once with the SimpleXml lexer
+*   allocs, alloc_MB   allocations and allocated megabytes per iteration
+*   allocs_per_MB      allocations per megabyte of input, the figure AllocationTests keeps in check
+*   peak_MB, peak_x    highest heap use during an iteration, above the input text held by the
+*                      caller, in megabytes and as a multiple of the input size
+* The path operation (node path at the middle of the document, as the status bar shows it) is run
+* on the text in place, and by quickxml-copy on a copy, as the plugin did before reading the editor
+* buffer directly.
+* pipeline/inline/... against pipeline/pipelined/... runs the SimpleXml pretty printer with the
+* lexer on the calling thread and on a second thread (PrettyPrintParms::pipelined).
+* The documents come from the CorpusGenerator presets (see shapeParms); --corpus_seed=N changes the
+* seed. Use --benchmark_out=<file> --benchmark_out_format=json for a machine readable report.
+*/
+
+namespace XMLToolsBench {
+    struct Document {
+        std::string xml;
+        size_t tokens;
+        size_t errors;      // well-formedness errors found by the SimpleXml checker
+    };
+
+    uint64_t corpusSeed = 1;
+
+    // documents are generated on first use and shared by all engines
+    const Document& document(Shape shape, size_t size) {
+        static std::map<std::pair<Shape, size_t>, Document> documents;
+        auto found = documents.find({ shape, size });
+        if (found == documents.end()) {
+            Document doc;
+            doc.xml = CorpusGenerator(shapeParms(shape, size, corpusSeed)).generate();
+            doc.tokens = runSimpleXml(doc.xml, Operation::Tokenize);
+            doc.errors = runSimpleXml(doc.xml, Operation::Check);
+            found = documents.emplace(std::make_pair(shape, size), std::move(doc)).first;
+        }
+        return found->second;
+    }
+
+    void runBenchmark(benchmark::State& state, Engine engine, Operation op, Shape shape, size_t size) {
+        const Document& doc = document(shape, size);
+        if (doc.errors > 0) {
+            state.SkipWithError("the generated document is not well-formed");
+            return;
+        }
+
+        resetAllocationPeak();
+        AllocationTotals before = allocationTotals();
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(engine(doc.xml, op));
+        }
+        AllocationTotals after = allocationTotals();
+        size_t peak = after.peak - before.live;
+
+        state.SetBytesProcessed((int64_t)(state.iterations() * doc.xml.size()));
+        state.counters["tokens"] = benchmark::Counter((double)(state.iterations() * doc.tokens), benchmark::Counter::kIsRate);
+        state.counters["allocs"] = benchmark::Counter((double)(after.count - before.count), benchmark::Counter::kAvgIterations);
+        state.counters["alloc_MB"] = benchmark::Counter((after.bytes - before.bytes) / (1024.0 * 1024.0), benchmark::Counter::kAvgIterations);
+        state.counters["allocs_per_MB"] = (after.count - before.count) / (double)state.iterations() / (doc.xml.size() / (1024.0 * 1024.0));
+        state.counters["peak_MB"] = peak / (1024.0 * 1024.0);
+        state.counters["peak_x"] = (double)peak / doc.xml.size();
+        state.SetLabel(std::to_string(doc.xml.size()) + " bytes");
+    }
+
+    void registerBenchmarks() {
+        const size_t sizes[] = { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+
+        for (auto& engine : engineEntries()) {
+            for (auto op : engine.operations) {
+                for (auto shape : allShapes()) {
+                    for (auto size : sizes) {
+                        std::string name = std::string(engine.name) + "/" + operationName(op) + "/" + shapeName(shape) + "/" + std::to_string(size / 1024) + "KB";
+                        benchmark::RegisterBenchmark(name.c_str(), runBenchmark, engine.engine, op, shape, size)
+                            ->Unit(benchmark::kMillisecond)
+                            ->UseRealTime();
+                    }
+                }
+            }
+        }
+
+        for (bool pipelined : { false, true }) {
+            for (auto op : { Operation::PrettyPrint, Operation::Linearize }) {
+                for (auto shape : allShapes()) {
+                    for (auto size : sizes) {
+                        std::string name = std::string("pipeline/") + (pipelined ? "pipelined/" : "inline/") + operationName(op) + "/" + shapeName(shape) + "/" + std::to_string(size / 1024) + "KB";
+                        benchmark::RegisterBenchmark(name.c_str(), runBenchmark, pipelined ? runSimpleXmlPipelined : runSimpleXml, op, shape, size)
+                            ->Unit(benchmark::kMillisecond)
+                            ->UseRealTime();
+                    }
+                }
+            }
+        }
+    }
+}
+
+namespace XMLToolsBench {
+    void registerApplyBenchmarks();     // ApplyBenchmarks.cpp
+    void registerMemoryBenchmarks();    // MemoryBenchmarks.cpp
+    void registerXPathBenchmarks();     // XPathBenchmarks.cpp
+}
+
+int main(int argc, char** argv) {
+    // --corpus_seed=N generates other documents of the same shapes
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--corpus_seed=", 14) == 0) {
+            XMLToolsBench::corpusSeed = std::stoull(argv[i] + 14);
+            std::copy(argv + i + 1, argv + argc, argv + i);
+            --argc;
+            --i;
+        }
+    }
+
+    XMLToolsBench::registerBenchmarks();
+    XMLToolsBench::registerApplyBenchmarks();
+    XMLToolsBench::registerMemoryBenchmarks();
+    XMLToolsBench::registerXPathBenchmarks();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+#include "EngineRuns.h"
+
+#include "Checker.h"
+#include "Lexer.h"
+#include "PrettyPrinter.h"
+#include "StringXml.h"
+#include "XmlDocument.h"
+#include "XmlFormater.h"
+#include "XmlParser.h"
+
+namespace XMLToolsBench {
+    const char* operationName(Operation op) {
+        switch (op) {
+            case Operation::PrettyPrint: return "pretty";
+            case Operation::PrettyPrintAttr: return "pretty-attr";
+            case Operation::IndentOnly: return "indent-only";
+            case Operation::Linearize: return "linearize";
+            case Operation::Tokenize: return "tokenize";
+            case Operation::Check: return "check";
+            case Operation::Path: return "path";
+            case Operation::Document: return "document";
+        }
+        return "";
+    }
+
+    namespace {
+        // same setup as the SimpleXml commands of the plugin (see ToolsPrettyPrintFast.cpp)
+        size_t simpleXml(const std::string& xml, Operation op, bool pipelined) {
+            std::function<size_t(size_t, char*, size_t)> chunker = [&xml](size_t pos, char* buffer, size_t size) {
+                if (pos >= xml.size())
+                    return (size_t)0;
+                size_t len = std::min(size, xml.size() - pos);
+                memcpy(buffer, xml.data() + pos, len);
+                return len;
+            };
+            SimpleXml::ChunkedStream stream(1024 * 1024, chunker);
+
+            if (op == Operation::Tokenize) {
+                SimpleXml::Lexer lexer(stream);
+                size_t tokens = 0;
+                while (!lexer.Done() && lexer.peekToken() != SimpleXml::Token::InputEnd) {
+                    lexer.eatToken();
+                    ++tokens;
+                }
+                return tokens;
+            }
+            if (op == Operation::Check) {
+                SimpleXml::ErrorList errors;
+                SimpleXml::Checker checker(stream, errors);
+                checker.Check();
+                return errors.size();
+            }
+
+            SimpleXml::PrettyPrintParms parms;
+            parms.eol = "\n";
+            parms.tab = "\t";
+            parms.insertIndents = true;
+            parms.insertNewLines = true;
+            parms.removeWhitespace = true;
+            parms.autocloseEmptyElements = false;
+            parms.keepExistingBreaks = (op == Operation::IndentOnly);
+            parms.indentAttributes = (op == Operation::PrettyPrintAttr);
+            if (op == Operation::Linearize) {
+                parms.eol = "";
+                parms.tab = "";
+                parms.insertIndents = false;
+                parms.insertNewLines = false;
+            }
+            parms.pipelined = pipelined;
+            SimpleXml::PrettyPrinter prettyPrinter(stream, parms);
+            prettyPrinter.Convert();
+            return prettyPrinter.Text().size();
+        }
+    }
+
+    size_t runSimpleXml(const std::string& xml, Operation op) {
+        return simpleXml(xml, op, false);
+    }
+
+    size_t runSimpleXmlPipelined(const std::string& xml, Operation op) {
+        return simpleXml(xml, op, true);
+    }
+
+    size_t runQuickXmlText(const char* xml, size_t length, Operation op) {
+        if (op == Operation::Tokenize) {
+            QuickXml::XmlParser parser(xml, length);
+            size_t tokens = 0;
+            while (parser.parseNext().type != QuickXml::XmlTokenType::EndOfFile) {
+                ++tokens;
+            }
+            return tokens;
+        }
+
+        // the read-only model the XPath and validation commands query
+        if (op == Operation::Document) {
+            QuickXml::Document document(xml, length);
+            return document.nodeCount();
+        }
+
+        if (op == Operation::Path) {
+            QuickXml::XmlFormater formater(xml, length);
+            return formater.currentPath(length / 2, XPATH_MODE_WITHNAMESPACE)->str().size();
+        }
+
+        QuickXml::XmlFormaterParamsType params;
+        params.indentAttributes = (op == Operation::PrettyPrintAttr || op == Operation::IndentOnly);
+        params.indentOnly = (op == Operation::IndentOnly);
+        QuickXml::XmlFormater formater(xml, length, params);
+        std::stringstream* out = (op == Operation::Linearize) ? formater.linearize() : formater.prettyPrint();
+        return (size_t)out->tellp();
+    }
+
+    size_t runQuickXml(const std::string& xml, Operation op) {
+        return runQuickXmlText(xml.c_str(), xml.length(), op);
+    }
+
+    // the text copied out of the editor first (SCI_GETTEXT into a new buffer)
+    size_t runQuickXmlCopy(const std::string& xml, Operation op) {
+        std::unique_ptr<char[]> copy(new char[xml.length() + 1]);
+        memcpy(copy.get(), xml.c_str(), xml.length() + 1);
+        return runQuickXmlText(copy.get(), xml.length(), op);
+    }
+
+    size_t runStringXml(const std::string& xml, Operation op) {
+        std::string text = xml;
+        StringXml::XmlFormaterParamsType params;
+        StringXml::XmlFormater formater(&text, params);
+        switch (op) {
+            case Operation::PrettyPrint: formater.prettyPrint(); break;
+            case Operation::PrettyPrintAttr: formater.prettyPrintAttr(); break;
+            case Operation::IndentOnly: formater.prettyPrintIndent(); break;
+            case Operation::Linearize: formater.linearize(); break;
+            default: break;
+        }
+        return text.size();
+    }
+
+    const std::vector<EngineEntry>& engineEntries() {
+        static const std::vector<EngineEntry> engines = {
+            { "simplexml", runSimpleXml, { Operation::PrettyPrint, Operation::PrettyPrintAttr, Operation::IndentOnly, Operation::Linearize, Operation::Tokenize, Operation::Check } },
+            { "quickxml", runQuickXml, { Operation::PrettyPrint, Operation::PrettyPrintAttr, Operation::IndentOnly, Operation::Linearize, Operation::Tokenize, Operation::Path, Operation::Document } },
+            { "quickxml-copy", runQuickXmlCopy, { Operation::Tokenize, Operation::Path } },
+            // StringXml edits the text in place and has no separate tokenizer
+            { "stringxml", runStringXml, { Operation::PrettyPrint, Operation::PrettyPrintAttr, Operation::IndentOnly, Operation::Linearize } },
+        };
+        return engines;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+* The engine operations measured by the benchmarks and the allocation tests, each set up as the
+* plugin does it.
+*/
+namespace XMLToolsBench {
+    enum class Operation { PrettyPrint, PrettyPrintAttr, IndentOnly, Linearize, Tokenize, Check, Path, Document };
+
+    const char* operationName(Operation op);
+
+    // runs one operation and returns the size of its result, so that the work is not optimized away
+    typedef std::function<size_t(const std::string&, Operation)> Engine;
+
+    struct EngineEntry {
+        const char* name;
+        Engine engine;
+        std::vector<Operation> operations;
+    };
+
+    // every engine with the operations it supports
+    const std::vector<EngineEntry>& engineEntries();
+
+    size_t runSimpleXml(const std::string& xml, Operation op);
+    // the same, lexing on a second thread (PrettyPrintParms::pipelined)
+    size_t runSimpleXmlPipelined(const std::string& xml, Operation op);
+    size_t runQuickXmlText(const char* xml, size_t length, Operation op);
+    size_t runQuickXml(const std::string& xml, Operation op);
+    size_t runQuickXmlCopy(const std::string& xml, Operation op);
+    size_t runStringXml(const std::string& xml, Operation op);
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "AllocationCounter.h"
+#include "CorpusGenerator.h"
+
+#include "DocumentFormat.h"
+#include "MemoryScintillaDoc.h"
+
+/*
+* Peak heap use of the pretty print command, per engine, on the in-memory ScintillaDoc stand-in:
+*   command/<engine>/run      one document, formatted from the editor (run(): chunked read when the engine can)
+*   command/<engine>/phases   as with several documents: collect (text copy), process, apply
+* peak_MB and peak_x give the highest heap use above the document text, in megabytes and as a
+* multiple of the document size; the editor's own buffer is not part of it. The estimates the
+* memory budget works with are Engine::memoryFactor().
+*/
+
+namespace XMLToolsBench {
+    namespace {
+        typedef FormatDocumentAction<MemoryScintillaDoc> FormatAction;
+
+        const std::string& commandDocument(Shape shape, size_t size) {
+            static std::map<std::pair<Shape, size_t>, std::string> documents;
+            auto found = documents.find({ shape, size });
+            if (found == documents.end())
+                found = documents.emplace(std::make_pair(shape, size), CorpusGenerator(shapeParms(shape, size)).generate()).first;
+            return found->second;
+        }
+
+        void runCommand(benchmark::State& state, std::string engine, bool phases, Shape shape, size_t size) {
+            const std::string& xml = commandDocument(shape, size);
+            FormatAction::Settings settings;
+            settings.engine = engine;
+            // one thread, as the plugin does for several documents; the peak does not depend on it
+            settings.options.allowThreads = false;
+            FormatAction action(settings);
+            MemoryScintillaDoc doc(xml);
+            size_t peak = 0;
+            std::string log;
+
+            for (auto _ : state) {
+                state.PauseTiming();
+                doc.text = xml;
+                // room for the formatted text, so that the stand-in does not count a reallocation
+                doc.text.reserve(2 * xml.size());
+                doc.selectionStart = doc.selectionEnd = 0;
+                resetAllocationPeak();
+                size_t before = allocationTotals().live;
+                state.ResumeTiming();
+
+                std::unique_ptr<FormatAction::Task> task;
+                if (phases) {
+                    task = action.collect(doc);
+                    action.process(*task);
+                    action.apply(doc, *task);
+                }
+                else {
+                    task = action.run(doc);
+                }
+                log = task->log;
+                task.reset();
+
+                state.PauseTiming();
+                peak = std::max(peak, allocationTotals().peak - before);
+                state.ResumeTiming();
+            }
+
+            state.SetBytesProcessed((int64_t)(state.iterations() * xml.size()));
+            state.counters["peak_MB"] = peak / (1024.0 * 1024.0);
+            state.counters["peak_x"] = (double)peak / xml.size();
+            state.SetLabel(log);
+        }
+    }
+
+    void registerMemoryBenchmarks() {
+        const size_t sizes[] = { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+        const Shape shapes[] = { Shape::Flat, Shape::Mixed };
+        for (const char* engine : { "Auto", "SimpleXml", "QuickXml", "StringXml" }) {
+            for (bool phases : { false, true }) {
+                for (Shape shape : shapes) {
+                    for (size_t size : sizes) {
+                        std::string lower(engine);
+                        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+                        std::string name = "command/" + lower + (phases ? "/phases/" : "/run/") + shapeName(shape) + "/" + std::to_string(size / 1024) + "KB";
+                        benchmark::RegisterBenchmark(name.c_str(), runCommand, std::string(engine), phases, shape, size)
+                            ->Unit(benchmark::kMillisecond)
+                            ->UseRealTime();
+                    }
+                }
+            }
+        }
+    }
+}
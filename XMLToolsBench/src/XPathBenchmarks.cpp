@@ -0,0 +1,182 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "CorpusGenerator.h"
+
+#include "XmlIndex.h"
+#include "XPathStream.h"
+
+/*
+* Several streamed XPath expressions on the same document:
+*   xpath/set/<N>    the N expressions evaluated together, in one pass (one automaton)
+*   xpath/each/<N>   one pass per expression, as running them one after the other does
+* The expressions are forward-only paths over the element and attribute names of the generated
+* documents, many of them starting with the same steps, as the queries of an extraction job do.
+* states gives the states of the shared automaton, against the steps of the expressions.
+* One expression on the document model, once it is built:
+*   xpath/scan/<query>    without index, the subtrees are scanned
+*   xpath/index/<query>   with a DocumentIndex built before (a0 being the identity attribute);
+*                         index_ms and index_KB give what building the indexes the query uses cost
+*   xpath/parallel/<T>    a descendant step with a predicate, split across T threads (1 being
+*                         the sequential evaluation); nodes gives the nodes of the document
+*/
+
+namespace XMLToolsBench {
+    namespace {
+        const char* names[] = { "item", "record", "value", "entry", "data", "node", "field", "group" };
+
+        std::vector<QuickXml::XPathExpression> expressions(size_t count) {
+            std::vector<QuickXml::XPathExpression> list;
+            for (size_t i = 0; i < count; ++i) {
+                std::string first = names[(i / 4) % 8], second = names[(i / 32) % 8];
+                std::string attribute = "a" + std::to_string((i / 256) % 3);
+                switch (i % 4) {
+                    case 0: list.emplace_back("/root/" + first + "/" + second); break;
+                    case 1: list.emplace_back("//" + first + "/@" + attribute); break;
+                    case 2: list.emplace_back("//" + first + "[@a0]/" + second); break;
+                    default: list.emplace_back("/root/" + first + "[2]/" + second); break;
+                }
+            }
+            return list;
+        }
+
+        const std::string& xpathDocument(Shape shape, size_t size) {
+            static std::map<std::pair<Shape, size_t>, std::string> documents;
+            auto found = documents.find({ shape, size });
+            if (found == documents.end())
+                found = documents.emplace(std::make_pair(shape, size), CorpusGenerator(shapeParms(shape, size)).generate()).first;
+            return found->second;
+        }
+
+        void runXPath(benchmark::State& state, bool together, size_t count, Shape shape, size_t size) {
+            const std::string& xml = xpathDocument(shape, size);
+            std::vector<QuickXml::XPathExpression> list = expressions(count);
+            size_t steps = 0;
+            for (const auto& expression : list)
+                steps += expression.tree()[expression.root()].steps.size();
+            size_t matches = 0;
+            auto onMatch = [&matches](const QuickXml::XPathMatch&) { ++matches; };
+
+            QuickXml::XPathStream set(list);
+            std::vector<std::unique_ptr<QuickXml::XPathStream>> each;
+            if (!together) {
+                for (const auto& expression : list)
+                    each.push_back(std::make_unique<QuickXml::XPathStream>(expression));
+            }
+
+            for (auto _ : state) {
+                matches = 0;
+                if (together) {
+                    set.run(xml.c_str(), xml.size(), onMatch);
+                }
+                else {
+                    for (auto& stream : each)
+                        stream->run(xml.c_str(), xml.size(), onMatch);
+                }
+                benchmark::DoNotOptimize(matches);
+            }
+
+            state.SetBytesProcessed((int64_t)(state.iterations() * xml.size()));
+            state.counters["matches"] = (double)matches;
+            state.counters["states"] = (double)(together ? set.stateCount() : steps + count);
+            state.SetLabel(std::to_string(count) + " expressions, " + std::to_string(steps) + " steps");
+        }
+
+        // the queries of the index benchmarks: element name, identity attribute value, attribute name
+        std::string indexQuery(const QuickXml::Document& doc, const std::string& query) {
+            if (query != "value")
+                return query == "name" ? "//item" : "//item[@a1]";
+            // a value the document has
+            QuickXml::NameId a0 = doc.findName("a0");
+            for (QuickXml::AttrId attr = 0; attr < doc.attributeCount(); ++attr) {
+                if (doc.attributeNameId(attr) == a0)
+                    return "//*[@a0 = '" + doc.attributeValue(attr) + "']";
+            }
+            return "//*[@a0 = '']";
+        }
+
+        void runIndexed(benchmark::State& state, bool indexed, const std::string& query, Shape shape, size_t size) {
+            const std::string& xml = xpathDocument(shape, size);
+            QuickXml::Document doc(xml.c_str(), xml.size());
+            QuickXml::DocumentIndex index(doc, { "a0" });
+            QuickXml::XPathExpression expression(indexQuery(doc, query));
+            size_t matches = indexed ? expression.evaluate(index).nodes.size() : 0;
+
+            for (auto _ : state) {
+                QuickXml::XPathValue value = indexed ? expression.evaluate(index) : expression.evaluate(doc);
+                matches = value.nodes.size();
+                benchmark::DoNotOptimize(matches);
+            }
+
+            state.SetBytesProcessed((int64_t)(state.iterations() * xml.size()));
+            state.counters["matches"] = (double)matches;
+            double milliseconds = 0;
+            for (auto part : { QuickXml::DocumentIndex::Part::Names, QuickXml::DocumentIndex::Part::Attributes, QuickXml::DocumentIndex::Part::Values })
+                milliseconds += index.stats(part).milliseconds;
+            state.counters["index_ms"] = milliseconds;
+            state.counters["index_KB"] = (double)index.memoryUsage() / 1024;
+            state.SetLabel(expression.expression());
+        }
+
+        void runParallel(benchmark::State& state, unsigned threads, Shape shape, size_t size) {
+            const std::string& xml = xpathDocument(shape, size);
+            QuickXml::Document doc(xml.c_str(), xml.size());
+            QuickXml::XPathExpression expression("//item[contains(., 'a')]");
+            QuickXml::XPathOptions options;
+            options.threads = threads;
+            QuickXml::XPathNode root = QuickXml::XPathNode::tree(doc.root());
+            size_t matches = 0;
+
+            for (auto _ : state) {
+                matches = expression.evaluate(doc, root, options).nodes.size();
+                benchmark::DoNotOptimize(matches);
+            }
+
+            state.SetBytesProcessed((int64_t)(state.iterations() * xml.size()));
+            state.counters["matches"] = (double)matches;
+            state.counters["nodes"] = (double)doc.nodeCount();
+            state.SetLabel(expression.expression());
+        }
+    }
+
+    void registerXPathBenchmarks() {
+        const size_t sizes[] = { 64 * 1024, 1024 * 1024 };
+        const size_t counts[] = { 1, 10, 50, 200 };
+        const Shape shapes[] = { Shape::Attributes, Shape::Mixed };
+        for (bool together : { true, false }) {
+            for (size_t count : counts) {
+                for (Shape shape : shapes) {
+                    for (size_t size : sizes) {
+                        std::string name = std::string("xpath/") + (together ? "set/" : "each/") + std::to_string(count) + "/" + shapeName(shape) + "/" + std::to_string(size / 1024) + "KB";
+                        benchmark::RegisterBenchmark(name.c_str(), runXPath, together, count, shape, size)
+                            ->Unit(benchmark::kMillisecond)
+                            ->UseRealTime();
+                    }
+                }
+            }
+        }
+        for (bool indexed : { false, true }) {
+            for (const char* query : { "name", "value", "attribute" }) {
+                for (size_t size : sizes) {
+                    std::string name = std::string("xpath/") + (indexed ? "index/" : "scan/") + query + "/" + shapeName(Shape::Attributes) + "/" + std::to_string(size / 1024) + "KB";
+                    benchmark::RegisterBenchmark(name.c_str(), runIndexed, indexed, std::string(query), Shape::Attributes, size)
+                        ->Unit(benchmark::kMicrosecond)
+                        ->UseRealTime();
+                }
+            }
+        }
+        for (unsigned threads : { 1u, 2u, 4u, 8u }) {
+            for (size_t size : { (size_t)1024 * 1024, (size_t)8 * 1024 * 1024 }) {
+                std::string name = "xpath/parallel/" + std::to_string(threads) + "/" + shapeName(Shape::Mixed) + "/" + std::to_string(size / 1024) + "KB";
+                benchmark::RegisterBenchmark(name.c_str(), runParallel, threads, Shape::Mixed, size)
+                    ->Unit(benchmark::kMillisecond)
+                    ->UseRealTime();
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "CorpusGenerator.h"
+
+/*
+* xmlgen: writes a synthetic document of the requested size and shape, see CorpusParms.
+*
+*   xmlgen --size 2G --seed 7 --depth 12 --fanout 4 --eol crlf -o big.xml
+*/
+
+using namespace XMLToolsBench;
+
+namespace {
+    void usage() {
+        fprintf(stderr,
+            "usage: xmlgen [options] [-o file]\n"
+            "  --shape NAME          start from a benchmark preset: flat, deep, attributes, text, mixed\n"
+            "  --size N[K|M|G]       target size in bytes (default 1M)\n"
+            "  --seed N              generator seed (default 1)\n"
+            "  --depth N             maximal element depth\n"
+            "  --fanout N            average children per element\n"
+            "  --attributes N        average attributes per element\n"
+            "  --text R              share of character data in the output (0..1)\n"
+            "  --cdata P             CDATA section density (0..1)\n"
+            "  --comments P          comment density (0..1)\n"
+            "  --namespaces P        namespace density (0..1)\n"
+            "  --space-preserve P    xml:space=\"preserve\" region density (0..1)\n"
+            "  --multibyte P         multibyte UTF-8 word density (0..1)\n"
+            "  --dtd N               entities declared in an internal DTD subset\n"
+            "  --eol lf|crlf|cr|none line ending style\n"
+            "  --no-indent           do not indent the markup\n"
+            "  -o FILE               output file (default: standard output)\n");
+    }
+
+    uint64_t parseSize(const std::string& value) {
+        size_t end = 0;
+        uint64_t size = std::stoull(value, &end);
+        std::string unit = value.substr(end);
+        if (unit == "K" || unit == "k" || unit == "KB") size <<= 10;
+        else if (unit == "M" || unit == "m" || unit == "MB") size <<= 20;
+        else if (unit == "G" || unit == "g" || unit == "GB") size <<= 30;
+        else if (!unit.empty()) throw std::invalid_argument("unknown size unit " + unit);
+        return size;
+    }
+
+    double parseRatio(const std::string& value) {
+        double ratio = std::stod(value);
+        if (ratio < 0 || ratio > 1)
+            throw std::invalid_argument("value out of range 0..1: " + value);
+        return ratio;
+    }
+
+    Shape parseShape(const std::string& value) {
+        for (auto shape : allShapes()) {
+            if (value == shapeName(shape))
+                return shape;
+        }
+        throw std::invalid_argument("unknown shape " + value);
+    }
+
+    LineEnding parseLineEnding(const std::string& value) {
+        if (value == "lf") return LineEnding::LF;
+        if (value == "crlf") return LineEnding::CRLF;
+        if (value == "cr") return LineEnding::CR;
+        if (value == "none") return LineEnding::None;
+        throw std::invalid_argument("unknown line ending " + value);
+    }
+}
+
+int main(int argc, char** argv) {
+    CorpusParms parms;
+    std::string output;
+
+    try {
+        // a preset comes first, so the other options refine it whatever their order
+        for (int i = 1; i + 1 < argc; ++i) {
+            if (strcmp(argv[i], "--shape") == 0)
+                parms = shapeParms(parseShape(argv[i + 1]), parms.size);
+        }
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                usage();
+                return 0;
+            }
+            if (arg == "--no-indent") {
+                parms.indent = false;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                usage();
+                return 2;
+            }
+            std::string value = argv[++i];
+            if (arg == "--shape") continue;
+            else if (arg == "--size") parms.size = parseSize(value);
+            else if (arg == "--seed") parms.seed = std::stoull(value);
+            else if (arg == "--depth") parms.maxDepth = (unsigned)std::stoul(value);
+            else if (arg == "--fanout") parms.fanOut = (unsigned)std::stoul(value);
+            else if (arg == "--attributes") parms.attributes = (unsigned)std::stoul(value);
+            else if (arg == "--text") parms.textRatio = parseRatio(value);
+            else if (arg == "--cdata") parms.cdataDensity = parseRatio(value);
+            else if (arg == "--comments") parms.commentDensity = parseRatio(value);
+            else if (arg == "--namespaces") parms.namespaceDensity = parseRatio(value);
+            else if (arg == "--space-preserve") parms.spacePreserveDensity = parseRatio(value);
+            else if (arg == "--multibyte") parms.multibyteDensity = parseRatio(value);
+            else if (arg == "--dtd") parms.dtdEntities = (unsigned)std::stoul(value);
+            else if (arg == "--eol") parms.lineEnding = parseLineEnding(value);
+            else if (arg == "-o") output = value;
+            else {
+                usage();
+                return 2;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "xmlgen: %s\n", e.what());
+        return 2;
+    }
+
+    FILE* out = output.empty() ? stdout : fopen(output.c_str(), "wb");
+    if (out == nullptr) {
+        fprintf(stderr, "xmlgen: cannot open %s\n", output.c_str());
+        return 1;
+    }
+
+    bool failed = false;
+    CorpusGenerator generator(parms);
+    generator.write([out, &failed](const char* data, size_t len) {
+        if (!failed && fwrite(data, 1, len, out) != len)
+            failed = true;
+    });
+
+    if (out != stdout && fclose(out) != 0)
+        failed = true;
+    if (failed) {
+        fprintf(stderr, "xmlgen: write error\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+# Rewrites copies of SAMPLE in place, several at once, and compares them with the output of a
+# single run to standard output.
+#   cmake -DXMLTOOLS=... -DSAMPLE=... -DWORK=... -P InPlaceTest.cmake
+
+set(files)
+foreach(i RANGE 1 6)
+    configure_file(${SAMPLE} ${WORK}-inplace-${i}.xml COPYONLY)
+    list(APPEND files ${WORK}-inplace-${i}.xml)
+endforeach()
+
+execute_process(COMMAND ${XMLTOOLS} pretty -e quickxml ${SAMPLE} OUTPUT_VARIABLE expected RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "xmltools pretty failed: ${result}")
+endif()
+
+execute_process(COMMAND ${XMLTOOLS} pretty -e quickxml -i -j 3 ${files} RESULT_VARIABLE result ERROR_VARIABLE timings)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "xmltools pretty -i -j 3 failed: ${result}\n${timings}")
+endif()
+
+foreach(file ${files})
+    file(READ ${file} actual)
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "${file} differs from the standard output run")
+    endif()
+    string(FIND "${timings}" "${file}: pretty print with QuickXml" found)
+    if(found EQUAL -1)
+        message(FATAL_ERROR "no timing reported for ${file}:\n${timings}")
+    endif()
+endforeach()
+
+file(GLOB leftovers ${WORK}-inplace-*.xml.*)
+if(leftovers)
+    message(FATAL_ERROR "temporary files left: ${leftovers}")
+endif()
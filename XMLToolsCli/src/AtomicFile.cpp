@@ -0,0 +1,80 @@
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "AtomicFile.h"
+
+namespace XMLToolsCli {
+    AtomicFile::AtomicFile(const std::string& path, const std::string& modeFrom) : path(path) {
+#ifndef _WIN32
+        std::string pattern = path + ".XXXXXX";
+        int fd = mkstemp(&pattern[0]);
+        if (fd < 0)
+            throw std::runtime_error("cannot create temporary file: " + std::string(strerror(errno)));
+        tempPath = pattern;
+
+        // mkstemp creates the file private: take the mode of the file replaced, or the default one
+        struct stat st;
+        if (stat(modeFrom.empty() ? path.c_str() : modeFrom.c_str(), &st) == 0) {
+            fchmod(fd, st.st_mode & 07777);
+        }
+        else {
+            mode_t mask = umask(0);
+            umask(mask);
+            fchmod(fd, 0666 & ~mask);
+        }
+        file = fdopen(fd, "wb");
+        if (file == nullptr) {
+            close(fd);
+            remove(tempPath.c_str());
+            throw std::runtime_error("cannot create temporary file: " + std::string(strerror(errno)));
+        }
+#else
+        (void)modeFrom;
+        tempPath = path + ".xmltools.tmp";
+        file = fopen(tempPath.c_str(), "wb");
+        if (file == nullptr)
+            throw std::runtime_error("cannot create temporary file " + tempPath);
+#endif
+    }
+
+    AtomicFile::~AtomicFile() {
+        if (file != nullptr) {
+            fclose(file);
+            remove(tempPath.c_str());
+        }
+    }
+
+    void AtomicFile::write(const char* data, size_t len) {
+        if (!failed && fwrite(data, 1, len, file) != len)
+            failed = true;
+    }
+
+    void AtomicFile::commit() {
+        bool ok = !failed && fflush(file) == 0;
+#ifndef _WIN32
+        // the data must be on disk before the rename makes it visible
+        ok = ok && fsync(fileno(file)) == 0;
+#endif
+        ok = (fclose(file) == 0) && ok;
+        file = nullptr;
+        if (!ok) {
+            remove(tempPath.c_str());
+            throw std::runtime_error("write error");
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            remove(tempPath.c_str());
+            throw std::runtime_error("cannot replace file: " + error.message());
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "OutputSink.h"
+
+namespace XMLToolsCli {
+    /*
+    * Output file written next to its destination under a temporary name and renamed over it by
+    * commit(), so readers never see a partly written file and a failed run leaves the old one
+    * untouched. Without commit() the temporary file is removed. Errors are thrown as
+    * std::runtime_error.
+    */
+    class AtomicFile : public SimpleXml::OutputSink {
+        std::string path;
+        std::string tempPath;
+        FILE* file = nullptr;
+        bool failed = false;
+    public:
+        // modeFrom: file whose permissions the new one gets; by default those of the file replaced
+        AtomicFile(const std::string& path, const std::string& modeFrom = std::string());
+        ~AtomicFile();
+
+        AtomicFile(const AtomicFile&) = delete;
+        AtomicFile& operator=(const AtomicFile&) = delete;
+
+        using OutputSink::write;
+        void write(const char* data, size_t len) override;
+
+        void commit();
+    };
+
+    // writes to a stdio stream, typically stdout
+    class FileOutputSink : public SimpleXml::OutputSink {
+        FILE* file;
+        bool failed = false;
+    public:
+        explicit FileOutputSink(FILE* file) : file(file) {}
+
+        using OutputSink::write;
+        void write(const char* data, size_t len) override {
+            if (!failed && fwrite(data, 1, len, file) != len)
+                failed = true;
+        }
+
+        bool ok() { return !failed && fflush(file) == 0; }
+    };
+}
@@ -0,0 +1,81 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+namespace XMLToolsCli {
+    namespace {
+        std::string readStream(FILE* in) {
+            std::string data;
+            char block[64 * 1024];
+            size_t len;
+            while ((len = fread(block, 1, sizeof(block), in)) > 0)
+                data.append(block, len);
+            if (ferror(in))
+                throw std::runtime_error("read error");
+            return data;
+        }
+    }
+
+    MappedFile::MappedFile(const std::string& path) {
+        if (path == "-") {
+            buffer = readStream(stdin);
+            text = buffer.c_str();
+            size = buffer.size();
+            return;
+        }
+
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error(strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error(strerror(err));
+        }
+        if (S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                // the engines read front to back
+                madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+                close(fd);
+                text = static_cast<const char*>(view);
+                size = (size_t)st.st_size;
+                mapped = true;
+                return;
+            }
+        }
+        close(fd);
+#endif
+
+        // empty files, special files, or no mapping
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("cannot open file");
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (in.bad())
+            throw std::runtime_error("read error");
+        text = buffer.c_str();
+        size = buffer.size();
+    }
+
+    MappedFile::~MappedFile() {
+#ifndef _WIN32
+        if (mapped)
+            munmap(const_cast<char*>(text), size);
+#endif
+    }
+}
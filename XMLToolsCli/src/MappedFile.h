@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace XMLToolsCli {
+    /*
+    * Read-only view of a whole file. The file is mapped into memory where the system allows it, so
+    * multi-GB inputs are paged in by the engines as they read; otherwise (standard input, pipes,
+    * Windows builds) it is read into a buffer. A mapped text is not followed by a NUL byte.
+    * Errors are thrown as std::runtime_error.
+    */
+    class MappedFile {
+        const char* text = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        std::string buffer;
+    public:
+        // "-" is the standard input
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return text; }
+        size_t length() const { return size; }
+        bool isMapped() const { return mapped; }
+    };
+}
@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "AtomicFile.h"
+#include "Checker.h"
+#include "FormatEngine.h"
+#include "MappedFile.h"
+#include "XmlFormater.h"
+#include "XPath.h"
+#include "XPathPlan.h"
+#include "XPathStream.h"
+
+/*
+* xmltools: the formatting engines from the command line.
+*
+*   xmltools pretty -j 8 -i *.xml
+*   xmltools check big.xml
+*   xmltools path-at 1234 doc.xml
+*   xmltools xpath "//a:item[@id]" --ns "xmlns:a='urn:a'" doc.xml
+*   xmltools xpath-set queries.txt huge.xml
+*   xmltools xpath "//item[@id = concat('a', 'b')]" --plan doc.xml
+*/
+
+using namespace XMLToolsCli;
+
+namespace {
+    enum class Command { Format, Check, PathAt, Tokens, XPath, XPathSet };
+
+    struct Settings {
+        Command command = Command::Format;
+        FormatEngine::Operation operation = FormatEngine::Operation::PrettyPrint;
+        FormatEngine::Options options;
+        std::string engine = "auto";
+        size_t offset = 0;              // path-at
+        bool nodeIndex = false;         // path-at
+        std::string expression;         // xpath
+        std::vector<std::string> expressions;   // xpath-set
+        std::string namespaces;         // xpath
+        bool withOffsets = false;       // xpath
+        bool plan = false;              // xpath
+        unsigned xpathThreads = std::max(1u, std::thread::hardware_concurrency());     // xpath, xpath-set
+        std::string output;             // -o
+        bool inPlace = false;
+        unsigned jobs = 1;
+        bool timing = false;
+        std::vector<std::string> files;
+    };
+
+    // what a file gave besides its output: messages for stderr, and success
+    struct Result {
+        std::string messages;
+        bool ok = true;
+    };
+
+    void usage() {
+        fprintf(stderr,
+            "usage: xmltools COMMAND [options] [files]\n"
+            "commands:\n"
+            "  pretty                pretty print\n"
+            "  pretty-attr           pretty print, one attribute per line\n"
+            "  indent-only           fix the indentation, keep the line breaks\n"
+            "  linearize             remove the formatting\n"
+            "  check                 report well-formedness errors\n"
+            "  path-at OFFSET        path of the node at a byte offset\n"
+            "  tokens                list the tokens (QuickXml parser)\n"
+            "  xpath EXPR            nodes selected by an XPath 1.0 expression: type, name and value;\n"
+            "                        forward-only paths are streamed, with -t telling which way\n"
+            "  xpath-set FILE        the same for the expressions of FILE (one per line, # comments),\n"
+            "                        streamed together in one pass; lines start with the expression number\n"
+            "options:\n"
+            "  -o FILE               output file (one input only, default: standard output)\n"
+            "  -i, --in-place        rewrite the input files\n"
+            "  -j N                  process N files at once, reports the time per file\n"
+            "  -t, --time            report the time per file\n"
+            "  -e, --engine NAME     auto, simplexml, quickxml or stringxml (default auto)\n"
+            "  --indent N            indent with N spaces (default: one tab)\n"
+            "  --eol lf|crlf|cr      line ending of the output (default lf)\n"
+            "  --max-indent N        maximal indentation level, 0 for no limit (default 255)\n"
+            "  --autoclose           write <a/> for <a></a>\n"
+            "  --space-preserve      apply xml:space=\"preserve\"\n"
+            "  --no-conformity       let QuickXml trim whitespace that may be significant\n"
+            "  --memory-budget MB    format with SimpleXml the files the engine would format over\n"
+            "                        MB megabytes, fail on those SimpleXml would too\n"
+            "  --index               path-at: add the position of each node\n"
+            "  --ns DECLS            xpath: prefixes of the expression, as \"xmlns:a='urn:a' ...\"\n"
+            "  --offsets             xpath: start each line with the byte offset of the node\n"
+            "  --plan                xpath: write how the expression is evaluated instead of the nodes\n"
+            "  --threads N           xpath, xpath-set: split the descendant steps of the document model\n"
+            "                        expressions across N threads (default: one per core)\n"
+            "Without files, or with \"-\", the standard input is read.\n");
+    }
+
+    bool parseCommand(const std::string& name, Settings& settings) {
+        if (name == "pretty") settings.operation = FormatEngine::Operation::PrettyPrint;
+        else if (name == "pretty-attr") settings.operation = FormatEngine::Operation::PrettyPrintAttr;
+        else if (name == "indent-only") settings.operation = FormatEngine::Operation::IndentOnly;
+        else if (name == "linearize") settings.operation = FormatEngine::Operation::Linearize;
+        else if (name == "check") settings.command = Command::Check;
+        else if (name == "path-at") settings.command = Command::PathAt;
+        else if (name == "tokens") settings.command = Command::Tokens;
+        else if (name == "xpath") settings.command = Command::XPath;
+        else if (name == "xpath-set") settings.command = Command::XPathSet;
+        else return false;
+        return true;
+    }
+
+    std::string parseEol(const std::string& value) {
+        if (value == "lf") return "\n";
+        if (value == "crlf") return "\r\n";
+        if (value == "cr") return "\r";
+        throw std::invalid_argument("unknown line ending " + value);
+    }
+
+    // the lines of an expression file, without the empty ones and the comments
+    std::vector<std::string> readExpressions(const std::string& path) {
+        MappedFile file(path);
+        std::vector<std::string> expressions;
+        const char* end = file.data() + file.length();
+        for (const char* line = file.data(); line < end;) {
+            const char* eol = std::find(line, end, '\n');
+            std::string expression(line, eol);
+            expression.erase(0, expression.find_first_not_of(" \t\r"));
+            expression.erase(expression.find_last_not_of(" \t\r") + 1);
+            if (!expression.empty() && expression[0] != '#')
+                expressions.push_back(expression);
+            line = eol + 1;
+        }
+        if (expressions.empty())
+            throw std::invalid_argument(path + " has no expression");
+        return expressions;
+    }
+
+    // parses the command line; returns false (after printing why) when it is not usable
+    bool parseArguments(int argc, char** argv, Settings& settings) {
+        if (argc < 2 || !parseCommand(argv[1], settings)) {
+            usage();
+            return false;
+        }
+        int i = 2;
+        if (settings.command == Command::PathAt) {
+            if (argc < 3) {
+                usage();
+                return false;
+            }
+            settings.offset = (size_t)std::stoull(argv[i++]);
+        }
+        else if (settings.command == Command::XPath) {
+            if (argc < 3) {
+                usage();
+                return false;
+            }
+            settings.expression = argv[i++];
+        }
+        else if (settings.command == Command::XPathSet) {
+            if (argc < 3) {
+                usage();
+                return false;
+            }
+            settings.expressions = readExpressions(argv[i++]);
+        }
+
+        for (; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "-h" || arg == "--help") { usage(); return false; }
+            else if (arg == "-o") settings.output = value();
+            else if (arg == "-i" || arg == "--in-place") settings.inPlace = true;
+            else if (arg == "-j") { settings.jobs = (unsigned)std::max(1ul, std::stoul(value())); settings.timing = true; }
+            else if (arg == "-t" || arg == "--time") settings.timing = true;
+            else if (arg == "-e" || arg == "--engine") settings.engine = value();
+            else if (arg == "--indent") { unsigned n = (unsigned)std::stoul(value()); settings.options.tab = n ? std::string(n, ' ') : "\t"; }
+            else if (arg == "--eol") settings.options.eol = parseEol(value());
+            else if (arg == "--max-indent") settings.options.maxIndentLevel = (size_t)std::stoul(value());
+            else if (arg == "--autoclose") settings.options.autoclose = true;
+            else if (arg == "--space-preserve") settings.options.applySpacePreserve = true;
+            else if (arg == "--no-conformity") settings.options.ensureConformity = false;
+            else if (arg == "--memory-budget") settings.options.memoryBudget = (size_t)std::stoull(value()) * 1024 * 1024;
+            else if (arg == "--index") settings.nodeIndex = true;
+            else if (arg == "--ns") settings.namespaces = value();
+            else if (arg == "--offsets") settings.withOffsets = true;
+            else if (arg == "--plan") settings.plan = true;
+            else if (arg == "--threads") settings.xpathThreads = (unsigned)std::max(1ul, std::stoul(value()));
+            else if (arg.size() > 1 && arg[0] == '-') throw std::invalid_argument("unknown option " + arg);
+            else settings.files.push_back(arg);
+        }
+        if (settings.files.empty())
+            settings.files.push_back("-");
+
+        if (settings.inPlace && (settings.command != Command::Format || !settings.output.empty()))
+            throw std::invalid_argument("--in-place only applies to the formatting commands, without -o");
+        if (settings.inPlace && std::find(settings.files.begin(), settings.files.end(), "-") != settings.files.end())
+            throw std::invalid_argument("the standard input cannot be rewritten in place");
+        if (!settings.output.empty() && settings.files.size() > 1)
+            throw std::invalid_argument("-o needs a single input file");
+        return true;
+    }
+
+    // a selected node as the xpath commands write it
+    std::string matchLine(const Settings& settings, const QuickXml::XPathMatch& match) {
+        std::string line;
+        if (settings.command == Command::XPathSet)
+            line = std::to_string(match.query + 1) + "\t";
+        if (settings.withOffsets)
+            line += std::to_string(match.offset) + "\t";
+        return line + match.entry.type + "\t" + match.entry.name + "\t" + match.entry.value + "\n";
+    }
+
+    // formats, checks, ... one file; the output goes to out unless the file is rewritten in place
+    Result processFile(const std::string& path, const Settings& settings, SimpleXml::OutputSink& out) {
+        Result result;
+        std::string name = path == "-" ? "<stdin>" : path;
+        try {
+            auto start = std::chrono::steady_clock::now();
+            MappedFile file(path);
+            std::string detail;
+
+            switch (settings.command) {
+                case Command::Format: {
+                    FormatEngine::Input input(file.data(), file.length());
+                    FormatEngine::Engine* engine = &FormatEngine::engineByName(settings.engine);
+                    // the automatic selection is done here, so that the shared engine keeps no state
+                    if (engine == &FormatEngine::autoEngine())
+                        engine = FormatEngine::autoEngine().select(settings.operation, input, settings.options).engine;
+                    engine = FormatEngine::withinMemoryBudget(*engine, settings.operation, input, settings.options).engine;
+                    detail = std::string(FormatEngine::operationName(settings.operation)) + " with " + engine->name();
+
+                    if (settings.inPlace) {
+                        AtomicFile target(path, path);
+                        engine->format(settings.operation, input, settings.options, target);
+                        target.commit();
+                    }
+                    else {
+                        engine->format(settings.operation, input, settings.options, out);
+                    }
+                    break;
+                }
+                case Command::Check: {
+                    SimpleXml::ErrorList errors;
+                    SimpleXml::ChunkedStream stream(file.data(), file.length());
+                    SimpleXml::Checker checker(stream, errors);
+                    checker.parms.resourceLocation = name;
+                    if (!checker.Check())
+                        result.ok = false;
+                    for (const auto& error : errors) {
+                        out.write(error.resourceLocation + ":" + std::to_string(error.line) + ":" + std::to_string(error.column) + ": " + error.message + "\n");
+                    }
+                    detail = std::to_string(checker.errorCount()) + " errors";
+                    break;
+                }
+                case Command::PathAt: {
+                    if (settings.offset > file.length())
+                        throw std::runtime_error("offset " + std::to_string(settings.offset) + " is past the end of the file");
+                    QuickXml::XmlFormater formater(file.data(), file.length());
+                    int mode = XPATH_MODE_WITHNAMESPACE;
+                    if (settings.nodeIndex) mode |= XPATH_MODE_WITHNODEINDEX;
+                    out.write(formater.currentPath(settings.offset, mode)->str() + "\n");
+                    break;
+                }
+                case Command::Tokens: {
+                    QuickXml::XmlFormater formater(file.data(), file.length());
+                    out.write(formater.debugTokens("\n", true) + "\n");
+                    break;
+                }
+                case Command::XPath: {
+                    QuickXml::XPathPlan plan(settings.expression, QuickXml::parseSelectionNamespaces(settings.namespaces));
+                    if (settings.plan) {
+                        out.write(plan.describe());
+                        break;
+                    }
+                    const QuickXml::XPathExpression& expression = plan.expression();
+                    // the matches are written as they come: a stream stops at the first error, after those before it
+                    QuickXml::XPathOptions options;
+                    options.threads = settings.xpathThreads;
+                    QuickXml::XPathRun run = QuickXml::selectMatches(file.data(), file.length(), expression, [&settings, &out](const QuickXml::XPathMatch& match) {
+                        out.write(matchLine(settings, match));
+                    }, options);
+                    if (!run.wellFormed)
+                        throw std::runtime_error("offset " + std::to_string(run.errorOffset) + ": " + run.errorMessage);
+                    detail = std::to_string(run.count) + " nodes, " + (run.strategy == QuickXml::XPathStrategy::Stream ? "streamed" : "document model (" + run.reason + ")");
+                    break;
+                }
+                case Command::XPathSet: {
+                    QuickXml::XPathNamespaces namespaces = QuickXml::parseSelectionNamespaces(settings.namespaces);
+                    std::vector<QuickXml::XPathExpression> expressions;
+                    for (const auto& text : settings.expressions) {
+                        try {
+                            expressions.emplace_back(text, namespaces);
+                        }
+                        catch (const QuickXml::XPathError& e) {
+                            throw std::runtime_error("expression " + std::to_string(expressions.size() + 1) + ": " + e.what());
+                        }
+                    }
+                    QuickXml::XPathOptions options;
+                    options.threads = settings.xpathThreads;
+                    std::vector<QuickXml::XPathRun> runs = QuickXml::selectMatches(file.data(), file.length(), expressions, [&settings, &out](const QuickXml::XPathMatch& match) {
+                        out.write(matchLine(settings, match));
+                    }, options);
+                    size_t nodes = 0, streamed = 0;
+                    for (const auto& run : runs) {
+                        if (!run.wellFormed)
+                            throw std::runtime_error("offset " + std::to_string(run.errorOffset) + ": " + run.errorMessage);
+                        nodes += run.count;
+                        if (run.strategy == QuickXml::XPathStrategy::Stream)
+                            ++streamed;
+                    }
+                    detail = std::to_string(nodes) + " nodes, " + std::to_string(streamed) + " of " + std::to_string(runs.size()) + " expressions streamed";
+                    break;
+                }
+            }
+
+            if (settings.timing) {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                char line[64];
+                snprintf(line, sizeof(line), "%.1f ms, %.1f MB/s", ms, ms > 0 ? file.length() / (ms * 1000.0) : 0.0);
+                result.messages += name + ": " + (detail.empty() ? "" : detail + ", ") + line + "\n";
+            }
+        }
+        catch (const std::exception& e) {
+            result.ok = false;
+            result.messages += "xmltools: " + name + ": " + e.what() + "\n";
+        }
+        return result;
+    }
+
+    // one file after the other, the output streamed as it is produced
+    bool runSequential(const Settings& settings, SimpleXml::OutputSink& out) {
+        bool ok = true;
+        for (const auto& path : settings.files) {
+            Result result = processFile(path, settings, out);
+            fputs(result.messages.c_str(), stderr);
+            ok = ok && result.ok;
+        }
+        return ok;
+    }
+
+    // settings.jobs files at once; outputs and messages are still written in the order of the files
+    bool runParallel(const Settings& settings, SimpleXml::OutputSink& out) {
+        struct Job {
+            SimpleXml::StringOutputSink output;
+            Result result;
+            bool done = false;
+        };
+        std::vector<Job> jobs(settings.files.size());
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::atomic<size_t> next{ 0 };
+
+        auto worker = [&]() {
+            for (size_t i = next++; i < jobs.size(); i = next++) {
+                Result result = processFile(settings.files[i], settings, jobs[i].output);
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs[i].result = std::move(result);
+                jobs[i].done = true;
+                finished.notify_all();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < std::min<size_t>(settings.jobs, jobs.size()); ++t)
+            threads.emplace_back(worker);
+
+        bool ok = true;
+        for (auto& job : jobs) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [&job]() { return job.done; });
+            }
+            out.write(job.output.str());
+            std::string().swap(job.output.str());
+            fputs(job.result.messages.c_str(), stderr);
+            ok = ok && job.result.ok;
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return ok;
+    }
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+    try {
+        if (!parseArguments(argc, argv, settings))
+            return 2;
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "xmltools: %s\n", e.what());
+        return 2;
+    }
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    // the files are formatted on the pool; one file gets the engine's own threads
+    if (settings.jobs > 1 && settings.files.size() > 1)
+        settings.options.allowThreads = false;
+
+    bool ok;
+    if (!settings.output.empty()) {
+        try {
+            AtomicFile out(settings.output);
+            ok = runSequential(settings, out);
+            // a failed check is still a report
+            if (ok || settings.command == Command::Check)
+                out.commit();
+        }
+        catch (const std::exception& e) {
+            fprintf(stderr, "xmltools: %s: %s\n", settings.output.c_str(), e.what());
+            ok = false;
+        }
+    }
+    else {
+        FileOutputSink out(stdout);
+        ok = settings.jobs > 1 && settings.files.size() > 1 ? runParallel(settings, out) : runSequential(settings, out);
+        if (!out.ok()) {
+            fprintf(stderr, "xmltools: write error\n");
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CppUnitTest.h"
+#include "MemoryScintillaDoc.h"
+#include "DocumentFormat.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace XMLToolsTests {
+	typedef FormatDocumentAction<MemoryScintillaDoc> FormatAction;
+
+	std::string sampleDocument(int n) {
+		std::string xml = "<?xml version=\"1.0\"?><root id=\"" + std::to_string(n) + "\">";
+		for (int i = 0; i < 50 + 10 * n; ++i) {
+			xml += "<item a=\"" + std::to_string(i) + "\"><name>n" + std::to_string(i) + "</name><empty></empty></item>";
+		}
+		return xml + "</root>";
+	}
+
+	std::string formatted(const std::string& engine, FormatEngine::Operation op, const std::string& text, const std::string& eol = "\n") {
+		FormatEngine::Options options;
+		options.eol = eol;
+		FormatEngine::Input input(text.c_str(), text.size());
+		SimpleXml::StringOutputSink out;
+		FormatEngine::engineByName(engine).format(op, input, options, out);
+		return out.str();
+	}
+
+	DocumentAccess<MemoryScintillaDoc> accessTo(std::vector<MemoryScintillaDoc>& docs) {
+		return [&docs](size_t index, const std::function<void(MemoryScintillaDoc&)>& fn) {
+			if (!docs[index].IsReadOnly())
+				fn(docs[index]);
+		};
+	}
+
+	// a document read from the thread which owns it only, as the editor answers its messages
+	struct OwnerThreadDoc : public MemoryScintillaDoc {
+		using MemoryScintillaDoc::MemoryScintillaDoc;
+
+		size_t GetText(size_t offset, char* target, size_t length) {
+			Assert::IsTrue(std::this_thread::get_id() == owner);
+			return MemoryScintillaDoc::GetText(offset, target, length);
+		}
+	};
+
+	// fails on the documents whose text starts with "fail"
+	class FailingAction : public DocumentAction<MemoryScintillaDoc> {
+		struct TextTask : public Task {
+			std::string text;
+		};
+	public:
+		std::unique_ptr<Task> collect(MemoryScintillaDoc& doc) override {
+			std::unique_ptr<TextTask> task(new TextTask);
+			task->text = doc.text;
+			return task;
+		}
+		void process(Task& task) override {
+			TextTask& textTask = static_cast<TextTask&>(task);
+			if (textTask.text.compare(0, 4, "fail") == 0)
+				throw std::runtime_error("failed");
+			textTask.text += "!";
+		}
+		void apply(MemoryScintillaDoc& doc, Task& task) override {
+			const std::string& text = static_cast<TextTask&>(task).text;
+			if (text.compare(0, 5, "apply") == 0)
+				throw std::logic_error("apply failed");
+			doc.SetWorkText(text.c_str());
+		}
+	};
+
+	TEST_CLASS(DocumentActionTests) {
+	public:
+		TEST_METHOD(RunFormatsWholeDocumentInChunks) {
+			FormatAction::Settings settings;
+			settings.engine = "SimpleXml";
+			FormatAction action(settings);
+			MemoryScintillaDoc doc(sampleDocument(1));
+			doc.eol = "\r\n";
+			std::string expected = formatted("SimpleXml", FormatEngine::Operation::PrettyPrint, doc.text, "\r\n");
+
+			auto task = action.run(doc);
+
+			Assert::IsTrue(task != nullptr);
+			Assert::AreEqual(expected, doc.text);
+			Assert::AreEqual(1, doc.undoActions);
+			Assert::AreEqual(80, doc.scrollWidth);
+			Assert::IsTrue(task->log.find("SimpleXml") != std::string::npos);
+		}
+
+		TEST_METHOD(RunReadsEditorOnCallingThread) {
+			FormatDocumentAction<OwnerThreadDoc>::Settings settings;
+			settings.engine = "SimpleXml";
+			// pipelined whatever the size, when the engine is free to
+			settings.options.parallelDocumentSize = 0;
+			FormatDocumentAction<OwnerThreadDoc> action(settings);
+			OwnerThreadDoc doc(sampleDocument(40));
+			std::string expected = formatted("SimpleXml", FormatEngine::Operation::PrettyPrint, doc.text);
+
+			action.run(doc);
+
+			Assert::AreEqual(expected, doc.text);
+			Assert::IsTrue(doc.copies > 0);
+			Assert::IsFalse(doc.touchedFromOtherThread);
+		}
+
+		TEST_METHOD(RunFormatsSelectionOnly) {
+			FormatAction::Settings settings;
+			settings.engine = "QuickXml";
+			settings.operation = FormatEngine::Operation::Linearize;
+			FormatAction action(settings);
+			std::string selected = "<a>\n  <b/>\n</a>";
+			MemoryScintillaDoc doc("before" + selected + "after");
+			doc.selectionStart = 6;
+			doc.selectionEnd = 6 + selected.size();
+
+			action.run(doc);
+
+			std::string linearized = formatted("QuickXml", FormatEngine::Operation::Linearize, selected);
+			Assert::AreEqual("before" + linearized + "after", doc.text);
+			// the formatted text stays selected
+			Assert::AreEqual((size_t)6, doc.selectionStart);
+			Assert::AreEqual(6 + linearized.size(), doc.selectionEnd);
+			Assert::AreEqual(doc.selectionEnd, doc.currentPosition);
+		}
+
+		TEST_METHOD(ApplyEditsChangedLinesOnly) {
+			FormatAction::Settings settings;
+			settings.engine = "QuickXml";
+			FormatAction action(settings);
+			std::string expected = formatted("QuickXml", FormatEngine::Operation::PrettyPrint, sampleDocument(2));
+			// a formatted document with two lines to fix
+			std::string text = expected;
+			text.replace(text.find("<name>n7</name>"), 15, "<name>n7</name  >");
+			text.insert(text.rfind("<item"), "   ");
+			MemoryScintillaDoc doc(text);
+			doc.currentPosition = doc.selectionStart = doc.selectionEnd = text.rfind("<item");
+
+			auto task = action.run(doc);
+
+			Assert::AreEqual(expected, doc.text);
+			Assert::AreEqual(1, doc.undoActions);
+			Assert::AreEqual(2, doc.replaceCount);
+			Assert::AreEqual((size_t)5, doc.replacedBytes);
+			Assert::AreEqual(expected.rfind("<item"), doc.currentPosition);
+			Assert::IsTrue(task->log.find("2 edits") != std::string::npos);
+		}
+
+		TEST_METHOD(ApplyWithoutChangeKeepsUndoHistory) {
+			FormatAction::Settings settings;
+			settings.engine = "SimpleXml";
+			FormatAction action(settings);
+			MemoryScintillaDoc doc(formatted("SimpleXml", FormatEngine::Operation::PrettyPrint, sampleDocument(1)));
+
+			action.run(doc);
+
+			Assert::AreEqual(0, doc.undoActions);
+			Assert::AreEqual(0, doc.replaceCount);
+		}
+
+		TEST_METHOD(ConcurrentMatchesSequential) {
+			FormatAction::Settings settings;
+			settings.operation = FormatEngine::Operation::PrettyPrintAttr;
+			FormatAction action(settings);
+
+			std::vector<MemoryScintillaDoc> sequential, concurrent;
+			for (int i = 0; i < 12; ++i) {
+				sequential.emplace_back(sampleDocument(i));
+				concurrent.emplace_back(sampleDocument(i));
+			}
+			concurrent[3].selectionStart = sequential[3].selectionStart = 21;
+			concurrent[3].selectionEnd = sequential[3].selectionEnd = 21 + 120;
+
+			runDocumentAction<MemoryScintillaDoc>(action, sequential.size(), accessTo(sequential), 1);
+			std::vector<size_t> appliedOrder;
+			runDocumentAction<MemoryScintillaDoc>(action, concurrent.size(), accessTo(concurrent), 4,
+				[&appliedOrder](size_t index, MemoryScintillaDoc&, const FormatAction::Task& task) {
+					appliedOrder.push_back(index);
+					Assert::IsFalse(task.log.empty());
+				});
+
+			for (size_t i = 0; i < concurrent.size(); ++i) {
+				Assert::AreEqual(sequential[i].text, concurrent[i].text);
+				Assert::AreEqual(1, concurrent[i].undoActions);
+				Assert::IsFalse(concurrent[i].touchedFromOtherThread);
+				Assert::AreEqual(i, appliedOrder[i]);
+			}
+		}
+
+		TEST_METHOD(SkippedDocumentsAreLeftAlone) {
+			FormatAction action{ FormatAction::Settings() };
+			std::vector<MemoryScintillaDoc> docs;
+			for (int i = 0; i < 4; ++i)
+				docs.emplace_back(sampleDocument(i));
+			docs[2].readOnly = true;
+			std::string readOnlyText = docs[2].text;
+
+			runDocumentAction<MemoryScintillaDoc>(action, docs.size(), accessTo(docs), 3);
+
+			Assert::AreEqual(readOnlyText, docs[2].text);
+			Assert::AreEqual(0, docs[2].undoActions);
+			Assert::AreEqual(1, docs[3].undoActions);
+		}
+
+		TEST_METHOD(FailureKeepsDocumentAndRethrows) {
+			FailingAction action;
+			std::vector<MemoryScintillaDoc> docs = { MemoryScintillaDoc("one"), MemoryScintillaDoc("fail"), MemoryScintillaDoc("three") };
+
+			bool thrown = false;
+			try {
+				runDocumentAction<MemoryScintillaDoc>(action, docs.size(), accessTo(docs), 2);
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+
+			Assert::IsTrue(thrown);
+			Assert::AreEqual(std::string("one!"), docs[0].text);
+			Assert::AreEqual(std::string("fail"), docs[1].text);
+			Assert::AreEqual(std::string("three!"), docs[2].text);
+		}
+
+		TEST_METHOD(ApplyFailureStopsPoolAndRethrows) {
+			FailingAction action;
+			std::vector<MemoryScintillaDoc> docs;
+			for (const char* text : { "one", "two", "apply", "four", "five", "six", "seven", "eight" })
+				docs.emplace_back(text);
+
+			bool thrown = false;
+			try {
+				runDocumentAction<MemoryScintillaDoc>(action, docs.size(), accessTo(docs), 4);
+			}
+			catch (const std::logic_error&) {
+				thrown = true;
+			}
+
+			Assert::IsTrue(thrown);
+			Assert::AreEqual(std::string("one!"), docs[0].text);
+			Assert::AreEqual(std::string("two!"), docs[1].text);
+			// the failed document and the ones after it are left as they are
+			Assert::AreEqual(std::string("apply"), docs[2].text);
+			for (size_t i = 3; i < docs.size(); ++i)
+				Assert::AreEqual(0, docs[i].setTextCount);
+		}
+
+				TEST_METHOD(MemoryBudgetSwitchesOrRefusesEachDocument) {
+			std::vector<MemoryScintillaDoc> docs = { MemoryScintillaDoc(sampleDocument(0)), MemoryScintillaDoc(sampleDocument(1500)), MemoryScintillaDoc(sampleDocument(3000)) };
+			std::vector<std::string> texts = { docs[0].text, docs[1].text, docs[2].text };
+			FormatAction::Settings settings;
+			settings.engine = "QuickXml";
+			// QuickXml fits for the first document only, SimpleXml for the first two
+			settings.options.memoryBudget = FormatEngine::simpleXmlEngine().estimatedPeak(texts[1].size());
+			Assert::IsTrue(FormatEngine::quickXmlEngine().estimatedPeak(texts[0].size()) <= settings.options.memoryBudget);
+			Assert::IsTrue(FormatEngine::quickXmlEngine().estimatedPeak(texts[1].size()) > settings.options.memoryBudget);
+			FormatAction action(settings);
+
+			std::vector<std::string> logs(docs.size());
+			bool refused = false;
+			try {
+				runDocumentAction<MemoryScintillaDoc>(action, docs.size(), accessTo(docs), 2,
+					[&logs](size_t index, MemoryScintillaDoc&, const FormatAction::Task& task) { logs[index] = task.log; });
+			}
+			catch (const FormatEngine::MemoryBudgetError&) {
+				refused = true;
+			}
+
+			Assert::IsTrue(refused);
+			Assert::AreEqual(formatted("QuickXml", FormatEngine::Operation::PrettyPrint, texts[0]), docs[0].text);
+			Assert::AreEqual(formatted("SimpleXml", FormatEngine::Operation::PrettyPrint, texts[1]), docs[1].text);
+			Assert::IsTrue(logs[1].find("memory budget") != std::string::npos);
+			// the refused document is neither copied nor changed
+			Assert::AreEqual(texts[2], docs[2].text);
+			Assert::AreEqual(0, docs[2].copies);
+			Assert::AreEqual(0, docs[2].undoActions);
+		}
+	};
+}
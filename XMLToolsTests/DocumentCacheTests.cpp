@@ -0,0 +1,149 @@
+#include <memory>
+#include <string>
+
+#include "CppUnitTest.h"
+#include "MemoryScintillaDoc.h"
+#include "DocumentCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace XMLToolsTests {
+	TEST_CLASS(DocumentCacheTests) {
+	public:
+		TEST_METHOD(ReusedUntilModified) {
+			MemoryScintillaDoc doc("<doc xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:noNamespaceSchemaLocation=\"doc.xsd\"><a/></doc>");
+			DocumentCache cache;
+
+			std::shared_ptr<const ParsedDocument> first = cache.get(1, 1, doc);
+			Assert::IsTrue(first->document.wellFormed());
+			Assert::AreEqual(std::string("doc"), first->hints.rootName);
+			Assert::IsTrue(first->hints.schemaLocation);
+			Assert::IsTrue(first->stylesheet == false);
+			Assert::IsTrue(first == cache.get(1, 1, doc));
+
+			// same length, other text: only the notification tells
+			doc.text.replace(doc.text.find("<a/>"), 4, "<b/>");
+			Assert::IsTrue(first == cache.get(1, 1, doc));
+			cache.modified(1);
+			std::shared_ptr<const ParsedDocument> second = cache.get(1, 1, doc);
+			Assert::IsTrue(first != second);
+			Assert::AreEqual(doc.text, second->text);
+
+			// the document given before stays valid
+			Assert::AreEqual(std::string("a"), std::string(first->document.name(first->document.firstChild(first->document.documentElement()))));
+
+			DocumentCache::Stats stats = cache.stats();
+			Assert::AreEqual((size_t)2, stats.hits);
+			Assert::AreEqual((size_t)2, stats.misses);
+			Assert::AreEqual((size_t)1, stats.entries);
+			Assert::AreEqual(0, doc.copies);
+		}
+
+		TEST_METHOD(LengthChangeWithoutNotification) {
+			MemoryScintillaDoc doc("<a/>");
+			DocumentCache cache;
+
+			std::shared_ptr<const ParsedDocument> first = cache.get(1, 1, doc);
+			doc.text = "<a><b/></a>";
+			std::shared_ptr<const ParsedDocument> second = cache.get(1, 1, doc);
+			Assert::IsTrue(first != second);
+			Assert::AreEqual(doc.text, second->text);
+		}
+
+		TEST_METHOD(BuffersAreKeptApart) {
+			MemoryScintillaDoc doc1("<a/>"), doc2("<xsl:stylesheet xmlns:xsl=\"http://www.w3.org/1999/XSL/Transform\" version=\"1.0\"/>");
+			DocumentCache cache;
+
+			std::shared_ptr<const ParsedDocument> parsed1 = cache.get(1, 1, doc1);
+			std::shared_ptr<const ParsedDocument> parsed2 = cache.get(2, 2, doc2);
+			Assert::IsFalse(parsed1->stylesheet);
+			Assert::IsTrue(parsed2->stylesheet);
+
+			cache.modified(1);
+			Assert::IsTrue(parsed2 == cache.get(2, 2, doc2));
+			Assert::IsTrue(parsed1 != cache.get(1, 1, doc1));
+
+			cache.closed(2);
+			Assert::AreEqual((size_t)1, cache.stats().entries);
+			Assert::IsTrue(parsed2 != cache.get(2, 2, doc2));
+		}
+
+		TEST_METHOD(ModifiedThroughTheDocument) {
+			MemoryScintillaDoc doc1("<a><b/></a>"), doc2("<c><d/></c>");
+			DocumentCache cache;
+
+			// buffers 1 and 2 hold the Scintilla documents 10 and 20
+			std::shared_ptr<const ParsedDocument> parsed1 = cache.get(1, 10, doc1);
+			std::shared_ptr<const ParsedDocument> parsed2 = cache.get(2, 20, doc2);
+
+			// an edit of buffer 2 through any window, the current one of a view or not
+			doc2.text.replace(doc2.text.find("<d/>"), 4, "<e/>");
+			cache.modified(20);
+			Assert::IsTrue(parsed1 == cache.get(1, 10, doc1));
+			std::shared_ptr<const ParsedDocument> edited = cache.get(2, 20, doc2);
+			Assert::IsTrue(parsed2 != edited);
+			Assert::AreEqual(doc2.text, edited->text);
+
+			// a document no command has read
+			cache.modified(30);
+			Assert::IsTrue(parsed1 == cache.get(1, 10, doc1));
+
+			cache.closed(1);
+			Assert::AreEqual((size_t)1, cache.stats().entries);
+			Assert::IsTrue(edited == cache.get(2, 20, doc2));
+			Assert::IsTrue(parsed1 != cache.get(1, 10, doc1));
+		}
+
+		TEST_METHOD(IndexedWithTheIdentityAttributes) {
+			MemoryScintillaDoc doc("<a><b id=\"1\" key=\"k\"/><b key=\"1\"/></a>");
+			DocumentCache cache;
+
+			std::shared_ptr<const ParsedDocument> first = cache.get(1, 1, doc);
+			Assert::AreEqual((size_t)1, first->index.elementsWithValue(first->document.findName("id"), "1").size());
+			cache.setIdentityAttributes({ "id", "name" });
+			Assert::IsTrue(first == cache.get(1, 1, doc));
+
+			// the documents indexed with other attributes are parsed again
+			cache.setIdentityAttributes({ "key" });
+			std::shared_ptr<const ParsedDocument> second = cache.get(1, 1, doc);
+			Assert::IsTrue(first != second);
+			Assert::AreEqual((size_t)1, second->index.elementsWithValue(second->document.findName("key"), "1").size());
+			Assert::AreEqual((size_t)0, second->index.elementsWithValue(second->document.findName("id"), "1").size());
+		}
+
+		TEST_METHOD(LeastRecentlyUsedEvictedOverCapacity) {
+			MemoryScintillaDoc doc1("<a><b/><b/></a>"), doc2("<c><d/><d/></c>"), doc3("<e><f/><f/></e>");
+			DocumentCache probe;
+			size_t size = probe.get(0, 0, doc1)->memoryUsage();
+
+			DocumentCache cache(2 * size + size / 2);
+			std::shared_ptr<const ParsedDocument> parsed1 = cache.get(1, 1, doc1);
+			std::shared_ptr<const ParsedDocument> parsed2 = cache.get(2, 2, doc2);
+			cache.get(1, 1, doc1);		// 2 is now the least recently used
+			cache.get(3, 3, doc3);
+
+			DocumentCache::Stats stats = cache.stats();
+			Assert::AreEqual((size_t)1, stats.evictions);
+			Assert::AreEqual((size_t)2, stats.entries);
+			Assert::IsTrue(stats.bytes <= 2 * size + size / 2);
+			Assert::IsTrue(parsed1 == cache.get(1, 1, doc1));
+			Assert::IsTrue(parsed2 != cache.get(2, 2, doc2));
+
+			// a document larger than the cache is kept alone, until another one is parsed
+			cache.setCapacity(size / 2);
+			Assert::AreEqual((size_t)1, cache.stats().entries);
+			std::shared_ptr<const ParsedDocument> large = cache.get(1, 1, doc1);
+			Assert::IsTrue(large->document.wellFormed());
+			Assert::AreEqual((size_t)1, cache.stats().entries);
+			Assert::IsTrue(large == cache.get(1, 1, doc1));
+			Assert::IsTrue(parsed2 != cache.get(2, 2, doc2));
+			Assert::AreEqual((size_t)1, cache.stats().entries);
+
+			// nothing is kept by a disabled cache
+			cache.setCapacity(0);
+			Assert::AreEqual((size_t)0, cache.stats().entries);
+			Assert::IsTrue(cache.get(1, 1, doc1) != cache.get(1, 1, doc1));
+			Assert::AreEqual((size_t)0, cache.stats().entries);
+		}
+	};
+}
@@ -0,0 +1,74 @@
+#include <string>
+
+#include "CppUnitTest.h"
+#include "MemoryScintillaDoc.h"
+#include "DocumentQueries.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace XMLToolsTests {
+	TEST_CLASS(DocumentQueriesTests) {
+	public:
+		TEST_METHOD(CurrentPathReadsInPlace) {
+			MemoryScintillaDoc doc("<root><a:div xmlns:a=\"urn:a\"></a:div><a:div xmlns:a=\"urn:a\">test</a:div></root>");
+			doc.currentPosition = doc.text.find("test");
+			QuickXml::XmlFormaterParamsType params = QuickXml::XmlFormater::getDefaultParams();
+
+			std::string copy = doc.text;
+			QuickXml::XmlFormater formater(copy.c_str(), copy.length(), params);
+			std::string expected = formater.currentPath(doc.currentPosition, XPATH_MODE_WITHNAMESPACE | XPATH_MODE_WITHNODEINDEX)->str();
+
+			Assert::AreEqual(expected, documentCurrentPath(doc, doc.currentPosition, XPATH_MODE_WITHNAMESPACE | XPATH_MODE_WITHNODEINDEX, params));
+			Assert::AreEqual(std::string("/root/a:div[2]"), expected);
+			Assert::AreEqual(0, doc.copies);
+		}
+
+		TEST_METHOD(TokensOfSelectionStopAtItsEnd) {
+			// the selection is followed by more markup, which must not be tokenized with it
+			std::string selected = "<b x='1'><!-- c";
+			MemoryScintillaDoc doc("<a>" + selected + " --></b></a>");
+			doc.selectionStart = 3;
+			doc.selectionEnd = 3 + selected.size();
+			QuickXml::XmlFormaterParamsType params = QuickXml::XmlFormater::getDefaultParams();
+
+			QuickXml::XmlFormater formater(selected.c_str(), selected.length(), params);
+			std::string expected = formater.debugTokens("\n", true);
+
+			Assert::AreEqual(expected, documentTokens(doc, "\n", params));
+			Assert::IsTrue(doc.inSelection);
+			Assert::AreEqual(0, doc.copies);
+		}
+
+		TEST_METHOD(HasDoctype) {
+			std::string internal = "<?xml version=\"1.0\"?><!DOCTYPE a [<!ELEMENT a (#PCDATA)>]><a/>";
+			std::string external = "<!-- x --><!DOCTYPE a SYSTEM \"a.dtd\"><a/>";
+			std::string none = "<?xml version=\"1.0\"?><a><!DOCTYPE b></a>";
+
+			Assert::IsTrue(hasDoctype(internal.c_str(), internal.size()));
+			Assert::IsTrue(hasDoctype(external.c_str(), external.size()));
+			Assert::IsFalse(hasDoctype(none.c_str(), none.size()));
+			// a range cut in the middle of the declaration name
+			Assert::IsFalse(hasDoctype(external.c_str(), external.find("DOCTYPE") + 3));
+		}
+
+		TEST_METHOD(ValidationHintsOfRootElement) {
+			std::string noNamespace = "<?xml version=\"1.0\"?>\n<x:doc xmlns:x=\"urn:x\" xmlns:i=\"http://www.w3.org/2001/XMLSchema-instance\" i:noNamespaceSchemaLocation=\"doc.xsd\"/>";
+			ValidationHints hints = validationHints(noNamespace.c_str(), noNamespace.size());
+			Assert::AreEqual(std::string("x:doc"), hints.rootName);
+			Assert::IsTrue(hints.schemaLocation);
+			Assert::IsFalse(hints.doctype);
+
+			std::string located = "<doc xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:schemaLocation=\"urn:d doc.xsd\"/>";
+			Assert::IsTrue(validationHints(located.c_str(), located.size()).schemaLocation);
+
+			// the attribute must be in the schema instance namespace, and on the root element
+			std::string other = "<doc xmlns:xsi=\"urn:other\" xsi:schemaLocation=\"doc.xsd\"><a xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:schemaLocation=\"a.xsd\"/></doc>";
+			hints = validationHints(other.c_str(), other.size());
+			Assert::AreEqual(std::string("doc"), hints.rootName);
+			Assert::IsFalse(hints.schemaLocation);
+
+			std::string dtd = "<!DOCTYPE doc SYSTEM \"doc.dtd\"><doc/>";
+			Assert::IsTrue(validationHints(dtd.c_str(), dtd.size()).doctype);
+		}
+	};
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+/*
+* In-memory stand-in for ScintillaDoc, with the members the document actions use, so that they
+* can be tested without an editor. Every call records the thread it came from.
+*/
+struct MemoryScintillaDoc {
+	std::string text;
+	size_t selectionStart = 0;
+	size_t selectionEnd = 0;
+	std::string eol = "\n";
+	bool useTabs = true;
+	bool readOnly = false;
+	size_t currentPosition = 0;
+
+	bool inSelection = false;
+	int setTextCount = 0;
+	int scrollWidth = 0;
+	int copies = 0;				// texts copied out of the document (GetText, GetWorkText)
+	int undoActions = 0;		// undo actions ended
+	int undoDepth = 0;
+	int replaceCount = 0;		// ReplaceTarget calls
+	size_t replacedBytes = 0;	// chars removed and inserted by ReplaceTarget
+	bool touchedFromOtherThread = false;
+	std::thread::id owner = std::this_thread::get_id();
+
+	struct sciWorkText {
+		char* text;
+		intptr_t length;
+		intptr_t selstart;
+
+		operator bool() {
+			return text != NULL;
+		}
+
+		void FreeMemory() {
+			if (text) {
+				delete[] text;
+				text = NULL;
+			}
+		}
+	};
+
+	struct sciTextView {
+		const char* text;
+		intptr_t length;
+		intptr_t selstart;
+
+		operator bool() {
+			return text != NULL;
+		}
+	};
+
+	MemoryScintillaDoc(const std::string& text) : text(text) {}
+
+	void touch() {
+		if (std::this_thread::get_id() != owner)
+			touchedFromOtherThread = true;
+	}
+
+	bool IsReadOnly() { touch(); return readOnly; }
+	std::string Tab() { touch(); return useTabs ? "\t" : "    "; }
+	std::string EOL() { touch(); return eol; }
+	size_t SelectionStart() { touch(); return selectionStart; }
+	size_t SelectionEnd() { touch(); return selectionEnd; }
+	size_t GetTextLength() { touch(); return text.size(); }
+	size_t CurrentPosition() { touch(); return currentPosition; }
+
+	// like SCI_GETTEXTRANGE, terminates the range
+	size_t GetText(size_t offset, char* target, size_t length) {
+		touch();
+		++copies;
+		if (offset >= text.size()) return 0;
+		if (length > text.size() - offset) length = text.size() - offset;
+		memcpy(target, text.data() + offset, length);
+		target[length] = 0;
+		return length;
+	}
+
+	sciWorkText GetWorkText() {
+		touch();
+		++copies;
+		size_t start = 0, end = text.size();
+		inSelection = selectionEnd > selectionStart;
+		if (inSelection) {
+			start = selectionStart;
+			end = selectionEnd;
+		}
+		char* copy = new char[end - start + 1];
+		memcpy(copy, text.data() + start, end - start);
+		copy[end - start] = 0;
+		return { copy, (intptr_t)(end - start), inSelection ? (intptr_t)start : -1 };
+	}
+
+	// null terminated, as SCI_GETCHARACTERPOINTER
+	sciTextView GetCharacterPointer() {
+		touch();
+		return { text.c_str(), (intptr_t)text.size(), -1 };
+	}
+
+	// not terminated, as SCI_GETRANGEPOINTER
+	sciTextView GetRangePointer(size_t start, size_t length) {
+		touch();
+		return { text.data() + start, (intptr_t)length, (intptr_t)start };
+	}
+
+	sciTextView GetWorkTextView() {
+		touch();
+		inSelection = selectionEnd > selectionStart;
+		if (inSelection)
+			return GetRangePointer(selectionStart, selectionEnd - selectionStart);
+		return GetCharacterPointer();
+	}
+
+	void SetWorkText(const char* newText) {
+		touch();
+		++setTextCount;
+		if (inSelection) {
+			text.replace(selectionStart, selectionEnd - selectionStart, newText);
+			selectionEnd = selectionStart + strlen(newText);
+		}
+		else {
+			text = newText;
+		}
+	}
+
+	void SetCurrentPosition(size_t pos) { touch(); currentPosition = pos; selectionEnd = pos; }
+	void SetAnchor(size_t pos) { touch(); selectionStart = pos; }
+
+	// the selection and the caret follow the change, as in Scintilla
+	void ReplaceTarget(size_t start, size_t length, const char* newText, size_t newLength) {
+		touch();
+		++replaceCount;
+		replacedBytes += length + newLength;
+		text.replace(start, length, newText, newLength);
+		auto follow = [start, length, newLength](size_t& pos) {
+			if (pos >= start + length) pos = pos - length + newLength;
+			else if (pos > start) pos = start + newLength;
+		};
+		follow(selectionStart);
+		follow(selectionEnd);
+		follow(currentPosition);
+	}
+
+	void BeginUndoAction() { touch(); ++undoDepth; }
+	void EndUndoAction() { touch(); if (--undoDepth == 0) ++undoActions; }
+
+	void SetScrollWidth(int width) { touch(); scrollWidth = width; }
+	void SetXOffset(int) { touch(); }
+};
@@ -4,11 +4,12 @@
 #include "StdAfx.h"
 #include "Scintilla.h"
 #include "XMLTools.h"
+#include "nppHelpers.h"
 #include "XpathEvalDlg.h"
 #include "Report.h"
 #include "MSXMLHelper.h"
 #include "XmlWrapperInterface.h"
-#include "MSXMLWrapper.h"
+#include "QuickXmlWrapper.h"
 #include <assert.h>
 
 #ifdef _DEBUG
@@ -31,6 +32,7 @@ CXPathEvalDlg::CXPathEvalDlg(CWnd* pParent /*=NULL*/, unsigned long flags /*= 0*
   //}}AFX_DATA_INIT
 
   this->m_iFlags = flags;
+  this->m_iCachedRow = -1;
 }
 
 
@@ -49,6 +51,7 @@ BEGIN_MESSAGE_MAP(CXPathEvalDlg, CDialog)
   ON_BN_CLICKED(IDC_BTN_EVALUATE, OnBtnEvaluate)
   ON_BN_CLICKED(IDC_BTN_COPY2CLIPBOARD, OnBnClickedBtnCopy2clipboard)
   ON_WM_SIZE()
+  ON_NOTIFY(LVN_GETDISPINFO, IDC_LIST_XPATHRESULTS, OnGetDispInfoResults)
   //}}AFX_MSG_MAP
 //  ON_WM_DESTROY()
 //ON_WM_CLOSE()
@@ -88,22 +91,17 @@ int CXPathEvalDlg::execute_xpath_expression(CStringW xpathExpr) {
     ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTSCINTILLA, 0, (LPARAM)&currentEdit);
     HWND hCurrentEditView = getCurrentHScintilla(currentEdit);
 
-    size_t currentLength = (size_t) ::SendMessage(hCurrentEditView, SCI_GETLENGTH, 0, 0);
+    // the document model is shared with the other commands, and kept until the buffer is modified
+    std::shared_ptr<const ParsedDocument> parsed = currentParsedDocument();
 
-    char* data = new char[currentLength + sizeof(char)];
-    if (!data) return(-1);  // allocation error, abort check
-    memset(data, '\0', currentLength + sizeof(char));
+    XmlWrapperInterface* wrapper = new QuickXmlWrapper(parsed, Report::getEncoding(nppData._nppHandle));
 
-    ::SendMessage(hCurrentEditView, SCI_GETTEXT, currentLength + sizeof(char), reinterpret_cast<LPARAM>(data));
-
-    XmlWrapperInterface* wrapper = new MSXMLWrapper(data, currentLength);
-    delete[] data; data = NULL;
-
-    std::vector<XPathResultEntryType> nodes = wrapper->xpathEvaluate(xpathExpr.GetString(), m_sNamespace.GetString());
+    // the cursor keeps the document model alive; the rows are only built when the list shows them
+    std::unique_ptr<XPathResultCursor> nodes = wrapper->xpathCursor(xpathExpr.GetString(), m_sNamespace.GetString());
 
     std::vector<ErrorEntryType> errors = wrapper->getLastErrors();
     if (errors.empty()) {
-        print_xpath_nodes(nodes);
+        print_xpath_nodes(std::move(nodes));
     }
     else {
         displayXMLErrors(errors, hCurrentEditView, L"Error: unable to parse XML", ERRORS_DISPLAY_MODE_ALERT);
@@ -114,29 +112,42 @@ int CXPathEvalDlg::execute_xpath_expression(CStringW xpathExpr) {
     return 0;
 }
 
-void CXPathEvalDlg::AddToList(CListCtrl *list, CStringW type, CStringW name, CStringW value) {
-  int idx = list->GetItemCount();
-  list->InsertItem(idx, type);
-  list->SetItemText(idx, 1, name);
-  list->SetItemText(idx, 2, value);
-
-  this->m_sResult.AppendFormat(L"%s\t%s\t%s\n", type.GetString(), name.GetString(), value.GetString());
+// a row of the results; the list asks for each column of a row in turn, so the last row is kept
+const XPathResultEntryType& CXPathEvalDlg::resultRow(int index) {
+    if (index != this->m_iCachedRow) {
+        if (this->m_pResults->size() == 0) {
+            this->m_cachedRow = { L"", L"No result", L"" };
+        }
+        else {
+            this->m_cachedRow = this->m_pResults->entry((size_t)index);
+        }
+        this->m_iCachedRow = index;
+    }
+    return this->m_cachedRow;
 }
 
-void CXPathEvalDlg::print_xpath_nodes(std::vector<XPathResultEntryType> nodes) {
+void CXPathEvalDlg::print_xpath_nodes(std::unique_ptr<XPathResultCursor> nodes) {
     CListCtrl* listresults = (CListCtrl*)this->GetDlgItem(IDC_LIST_XPATHRESULTS);
     listresults->DeleteAllItems();
 
-    if (nodes.size() == 0) {
-        AddToList(listresults, "", "No result", "");
-    }
-    else {
-        for (std::vector<XPathResultEntryType>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
-            AddToList(listresults, Report::cstring((*it).type.c_str()),
-                                   Report::cstring((*it).name.c_str()),
-                                   Report::cstring((*it).value.c_str()));
-        }
+    this->m_pResults = std::move(nodes);
+    this->m_iCachedRow = -1;
+
+    // an empty result shows a single "No result" row
+    size_t count = this->m_pResults->size();
+    listresults->SetItemCountEx((int)(count == 0 ? 1 : count));
+}
+
+void CXPathEvalDlg::OnGetDispInfoResults(NMHDR* pNMHDR, LRESULT* pResult) {
+    LVITEMW& item = reinterpret_cast<NMLVDISPINFOW*>(pNMHDR)->item;
+
+    if ((item.mask & LVIF_TEXT) && this->m_pResults) {
+        const XPathResultEntryType& row = this->resultRow(item.iItem);
+        const std::wstring& text = (item.iSubItem == 0) ? row.type : ((item.iSubItem == 1) ? row.name : row.value);
+        wcsncpy_s(item.pszText, item.cchTextMax, text.c_str(), _TRUNCATE);
     }
+
+    *pResult = 0;
 }
 
 BOOL CXPathEvalDlg::OnInitDialog() {
@@ -254,6 +265,16 @@ void CXPathEvalDlg::OnSize(UINT nType, int cx, int cy) {
 }
 
 void CXPathEvalDlg::OnBnClickedBtnCopy2clipboard() {
+  // the text of all the rows is only built when it is copied
+  this->m_sResult.Empty();
+  if (this->m_pResults) {
+    size_t count = this->m_pResults->size();
+    for (size_t i = 0; i < (count == 0 ? 1 : count); ++i) {
+      const XPathResultEntryType& row = this->resultRow((int)i);
+      this->m_sResult.AppendFormat(L"%s\t%s\t%s\n", row.type.c_str(), row.name.c_str(), row.value.c_str());
+    }
+  }
+
   if (this->m_sResult.IsEmpty()) {
     MessageBox(L"Result is empty.");
   } else {
@@ -279,5 +300,7 @@ void CXPathEvalDlg::OnBnClickedBtnCopy2clipboard() {
 void CXPathEvalDlg::OnBnClickedBtnClearlist() {
   CListCtrl *listresults = (CListCtrl*) this->GetDlgItem(IDC_LIST_XPATHRESULTS);
   listresults->DeleteAllItems();
+  this->m_pResults.reset();
+  this->m_iCachedRow = -1;
   this->m_sResult.Empty();
 }
@@ -10,6 +10,7 @@
 #include "PluginInterface.h"
 #include "XmlWrapperInterface.h"
 
+#include <memory>
 #include <string>
 
 /////////////////////////////////////////////////////////////////////////////
@@ -40,10 +41,15 @@ protected:
 protected:
     unsigned long m_iFlags;
 
+    // results of the last evaluation; the list is virtual, its rows are built when it shows them
+    std::unique_ptr<XPathResultCursor> m_pResults;
+    int m_iCachedRow;
+    XPathResultEntryType m_cachedRow;
+
     int execute_xpath_expression(CStringW xpathExpr);
-    void print_xpath_nodes(std::vector<XPathResultEntryType> nodes);
+    void print_xpath_nodes(std::unique_ptr<XPathResultCursor> nodes);
     //int register_namespaces(xmlXPathContextPtr xpathCtx, const xmlChar* nsList);
-    void AddToList(CListCtrl* list, CStringW type, CStringW name, CStringW value);
+    const XPathResultEntryType& resultRow(int index);
 
     HWND getCurrentHScintilla(int which);
 
@@ -52,6 +58,7 @@ protected:
     afx_msg void OnBtnEvaluate();
     virtual BOOL OnInitDialog();
     afx_msg void OnSize(UINT nType, int cx, int cy);
+    afx_msg void OnGetDispInfoResults(NMHDR* pNMHDR, LRESULT* pResult);
     //}}AFX_MSG
     DECLARE_MESSAGE_MAP()
 public:
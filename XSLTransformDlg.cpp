@@ -4,6 +4,7 @@
 #include "StdAfx.h"
 #include "Scintilla.h"
 #include "XMLTools.h"
+#include "nppHelpers.h"
 #include "XSLTransformDlg.h"
 #include "Report.h"
 #include "menuCmdID.h"
@@ -78,17 +79,14 @@ void CXSLTransformDlg::OnBtnTransform() {
     int currentEdit;
     ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTSCINTILLA, 0, (LPARAM)&currentEdit);
     HWND hCurrentEditView = getCurrentHScintilla(currentEdit);
-    
-    size_t currentLength = (size_t) ::SendMessage(hCurrentEditView, SCI_GETLENGTH, 0, 0);
 
-    char* data = new char[currentLength + sizeof(char)];
-    if (!data) return;  // allocation error, abort check
-    memset(data, '\0', currentLength + sizeof(char));
+    // the text and the stylesheet detection come from the parsed document shared with the other commands
+    std::shared_ptr<const ParsedDocument> parsed = currentParsedDocument();
 
-    ::SendMessage(hCurrentEditView, SCI_GETTEXT, currentLength + sizeof(char), reinterpret_cast<LPARAM>(data));
-
-    XmlWrapperInterface* wrapper = new MSXMLWrapper(data, currentLength);
-    delete[] data; data = NULL;
+    MSXMLWrapper* wrapper = new MSXMLWrapper(parsed->text.c_str(), parsed->text.length());
+    if (parsed->document.wellFormed()) {
+        wrapper->setStylesheetHint(parsed->stylesheet);
+    }
 
     XSLTransformResultType res;
     if (wrapper->xslTransform(m_sSelectedFile.GetString(), &res, m_sXSLTOptions.GetString())) {
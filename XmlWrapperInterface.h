@@ -4,6 +4,7 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <memory>
 
 struct XPathResultEntryType {
     std::wstring type;
@@ -11,6 +12,35 @@ struct XPathResultEntryType {
     std::wstring value;
 };
 
+/*
+* Results of an xpath evaluation, read one row at a time: a wrapper which can build the name and
+* value of a row, and their conversion to UTF-16, only when the row is read, so that a list view
+* can show a page of a large result without building all the rows.
+*/
+class XPathResultCursor {
+public:
+    virtual ~XPathResultCursor() {}
+
+    virtual size_t size() = 0;
+
+    // offset of the node in the source, SIZE_MAX when the wrapper does not know it
+    virtual size_t offset(size_t index) = 0;
+
+    virtual XPathResultEntryType entry(size_t index) = 0;
+};
+
+// cursor over results already built
+class XPathResultVectorCursor : public XPathResultCursor {
+    std::vector<XPathResultEntryType> entries;
+
+public:
+    XPathResultVectorCursor(std::vector<XPathResultEntryType> entries) : entries(std::move(entries)) {}
+
+    size_t size() { return this->entries.size(); }
+    size_t offset(size_t index) { return SIZE_MAX; }
+    XPathResultEntryType entry(size_t index) { return this->entries[index]; }
+};
+
 struct XSLTransformResultType {
     std::string data;
     UniMode encoding = UniMode::uniEnd;
@@ -133,6 +163,16 @@ public:
     */
     virtual std::vector<XPathResultEntryType> xpathEvaluate(std::wstring xpath, std::wstring ns = L"") = 0;
 
+    /*
+    * Perform xpath evaluation, building the rows of the result when they are read
+    * @param xpath The expression to be evaluated
+    * @param ns An optional string describing the required namespaces
+    * @return A cursor over the evaluation occurrences, which may outlive the wrapper; by default, over the xpathEvaluate() results
+    */
+    virtual std::unique_ptr<XPathResultCursor> xpathCursor(std::wstring xpath, std::wstring ns = L"") {
+        return std::make_unique<XPathResultVectorCursor>(this->xpathEvaluate(xpath, ns));
+    }
+
     /*
     * Perform xsl transformation
     * @param xslfile The path of XSL transformation stylesheet
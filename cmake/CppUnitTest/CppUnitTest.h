@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+* Stand-in for the Visual Studio "CppUnitTest.h" when the test projects are built with CMake.
+*
+* TEST_CLASS / TEST_METHOD register every method as a GoogleTest test named <class>.<method>, and a
+* failed Assert throws, so the rest of the method is skipped like under the Visual Studio runner.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework {
+    class AssertFailedException : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    class Assert {
+        static std::string narrow(const wchar_t* message) {
+            std::string res;
+            for (; message && *message; ++message) {
+                res += (*message < 0x80) ? (char)*message : '?';
+            }
+            return res;
+        }
+    public:
+        static void IsTrue(bool condition, const wchar_t* message = nullptr) {
+            if (!condition) {
+                throw AssertFailedException("Assert::IsTrue failed. " + narrow(message));
+            }
+        }
+
+        static void IsFalse(bool condition, const wchar_t* message = nullptr) {
+            if (condition) {
+                throw AssertFailedException("Assert::IsFalse failed. " + narrow(message));
+            }
+        }
+
+        template <typename T>
+        static void AreEqual(const T& expected, const T& actual, const wchar_t* message = nullptr) {
+            if (!(expected == actual)) {
+                throw AssertFailedException("Assert::AreEqual failed. " + narrow(message));
+            }
+        }
+
+        template <typename ExpectedException, typename Functor>
+        static void ExpectException(Functor functor, const wchar_t* message = nullptr) {
+            try {
+                functor();
+            }
+            catch (const ExpectedException&) {
+                return;
+            }
+            catch (...) {
+                throw AssertFailedException("Assert::ExpectException failed, another exception was thrown. " + narrow(message));
+            }
+            throw AssertFailedException("Assert::ExpectException failed, no exception was thrown. " + narrow(message));
+        }
+
+        static void Fail(const wchar_t* message = nullptr) {
+            throw AssertFailedException("Assert::Fail. " + narrow(message));
+        }
+    };
+
+    namespace Detail {
+        template <typename TestClass, typename ClassName>
+        class TestBase {
+        protected:
+            using Self = TestClass;
+
+            static const char* testClassName() { return ClassName::get(); }
+
+            static bool registerMethod(const char* className, const char* methodName, const char* file, int line, void (*run)(TestClass&)) {
+                class Method : public ::testing::Test {
+                    void (*run)(TestClass&);
+                public:
+                    Method(void (*run)(TestClass&)) : run(run) {}
+                    void TestBody() override {
+                        TestClass instance;
+                        try {
+                            run(instance);
+                        }
+                        catch (const AssertFailedException& e) {
+                            GTEST_FAIL() << e.what();
+                        }
+                    }
+                };
+                ::testing::RegisterTest(className, methodName, nullptr, nullptr, file, line,
+                    [run]() -> ::testing::Test* { return new Method(run); });
+                return true;
+            }
+        };
+    }
+}}}
+
+#define TEST_CLASS(className) \
+    class className; \
+    struct className##_ClassName { static const char* get() { return #className; } }; \
+    class className : public ::Microsoft::VisualStudio::CppUnitTestFramework::Detail::TestBase<className, className##_ClassName>
+
+// The registration lives in a nested class, whose member functions see the complete test class.
+#define TEST_METHOD(methodName) \
+    struct methodName##_Registration { \
+        methodName##_Registration(const char* className) { \
+            registerMethod(className, #methodName, __FILE__, __LINE__, [](Self& test) { test.methodName(); }); \
+        } \
+    }; \
+    static inline methodName##_Registration methodName##_registration{ testClassName() }; \
+    void methodName()
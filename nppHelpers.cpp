@@ -1,11 +1,40 @@
 #include "StdAfx.h"
 #include "nppHelpers.h"
 #include "XMLTools.h"
+#include "Report.h"
 
 HWND getCurrentHScintilla(int which) {
     return (which == 0) ? nppData._scintillaMainHandle : nppData._scintillaSecondHandle;
 };
 
+DocumentCache documentCache;
+
+// document a Scintilla window edits, as SCN_MODIFIED only gives the window; it can be the hidden
+// one Notepad++ edits the other buffers with
+DocumentCache::DocumentId documentOfView(HWND view) {
+    return (DocumentCache::DocumentId)::SendMessage(view, SCI_GETDOCPOINTER, 0, 0);
+}
+
+std::shared_ptr<const ParsedDocument> currentParsedDocument() {
+    int currentEdit;
+    ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTSCINTILLA, 0, (LPARAM)&currentEdit);
+
+    HWND view = getCurrentHScintilla(currentEdit);
+    ScintillaDoc doc = ScintillaDoc(view);
+    DocumentCache::BufferId buffer = (DocumentCache::BufferId)::SendMessage(nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0);
+
+    std::vector<std::string> identityAttributes;
+    std::wstring temp;
+    std::wstringstream wss(xmltoolsoptions.identityAttributes);
+    while (std::getline(wss, temp, L';')) {
+        if (!temp.empty()) identityAttributes.push_back(Report::ws2s(temp));
+    }
+
+    documentCache.setIdentityAttributes(identityAttributes);
+    documentCache.setCapacity(xmltoolsoptions.documentCacheMB > 0 ? (size_t)xmltoolsoptions.documentCacheMB * 1024 * 1024 : 0);
+    return documentCache.get(buffer, documentOfView(view), doc);
+}
+
 int nbopenfiles1, nbopenfiles2;
 
 int initDocIterator() {
@@ -22,22 +51,25 @@ int initDocIterator() {
     return 0;
 }
 
+// activates the index-th open document, counting the main view first
+static bool activateDoc(int index) {
+    if (index >= 0 && index < nbopenfiles1) {
+        ::SendMessage(nppData._nppHandle, NPPM_ACTIVATEDOC, MAIN_VIEW, index);
+    }
+    else if (index >= nbopenfiles1 && index < nbopenfiles1 + nbopenfiles2) {
+        ::SendMessage(nppData._nppHandle, NPPM_ACTIVATEDOC, SUB_VIEW, index - nbopenfiles1);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
 bool hasNextDoc(int* iter) {
     dbgln("hasNextDoc()");
 
     if (config.doPrettyPrintAllOpenFiles) {
-        if (*iter < 0 || *iter >= (nbopenfiles1 + nbopenfiles2)) return false;
-
-        if (*iter < nbopenfiles1) {
-            ::SendMessage(nppData._nppHandle, NPPM_ACTIVATEDOC, MAIN_VIEW, (*iter));
-        }
-        else if (*iter >= nbopenfiles1 && *iter < nbopenfiles1 + nbopenfiles2) {
-            auto idx = (*iter) - nbopenfiles1;
-            ::SendMessage(nppData._nppHandle, NPPM_ACTIVATEDOC, SUB_VIEW, idx);
-        }
-        else {
-            return false;
-        }
+        if (!activateDoc(*iter)) return false;
 
         ++(*iter);
         return true;
@@ -89,6 +121,57 @@ void nppMultiDocumentCommand(const std::wstring &debugname, void (*action)(Scint
     dbgln(txt);
 }
 
+void nppMultiDocumentCommand(const std::wstring& debugname, DocumentAction<ScintillaDoc>& action) {
+    dbgln(L"+ nppMultiDocumentCommand(\"" + debugname + L"\")");
+
+    auto clock_start = clock();
+
+    initDocIterator();
+    size_t count = config.doPrettyPrintAllOpenFiles ? (size_t)(nbopenfiles1 + nbopenfiles2) : 1;
+
+    // the documents are activated in turn on this thread; with several documents, the action
+    // collects all texts first, processes them on a pool of threads, then applies the results
+    DocumentAccess<ScintillaDoc> access = [](size_t index, const std::function<void(ScintillaDoc&)>& fn) {
+        if (config.doPrettyPrintAllOpenFiles && !activateDoc((int)index))
+            return;
+
+        int currentEdit;
+        ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTSCINTILLA, 0, (LPARAM)&currentEdit);
+
+        ScintillaDoc doc = ScintillaDoc(getCurrentHScintilla(currentEdit));
+
+        if (doc.IsReadOnly())
+            return;
+
+        fn(doc);
+    };
+
+    auto applied = [](size_t, ScintillaDoc& doc, const DocumentAction<ScintillaDoc>::Task& task) {
+        wchar_t filename[MAX_PATH]{ 0 };
+        ::SendMessage(nppData._nppHandle, NPPM_GETFILENAME, MAX_PATH, (LPARAM)filename);
+
+        std::wstring txt;
+        txt = txt + filename + L" => " + Report::widen(task.log.c_str()) + L", time taken: " + std::to_wstring((long)task.milliseconds) + L" ms";
+        dbgln(txt, DBG_LEVEL::DBG_INFO);
+
+        // Put scroll at the left of the view
+        doc.SetXOffset(0);
+    };
+
+    try {
+        runDocumentAction<ScintillaDoc>(action, count, access, std::thread::hardware_concurrency(), applied);
+    }
+    catch (const std::exception& e) {
+        Report::_printf_err(Report::widen(e.what()));
+    }
+
+    auto clock_end = clock();
+
+    std::wstring txt;
+    txt = txt + L"- nppMultiDocumentCommand(\"" + debugname + L"\") => time taken: " + std::to_wstring(clock_end - clock_start) + L" ms";
+    dbgln(txt);
+}
+
 void nppDocumentCommand(const std::wstring& debugname, void (*action)(ScintillaDoc&)) {
     dbgln(L"+ nppDocumentCommand(\"" + debugname + L"\")");
 
@@ -8,5 +8,14 @@ extern NppData nppData;
 extern HWND getCurrentHScintilla(int which);
 
 #include "ScintillaDoc.h"
+#include "DocumentAction.h"
+#include "DocumentCache.h"
+
+// parsed documents shared by the XPath, validation and XSLT commands, see DocumentCache.h
+extern DocumentCache documentCache;
+DocumentCache::DocumentId documentOfView(HWND view);
+std::shared_ptr<const ParsedDocument> currentParsedDocument();
+
 void nppMultiDocumentCommand(const std::wstring &debugname, void (*action)(ScintillaDoc&));
+void nppMultiDocumentCommand(const std::wstring& debugname, DocumentAction<ScintillaDoc>& action);
 void nppDocumentCommand(const std::wstring& debugname, void (*action)(ScintillaDoc&));
\ No newline at end of file